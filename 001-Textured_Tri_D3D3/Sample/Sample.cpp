@@ -10,6 +10,11 @@
 #include <d3dtypes.h>
 #include <d3dcaps.h>
 
+#include <string.h>
+
+#include "Trace.h"
+#include "D3DStateFilter.h"
+
 #pragma comment (lib, "ddraw.lib")
 #pragma comment (lib, "dxguid.lib")
 
@@ -19,6 +24,10 @@ LPDIRECTDRAWSURFACE4 g_pDdsPrimary    = NULL;
 LPDIRECTDRAWSURFACE4 g_pDdsBackBuffer = NULL;
 LPDIRECT3D3          g_pD3D           = NULL;
 LPDIRECT3DDEVICE3    g_pD3dDevice     = NULL;
+//state calls go through the filter, it drops the calls that change nothing
+CD3D3StateFilter     g_StateFilter;
+//the states of the scene, Render_Scene() sets them in one call
+state_block          g_SceneStates;
 LPDIRECT3DVIEWPORT3  g_pViewport     = NULL;
 RECT                 g_RcScreenRect;
 RECT                 g_RcViewportRect;
@@ -82,6 +91,8 @@ HRESULT CALLBACK Texture_Search_Callback( DDPIXELFORMAT* pddpf, VOID* param )
 
 LPDIRECT3DTEXTURE2 Get_Texture(char *szFilename)
 {
+	TRACE_SCOPE("Get_Texture");
+
 	HRESULT hr;
 	LPDIRECT3DTEXTURE2 FloorTexture  = NULL;
 	LPDIRECTDRAWSURFACE4 TexSurface = NULL;
@@ -179,6 +190,8 @@ vector3 Vec3_Cross(vector3 v1, vector3 v2)
 
 HRESULT Initialize_3DEnvironment()
 {
+	TRACE_SCOPE("Initialize_3DEnvironment");
+
 	HRESULT hr;
 
     //-------------------------------------------------------------------------
@@ -299,6 +312,8 @@ HRESULT Initialize_3DEnvironment()
 	if( FAILED( hr ) )
 		return hr;
 
+	g_StateFilter.Attach( g_pD3dDevice );
+
 	    //-------------------------------------------------------------------------
 	// Step 4: Create the viewport
     //-------------------------------------------------------------------------
@@ -335,6 +350,8 @@ HRESULT Initialize_3DEnvironment()
 
 void Init_Scene()
 {
+	TRACE_SCOPE("Init_Scene");
+
 	//MATRIX WORLD
 	D3DMATRIX MatWorld = {
 		1.0,	0.0,	0.0,	0.0,
@@ -387,9 +404,13 @@ void Init_Scene()
 		0.0,	0.0,	Q,				1.0,
 		0.0,	0.0,	-Q * fZNear,	0.0 };
 
-	g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_WORLD, &MatWorld );
-    g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_VIEW,       &MatView );
-    g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_PROJECTION, &MatProj );
+	g_StateFilter.SetTransform( D3DTRANSFORMSTATE_WORLD, &MatWorld );
+    g_StateFilter.SetTransform( D3DTRANSFORMSTATE_VIEW,       &MatView );
+    g_StateFilter.SetTransform( D3DTRANSFORMSTATE_PROJECTION, &MatProj );
+
+	State_Block_Init( &g_SceneStates );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
 
 	g_pCubeTexture = Get_Texture("texture256.bmp");
 }
@@ -403,6 +424,8 @@ VOID On_Move(int x, int y)
 
 HRESULT Render_Scene()
 {
+	TRACE_SCOPE("Render_Scene");
+
 	HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_RcViewportRect, D3DCLEAR_TARGET,
 		                0x00ffffff, 1.0f, 0L );
 	if(FAILED( hr))
@@ -415,10 +438,9 @@ HRESULT Render_Scene()
         return S_OK;
     }
 
-	g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
-    g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
+	g_StateFilter.Apply( &g_SceneStates );
 
-    g_pD3dDevice->SetTexture( 0, g_pCubeTexture );
+    g_StateFilter.SetTexture( 0, g_pCubeTexture );
 
 	if( FAILED( g_pD3dDevice->DrawPrimitive( D3DPT_TRIANGLELIST, D3DFVF_VERTEX, 
                                &g_VertBuff, 3, NULL ) ) )
@@ -431,8 +453,12 @@ HRESULT Render_Scene()
 
 	//   On_Move()
 	//       
-	g_pDdsPrimary->Blt( &g_RcScreenRect, g_pDdsBackBuffer, 
-                               &g_RcViewportRect, DDBLT_WAIT, NULL );
+	{
+		TRACE_SCOPE("Present");
+
+		g_pDdsPrimary->Blt( &g_RcScreenRect, g_pDdsBackBuffer, 
+			&g_RcViewportRect, DDBLT_WAIT, NULL );
+	}
 
 	return S_OK;
 
@@ -449,6 +475,12 @@ void Destroy_App()
 
 	if(g_pD3dDevice)
 	{
+		//calls the filter saved, in the output window of the debugger
+		char szText[256];
+		State_Cache_Format(g_StateFilter.Cache(), szText, sizeof(szText));
+		OutputDebugString(szText);
+		OutputDebugString("\n");
+
 		g_pD3dDevice->Release();
 		g_pD3dDevice = NULL;
 	}
@@ -504,6 +536,11 @@ LRESULT CALLBACK WndProc(HWND g_hWnd,
 			// used for blitting the backbuffer to the primary.
 			On_Move( (SHORT)LOWORD(lParam), (SHORT)HIWORD(lParam) );
             break;
+		case WM_KEYDOWN:
+			//F11 pauses and resumes the trace started with -trace
+			if(wParam == VK_F11)
+				Trace_Enable(!g_TraceEnabled);
+			break;
 
 		default:
 			return DefWindowProc(g_hWnd, uMsg, wParam, lParam);
@@ -519,7 +556,6 @@ int PASCAL WinMain(HINSTANCE hInstance,
 					int nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
 
 	WNDCLASS wcl;
 	wcl.style = CS_HREDRAW | CS_VREDRAW;
@@ -558,6 +594,11 @@ int PASCAL WinMain(HINSTANCE hInstance,
 	ShowWindow(g_hWnd, nCmdShow);
 	UpdateWindow(g_hWnd);
 
+	//Sample.exe -trace writes trace.json, open it in
+	//chrome about://tracing or ui.perfetto.dev
+	if(strstr(lpCmdLine, "-trace"))
+		Trace_Init("trace.json");
+
 	Initialize_3DEnvironment();
 
 	Init_Scene();
@@ -582,6 +623,8 @@ int PASCAL WinMain(HINSTANCE hInstance,
 
 	Destroy_App();
 
+	Trace_Shutdown();
+
 	DestroyWindow(g_hWnd);
 	UnregisterClass(wcl.lpszClassName, wcl.hInstance);
 
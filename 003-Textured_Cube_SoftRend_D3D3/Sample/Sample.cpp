@@ -10,18 +10,28 @@
 #include <d3dtypes.h>
 #include <d3dcaps.h>
 
+#include <string.h>
+
+#include "Trace.h"
+#include "D3DStateFilter.h"
+#include "Math3D.h"
+#include "VertexBuffer.h"
+#include "FrameScheduler.h"
+#include "DirtyRect.h"
+
 #pragma comment (lib, "ddraw.lib")
 #pragma comment (lib, "dxguid.lib")
 
-#define PI 3.14159265358979f
-#define PI2 (PI * 2.0f)
-
 LPDIRECTDRAW         g_pDD1           = NULL;
 LPDIRECTDRAW4        g_pDD4           = NULL;
 LPDIRECTDRAWSURFACE4 g_pDdsPrimary    = NULL;
 LPDIRECTDRAWSURFACE4 g_pDdsBackBuffer = NULL;
 LPDIRECT3D3          g_pD3D           = NULL;
 LPDIRECT3DDEVICE3    g_pD3dDevice     = NULL;
+//state calls go through the filter, it drops the calls that change nothing
+CD3D3StateFilter     g_StateFilter;
+//the states of the scene, Render_Scene() sets them in one call
+state_block          g_SceneStates;
 LPDIRECT3DVIEWPORT3  g_pViewport     = NULL;
 RECT                 g_RcScreenRect;
 RECT                 g_RcViewportRect;
@@ -29,30 +39,14 @@ LPDIRECT3DTEXTURE2   g_pCubeTexture  = NULL;
 
 HWND g_hWnd;
 
-//matrix offset
-enum {	M00, M01, M02, M03,
-		M10, M11, M12, M13,
-		M20, M21, M22, M23,
-		M30, M31, M32, M33	};
-
-struct matrix4x4
-{
-	matrix4x4(){};
-
-	float Mat[16];
+//the cube turns once in 10 seconds, whatever the frame rate is
+#define SPIN_SPEED (PI2 / 10.0f)
 
-	matrix4x4(float IR0C0, float IR0C1, float IR0C2, float IR0C3,
-			float IR1C0, float IR1C1, float IR1C2, float IR1C3,
-			float IR2C0, float IR2C1, float IR2C2, float IR2C3,
-			float IR3C0, float IR3C1, float IR3C2, float IR3C3)
-	{
-		Mat[M00] = IR0C0;	Mat[M01] = IR0C1;	Mat[M02] = IR0C2;	Mat[M03] = IR0C3;
-		Mat[M10] = IR1C0;	Mat[M11] = IR1C1;	Mat[M12] = IR1C2;	Mat[M13] = IR1C3;
-		Mat[M20] = IR2C0;	Mat[M21] = IR2C1;	Mat[M22] = IR2C2;	Mat[M23] = IR2C3;
-		Mat[M30] = IR3C0;	Mat[M31] = IR3C1;	Mat[M32] = IR3C2;	Mat[M33] = IR3C3;
-	}
-	
-};
+//the simulation moves in ticks of 1 / SCHED_TICKS_PER_SECOND seconds,
+//the frames are drawn between the angles of the last two ticks
+frame_scheduler g_Scheduler;
+float g_Angle = 0.0f;
+float g_PrevAngle = 0.0f;
 
 matrix4x4 g_MatWorld;
 matrix4x4 g_MatView;
@@ -60,39 +54,47 @@ matrix4x4 g_MatProj;
 
 //  24 ,   , 12 
 //  
-struct vector4
+struct vertex
 {
-        float x,y,z,rhw; 
-		float tu, tv; 
-}; 
-
-vector4 g_VertBuffTransformed[24];
-
-vector4 g_VertBuff[24] = {
--5.000000,-5.000000,-5.000000,	1.0, 	1.0,1.0,
--5.000000,-5.000000,5.000000,	1.0, 	1.0,0.0,
-5.000000,-5.000000,5.000000,	1.0, 	0.0,0.0,
-5.000000,-5.000000,-5.000000,	1.0, 	0.0,1.0,
--5.000000,5.000000,-5.000000,	1.0, 	0.0,1.0,
-5.000000,5.000000,-5.000000,	1.0, 	1.0,1.0,
-5.000000,5.000000,5.000000,		1.0, 	1.0,0.0,
--5.000000,5.000000,5.000000,	1.0, 	0.0,0.0,
--5.000000,-5.000000,-5.000000,	1.0, 	0.0,1.0,
-5.000000,-5.000000,-5.000000,	1.0, 	1.0,1.0,
-5.000000,5.000000,-5.000000,	1.0, 	1.0,0.0,
--5.000000,5.000000,-5.000000,	1.0, 	0.0,0.0,
-5.000000,-5.000000,-5.000000,	1.0, 	0.0,1.0,
-5.000000,-5.000000,5.000000,	1.0, 	1.0,1.0,
-5.000000,5.000000,5.000000,		1.0, 	1.0,0.0,
-5.000000,5.000000,-5.000000,	1.0, 	0.0,0.0,
-5.000000,-5.000000,5.000000,	1.0, 	0.0,1.0,
--5.000000,-5.000000,5.000000,	1.0, 	1.0,1.0,
--5.000000,5.000000,5.000000,	1.0, 	1.0,0.0,
-5.000000,5.000000,5.000000,		1.0, 	0.0,0.0,
--5.000000,-5.000000,5.000000,	1.0, 	0.0,1.0,
--5.000000,-5.000000,-5.000000,	1.0, 	1.0,1.0,
--5.000000,5.000000,-5.000000,	1.0, 	1.0,0.0,
--5.000000,5.000000,5.000000,	1.0, 	0.0,0.0 };
+	float x, y, z;
+	float tu, tv;
+};
+
+//the cube in a vertex buffer and its screen space copy, Update_Scene()
+//transforms the cube into g_pTLVB like ProcessVertices() of DirectX 6,
+//the vertices are transformed again only when the matrices change
+vertex_buffer *g_pCubeVB = NULL;
+vertex_buffer *g_pTLVB = NULL;
+
+//only the part of the frame the cube covers now or covered in the last
+//frame is cleared and copied to the screen, the bounds come from g_pTLVB
+dirty_rect g_Dirty;
+
+vertex g_VertBuff[24] = {
+-5.000000,-5.000000,-5.000000,	1.0,1.0,
+-5.000000,-5.000000,5.000000,	1.0,0.0,
+5.000000,-5.000000,5.000000,	0.0,0.0,
+5.000000,-5.000000,-5.000000,	0.0,1.0,
+-5.000000,5.000000,-5.000000,	0.0,1.0,
+5.000000,5.000000,-5.000000,	1.0,1.0,
+5.000000,5.000000,5.000000,		1.0,0.0,
+-5.000000,5.000000,5.000000,	0.0,0.0,
+-5.000000,-5.000000,-5.000000,	0.0,1.0,
+5.000000,-5.000000,-5.000000,	1.0,1.0,
+5.000000,5.000000,-5.000000,	1.0,0.0,
+-5.000000,5.000000,-5.000000,	0.0,0.0,
+5.000000,-5.000000,-5.000000,	0.0,1.0,
+5.000000,-5.000000,5.000000,	1.0,1.0,
+5.000000,5.000000,5.000000,		1.0,0.0,
+5.000000,5.000000,-5.000000,	0.0,0.0,
+5.000000,-5.000000,5.000000,	0.0,1.0,
+-5.000000,-5.000000,5.000000,	1.0,1.0,
+-5.000000,5.000000,5.000000,	1.0,0.0,
+5.000000,5.000000,5.000000,		0.0,0.0,
+-5.000000,-5.000000,5.000000,	0.0,1.0,
+-5.000000,-5.000000,-5.000000,	1.0,1.0,
+-5.000000,5.000000,-5.000000,	1.0,0.0,
+-5.000000,5.000000,5.000000,	0.0,0.0 };
 
 WORD g_IndexBuff[36] = {
 		0,2,1, 		// 1 triangle
@@ -129,6 +131,8 @@ HRESULT CALLBACK Texture_Search_Callback( DDPIXELFORMAT* pddpf, VOID* param )
 
 LPDIRECT3DTEXTURE2 Get_Texture(char *szFilename)
 {
+	TRACE_SCOPE("Get_Texture");
+
 	HRESULT hr;
 	LPDIRECT3DTEXTURE2 FloorTexture  = NULL;
 	LPDIRECTDRAWSURFACE4 TexSurface = NULL;
@@ -203,29 +207,10 @@ LPDIRECT3DTEXTURE2 Get_Texture(char *szFilename)
 	return FloorTexture;
 }
 
-float Vec3_Dot(vector4 v1, vector4 v2)
-{
-	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
-}
-
-vector4 Vec3_Normalize(vector4 v)
-{
-	float len = sqrtf((v.x * v.x) + (v.y * v.y) + (v.z * v.z));
-	vector4 t = { v.x / len, v.y / len, v.z / len };
-	return t;
-}
-
-vector4 Vec3_Cross(vector4 v1, vector4 v2)
-{
-	vector4 t = { v1.y * v2.z - v1.z * v2.y,
-			v1.z * v2.x - v1.x * v2.z,
-			v1.x * v2.y - v1.y * v2.x };
-
-	return t;
-}
-
 HRESULT Initialize_3DEnvironment()
 {
+	TRACE_SCOPE("Initialize_3DEnvironment");
+
 	HRESULT hr;
 
     //-------------------------------------------------------------------------
@@ -346,6 +331,8 @@ HRESULT Initialize_3DEnvironment()
 	if( FAILED( hr ) )
 		return hr;
 
+	g_StateFilter.Attach( g_pD3dDevice );
+
 	    //-------------------------------------------------------------------------
 	// Step 4: Create the viewport
     //-------------------------------------------------------------------------
@@ -380,86 +367,38 @@ HRESULT Initialize_3DEnvironment()
 	return hr;
 }
 
-vector4 Vec4_Mat4x4_Mul(vector4& VecIn, matrix4x4 &MatIn)
-{
-	vector4 VecOut;
-
-	VecOut.x =	VecIn.x * MatIn.Mat[M00] +
-				VecIn.y * MatIn.Mat[M10] +
-				VecIn.z * MatIn.Mat[M20] +
-				VecIn.rhw * MatIn.Mat[M30];
-
-	VecOut.y =	VecIn.x * MatIn.Mat[M01] +
-				VecIn.y * MatIn.Mat[M11] +
-				VecIn.z * MatIn.Mat[M21] +
-				VecIn.rhw * MatIn.Mat[M31];
-
-	VecOut.z =	VecIn.x * MatIn.Mat[M02] +
-				VecIn.y * MatIn.Mat[M12] +
-				VecIn.z * MatIn.Mat[M22] +
-				VecIn.rhw * MatIn.Mat[M32];
-
-	VecOut.rhw = VecIn.x * MatIn.Mat[M03] +
-				VecIn.y * MatIn.Mat[M13] +
-				VecIn.z * MatIn.Mat[M23] +
-				VecIn.rhw * MatIn.Mat[M33];
-
-	VecOut.tu = VecIn.tu;
-	VecOut.tv = VecIn.tv;
-
-	return VecOut;
-}
-
 void Init_Scene()
 {
-		//MATRIX VIEW CALCULATION
-	vector4 VecRight = { 1.0f, 0.0f, 0.0 };
-	vector4 VecUp = { 0.0f, 1.0f, 0.0f }; 
-	vector4 VecCamPos = { 0.0f, 0.0f, -15.0f };
-	vector4 VecLook = { -1.0f * VecCamPos.x, -1.0f * VecCamPos.y, -1.0f * VecCamPos.z };
-	
-	VecLook = Vec3_Normalize(VecLook);
+	TRACE_SCOPE("Init_Scene");
 
-	VecUp = Vec3_Cross(VecLook, VecRight);
-	VecUp = Vec3_Normalize(VecUp);
-	VecRight = Vec3_Cross(VecUp, VecLook);
-	VecRight = Vec3_Normalize(VecRight);
-
-	float xp = -Vec3_Dot(VecCamPos, VecRight);
-	float yp = -Vec3_Dot(VecCamPos, VecUp);
-	float zp = -Vec3_Dot(VecCamPos, VecLook);
-	
-	g_MatView = matrix4x4 (
-		VecRight.x,	VecUp.x,	VecLook.x,	0.0,
-		VecRight.y,	VecUp.y,	VecLook.y,	0.0,
-		VecRight.z,	VecUp.z,	VecLook.z,	0.0,
-		xp,			yp,			zp,			1.0 );
+	//MATRIX VIEW CALCULATION
+	vector3 VecCamPos = { 0.0f, 0.0f, -15.0f };
+	g_MatView = Mat4x4_View(VecCamPos);
 
 	//MATRIX PROJECTION CALCULATION
 	RECT rc;
 	GetClientRect(g_hWnd, &rc);
 
-	float fFov = PI / 2.0f; // FOV 90 degree
-	float fAspect = (float)rc.right / (float)rc.bottom;
-	float fZFar = 100.0f;
-	float fZNear = 1.0f;
+	// FOV 90 degree
+	g_MatProj = Mat4x4_Projection(PI / 2.0f, (float)rc.right / (float)rc.bottom, 1.0f, 100.0f);
 
-	float    h, w, Q;
+	Dirty_Init(&g_Dirty, (DWORD)rc.right, (DWORD)rc.bottom, DIRTY_MAX_PERCENT);
 
-	w = (1.0f / tanf(fFov * 0.5f)) / fAspect;
-	h = 1.0f / tanf(fFov * 0.5f);
-	Q = fZFar / (fZFar - fZNear);
+	//the cube goes once into the vertex buffer
+	g_pCubeVB = Vertex_Buffer_Create(D3DFVF_XYZ | D3DFVF_TEX1, 24);
+	g_pTLVB = Vertex_Buffer_Create(D3DFVF_XYZRHW | D3DFVF_TEX1, 24);
+	if(!g_pCubeVB || !g_pTLVB)
+		return;
 
-	g_MatProj = matrix4x4 (
-		w,		0.0,	0.0,			0.0,
-		0.0,	h,		0.0,			0.0,
-		0.0,	0.0,	Q,				1.0,
-		0.0,	0.0,	-Q * fZNear,	0.0 );
+	memcpy(Vertex_Buffer_Lock(g_pCubeVB, 0, 24), g_VertBuff, sizeof(g_VertBuff));
 
 	//  
 	//    
-	g_pD3dDevice->SetRenderState(D3DRENDERSTATE_CULLMODE, D3DCULL_CCW);
-	g_pD3dDevice->SetRenderState(D3DRENDERSTATE_TEXTUREPERSPECTIVE, true);
+	State_Block_Init( &g_SceneStates );
+	State_Block_Render( &g_SceneStates, D3DRENDERSTATE_CULLMODE, D3DCULL_CCW );
+	State_Block_Render( &g_SceneStates, D3DRENDERSTATE_TEXTUREPERSPECTIVE, true );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
 
 	g_pCubeTexture = Get_Texture("texture24.bmp");
 }
@@ -469,23 +408,36 @@ VOID On_Move(int x, int y)
 	DWORD dwWidth  = g_RcScreenRect.right - g_RcScreenRect.left;
 	DWORD dwHeight = g_RcScreenRect.bottom - g_RcScreenRect.top;
     SetRect( &g_RcScreenRect, x, y, x + dwWidth, y + dwHeight );
+
+	//the screen under the new place has none of the frame
+	Dirty_Invalidate( &g_Dirty );
+}
+
+//one step of the simulation
+void Tick_Scene()
+{
+	g_PrevAngle = g_Angle;
+	g_Angle += SPIN_SPEED / (float)SCHED_TICKS_PER_SECOND;
+
+	if(g_Angle > PI2)
+	{
+		g_Angle -= PI2;
+		g_PrevAngle -= PI2;
+	}
 }
 
-void Update_Scene()
+void Update_Scene(float fAlpha)
 {
-	float static Angle = 0.0f;
+	TRACE_SCOPE("Update_Scene");
+
+	float Angle = g_PrevAngle + (g_Angle - g_PrevAngle) * fAlpha;
 
 	//MATRIX WORLD
 	//   Y
-	g_MatWorld = matrix4x4 (
-		cosf(Angle),	0.0,	-sinf(Angle),	0.0,
-		0.0,			1.0,	0.0,			0.0,
-		sinf(Angle),	0.0,	cosf(Angle),	0.0,
-		0.0,			0.0,	0.0,			1.0 );
+	g_MatWorld = Mat4x4_Rotation_Y(Angle);
 
-	Angle += PI / 10000.0f;
-	if(Angle > PI2)
-		Angle = 0.0f;
+	if(!g_pCubeVB || !g_pTLVB)
+		return;
 
 	RECT rc;
 	GetClientRect(g_hWnd, &rc);
@@ -493,28 +445,27 @@ void Update_Scene()
 	//  24 
 	//      (   Y)
 	//     
-	for ( int i = 0; i < 24; i++ )
-	{
-		vector4 VecTemp = Vec4_Mat4x4_Mul(g_VertBuff[i], g_MatWorld);
-		VecTemp = Vec4_Mat4x4_Mul(VecTemp, g_MatView);
-		VecTemp = Vec4_Mat4x4_Mul(VecTemp, g_MatProj);
-			
-		VecTemp.x = VecTemp.x / VecTemp.rhw;
-		VecTemp.y = VecTemp.y / VecTemp.rhw;
-		VecTemp.z = VecTemp.z / VecTemp.rhw;
-		VecTemp.rhw = 1.0f / VecTemp.rhw;
-
-		VecTemp.x = VecTemp.x * rc.right / 2.0f + rc.right / 2.0f;
-		VecTemp.y = -VecTemp.y * rc.bottom / 2.0f + rc.bottom / 2.0f;
-
-		g_VertBuffTransformed[i] = VecTemp;
-	}
+	//the same as ProcessVertices() of the DirectX 6 vertex buffer,
+	//nothing is transformed while the matrices stay the same
+	matrix4x4 MatWVP = Mat4x4_Mul(Mat4x4_Mul(g_MatWorld, g_MatView), g_MatProj);
+	vb_viewport Viewport = { 0, 0, (DWORD)rc.right, (DWORD)rc.bottom };
+
+	Vertex_Buffer_Process(g_pTLVB, 0, 24, g_pCubeVB, 0, &MatWVP, &Viewport);
 }
 
 HRESULT Render_Scene()
 {
+	TRACE_SCOPE("Render_Scene");
+
 	
-	HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_RcViewportRect, D3DCLEAR_TARGET,
+	RECT RcClear;
+	if( !Dirty_Clear_Rect( &g_Dirty, &RcClear ) )
+		RcClear = g_RcViewportRect;
+
+	//nothing to clear, Clear2() does not take an empty rectangle
+	HRESULT hr = S_OK;
+	if( !Rect_Is_Empty( &RcClear ) )
+		hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&RcClear, D3DCLEAR_TARGET,
 		                0x00ffffff, 1.0f, 0L );
 	if(FAILED( hr))
 		return E_FAIL;
@@ -526,13 +477,12 @@ HRESULT Render_Scene()
         return S_OK;
     }
 
-	g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
-    g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
+	g_StateFilter.Apply( &g_SceneStates );
 
-    g_pD3dDevice->SetTexture( 0, g_pCubeTexture );
+    g_StateFilter.SetTexture( 0, g_pCubeTexture );
 
-	if( FAILED( g_pD3dDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, D3DFVF_XYZRHW | D3DFVF_TEX1, 
-                               g_VertBuffTransformed, 24,
+	if( g_pTLVB && FAILED( g_pD3dDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, D3DFVF_XYZRHW | D3DFVF_TEX1, 
+                               (LPVOID)Vertex_Buffer_Data(g_pTLVB), 24,
 							   g_IndexBuff, 36, NULL ) ) )
 
     {
@@ -542,10 +492,30 @@ HRESULT Render_Scene()
 	// End the scene.
     g_pD3dDevice->EndScene();
 
+	//XYZRHW and one pair of texture coordinates
+	RECT RcDrawn = { 0, 0, 0, 0 };
+	if( g_pTLVB )
+		RcDrawn = Rect_Of_Vertices( Vertex_Buffer_Data(g_pTLVB), 24, 6 * sizeof(float) );
+
+	RECT RcPresent;
+	if( !Dirty_End_Frame( &g_Dirty, &RcDrawn, &RcPresent ) )
+		RcPresent = g_RcViewportRect;
+
+	if( Rect_Is_Empty( &RcPresent ) )
+		return S_OK;
+
 	//   On_Move()
 	//       
-	g_pDdsPrimary->Blt( &g_RcScreenRect, g_pDdsBackBuffer, 
-                               &g_RcViewportRect, DDBLT_WAIT, NULL );
+	{
+		TRACE_SCOPE("Present");
+
+		//the same part of the window, the viewport starts at 0, 0
+		RECT RcDest = RcPresent;
+		OffsetRect( &RcDest, g_RcScreenRect.left, g_RcScreenRect.top );
+
+		g_pDdsPrimary->Blt( &RcDest, g_pDdsBackBuffer, 
+			&RcPresent, DDBLT_WAIT, NULL );
+	}
 
 	return S_OK;
 
@@ -562,6 +532,12 @@ void Destroy_App()
 
 	if(g_pD3dDevice)
 	{
+		//calls the filter saved, in the output window of the debugger
+		char szText[256];
+		State_Cache_Format(g_StateFilter.Cache(), szText, sizeof(szText));
+		OutputDebugString(szText);
+		OutputDebugString("\n");
+
 		g_pD3dDevice->Release();
 		g_pD3dDevice = NULL;
 	}
@@ -572,6 +548,18 @@ void Destroy_App()
 		g_pCubeTexture = NULL;
 	}
 
+	if(g_pTLVB)
+	{
+		Vertex_Buffer_Destroy(g_pTLVB);
+		g_pTLVB = NULL;
+	}
+
+	if(g_pCubeVB)
+	{
+		Vertex_Buffer_Destroy(g_pCubeVB);
+		g_pCubeVB = NULL;
+	}
+
 	if(g_pDdsBackBuffer)
 	{
 		g_pDdsBackBuffer->Release();
@@ -617,6 +605,17 @@ LRESULT CALLBACK WndProc(HWND g_hWnd,
 			// used for blitting the backbuffer to the primary.
 			On_Move( (SHORT)LOWORD(lParam), (SHORT)HIWORD(lParam) );
             break;
+		case WM_PAINT:
+			//a window uncovered a part of the frame, the next one is copied whole
+			Dirty_Invalidate( &g_Dirty );
+			Scheduler_Invalidate( &g_Scheduler );
+			ValidateRect( g_hWnd, NULL );
+			break;
+		case WM_KEYDOWN:
+			//F11 pauses and resumes the trace started with -trace
+			if(wParam == VK_F11)
+				Trace_Enable(!g_TraceEnabled);
+			break;
 
 		default:
 			return DefWindowProc(g_hWnd, uMsg, wParam, lParam);
@@ -632,7 +631,6 @@ int PASCAL WinMain(HINSTANCE hInstance,
 					int nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
 
 	WNDCLASS wcl;
 	wcl.style = CS_HREDRAW | CS_VREDRAW;
@@ -671,10 +669,21 @@ int PASCAL WinMain(HINSTANCE hInstance,
 	ShowWindow(g_hWnd, nCmdShow);
 	UpdateWindow(g_hWnd);
 
+	//Sample.exe -trace writes trace.json, open it in
+	//chrome about://tracing or ui.perfetto.dev
+	if(strstr(lpCmdLine, "-trace"))
+		Trace_Init("trace.json");
+
 	Initialize_3DEnvironment();
 
 	Init_Scene();
 
+	//Sample.exe -fps 30 draws at most 30 frames per second, Sample.exe -onchange
+	//draws only when the cube has moved, both sleep between the frames
+	DWORD dwMode, dwMaxFps;
+	Scheduler_Parse_Options(lpCmdLine, &dwMode, &dwMaxFps);
+	Scheduler_Init(&g_Scheduler, SCHED_TICKS_PER_SECOND, dwMode, dwMaxFps);
+
 	MSG msg;
 
 	while(true)
@@ -685,17 +694,35 @@ int PASCAL WinMain(HINSTANCE hInstance,
 				break;
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			continue;
 		}
 
 		if(GetKeyState(VK_ESCAPE) & 0xFF00)
 			break;
 
-		Update_Scene();
-		Render_Scene();
+		DWORD dwTicks = Scheduler_Update(&g_Scheduler);
+		for(DWORD i = 0; i < dwTicks; i++)
+			Tick_Scene();
+
+		if(Scheduler_Should_Render(&g_Scheduler))
+		{
+			Update_Scene(Scheduler_Alpha(&g_Scheduler));
+			Render_Scene();
+			Scheduler_Frame_Done(&g_Scheduler);
+		}
+		else
+		{
+			//nothing to draw yet, sleep until a message comes or a frame is due
+			MsgWaitForMultipleObjects(0, NULL, FALSE, Scheduler_Wait_Ms(&g_Scheduler), QS_ALLINPUT);
+		}
 	}
 
+	Scheduler_Shutdown(&g_Scheduler);
+
 	Destroy_App();
 
+	Trace_Shutdown();
+
 	DestroyWindow(g_hWnd);
 	UnregisterClass(wcl.lpszClassName, wcl.hInstance);
 
@@ -10,6 +10,14 @@
 #include <d3dtypes.h>
 #include <d3dcaps.h>
 
+#include <string.h>
+
+#include "Trace.h"
+#include "D3DStateFilter.h"
+#include "FrameScheduler.h"
+#include "Presenter.h"
+#include "DynamicRes.h"
+
 #pragma comment (lib, "ddraw.lib")
 #pragma comment (lib, "dxguid.lib")
 
@@ -18,18 +26,37 @@
 
 LPDIRECTDRAW         g_pDD1           = NULL;
 LPDIRECTDRAW4        g_pDD4           = NULL;
-LPDIRECTDRAWSURFACE4 g_pDdsPrimary    = NULL;
-LPDIRECTDRAWSURFACE4 g_pDdsBackBuffer = NULL;
+//primary and back buffer: a window, a fullscreen flip chain or no display
+presenter            g_Presenter;
+present_options      g_PresentOptions;
 LPDIRECT3D3          g_pD3D           = NULL;
 LPDIRECT3DDEVICE3    g_pD3dDevice     = NULL;
+//state calls go through the filter, it drops the calls that change nothing
+CD3D3StateFilter     g_StateFilter;
+//the states of the scene, Render_Scene() sets them in one call
+state_block          g_SceneStates;
 LPDIRECT3DVIEWPORT3  g_pViewport     = NULL;
-RECT                 g_RcScreenRect;
-RECT                 g_RcViewportRect;
 LPDIRECT3DTEXTURE2	 g_pCubeTexture  = NULL;
 LPDIRECTDRAWSURFACE4 g_pDdsZBuffer = NULL;
+//found once, a resize makes the new Z buffer with it
+DDPIXELFORMAT        g_ddpfZBuffer;
 
 HWND g_hWnd;
 
+//the cube turns once in 10 seconds, whatever the frame rate is
+#define SPIN_SPEED (PI2 / 10.0f)
+
+//the simulation moves in ticks of 1 / SCHED_TICKS_PER_SECOND seconds,
+//the frames are drawn between the angles of the last two ticks
+frame_scheduler g_Scheduler;
+
+//Sample.exe -dynres 16.6 draws into a smaller part of the back buffer
+//when the frames take longer than 16.6 ms, the present stretches it
+dynamic_res g_DynRes;
+bool g_bDynRes = false;
+float g_Angle = 0.0f;
+float g_PrevAngle = 0.0f;
+
 struct vector3
 {
 	float x,y,z;
@@ -110,6 +137,8 @@ HRESULT CALLBACK Texture_Search_Callback( DDPIXELFORMAT* pddpf, VOID* param )
 
 LPDIRECT3DTEXTURE2 Get_Texture(char *szFilename)
 {
+	TRACE_SCOPE("Get_Texture");
+
 	HRESULT hr;
 	LPDIRECT3DTEXTURE2 FloorTexture  = NULL;
 	LPDIRECTDRAWSURFACE4 TexSurface = NULL;
@@ -221,8 +250,61 @@ vector3 Vec3_Cross(vector3 v1, vector3 v2)
 	return t;
 }
 
+// Create a z-buffer of the given size and attach it to pTarget. For
+// hardware devices, the z-buffer should be in video memory.
+HRESULT Create_ZBuffer( LPDIRECTDRAWSURFACE4 pTarget, DWORD dwWidth, DWORD dwHeight,
+						LPDIRECTDRAWSURFACE4 *ppZBuffer )
+{
+	DDSURFACEDESC2 ddsd;
+	ZeroMemory( &ddsd, sizeof(DDSURFACEDESC2) );
+	ddsd.dwSize         = sizeof(DDSURFACEDESC2);
+    ddsd.dwFlags        = DDSD_CAPS|DDSD_WIDTH|DDSD_HEIGHT|DDSD_PIXELFORMAT;
+    ddsd.ddsCaps.dwCaps = DDSCAPS_ZBUFFER | DDSCAPS_VIDEOMEMORY;
+	ddsd.dwWidth        = dwWidth;
+	ddsd.dwHeight       = dwHeight;
+    memcpy( &ddsd.ddpfPixelFormat, &g_ddpfZBuffer, sizeof(DDPIXELFORMAT) );
+
+	LPDIRECTDRAWSURFACE4 pZBuffer;
+	HRESULT hr = g_pDD4->CreateSurface( &ddsd, &pZBuffer, NULL );
+	if( FAILED( hr ) )
+		return hr;
+
+	// Attach the z-buffer to the back buffer.
+	hr = pTarget->AddAttachedSurface( pZBuffer );
+	if( FAILED( hr ) )
+	{
+		pZBuffer->Release();
+		return hr;
+	}
+
+	*ppZBuffer = pZBuffer;
+
+	return S_OK;
+}
+
+// The viewport covers the part of the back buffer the frame is drawn
+// into, it can be smaller than the surface after a resize and smaller
+// than the window with dynamic resolution
+void Set_Viewport()
+{
+    D3DVIEWPORT2 vdData;
+    ZeroMemory( &vdData, sizeof(D3DVIEWPORT2) );
+    vdData.dwSize       = sizeof(D3DVIEWPORT2);
+	vdData.dwWidth      = g_Presenter.RcSource.right;
+	vdData.dwHeight     = g_Presenter.RcSource.bottom;
+    vdData.dvClipX      = -1.0f;
+    vdData.dvClipWidth  = 2.0f;
+    vdData.dvClipY      = 1.0f;
+    vdData.dvClipHeight = 2.0f;
+    vdData.dvMaxZ       = 1.0f;
+
+    g_pViewport->SetViewport2( &vdData );
+}
+
 HRESULT Initialize_3DEnvironment()
 {
+	TRACE_SCOPE("Initialize_3DEnvironment");
+
 	HRESULT hr;
 
     //-------------------------------------------------------------------------
@@ -245,77 +327,21 @@ HRESULT Initialize_3DEnvironment()
 	if( FAILED( hr ) )
 		return hr;
 
-    // Set the Windows cooperative level. This is where we tell the system
-	// whether wew will be rendering in fullscreen mode or in a window. Note
-	// that some hardware (non-GDI) may not be able to render into a window.
-	// The flag DDSCL_NORMAL specifies windowed mode. Using fullscreen mode
-	// is the topic of a subsequent tutorial. The DDSCL_FPUSETUP flag is a 
-	// hint to DirectX to optomize floating points calculations. See the docs
-	// for more info on this. Note: this call could fail if another application
-	// already controls a fullscreen, exclusive mode.
-    hr = g_pDD4->SetCooperativeLevel( g_hWnd, DDSCL_NORMAL );
-	if( FAILED( hr ) )
-		return hr;
-
     //-------------------------------------------------------------------------
 	// Step 2: Create DirectDraw surfaces used for rendering
     //-------------------------------------------------------------------------
 
-	// Initialize a surface description structure for the primary surface. The
-	// primary surface represents the entire display, with dimensions and a
-	// pixel format of the display. Therefore, none of that information needs
-	// to be specified in order to create the primary surface.
-	DDSURFACEDESC2 ddsd;
-	ZeroMemory( &ddsd, sizeof(DDSURFACEDESC2) );
-	ddsd.dwSize         = sizeof(DDSURFACEDESC2);
-	ddsd.dwFlags        = DDSD_CAPS;
-	ddsd.ddsCaps.dwCaps = DDSCAPS_PRIMARYSURFACE;
-
-	// Create the primary surface.
-	hr = g_pDD4->CreateSurface( &ddsd, &g_pDdsPrimary, NULL );
-	if( FAILED( hr ) )
-		return hr;
+	// The presenter sets the cooperative level and creates the primary
+	// surface and the back buffer: an offscreen surface the size of the
+	// window, or a flip chain in fullscreen. The DDSCAPS_3DDEVICE is
+	// needed so we can later query the back buffer for an
+	// IDirect3DDevice interface.
+	g_PresentOptions.dwBackCaps = DDSCAPS_3DDEVICE;
 
-	// Setup a surface description to create a backbuffer. This is an
-	// offscreen plain surface with dimensions equal to our window size.
-	// The DDSCAPS_3DDEVICE is needed so we can later query this surface
-	// for an IDirect3DDevice interface.
-	ddsd.dwFlags        = DDSD_WIDTH | DDSD_HEIGHT | DDSD_CAPS;
-	ddsd.ddsCaps.dwCaps = DDSCAPS_OFFSCREENPLAIN | DDSCAPS_3DDEVICE;
-
-	// Set the dimensions of the backbuffer. Note that if our window changes
-	// size, we need to destroy this surface and create a new one.
-	GetClientRect( g_hWnd, &g_RcScreenRect );
-	GetClientRect( g_hWnd, &g_RcViewportRect );
-	ClientToScreen( g_hWnd, (POINT*)&g_RcScreenRect.left );
-	ClientToScreen( g_hWnd, (POINT*)&g_RcScreenRect.right );
-	ddsd.dwWidth  = g_RcScreenRect.right - g_RcScreenRect.left;
-	ddsd.dwHeight = g_RcScreenRect.bottom - g_RcScreenRect.top;
-
-	// Create the backbuffer. The most likely reason for failure is running
-	// out of video memory. (A more sophisticated app should handle this.)
-	hr = g_pDD4->CreateSurface( &ddsd, &g_pDdsBackBuffer, NULL );
+	hr = Presenter_Create( &g_Presenter, g_pDD4, g_hWnd, &g_PresentOptions );
 	if( FAILED( hr ) )
 		return hr;
 
-	// Note: if using a z-buffer, the zbuffer surface creation would go around
-	// here. However, z-buffer usage is the topic of a subsequent tutorial.
-
-	// Create a clipper object which handles all our clipping for cases when
-	// our window is partially obscured by other windows. This is not needed
-	// for apps running in fullscreen mode.
-	LPDIRECTDRAWCLIPPER pcClipper;
-	hr = g_pDD4->CreateClipper( 0, &pcClipper, NULL );
-	if( FAILED( hr ) )
-		return hr;
-
-	// Associate the clipper with our window. Note that, afterwards, the
-	// clipper is internally referenced by the primary surface, so it is safe
-	// to release our local reference to it.
-	pcClipper->SetHWnd( 0, g_hWnd );
-	g_pDdsPrimary->SetClipper( pcClipper );
-	pcClipper->Release();
-
     //-------------------------------------------------------------------------
 	// Step 3: Create the Direct3D interfaces
     //-------------------------------------------------------------------------
@@ -342,34 +368,20 @@ HRESULT Initialize_3DEnvironment()
 	if( sizeof(DDPIXELFORMAT) != ddpfZBuffer.dwSize )
         return E_FAIL;
 
-    // Get z-buffer dimensions from the render target
-    // Setup the surface desc for the z-buffer.
-    ddsd.dwFlags        = DDSD_CAPS|DDSD_WIDTH|DDSD_HEIGHT|DDSD_PIXELFORMAT;
-    ddsd.ddsCaps.dwCaps = DDSCAPS_ZBUFFER;
-	ddsd.dwWidth        = g_RcScreenRect.right - g_RcScreenRect.left;
-	ddsd.dwHeight       = g_RcScreenRect.bottom - g_RcScreenRect.top;
-    memcpy( &ddsd.ddpfPixelFormat, &ddpfZBuffer, sizeof(DDPIXELFORMAT) );
-
-	// For hardware devices, the z-buffer should be in video memory. For
-	// software devices, create the z-buffer in system memory
-	if( IsEqualIID( *pDeviceGUID, IID_IDirect3DHALDevice ) )
-		ddsd.ddsCaps.dwCaps |= DDSCAPS_VIDEOMEMORY;
-	else
-		ddsd.ddsCaps.dwCaps |= DDSCAPS_SYSTEMMEMORY;
+	g_ddpfZBuffer = ddpfZBuffer;
 
 	// Create and attach a z-buffer. Real apps should be able to handle an
 	// error here (DDERR_OUTOFVIDEOMEMORY may be encountered). For this 
 	// tutorial, though, we are simply going to exit ungracefully.
-    if( FAILED( hr = g_pDD4->CreateSurface( &ddsd, &g_pDdsZBuffer, NULL ) ) )
-		return hr;
-
-	// Attach the z-buffer to the back buffer.
-    if( FAILED( hr = g_pDdsBackBuffer->AddAttachedSurface( g_pDdsZBuffer ) ) )
+    if( FAILED( hr = Create_ZBuffer( g_Presenter.pBackBuffer, g_Presenter.dwBufferWidth,
+		g_Presenter.dwBufferHeight, &g_pDdsZBuffer ) ) )
 		return hr;
 
 	// Before creating the device, check that we are NOT in a palettized
 	// display. That case will cause CreateDevice() to fail, since this simple 
 	// tutorial does not bother with palettes.
+	DDSURFACEDESC2 ddsd;
+	ZeroMemory( &ddsd, sizeof(DDSURFACEDESC2) );
 	ddsd.dwSize = sizeof(DDSURFACEDESC2);
 	g_pDD4->GetDisplayMode( &ddsd );
 	if( ddsd.ddpfPixelFormat.dwRGBBitCount <= 8 )
@@ -379,28 +391,18 @@ HRESULT Initialize_3DEnvironment()
 	// device enumeration, which is the topic of a future tutorial. The device
 	// is created off of our back buffer, which becomes the render target for
 	// the newly created device.
-    hr = g_pD3D->CreateDevice( IID_IDirect3DHALDevice, g_pDdsBackBuffer,
+    hr = g_pD3D->CreateDevice( IID_IDirect3DHALDevice, g_Presenter.pBackBuffer,
                                &g_pD3dDevice, NULL );
 
 	if( FAILED( hr ) )
 		return hr;
 
+	g_StateFilter.Attach( g_pD3dDevice );
+
 	    //-------------------------------------------------------------------------
 	// Step 4: Create the viewport
     //-------------------------------------------------------------------------
 
-    // Set up the viewport data parameters
-    D3DVIEWPORT2 vdData;
-    ZeroMemory( &vdData, sizeof(D3DVIEWPORT2) );
-    vdData.dwSize       = sizeof(D3DVIEWPORT2);
-	vdData.dwWidth      = g_RcScreenRect.right - g_RcScreenRect.left;
-	vdData.dwHeight     = g_RcScreenRect.bottom - g_RcScreenRect.top;
-    vdData.dvClipX      = -1.0f;
-    vdData.dvClipWidth  = 2.0f;
-    vdData.dvClipY      = 1.0f;
-    vdData.dvClipHeight = 2.0f;
-    vdData.dvMaxZ       = 1.0f;
-
     // Create the viewport
     hr = g_pD3D->CreateViewport( &g_pViewport, NULL );
 	if( FAILED( hr ) )
@@ -410,7 +412,7 @@ HRESULT Initialize_3DEnvironment()
     g_pD3dDevice->AddViewport( g_pViewport );
 
     // Set the parameters to the new viewport
-    g_pViewport->SetViewport2( &vdData );
+    Set_Viewport();
 
     // Set the viewport as current for the device
     g_pD3dDevice->SetCurrentViewport( g_pViewport );
@@ -419,8 +421,37 @@ HRESULT Initialize_3DEnvironment()
 	return hr;
 }
 
+//the aspect of the viewport, again after every resize
+void Set_Projection()
+{
+	//MATRIX PROJECTION CALCULATION
+	//the size of the back buffer, the window or the display mode
+	RECT rc = g_Presenter.RcViewport;
+
+	float fFov = 3.14f / 2.0f; // FOV 90 degree
+	float fAspect = (float)rc.right / (float)rc.bottom;
+	float fZFar = 100.0f;
+	float fZNear = 1.0f;
+
+	float    h, w, Q;
+
+	w = (1.0f / tanf(fFov * 0.5f)) / fAspect;
+	h = 1.0f / tanf(fFov * 0.5f);
+	Q = fZFar / (fZFar - fZNear);
+
+	D3DMATRIX MatProj = {
+		w,		0.0,	0.0,			0.0,
+		0.0,	h,		0.0,			0.0,
+		0.0,	0.0,	Q,				1.0,
+		0.0,	0.0,	-Q * fZNear,	0.0 };
+
+    g_StateFilter.SetTransform( D3DTRANSFORMSTATE_PROJECTION, &MatProj );
+}
+
 void Init_Scene()
 {
+	TRACE_SCOPE("Init_Scene");
+
 	//MATRIX VIEW CALCULATION
 	vector3 VecRight = { 1.0f, 0.0f, 0.0 };
 	vector3 VecUp = { 0.0f, 1.0f, 0.0f }; 
@@ -444,29 +475,8 @@ void Init_Scene()
 		VecRight.z,	VecUp.z,	VecLook.z,	0.0,
 		xp,			yp,			zp,			1.0 };
 
-	//MATRIX PROJECTION CALCULATION
-	RECT rc;
-	GetClientRect(g_hWnd, &rc);
-
-	float fFov = 3.14f / 2.0f; // FOV 90 degree
-	float fAspect = (float)rc.right / (float)rc.bottom;
-	float fZFar = 100.0f;
-	float fZNear = 1.0f;
-
-	float    h, w, Q;
-
-	w = (1.0f / tanf(fFov * 0.5f)) / fAspect;
-	h = 1.0f / tanf(fFov * 0.5f);
-	Q = fZFar / (fZFar - fZNear);
-
-	D3DMATRIX MatProj = {
-		w,		0.0,	0.0,			0.0,
-		0.0,	h,		0.0,			0.0,
-		0.0,	0.0,	Q,				1.0,
-		0.0,	0.0,	-Q * fZNear,	0.0 };
-
-    g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_VIEW,       &MatView );
-    g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_PROJECTION, &MatProj );
+    g_StateFilter.SetTransform( D3DTRANSFORMSTATE_VIEW,       &MatView );
+	Set_Projection();
 
 	//  
 	//    
@@ -477,23 +487,105 @@ void Init_Scene()
 	//    Z  -  
 	//      
 	//   
-	g_pD3dDevice->SetRenderState(D3DRENDERSTATE_CULLMODE, D3DCULL_CCW);
-	//g_pD3dDevice->SetRenderState(D3DRENDERSTATE_CULLMODE, D3DCULL_NONE);
-	g_pD3dDevice->SetRenderState(D3DRENDERSTATE_TEXTUREPERSPECTIVE, true);
+	State_Block_Init( &g_SceneStates );
+	State_Block_Render( &g_SceneStates, D3DRENDERSTATE_CULLMODE, D3DCULL_CCW );
+	//State_Block_Render( &g_SceneStates, D3DRENDERSTATE_CULLMODE, D3DCULL_NONE );
+	State_Block_Render( &g_SceneStates, D3DRENDERSTATE_TEXTUREPERSPECTIVE, true );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
 
 	g_pCubeTexture = Get_Texture("texture24.bmp");
 }
 
 VOID On_Move(int x, int y)
 {
-	DWORD dwWidth  = g_RcScreenRect.right - g_RcScreenRect.left;
-	DWORD dwHeight = g_RcScreenRect.bottom - g_RcScreenRect.top;
-    SetRect( &g_RcScreenRect, x, y, x + dwWidth, y + dwHeight );
+	Presenter_Move( &g_Presenter, x, y );
+}
+
+//the scene is drawn into the scaled part of the viewport, the projection
+//keeps the aspect of the window
+VOID Set_Scale()
+{
+	RECT Rc = Dynamic_Res_Rect( &g_DynRes, &g_Presenter.RcViewport );
+	Presenter_Set_Source( &g_Presenter, &Rc );
+
+	Set_Viewport();
+}
+
+//the time of a frame, every few frames it can change the scale
+VOID Update_Scale(float fFrameMs)
+{
+	if( !Dynamic_Res_Frame( &g_DynRes, fFrameMs ) )
+		return;
+
+	Trace_Counter( "resolution scale %", (LONG)(g_DynRes.fScale * 100.0f) );
+	Set_Scale();
+}
+
+//the device, the textures and the states stay, only the back buffer
+//and the Z buffer change when the window grows past them. The device
+//moves to the new ones first, when that fails everything stays as it was
+VOID On_Size(int Width, int Height)
+{
+	//WM_SIZE comes before the device exists, and with 0, 0 when minimized
+	if( !g_pD3dDevice || !g_pViewport || Width <= 0 || Height <= 0 )
+		return;
+
+	bool bNewSurface;
+	if( FAILED( Presenter_Resize( &g_Presenter, Width, Height, &bNewSurface ) ) )
+		return;
+
+	if( bNewSurface )
+	{
+		LPDIRECTDRAWSURFACE4 pZBuffer;
+		HRESULT hr = Create_ZBuffer( g_Presenter.pNewBuffer, g_Presenter.dwNewBufferWidth,
+			g_Presenter.dwNewBufferHeight, &pZBuffer );
+		if( SUCCEEDED( hr ) )
+		{
+			hr = g_pD3dDevice->SetRenderTarget( g_Presenter.pNewBuffer, 0 );
+			if( FAILED( hr ) )
+				pZBuffer->Release();
+		}
+
+		if( FAILED( hr ) )
+		{
+			Presenter_Cancel_Resize( &g_Presenter );
+			return;
+		}
+
+		g_Presenter.pBackBuffer->DeleteAttachedSurface( 0, g_pDdsZBuffer );
+		g_pDdsZBuffer->Release();
+		g_pDdsZBuffer = pZBuffer;
+	}
+
+	Presenter_Commit_Resize( &g_Presenter );
+
+	//the frames of the new size are measured from the start
+	Dynamic_Res_Reset( &g_DynRes );
+	Set_Scale();
+	Set_Projection();
+
+	Scheduler_Invalidate( &g_Scheduler );
+}
+
+//one step of the simulation
+void Tick_Scene()
+{
+	g_PrevAngle = g_Angle;
+	g_Angle += SPIN_SPEED / (float)SCHED_TICKS_PER_SECOND;
+
+	if(g_Angle > PI2)
+	{
+		g_Angle -= PI2;
+		g_PrevAngle -= PI2;
+	}
 }
 
-void Update_Scene()
+void Update_Scene(float fAlpha)
 {
-	float static Angle = 0.0f;
+	TRACE_SCOPE("Update_Scene");
+
+	float Angle = g_PrevAngle + (g_Angle - g_PrevAngle) * fAlpha;
 
 	//MATRIX WORLD
 	//   Y
@@ -503,19 +595,17 @@ void Update_Scene()
 		sinf(Angle),	0.0,	cosf(Angle),	0.0,
 		0.0,			0.0,	0.0,			1.0 };
 
-	Angle += PI / 10000.0f;
-	if(Angle > PI2)
-		Angle = 0.0f;
-
-	g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_WORLD, &MatWorld );
+	g_StateFilter.SetTransform( D3DTRANSFORMSTATE_WORLD, &MatWorld );
 
 }
 
 HRESULT Render_Scene()
 {
+	TRACE_SCOPE("Render_Scene");
+
 
-	HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_RcViewportRect, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER,
-	//HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_RcViewportRect, D3DCLEAR_TARGET,
+	HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_Presenter.RcSource, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER,
+	//HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_Presenter.RcSource, D3DCLEAR_TARGET,
 		                0x00ffffff, 1.0f, 0L );
 	if(FAILED( hr))
 		return E_FAIL;
@@ -527,10 +617,9 @@ HRESULT Render_Scene()
         return S_OK;
     }
 
-	g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
-    g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
+	g_StateFilter.Apply( &g_SceneStates );
 
-    g_pD3dDevice->SetTexture( 0, g_pCubeTexture );
+    g_StateFilter.SetTexture( 0, g_pCubeTexture );
 
 	if( FAILED( g_pD3dDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, D3DFVF_VERTEX, 
                                g_VertBuff, 24,
@@ -544,8 +633,11 @@ HRESULT Render_Scene()
 
 	//   On_Move()
 	//       
-	g_pDdsPrimary->Blt( &g_RcScreenRect, g_pDdsBackBuffer, 
-                               &g_RcViewportRect, DDBLT_WAIT, NULL );
+	{
+		TRACE_SCOPE("Present");
+
+		Presenter_Present( &g_Presenter, NULL );
+	}
 
 	return S_OK;
 
@@ -562,6 +654,12 @@ void Destroy_App()
 
 	if(g_pD3dDevice)
 	{
+		//calls the filter saved, in the output window of the debugger
+		char szText[256];
+		State_Cache_Format(g_StateFilter.Cache(), szText, sizeof(szText));
+		OutputDebugString(szText);
+		OutputDebugString("\n");
+
 		g_pD3dDevice->Release();
 		g_pD3dDevice = NULL;
 	}
@@ -569,8 +667,8 @@ void Destroy_App()
 	if (g_pDdsZBuffer)
     {
 		// Detach Z-Buffer from back buffer
-		if (g_pDdsBackBuffer)
-			g_pDdsBackBuffer->DeleteAttachedSurface (0L, g_pDdsZBuffer);
+		if (g_Presenter.pBackBuffer)
+			g_Presenter.pBackBuffer->DeleteAttachedSurface (0L, g_pDdsZBuffer);
 
 		// Release Z-Buffer
         g_pDdsZBuffer->Release ();
@@ -583,16 +681,7 @@ void Destroy_App()
 		g_pCubeTexture = NULL;
 	}
 
-	if(g_pDdsBackBuffer)
-	{
-		g_pDdsBackBuffer->Release();
-		g_pDdsBackBuffer = NULL;
-	}
-	if(g_pDdsPrimary)
-	{
-		g_pDdsPrimary->Release();
-		g_pDdsPrimary = NULL;
-	}
+	Presenter_Destroy(&g_Presenter);
 
 	if(g_pD3D)
 	{
@@ -628,6 +717,14 @@ LRESULT CALLBACK WndProc(HWND g_hWnd,
 			// used for blitting the backbuffer to the primary.
 			On_Move( (SHORT)LOWORD(lParam), (SHORT)HIWORD(lParam) );
             break;
+		case WM_SIZE:
+			On_Size( LOWORD(lParam), HIWORD(lParam) );
+			break;
+		case WM_KEYDOWN:
+			//F11 pauses and resumes the trace started with -trace
+			if(wParam == VK_F11)
+				Trace_Enable(!g_TraceEnabled);
+			break;
 
 		default:
 			return DefWindowProc(g_hWnd, uMsg, wParam, lParam);
@@ -643,7 +740,6 @@ int PASCAL WinMain(HINSTANCE hInstance,
 					int nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
 
 	WNDCLASS wcl;
 	wcl.style = CS_HREDRAW | CS_VREDRAW;
@@ -682,10 +778,31 @@ int PASCAL WinMain(HINSTANCE hInstance,
 	ShowWindow(g_hWnd, nCmdShow);
 	UpdateWindow(g_hWnd);
 
+	//Sample.exe -trace writes trace.json, open it in
+	//chrome about://tracing or ui.perfetto.dev
+	if(strstr(lpCmdLine, "-trace"))
+		Trace_Init("trace.json");
+
+	//-fullscreen, -backbuffers N, -headless
+	Presenter_Parse_Options(lpCmdLine, &g_PresentOptions);
+
+	//-dynres N, the budget of a frame in ms
+	float fTargetMs = Dynamic_Res_Parse_Options(lpCmdLine);
+	Dynamic_Res_Init(&g_DynRes, fTargetMs, DYNRES_MIN_SCALE);
+
 	Initialize_3DEnvironment();
 
 	Init_Scene();
 
+	//a flip shows the back buffer as it is, nothing to stretch with
+	g_bDynRes = fTargetMs > 0.0f && Presenter_Can_Stretch(&g_Presenter);
+
+	//Sample.exe -fps 30 draws at most 30 frames per second, Sample.exe -onchange
+	//draws only when the cube has moved, both sleep between the frames
+	DWORD dwMode, dwMaxFps;
+	Scheduler_Parse_Options(lpCmdLine, &dwMode, &dwMaxFps);
+	Scheduler_Init(&g_Scheduler, SCHED_TICKS_PER_SECOND, dwMode, dwMaxFps);
+
 	MSG msg;
 
 	while(true)
@@ -696,17 +813,42 @@ int PASCAL WinMain(HINSTANCE hInstance,
 				break;
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			continue;
 		}
 
 		if(GetKeyState(VK_ESCAPE) & 0xFF00)
 			break;
 
-		Update_Scene();
-		Render_Scene();
+		DWORD dwTicks = Scheduler_Update(&g_Scheduler);
+		for(DWORD i = 0; i < dwTicks; i++)
+			Tick_Scene();
+
+		if(Scheduler_Should_Render(&g_Scheduler))
+		{
+			LONGLONG Start = Timer_Ticks();
+
+			Update_Scene(Scheduler_Alpha(&g_Scheduler));
+			Render_Scene();
+			Scheduler_Frame_Done(&g_Scheduler);
+
+			//with queued blits the time of the hardware shows up here
+			//when the driver makes the next frame wait for it
+			if(g_bDynRes)
+				Update_Scale((float)(Timer_Seconds(Timer_Ticks() - Start) * 1000.0));
+		}
+		else
+		{
+			//nothing to draw yet, sleep until a message comes or a frame is due
+			MsgWaitForMultipleObjects(0, NULL, FALSE, Scheduler_Wait_Ms(&g_Scheduler), QS_ALLINPUT);
+		}
 	}
 
+	Scheduler_Shutdown(&g_Scheduler);
+
 	Destroy_App();
 
+	Trace_Shutdown();
+
 	DestroyWindow(g_hWnd);
 	UnregisterClass(wcl.lpszClassName, wcl.hInstance);
 
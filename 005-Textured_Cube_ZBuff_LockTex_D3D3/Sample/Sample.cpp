@@ -10,6 +10,12 @@
 #include <d3dtypes.h>
 #include <d3dcaps.h>
 
+#include <string.h>
+
+#include "Trace.h"
+#include "D3DStateFilter.h"
+#include "FrameScheduler.h"
+
 #pragma comment (lib, "ddraw.lib")
 #pragma comment (lib, "dxguid.lib")
 
@@ -22,6 +28,10 @@ LPDIRECTDRAWSURFACE4 g_pDdsPrimary    = NULL;
 LPDIRECTDRAWSURFACE4 g_pDdsBackBuffer = NULL;
 LPDIRECT3D3          g_pD3D           = NULL;
 LPDIRECT3DDEVICE3    g_pD3dDevice     = NULL;
+//state calls go through the filter, it drops the calls that change nothing
+CD3D3StateFilter     g_StateFilter;
+//the states of the scene, Render_Scene() sets them in one call
+state_block          g_SceneStates;
 LPDIRECT3DVIEWPORT3  g_pViewport     = NULL;
 RECT                 g_RcScreenRect;
 RECT                 g_RcViewportRect;
@@ -30,6 +40,15 @@ LPDIRECTDRAWSURFACE4 g_pDdsZBuffer = NULL;
 
 HWND g_hWnd;
 
+//the cube turns once in 10 seconds, whatever the frame rate is
+#define SPIN_SPEED (PI2 / 10.0f)
+
+//the simulation moves in ticks of 1 / SCHED_TICKS_PER_SECOND seconds,
+//the frames are drawn between the angles of the last two ticks
+frame_scheduler g_Scheduler;
+float g_Angle = 0.0f;
+float g_PrevAngle = 0.0f;
+
 struct vector3
 {
 	float x,y,z;
@@ -110,6 +129,8 @@ HRESULT CALLBACK Texture_Search_Callback( DDPIXELFORMAT* pddpf, VOID* param )
 
 LPDIRECT3DTEXTURE2 Get_Texture(char *szFilename)
 {
+	TRACE_SCOPE("Get_Texture");
+
 	HRESULT hr;
 	LPDIRECT3DTEXTURE2 FloorTexture  = NULL;
 	LPDIRECTDRAWSURFACE4 TexSurface = NULL;
@@ -233,6 +254,8 @@ vector3 Vec3_Cross(vector3 v1, vector3 v2)
 
 HRESULT Initialize_3DEnvironment()
 {
+	TRACE_SCOPE("Initialize_3DEnvironment");
+
 	HRESULT hr;
 
     //-------------------------------------------------------------------------
@@ -395,6 +418,8 @@ HRESULT Initialize_3DEnvironment()
 	if( FAILED( hr ) )
 		return hr;
 
+	g_StateFilter.Attach( g_pD3dDevice );
+
 	    //-------------------------------------------------------------------------
 	// Step 4: Create the viewport
     //-------------------------------------------------------------------------
@@ -431,6 +456,8 @@ HRESULT Initialize_3DEnvironment()
 
 void Init_Scene()
 {
+	TRACE_SCOPE("Init_Scene");
+
 	//MATRIX VIEW CALCULATION
 	vector3 VecRight = { 1.0f, 0.0f, 0.0 };
 	vector3 VecUp = { 0.0f, 1.0f, 0.0f }; 
@@ -475,8 +502,8 @@ void Init_Scene()
 		0.0,	0.0,	Q,				1.0,
 		0.0,	0.0,	-Q * fZNear,	0.0 };
 
-    g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_VIEW,       &MatView );
-    g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_PROJECTION, &MatProj );
+    g_StateFilter.SetTransform( D3DTRANSFORMSTATE_VIEW,       &MatView );
+    g_StateFilter.SetTransform( D3DTRANSFORMSTATE_PROJECTION, &MatProj );
 
 	//  
 	//    
@@ -487,9 +514,12 @@ void Init_Scene()
 	//    Z  -  
 	//      
 	//   
-	g_pD3dDevice->SetRenderState(D3DRENDERSTATE_CULLMODE, D3DCULL_CCW);
-	//g_pD3dDevice->SetRenderState(D3DRENDERSTATE_CULLMODE, D3DCULL_NONE);
-	g_pD3dDevice->SetRenderState(D3DRENDERSTATE_TEXTUREPERSPECTIVE, true);
+	State_Block_Init( &g_SceneStates );
+	State_Block_Render( &g_SceneStates, D3DRENDERSTATE_CULLMODE, D3DCULL_CCW );
+	//State_Block_Render( &g_SceneStates, D3DRENDERSTATE_CULLMODE, D3DCULL_NONE );
+	State_Block_Render( &g_SceneStates, D3DRENDERSTATE_TEXTUREPERSPECTIVE, true );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
+	State_Block_Stage( &g_SceneStates, 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
 
 	g_pCubeTexture = Get_Texture("texture24.bmp");
 }
@@ -501,9 +531,24 @@ VOID On_Move(int x, int y)
     SetRect( &g_RcScreenRect, x, y, x + dwWidth, y + dwHeight );
 }
 
-void Update_Scene()
+//one step of the simulation
+void Tick_Scene()
 {
-	float static Angle = 0.0f;
+	g_PrevAngle = g_Angle;
+	g_Angle += SPIN_SPEED / (float)SCHED_TICKS_PER_SECOND;
+
+	if(g_Angle > PI2)
+	{
+		g_Angle -= PI2;
+		g_PrevAngle -= PI2;
+	}
+}
+
+void Update_Scene(float fAlpha)
+{
+	TRACE_SCOPE("Update_Scene");
+
+	float Angle = g_PrevAngle + (g_Angle - g_PrevAngle) * fAlpha;
 
 	//MATRIX WORLD
 	//   Y
@@ -513,16 +558,14 @@ void Update_Scene()
 		sinf(Angle),	0.0,	cosf(Angle),	0.0,
 		0.0,			0.0,	0.0,			1.0 };
 
-	Angle += PI / 10000.0f;
-	if(Angle > PI2)
-		Angle = 0.0f;
-
-	g_pD3dDevice->SetTransform( D3DTRANSFORMSTATE_WORLD, &MatWorld );
+	g_StateFilter.SetTransform( D3DTRANSFORMSTATE_WORLD, &MatWorld );
 
 }
 
 HRESULT Render_Scene()
 {
+	TRACE_SCOPE("Render_Scene");
+
 
 	HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_RcViewportRect, D3DCLEAR_TARGET | D3DCLEAR_ZBUFFER,
 	//HRESULT hr = g_pViewport->Clear2( 1UL, (D3DRECT*)&g_RcViewportRect, D3DCLEAR_TARGET,
@@ -537,10 +580,9 @@ HRESULT Render_Scene()
         return S_OK;
     }
 
-	g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MINFILTER, D3DTFN_LINEAR );
-    g_pD3dDevice->SetTextureStageState( 0, D3DTSS_MAGFILTER, D3DTFG_LINEAR );
+	g_StateFilter.Apply( &g_SceneStates );
 
-    g_pD3dDevice->SetTexture( 0, g_pCubeTexture );
+    g_StateFilter.SetTexture( 0, g_pCubeTexture );
 
 	if( FAILED( g_pD3dDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, D3DFVF_VERTEX, 
                                g_VertBuff, 24,
@@ -554,8 +596,12 @@ HRESULT Render_Scene()
 
 	//   On_Move()
 	//       
-	g_pDdsPrimary->Blt( &g_RcScreenRect, g_pDdsBackBuffer, 
-                               &g_RcViewportRect, DDBLT_WAIT, NULL );
+	{
+		TRACE_SCOPE("Present");
+
+		g_pDdsPrimary->Blt( &g_RcScreenRect, g_pDdsBackBuffer, 
+			&g_RcViewportRect, DDBLT_WAIT, NULL );
+	}
 
 	return S_OK;
 
@@ -572,6 +618,12 @@ void Destroy_App()
 
 	if(g_pD3dDevice)
 	{
+		//calls the filter saved, in the output window of the debugger
+		char szText[256];
+		State_Cache_Format(g_StateFilter.Cache(), szText, sizeof(szText));
+		OutputDebugString(szText);
+		OutputDebugString("\n");
+
 		g_pD3dDevice->Release();
 		g_pD3dDevice = NULL;
 	}
@@ -638,6 +690,11 @@ LRESULT CALLBACK WndProc(HWND g_hWnd,
 			// used for blitting the backbuffer to the primary.
 			On_Move( (SHORT)LOWORD(lParam), (SHORT)HIWORD(lParam) );
             break;
+		case WM_KEYDOWN:
+			//F11 pauses and resumes the trace started with -trace
+			if(wParam == VK_F11)
+				Trace_Enable(!g_TraceEnabled);
+			break;
 
 		default:
 			return DefWindowProc(g_hWnd, uMsg, wParam, lParam);
@@ -653,7 +710,6 @@ int PASCAL WinMain(HINSTANCE hInstance,
 					int nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
 
 	WNDCLASS wcl;
 	wcl.style = CS_HREDRAW | CS_VREDRAW;
@@ -692,10 +748,21 @@ int PASCAL WinMain(HINSTANCE hInstance,
 	ShowWindow(g_hWnd, nCmdShow);
 	UpdateWindow(g_hWnd);
 
+	//Sample.exe -trace writes trace.json, open it in
+	//chrome about://tracing or ui.perfetto.dev
+	if(strstr(lpCmdLine, "-trace"))
+		Trace_Init("trace.json");
+
 	Initialize_3DEnvironment();
 
 	Init_Scene();
 
+	//Sample.exe -fps 30 draws at most 30 frames per second, Sample.exe -onchange
+	//draws only when the cube has moved, both sleep between the frames
+	DWORD dwMode, dwMaxFps;
+	Scheduler_Parse_Options(lpCmdLine, &dwMode, &dwMaxFps);
+	Scheduler_Init(&g_Scheduler, SCHED_TICKS_PER_SECOND, dwMode, dwMaxFps);
+
 	MSG msg;
 
 	while(true)
@@ -706,17 +773,35 @@ int PASCAL WinMain(HINSTANCE hInstance,
 				break;
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
+			continue;
 		}
 
 		if(GetKeyState(VK_ESCAPE) & 0xFF00)
 			break;
 
-		Update_Scene();
-		Render_Scene();
+		DWORD dwTicks = Scheduler_Update(&g_Scheduler);
+		for(DWORD i = 0; i < dwTicks; i++)
+			Tick_Scene();
+
+		if(Scheduler_Should_Render(&g_Scheduler))
+		{
+			Update_Scene(Scheduler_Alpha(&g_Scheduler));
+			Render_Scene();
+			Scheduler_Frame_Done(&g_Scheduler);
+		}
+		else
+		{
+			//nothing to draw yet, sleep until a message comes or a frame is due
+			MsgWaitForMultipleObjects(0, NULL, FALSE, Scheduler_Wait_Ms(&g_Scheduler), QS_ALLINPUT);
+		}
 	}
 
+	Scheduler_Shutdown(&g_Scheduler);
+
 	Destroy_App();
 
+	Trace_Shutdown();
+
 	DestroyWindow(g_hWnd);
 	UnregisterClass(wcl.lpszClassName, wcl.hInstance);
 
@@ -0,0 +1,683 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <windows.h>
+#include <math.h>
+
+#include <ddraw.h>
+
+#include <string.h>
+#include <stdio.h>
+
+#include "Trace.h"
+#include "Math3D.h"
+#include "Bitmap.h"
+#include "RenderStats.h"
+#include "SoftDevice.h"
+#include "DrawTrace.h"
+#include "FilterDevice.h"
+#include "FrameArena.h"
+#include "FrameScheduler.h"
+#include "DirtyRect.h"
+#include "Presenter.h"
+#include "DynamicRes.h"
+#include "FrameCapture.h"
+
+#pragma comment (lib, "ddraw.lib")
+#pragma comment (lib, "dxguid.lib")
+
+LPDIRECTDRAW         g_pDD1           = NULL;
+LPDIRECTDRAW4        g_pDD4           = NULL;
+//primary and back buffer: a window, a fullscreen flip chain or no display
+presenter            g_Presenter;
+present_options      g_PresentOptions;
+CSoftDevice          *g_pSoftDevice   = NULL;
+//the scene draws through g_pDevice: the state filter in front of the
+//software device, or of the recorder when the sample runs with -record
+IRenderDevice        *g_pDevice       = NULL;
+CFilterDevice        *g_pFilter       = NULL;
+CRecordDevice        *g_pRecorder     = NULL;
+bool                 g_bRecord        = false;
+soft_texture         *g_pCubeTexture  = NULL;
+//the states of the scene, Render_Scene() sets them in one call
+state_block          g_SceneStates;
+
+HWND g_hWnd;
+
+//the cube turns once in 10 seconds, whatever the frame rate is
+#define SPIN_SPEED (PI2 / 10.0f)
+
+//the simulation moves in ticks of 1 / SCHED_TICKS_PER_SECOND seconds,
+//the frames are drawn between the angles of the last two ticks
+frame_scheduler g_Scheduler;
+float g_Angle = 0.0f;
+float g_PrevAngle = 0.0f;
+
+//F2 shows the counters of the software device
+bool g_bShowStats = false;
+
+//only the part of the frame the cube covers now or covered in the last
+//frame is cleared and copied to the screen
+dirty_rect g_Dirty;
+
+//Sample.exe -dynres 16.6 draws into a smaller part of the back buffer
+//when the frames take longer than 16.6 ms, the present stretches it
+dynamic_res g_DynRes;
+bool g_bDynRes = false;
+
+//Sample.exe -capture records the frames into capture.y4m, a thread
+//writes them. Frames of another size after a resize are not recorded
+bool g_bCapture = false;
+DWORD g_dwCapturePolicy = CAPTURE_BLOCK;
+frame_capture *g_pCapture = NULL;
+DWORD g_dwCaptureWidth = 0;
+DWORD g_dwCaptureHeight = 0;
+
+//same layout as D3DVERTEX
+struct vertex
+{
+	float x, y, z;
+	float nx, ny, nz;
+	float tu, tv;
+};
+
+//the cube of the previous samples, 24 vertices, 12 triangles,
+//direct3d is not used, everything is drawn by CSoftDevice
+vertex g_VertBuff[24] = {
+-5.000000,-5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	1.0,1.0,
+-5.000000,-5.000000,5.000000,	0.000000, 0.000000, 0.000000,	1.0,0.0,
+5.000000,-5.000000,5.000000,	0.000000, 0.000000, 0.000000,	0.0,0.0,
+5.000000,-5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	0.0,1.0,
+-5.000000,5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	0.0,1.0,
+5.000000,5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	1.0,1.0,
+5.000000,5.000000,5.000000,		0.000000, 0.000000, 0.000000,	1.0,0.0,
+-5.000000,5.000000,5.000000,	0.000000, 0.000000, 0.000000,	0.0,0.0,
+-5.000000,-5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	0.0,1.0,
+5.000000,-5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	1.0,1.0,
+5.000000,5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	1.0,0.0,
+-5.000000,5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	0.0,0.0,
+5.000000,-5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	0.0,1.0,
+5.000000,-5.000000,5.000000,	0.000000, 0.000000, 0.000000,	1.0,1.0,
+5.000000,5.000000,5.000000,		0.000000, 0.000000, 0.000000,	1.0,0.0,
+5.000000,5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	0.0,0.0,
+5.000000,-5.000000,5.000000,	0.000000, 0.000000, 0.000000,	0.0,1.0,
+-5.000000,-5.000000,5.000000,	0.000000, 0.000000, 0.000000,	1.0,1.0,
+-5.000000,5.000000,5.000000,	0.000000, 0.000000, 0.000000,	1.0,0.0,
+5.000000,5.000000,5.000000,		0.000000, 0.000000, 0.000000,	0.0,0.0,
+-5.000000,-5.000000,5.000000,	0.000000, 0.000000, 0.000000,	0.0,1.0,
+-5.000000,-5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	1.0,1.0,
+-5.000000,5.000000,-5.000000,	0.000000, 0.000000, 0.000000,	1.0,0.0,
+-5.000000,5.000000,5.000000,	0.000000, 0.000000, 0.000000,	0.0,0.0 };
+
+WORD g_IndexBuff[36] = {
+		0,2,1, 		// 1 triangle
+		2,0,3,		// 2 triangle
+		4,6,5,		// 3 triangle
+		6,4,7,		// 4 triangle
+		8,10,9,		// 5 triangle
+		10,8,11,	// 6 triangle
+		12,14,13,	// 7 triangle
+		14,12,15,	// 8 triangle
+		16,18,17,	// 9 triangle
+		18,16,19,	// 10 triangle
+		20,22,21,	// 11 triangle
+		22,20,23};	// 12 triangle
+
+soft_texture *Get_Texture(char *szFilename)
+{
+	TRACE_SCOPE("Get_Texture");
+
+	//LoadImage() is not needed, the texture lives in system memory
+	bitmap Bmp;
+	if(!Bitmap_Load(szFilename, &Bmp))
+		return NULL;
+
+	soft_texture *pTexture = NULL;
+	if(SUCCEEDED(g_pDevice->CreateTexture(Bmp.dwWidth, Bmp.dwHeight, &pTexture)))
+		memcpy(pTexture->pBits, Bmp.pBits, Bmp.dwWidth * Bmp.dwHeight * sizeof(DWORD));
+
+	Bitmap_Free(&Bmp);
+
+	return pTexture;
+}
+
+HRESULT Initialize_3DEnvironment()
+{
+	TRACE_SCOPE("Initialize_3DEnvironment");
+
+	HRESULT hr;
+
+	hr = DirectDrawCreate( NULL, &g_pDD1, NULL );
+	if( FAILED( hr ) )
+		return hr;
+
+	hr = g_pDD1->QueryInterface( IID_IDirectDraw4, (VOID**)&g_pDD4 );
+	if( FAILED( hr ) )
+		return hr;
+
+	//in a window the back buffer is a 32 bit surface in system memory,
+	//CSoftDevice::Present() copies the frame into it and Blt() converts
+	//it to the format of the display. The fullscreen flip chain is 32 bit
+	DDPIXELFORMAT ddpf;
+	ZeroMemory( &ddpf, sizeof(DDPIXELFORMAT) );
+	ddpf.dwSize = sizeof(DDPIXELFORMAT);
+	ddpf.dwFlags = DDPF_RGB;
+	ddpf.dwRGBBitCount = 32;
+	ddpf.dwRBitMask = 0x00ff0000;
+	ddpf.dwGBitMask = 0x0000ff00;
+	ddpf.dwBBitMask = 0x000000ff;
+
+	if( g_PresentOptions.dwMode != PRESENT_FLIP )
+	{
+		g_PresentOptions.dwBackCaps = DDSCAPS_SYSTEMMEMORY;
+		g_PresentOptions.pFormat = &ddpf;
+	}
+
+	hr = Presenter_Create( &g_Presenter, g_pDD4, g_hWnd, &g_PresentOptions );
+	if( FAILED( hr ) )
+		return hr;
+
+	//software device with a z buffer, the size of the back buffer
+	DWORD dwWidth = g_Presenter.RcViewport.right;
+	DWORD dwHeight = g_Presenter.RcViewport.bottom;
+
+	hr = Create_Soft_Device( dwWidth, dwHeight, true, &g_pSoftDevice );
+	if( FAILED( hr ) )
+		return hr;
+
+	Dirty_Init( &g_Dirty, dwWidth, dwHeight, DIRTY_MAX_PERCENT );
+
+	g_pDevice = g_pSoftDevice;
+
+	//Sample.exe -record writes draw.trc for Tools/Replay
+	if( g_bRecord )
+	{
+		hr = Create_Record_Device( g_pSoftDevice, "draw.trc", &g_pRecorder );
+		if( FAILED( hr ) )
+			return hr;
+
+		g_pDevice = g_pRecorder;
+	}
+
+	//state calls that change nothing do not reach the device (or the trace)
+	hr = Create_Filter_Device( g_pDevice, &g_pFilter );
+	if( FAILED( hr ) )
+		return hr;
+
+	g_pDevice = g_pFilter;
+
+	if( g_bCapture )
+	{
+		g_pCapture = Capture_Create( "capture.y4m", dwWidth, dwHeight, SCHED_TICKS_PER_SECOND,
+			CAPTURE_DEFAULT_BUFFERS, g_dwCapturePolicy );
+		g_dwCaptureWidth = dwWidth;
+		g_dwCaptureHeight = dwHeight;
+	}
+
+	return hr;
+}
+
+//the aspect of the viewport, again after every resize
+void Set_Projection()
+{
+	//the size of the back buffer, the window or the display mode
+	RECT rc = g_Presenter.RcViewport;
+
+	float fFov = 3.14f / 2.0f; // FOV 90 degree
+	float fAspect = (float)rc.right / (float)rc.bottom;
+	matrix4x4 MatProj = Mat4x4_Projection(fFov, fAspect, 1.0f, 100.0f);
+
+	g_pDevice->SetTransform( SRTS_PROJECTION, &MatProj );
+}
+
+void Init_Scene()
+{
+	TRACE_SCOPE("Init_Scene");
+
+	vector3 VecCamPos = { 0.0f, 0.0f, -15.0f };
+	matrix4x4 MatView = Mat4x4_View(VecCamPos);
+
+	g_pDevice->SetTransform( SRTS_VIEW, &MatView );
+	Set_Projection();
+
+	//the block has every state of the pixel pipeline, the software
+	//device switches to its pipeline without looking at the states
+	State_Block_Init( &g_SceneStates );
+	State_Block_Render( &g_SceneStates, SRRS_CULLMODE, SRCULL_CCW );
+	State_Block_Render( &g_SceneStates, SRRS_TEXTUREPERSPECTIVE, true );
+	State_Block_Render( &g_SceneStates, SRRS_ZENABLE, true );
+	State_Block_Render( &g_SceneStates, SRRS_ZWRITEENABLE, true );
+	State_Block_Render( &g_SceneStates, SRRS_ZFUNC, SRCMP_LESSEQUAL );
+	State_Block_Stage( &g_SceneStates, 0, SRTSS_COLOROP, SRTOP_MODULATE );
+	State_Block_Stage( &g_SceneStates, 0, SRTSS_MINFILTER, SRTF_LINEAR );
+	State_Block_Stage( &g_SceneStates, 0, SRTSS_MAGFILTER, SRTF_LINEAR );
+
+	g_pCubeTexture = Get_Texture("texture24.bmp");
+}
+
+VOID On_Move(int x, int y)
+{
+	Presenter_Move( &g_Presenter, x, y );
+
+	//the screen under the new place has none of the frame
+	Dirty_Invalidate( &g_Dirty );
+}
+
+//the scene is drawn into the scaled part of the viewport, the projection
+//keeps the aspect of the window
+VOID Set_Scale()
+{
+	RECT Rc = Dynamic_Res_Rect( &g_DynRes, &g_Presenter.RcViewport );
+	Presenter_Set_Source( &g_Presenter, &Rc );
+
+	DWORD dwWidth  = g_Presenter.RcSource.right;
+	DWORD dwHeight = g_Presenter.RcSource.bottom;
+	g_pDevice->SetViewport( 0, 0, dwWidth, dwHeight );
+
+	Dirty_Init( &g_Dirty, dwWidth, dwHeight, DIRTY_MAX_PERCENT );
+}
+
+//the time of a frame, every few frames it can change the scale
+VOID Update_Scale(float fFrameMs)
+{
+	if( !Dynamic_Res_Frame( &g_DynRes, fFrameMs ) )
+		return;
+
+	Trace_Counter( "resolution scale %", (LONG)(g_DynRes.fScale * 100.0f) );
+	Set_Scale();
+}
+
+//the device keeps its texture and states, only the buffers change. The
+//device takes the new size first, when it can not the presenter stays
+//as it was
+VOID On_Size(int Width, int Height)
+{
+	//WM_SIZE comes before the device exists, and with 0, 0 when minimized
+	if( !g_pSoftDevice || Width <= 0 || Height <= 0 )
+		return;
+
+	bool bNewSurface;
+	if( FAILED( Presenter_Resize( &g_Presenter, Width, Height, &bNewSurface ) ) )
+		return;
+
+	//fullscreen keeps the size of the display mode
+	bool bNewSize = g_Presenter.bResizing &&
+		( g_Presenter.dwNewWidth != g_pSoftDevice->GetWidth() ||
+		g_Presenter.dwNewHeight != g_pSoftDevice->GetHeight() );
+
+	if( bNewSize && FAILED( g_pSoftDevice->Resize( g_Presenter.dwNewWidth, g_Presenter.dwNewHeight ) ) )
+	{
+		Presenter_Cancel_Resize( &g_Presenter );
+		return;
+	}
+
+	Presenter_Commit_Resize( &g_Presenter );
+
+	if( bNewSize )
+		Set_Projection();
+
+	//the frames of the new size are measured from the start
+	Dynamic_Res_Reset( &g_DynRes );
+	Set_Scale();
+
+	Scheduler_Invalidate( &g_Scheduler );
+}
+
+//one step of the simulation
+void Tick_Scene()
+{
+	g_PrevAngle = g_Angle;
+	g_Angle += SPIN_SPEED / (float)SCHED_TICKS_PER_SECOND;
+
+	if(g_Angle > PI2)
+	{
+		g_Angle -= PI2;
+		g_PrevAngle -= PI2;
+	}
+}
+
+void Update_Scene(float fAlpha)
+{
+	TRACE_SCOPE("Update_Scene");
+
+	float Angle = g_PrevAngle + (g_Angle - g_PrevAngle) * fAlpha;
+
+	matrix4x4 MatWorld = Mat4x4_Rotation_Y(Angle);
+
+	g_pDevice->SetTransform( SRTS_WORLD, &MatWorld );
+}
+
+void Draw_Stats()
+{
+	char szText[5][128];
+	char *szLines[5] = { szText[0], szText[1], szText[2], szText[3], szText[4] };
+
+	DWORD dwPixels = g_Presenter.RcSource.right * g_Presenter.RcSource.bottom;
+	int Count = Stats_Format(Stats_Get_Frame(), dwPixels, szLines, 5, 128);
+
+	HDC hdc;
+	if( FAILED( g_Presenter.pBackBuffer->GetDC( &hdc ) ) )
+		return;
+
+	SetBkMode( hdc, TRANSPARENT );
+	SetTextColor( hdc, RGB(255, 0, 0) );
+
+	for(int i = 0; i < Count; i++)
+		TextOut( hdc, 4, 4 + i * 16, szLines[i], (int)strlen(szLines[i]) );
+
+	g_Presenter.pBackBuffer->ReleaseDC( hdc );
+}
+
+HRESULT Render_Scene()
+{
+	TRACE_SCOPE("Render_Scene");
+
+	//the overlay and the debug views change the whole frame, the
+	//buffers of a flip chain have older frames
+	if( g_bShowStats || g_pSoftDevice->GetDebugMode() != SRDEBUG_NONE ||
+		!Presenter_Keeps_Frame( &g_Presenter ) )
+		Dirty_Invalidate( &g_Dirty );
+
+	RECT RcClear;
+	if( !Dirty_Clear_Rect( &g_Dirty, &RcClear ) )
+		RcClear = g_Presenter.RcSource;
+
+	g_pDevice->Clear( 1UL, &RcClear, SRCLEAR_TARGET | SRCLEAR_ZBUFFER,
+		                0x00ffffff, 1.0f );
+
+	if( FAILED( g_pDevice->BeginScene() ) )
+		return S_OK;
+
+	g_pDevice->ApplyStateBlock( &g_SceneStates );
+
+    g_pDevice->SetTexture( 0, g_pCubeTexture );
+
+	g_pDevice->DrawIndexedPrimitive( SRPT_TRIANGLELIST, SRFVF_VERTEX,
+                               g_VertBuff, 24,
+							   g_IndexBuff, 36, 0 );
+
+    g_pDevice->EndScene();
+
+	//the whole frame of the device, the thread converts and writes it
+	if( g_pCapture && g_pSoftDevice->GetWidth() == g_dwCaptureWidth &&
+		g_pSoftDevice->GetHeight() == g_dwCaptureHeight )
+	{
+		LONG lPitch;
+		DWORD *pPixels = Capture_Acquire( g_pCapture, &lPitch );
+		if( pPixels )
+		{
+			g_pSoftDevice->Present( pPixels, lPitch, NULL );
+			Capture_Submit( g_pCapture );
+		}
+	}
+
+	RECT RcDrawn, RcPresent;
+	g_pSoftDevice->GetDrawnRect( &RcDrawn );
+	if( !Dirty_End_Frame( &g_Dirty, &RcDrawn, &RcPresent ) )
+		RcPresent = g_Presenter.RcSource;
+
+	//nothing changed, the screen still shows the frame
+	if( Rect_Is_Empty( &RcPresent ) )
+	{
+		Stats_End_Frame();
+		return S_OK;
+	}
+
+	{
+		TRACE_SCOPE("Present");
+
+		//copy the frame of the software device into the back buffer
+		DDSURFACEDESC2 ddsd;
+		ZeroMemory( &ddsd, sizeof(DDSURFACEDESC2) );
+		ddsd.dwSize = sizeof(DDSURFACEDESC2);
+
+		if( FAILED( g_Presenter.pBackBuffer->Lock( NULL, &ddsd, DDLOCK_WAIT | DDLOCK_WRITEONLY, NULL ) ) )
+			return E_FAIL;
+
+		g_pSoftDevice->Present( ddsd.lpSurface, ddsd.lPitch, &RcPresent );
+
+		g_Presenter.pBackBuffer->Unlock( NULL );
+
+		//counters of the previous frame
+		if(g_bShowStats)
+			Draw_Stats();
+
+		Presenter_Present( &g_Presenter, &RcPresent );
+	}
+
+	Stats_End_Frame();
+
+	return S_OK;
+}
+
+void Destroy_App()
+{
+	if(g_pCubeTexture)
+	{
+		g_pDevice->DestroyTexture(g_pCubeTexture);
+		g_pCubeTexture = NULL;
+	}
+
+	if(g_pFilter)
+	{
+		g_pFilter->Release();
+		g_pFilter = NULL;
+	}
+
+	if(g_pRecorder)
+	{
+		g_pRecorder->Release();
+		g_pRecorder = NULL;
+	}
+
+	g_pDevice = NULL;
+
+	if(g_pCapture)
+	{
+		capture_stats Stats;
+		Capture_Destroy(g_pCapture, &Stats);
+		g_pCapture = NULL;
+
+		//in the output window of the debugger
+		char szText[256];
+		sprintf(szText, "capture: %u frames, %u dropped, %u failed, %.1f MB/s written, %.3f s waited\n",
+			(unsigned)Stats.dwFrames, (unsigned)Stats.dwDropped, (unsigned)Stats.dwFailed,
+			Stats.fWriteSeconds > 0.0 ? Stats.Bytes / Stats.fWriteSeconds / 1e6 : 0.0,
+			Stats.fWaitSeconds);
+		OutputDebugString(szText);
+	}
+
+	if(g_pSoftDevice)
+	{
+		g_pSoftDevice->Release();
+		g_pSoftDevice = NULL;
+	}
+
+	//scratch memory the device used on this thread
+	Frame_Arena_Local_Destroy();
+
+	Presenter_Destroy(&g_Presenter);
+
+	if(g_pDD4)
+	{
+		g_pDD4->Release();
+		g_pDD4 = NULL;
+	}
+
+	if(g_pDD1)
+	{
+		g_pDD1->Release();
+		g_pDD1 = NULL;
+	}
+}
+
+LRESULT CALLBACK WndProc(HWND g_hWnd,
+						 UINT uMsg,
+						 WPARAM wParam,
+						 LPARAM lParam)
+{
+	switch(uMsg)
+	{
+		case WM_CLOSE:
+			PostQuitMessage(0);
+			break;
+		case WM_MOVE:
+			On_Move( (SHORT)LOWORD(lParam), (SHORT)HIWORD(lParam) );
+            break;
+		case WM_SIZE:
+			On_Size( LOWORD(lParam), HIWORD(lParam) );
+			break;
+		case WM_PAINT:
+			//a window uncovered a part of the frame, the next one is copied whole
+			Dirty_Invalidate( &g_Dirty );
+			Scheduler_Invalidate( &g_Scheduler );
+			ValidateRect( g_hWnd, NULL );
+			break;
+		case WM_KEYDOWN:
+			//F2 shows and hides the statistics overlay
+			if(wParam == VK_F2)
+			{
+				g_bShowStats = !g_bShowStats;
+				Dirty_Invalidate(&g_Dirty);
+			}
+			//F3 switches the frame, the overdraw view and the cost view
+			if(wParam == VK_F3 && g_pSoftDevice)
+			{
+				g_pSoftDevice->SetDebugMode((g_pSoftDevice->GetDebugMode() + 1) % 3);
+				Dirty_Invalidate(&g_Dirty);
+			}
+			//F11 pauses and resumes the trace started with -trace
+			if(wParam == VK_F11)
+				Trace_Enable(!g_TraceEnabled);
+			break;
+
+		default:
+			return DefWindowProc(g_hWnd, uMsg, wParam, lParam);
+	}
+
+	return 0;
+
+}
+
+int PASCAL WinMain(HINSTANCE hInstance,
+				   HINSTANCE hPrevInstance,
+					LPSTR lpCmdLine,
+					int nCmdShow)
+{
+	UNREFERENCED_PARAMETER(hPrevInstance);
+
+	WNDCLASS wcl;
+	wcl.style = CS_HREDRAW | CS_VREDRAW;
+	wcl.lpfnWndProc = WndProc;
+	wcl.cbClsExtra = 0L;
+	wcl.cbWndExtra = 0L;
+	wcl.hInstance = hInstance;
+	wcl.hIcon = LoadIcon(NULL, IDI_APPLICATION);
+	wcl.hCursor = LoadCursor(NULL, IDC_ARROW);
+	wcl.hbrBackground = (HBRUSH)(COLOR_WINDOW+1);
+	wcl.lpszMenuName = NULL;
+	wcl.lpszClassName = "Sample";
+
+	if(!RegisterClass(&wcl))
+		return 0;
+
+	g_hWnd = CreateWindow("Sample", "Sample Application",
+					WS_OVERLAPPEDWINDOW,
+					0, 0,
+					640, 480,
+					NULL,
+					NULL,
+					hInstance,
+					NULL);
+	if(!g_hWnd)
+		return 0;
+
+	ShowWindow(g_hWnd, nCmdShow);
+	UpdateWindow(g_hWnd);
+
+	//Sample.exe -trace writes trace.json, open it in
+	//chrome about://tracing or ui.perfetto.dev
+	if(strstr(lpCmdLine, "-trace"))
+		Trace_Init("trace.json");
+
+	g_bRecord = strstr(lpCmdLine, "-record") != NULL;
+
+	//-capture, -dropframes leaves out the frames the disk can not take
+	g_bCapture = Capture_Parse_Options(lpCmdLine, &g_dwCapturePolicy);
+
+	//-fullscreen, -backbuffers N, -headless
+	Presenter_Parse_Options(lpCmdLine, &g_PresentOptions);
+
+	//-dynres N, the budget of a frame in ms
+	float fTargetMs = Dynamic_Res_Parse_Options(lpCmdLine);
+	Dynamic_Res_Init(&g_DynRes, fTargetMs, DYNRES_MIN_SCALE);
+
+	if(FAILED(Initialize_3DEnvironment()))
+	{
+		Destroy_App();
+		Trace_Shutdown();
+		DestroyWindow(g_hWnd);
+		return 0;
+	}
+
+	Init_Scene();
+
+	//a flip shows the back buffer as it is, nothing to stretch with
+	g_bDynRes = fTargetMs > 0.0f && Presenter_Can_Stretch(&g_Presenter);
+
+	//Sample.exe -fps 30 draws at most 30 frames per second, Sample.exe -onchange
+	//draws only when the cube has moved, both sleep between the frames
+	DWORD dwMode, dwMaxFps;
+	Scheduler_Parse_Options(lpCmdLine, &dwMode, &dwMaxFps);
+	Scheduler_Init(&g_Scheduler, SCHED_TICKS_PER_SECOND, dwMode, dwMaxFps);
+
+	MSG msg;
+
+	while(true)
+	{
+		if(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		{
+			if(msg.message ==	WM_QUIT)
+				break;
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+			continue;
+		}
+
+		if(GetKeyState(VK_ESCAPE) & 0xFF00)
+			break;
+
+		DWORD dwTicks = Scheduler_Update(&g_Scheduler);
+		for(DWORD i = 0; i < dwTicks; i++)
+			Tick_Scene();
+
+		if(Scheduler_Should_Render(&g_Scheduler))
+		{
+			LONGLONG Start = Timer_Ticks();
+
+			Update_Scene(Scheduler_Alpha(&g_Scheduler));
+			Render_Scene();
+			Scheduler_Frame_Done(&g_Scheduler);
+
+			if(g_bDynRes)
+				Update_Scale((float)(Timer_Seconds(Timer_Ticks() - Start) * 1000.0));
+		}
+		else
+		{
+			//nothing to draw yet, sleep until a message comes or a frame is due
+			MsgWaitForMultipleObjects(0, NULL, FALSE, Scheduler_Wait_Ms(&g_Scheduler), QS_ALLINPUT);
+		}
+	}
+
+	Scheduler_Shutdown(&g_Scheduler);
+
+	Destroy_App();
+
+	Trace_Shutdown();
+
+	DestroyWindow(g_hWnd);
+	UnregisterClass(wcl.lpszClassName, wcl.hInstance);
+
+	return (int)msg.wParam;
+}
@@ -0,0 +1,56 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Math3D.h"
+
+//transform of a vertex array by world * view * projection, the work of
+//SCENE_SOFT_TRANSFORM per frame
+static void Transform_Vertices(benchmark::State &State)
+{
+	std::vector<vector3> Vertices((size_t)State.range(0));
+	for(size_t i = 0; i < Vertices.size(); i++)
+	{
+		Vertices[i].x = (float)(i % 17) - 8.0f;
+		Vertices[i].y = (float)(i % 13) - 6.0f;
+		Vertices[i].z = (float)(i % 11) - 5.0f;
+	}
+
+	vector3 VecCam = { 0.0f, 0.0f, -8.0f };
+	matrix4x4 MatView = Mat4x4_View(VecCam);
+	matrix4x4 MatProj = Mat4x4_Projection(PI / 3.0f, 4.0f / 3.0f, 1.0f, 100.0f);
+
+	float Angle = 0.0f;
+	for(auto _ : State)
+	{
+		matrix4x4 Mat = Mat4x4_Mul(Mat4x4_Mul(Mat4x4_Rotation_Y(Angle), MatView), MatProj);
+
+		for(size_t i = 0; i < Vertices.size(); i++)
+		{
+			vector4 Out = Vec3_Mat4x4_Mul(Vertices[i], Mat);
+			benchmark::DoNotOptimize(Out);
+		}
+
+		Angle += 0.01f;
+	}
+
+	State.SetItemsProcessed(State.iterations() * State.range(0));
+}
+BENCHMARK(Transform_Vertices)->Range(8, 8 << 10);
+
+static void Matrix_Multiply(benchmark::State &State)
+{
+	matrix4x4 MatA = Mat4x4_Rotation_Y(0.3f);
+	matrix4x4 MatB = Mat4x4_Rotation_Y(0.5f);
+
+	for(auto _ : State)
+	{
+		MatA = Mat4x4_Mul(MatA, MatB);
+		benchmark::DoNotOptimize(MatA);
+	}
+}
+BENCHMARK(Matrix_Multiply);
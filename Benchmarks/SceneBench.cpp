@@ -0,0 +1,65 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <benchmark/benchmark.h>
+
+#include "Scenes.h"
+
+#ifndef SAMPLES_ROOT
+#define SAMPLES_ROOT "."
+#endif
+
+//one frame of a sample scene at 640x480 on CSoftDevice, the argument is
+//the index of the scene
+static void Scene_Frame(benchmark::State &State)
+{
+	const scene_desc *pDesc = Scene_Get((int)State.range(0));
+	State.SetLabel(pDesc->szName);
+
+	scene Scene;
+	if(FAILED(Scene_Init(&Scene, pDesc, 640, 480, SAMPLES_ROOT)))
+	{
+		State.SkipWithError("Scene_Init failed");
+		return;
+	}
+
+	float Angle = 0.0f;
+	for(auto _ : State)
+	{
+		Scene_Render(&Scene, Angle);
+		Angle += PI / 100.0f;
+	}
+
+	State.SetItemsProcessed(State.iterations() * 640 * 480);
+
+	Scene_Release(&Scene);
+}
+BENCHMARK(Scene_Frame)->DenseRange(0, Scene_Count() - 1)->Unit(benchmark::kMicrosecond);
+
+//the grid of 004 with the instancer against one draw per object
+static void Scene_Grid(benchmark::State &State)
+{
+	scene_options Options = {};
+	Options.dwObjects = 64;
+	Options.bInstance = State.range(0) != 0;
+	Options.Threads = 1;
+	State.SetLabel(Options.bInstance ? "instanced" : "one by one");
+
+	scene Scene;
+	if(FAILED(Scene_Init(&Scene, Scene_Find("004"), 640, 480, SAMPLES_ROOT, &Options)))
+	{
+		State.SkipWithError("Scene_Init failed");
+		return;
+	}
+
+	float Angle = 0.0f;
+	for(auto _ : State)
+	{
+		Scene_Render(&Scene, Angle);
+		Angle += PI / 100.0f;
+	}
+
+	Scene_Release(&Scene);
+}
+BENCHMARK(Scene_Grid)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
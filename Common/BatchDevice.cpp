@@ -0,0 +1,321 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <string.h>
+#include <new>
+
+#include "BatchDevice.h"
+#include "RenderStats.h"
+
+CBatchDevice::CBatchDevice()
+{
+	m_pDevice = NULL;
+	m_dwFlags = 0;
+	m_pVertices = NULL;
+	m_pIndices = NULL;
+	m_dwFVF = 0;
+	m_dwVertexCount = 0;
+	m_dwIndexCount = 0;
+	m_MatWorld = Mat4x4_Identity();
+	m_bWorldIdentity = true;
+	m_bWorldInDevice = true;
+	m_bInnerIdentity = false;
+}
+
+CBatchDevice::~CBatchDevice()
+{
+	Aligned_Free(m_pVertices);
+	Aligned_Free(m_pIndices);
+}
+
+HRESULT Create_Batch_Device(IRenderDevice *pDevice, DWORD dwFlags, CBatchDevice **ppBatch)
+{
+	if(!pDevice || !ppBatch)
+		return E_INVALIDARG;
+
+	*ppBatch = NULL;
+
+	CBatchDevice *pBatch = new(std::nothrow) CBatchDevice;
+	if(!pBatch)
+		return E_OUTOFMEMORY;
+
+	pBatch->m_pDevice = pDevice;
+	pBatch->m_dwFlags = dwFlags;
+	pBatch->m_bWorldInDevice = !(dwFlags & BATCH_WORLD);
+	pBatch->m_pVertices = (BYTE *)Aligned_Alloc(BATCH_VERTEX_BYTES, CACHE_LINE_SIZE);
+	pBatch->m_pIndices = (WORD *)Aligned_Alloc(BATCH_MAX_INDICES * sizeof(WORD), CACHE_LINE_SIZE);
+
+	if(!pBatch->m_pVertices || !pBatch->m_pIndices)
+	{
+		delete pBatch;
+		return E_OUTOFMEMORY;
+	}
+
+	*ppBatch = pBatch;
+
+	return S_OK;
+}
+
+ULONG CBatchDevice::Release()
+{
+	delete this;
+	return 0;
+}
+
+//batches of moved vertices are drawn with the identity matrix, draws
+//that can not be batched with the world matrix of the application
+HRESULT CBatchDevice::Set_Inner_World(bool bIdentity)
+{
+	if(m_bWorldInDevice)
+		return S_OK;
+
+	if(bIdentity)
+	{
+		if(m_bInnerIdentity)
+			return S_OK;
+
+		matrix4x4 MatIdentity = Mat4x4_Identity();
+		m_bInnerIdentity = true;
+		return m_pDevice->SetTransform(SRTS_WORLD, &MatIdentity);
+	}
+
+	m_bInnerIdentity = m_bWorldIdentity;
+	return m_pDevice->SetTransform(SRTS_WORLD, &m_MatWorld);
+}
+
+HRESULT CBatchDevice::Flush()
+{
+	if(!m_dwIndexCount)
+	{
+		m_dwVertexCount = 0;
+		return S_OK;
+	}
+
+	Set_Inner_World(true);
+
+	HRESULT hr = m_pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, m_dwFVF,
+		m_pVertices, m_dwVertexCount, m_pIndices, m_dwIndexCount, 0);
+
+	Stats_Local()->dwBatchesOut++;
+
+	m_dwVertexCount = 0;
+	m_dwIndexCount = 0;
+
+	return hr;
+}
+
+HRESULT CBatchDevice::Add(DWORD dwFVF, const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount)
+{
+	DWORD dwStride = Soft_FVF_Stride(dwFVF);
+	dwIndexCount -= dwIndexCount % 3;
+
+	if(m_dwVertexCount && (dwFVF != m_dwFVF ||
+		m_dwVertexCount + dwVertexCount > BATCH_MAX_VERTICES ||
+		m_dwIndexCount + dwIndexCount > BATCH_MAX_INDICES ||
+		(m_dwVertexCount + dwVertexCount) * dwStride > BATCH_VERTEX_BYTES))
+	{
+		HRESULT hr = Flush();
+		if(FAILED(hr))
+			return hr;
+	}
+
+	m_dwFVF = dwFVF;
+
+	BYTE *pOut = m_pVertices + m_dwVertexCount * dwStride;
+	memcpy(pOut, pVertices, dwVertexCount * dwStride);
+
+	//positions and normals to world space, the rest of the vertex is
+	//copied. The matrix is affine, the last column is not used
+	if(!m_bWorldInDevice && !m_bWorldIdentity && !(dwFVF & SRFVF_XYZRHW))
+	{
+		const float *m = m_MatWorld.Mat;
+		bool bNormal = (dwFVF & SRFVF_NORMAL) != 0;
+
+		for(DWORD i = 0; i < dwVertexCount; i++, pOut += dwStride)
+		{
+			float *pPos = (float *)pOut;
+			float x = pPos[0], y = pPos[1], z = pPos[2];
+			pPos[0] = x * m[M00] + y * m[M10] + z * m[M20] + m[M30];
+			pPos[1] = x * m[M01] + y * m[M11] + z * m[M21] + m[M31];
+			pPos[2] = x * m[M02] + y * m[M12] + z * m[M22] + m[M32];
+
+			if(bNormal)
+			{
+				x = pPos[3]; y = pPos[4]; z = pPos[5];
+				pPos[3] = x * m[M00] + y * m[M10] + z * m[M20];
+				pPos[4] = x * m[M01] + y * m[M11] + z * m[M21];
+				pPos[5] = x * m[M02] + y * m[M12] + z * m[M22];
+			}
+		}
+	}
+
+	//triangles with an index out of range are dropped, as the device does
+	WORD *pIndexOut = m_pIndices + m_dwIndexCount;
+	WORD wBase = (WORD)m_dwVertexCount;
+
+	for(DWORD i = 0; i < dwIndexCount; i += 3)
+	{
+		DWORD i0 = pIndices ? pIndices[i] : i;
+		DWORD i1 = pIndices ? pIndices[i + 1] : i + 1;
+		DWORD i2 = pIndices ? pIndices[i + 2] : i + 2;
+
+		if(i0 >= dwVertexCount || i1 >= dwVertexCount || i2 >= dwVertexCount)
+			continue;
+
+		pIndexOut[0] = (WORD)(wBase + i0);
+		pIndexOut[1] = (WORD)(wBase + i1);
+		pIndexOut[2] = (WORD)(wBase + i2);
+		pIndexOut += 3;
+	}
+
+	m_dwVertexCount += dwVertexCount;
+	m_dwIndexCount = (DWORD)(pIndexOut - m_pIndices);
+
+	return S_OK;
+}
+
+HRESULT CBatchDevice::DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags)
+{
+	Stats_Local()->dwBatchDrawsIn++;
+
+	if(dwPrimType == SRPT_TRIANGLELIST && pVertices && pIndices &&
+		dwVertexCount <= BATCH_MAX_VERTICES && dwIndexCount <= BATCH_MAX_INDICES &&
+		dwVertexCount * Soft_FVF_Stride(dwFVF) <= BATCH_VERTEX_BYTES)
+		return Add(dwFVF, pVertices, dwVertexCount, pIndices, dwIndexCount);
+
+	//strips, fans and draws larger than the buffer go to the device as they are
+	Flush();
+	Set_Inner_World(false);
+	Stats_Local()->dwBatchesOut++;
+
+	return m_pDevice->DrawIndexedPrimitive(dwPrimType, dwFVF, pVertices, dwVertexCount,
+		pIndices, dwIndexCount, dwFlags);
+}
+
+HRESULT CBatchDevice::DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags)
+{
+	Stats_Local()->dwBatchDrawsIn++;
+
+	if(dwPrimType == SRPT_TRIANGLELIST && pVertices &&
+		dwVertexCount <= BATCH_MAX_VERTICES && dwVertexCount <= BATCH_MAX_INDICES &&
+		dwVertexCount * Soft_FVF_Stride(dwFVF) <= BATCH_VERTEX_BYTES)
+		return Add(dwFVF, pVertices, dwVertexCount, NULL, dwVertexCount);
+
+	Flush();
+	Set_Inner_World(false);
+	Stats_Local()->dwBatchesOut++;
+
+	return m_pDevice->DrawPrimitive(dwPrimType, dwFVF, pVertices, dwVertexCount, dwFlags);
+}
+
+HRESULT CBatchDevice::SetRenderState(DWORD dwState, DWORD dwValue)
+{
+	Flush();
+	return m_pDevice->SetRenderState(dwState, dwValue);
+}
+
+HRESULT CBatchDevice::GetRenderState(DWORD dwState, DWORD *pdwValue)
+{
+	return m_pDevice->GetRenderState(dwState, pdwValue);
+}
+
+HRESULT CBatchDevice::SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue)
+{
+	Flush();
+	return m_pDevice->SetTextureStageState(dwStage, dwState, dwValue);
+}
+
+HRESULT CBatchDevice::SetTexture(DWORD dwStage, soft_texture *pTexture)
+{
+	Flush();
+	return m_pDevice->SetTexture(dwStage, pTexture);
+}
+
+HRESULT CBatchDevice::SetTransform(DWORD dwState, const matrix4x4 *pMatrix)
+{
+	//an affine world matrix stays in the batcher, the others end the batch
+	if((m_dwFlags & BATCH_WORLD) && dwState == SRTS_WORLD && pMatrix &&
+		pMatrix->Mat[M03] == 0.0f && pMatrix->Mat[M13] == 0.0f &&
+		pMatrix->Mat[M23] == 0.0f && pMatrix->Mat[M33] == 1.0f)
+	{
+		//the batch so far was made for the matrix in the device
+		if(m_bWorldInDevice)
+			Flush();
+
+		m_MatWorld = *pMatrix;
+		m_bWorldIdentity = Mat4x4_Equal(m_MatWorld, Mat4x4_Identity());
+		m_bWorldInDevice = false;
+		return S_OK;
+	}
+
+	Flush();
+
+	//the vertices are not moved until the next affine world matrix
+	if(dwState == SRTS_WORLD && pMatrix)
+	{
+		m_bWorldInDevice = true;
+		m_bInnerIdentity = false;
+	}
+
+	return m_pDevice->SetTransform(dwState, pMatrix);
+}
+
+HRESULT CBatchDevice::SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight)
+{
+	Flush();
+	return m_pDevice->SetViewport(dwX, dwY, dwWidth, dwHeight);
+}
+
+HRESULT CBatchDevice::ApplyStateBlock(state_block *pBlock)
+{
+	Flush();
+	return m_pDevice->ApplyStateBlock(pBlock);
+}
+
+HRESULT CBatchDevice::Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ)
+{
+	Flush();
+	return m_pDevice->Clear(dwCount, pRects, dwFlags, dwColor, fZ);
+}
+
+HRESULT CBatchDevice::BeginScene()
+{
+	return m_pDevice->BeginScene();
+}
+
+HRESULT CBatchDevice::EndScene()
+{
+	Flush();
+	return m_pDevice->EndScene();
+}
+
+HRESULT CBatchDevice::CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture)
+{
+	return m_pDevice->CreateTexture(dwWidth, dwHeight, ppTexture);
+}
+
+void CBatchDevice::DestroyTexture(soft_texture *pTexture)
+{
+	Flush();
+	m_pDevice->DestroyTexture(pTexture);
+}
+
+DWORD CBatchDevice::GetTextureHandle(soft_texture *pTexture)
+{
+	return m_pDevice->GetTextureHandle(pTexture);
+}
+
+DWORD CBatchDevice::GetWidth()
+{
+	return m_pDevice->GetWidth();
+}
+
+DWORD CBatchDevice::GetHeight()
+{
+	return m_pDevice->GetHeight();
+}
@@ -0,0 +1,94 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _BATCHDEVICE_H_
+#define _BATCHDEVICE_H_
+
+#include "Platform.h"
+#include "SoftDevice.h"
+
+//IRenderDevice in front of another device that puts triangle list draws
+//with the same states, texture and vertex format into one buffer, the
+//indices are moved by the vertices already in the buffer. The batch is
+//drawn with one call when a state changes, the buffer is full and at
+//EndScene(). Draws in and batches out are counted in render_stats.
+//
+//every state call ends the batch, put CFilterDevice in front of the
+//batcher so calls that change nothing do not break batches
+
+//vertices are moved to world space on the CPU when they are added, a
+//new world matrix does not end the batch, the device draws the batch
+//with the identity world matrix
+#define BATCH_WORLD			0x0001
+
+#define BATCH_MAX_VERTICES	SRMAXNUMVERTICES
+#define BATCH_MAX_INDICES	(3 * 32768)
+#define BATCH_VERTEX_BYTES	(1024 * 1024)
+
+class CBatchDevice : public IRenderDevice
+{
+public:
+	HRESULT SetRenderState(DWORD dwState, DWORD dwValue);
+	HRESULT GetRenderState(DWORD dwState, DWORD *pdwValue);
+	HRESULT SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue);
+	HRESULT SetTexture(DWORD dwStage, soft_texture *pTexture);
+	HRESULT SetTransform(DWORD dwState, const matrix4x4 *pMatrix);
+	HRESULT SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight);
+	HRESULT ApplyStateBlock(state_block *pBlock);
+
+	HRESULT Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ);
+	HRESULT BeginScene();
+	HRESULT EndScene();
+
+	HRESULT DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags);
+	HRESULT DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags);
+
+	HRESULT CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture);
+	void DestroyTexture(soft_texture *pTexture);
+	DWORD GetTextureHandle(soft_texture *pTexture);
+
+	DWORD GetWidth();
+	DWORD GetHeight();
+
+	//the device behind the batcher is not released
+	ULONG Release();
+
+	//draws the batch now
+	HRESULT Flush();
+
+private:
+	friend HRESULT Create_Batch_Device(IRenderDevice *pDevice, DWORD dwFlags, CBatchDevice **ppBatch);
+
+	CBatchDevice();
+	~CBatchDevice();
+
+	HRESULT Add(DWORD dwFVF, const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount);
+	HRESULT Set_Inner_World(bool bIdentity);
+
+	IRenderDevice *m_pDevice;
+	DWORD m_dwFlags;
+
+	BYTE *m_pVertices;
+	WORD *m_pIndices;
+	DWORD m_dwFVF;
+	DWORD m_dwVertexCount;
+	DWORD m_dwIndexCount;
+
+	//BATCH_WORLD: the world matrix of the application, the device has
+	//the identity matrix while batches are drawn. m_bWorldInDevice is
+	//true without BATCH_WORLD and after a world matrix that is not affine,
+	//then the vertices are not moved
+	matrix4x4 m_MatWorld;
+	bool m_bWorldIdentity;
+	bool m_bWorldInDevice;
+	bool m_bInnerIdentity;
+};
+
+HRESULT Create_Batch_Device(IRenderDevice *pDevice, DWORD dwFlags, CBatchDevice **ppBatch);
+
+#endif
@@ -0,0 +1,225 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+
+#include "Bitmap.h"
+
+//file is little endian, read byte by byte so the structure
+//packing of the compiler does not matter
+static DWORD Read_U32(const BYTE *p)
+{
+	return (DWORD)p[0] | ((DWORD)p[1] << 8) | ((DWORD)p[2] << 16) | ((DWORD)p[3] << 24);
+}
+
+static WORD Read_U16(const BYTE *p)
+{
+	return (WORD)(p[0] | (p[1] << 8));
+}
+
+bool Bitmap_Load(const char *szFilename, bitmap *pBitmap)
+{
+	ZeroMemory(pBitmap, sizeof(bitmap));
+
+	FILE *pFile = fopen(szFilename, "rb");
+	if(!pFile)
+		return false;
+
+	fseek(pFile, 0, SEEK_END);
+	long Size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	//BITMAPFILEHEADER is 14 bytes, BITMAPINFOHEADER 40 bytes
+	if(Size < 54)
+	{
+		fclose(pFile);
+		return false;
+	}
+
+	BYTE *pData = new(std::nothrow) BYTE[Size];
+	if(!pData)
+	{
+		fclose(pFile);
+		return false;
+	}
+
+	bool bRead = fread(pData, 1, Size, pFile) == (size_t)Size;
+	fclose(pFile);
+
+	if(!bRead || pData[0] != 'B' || pData[1] != 'M')
+	{
+		delete [] pData;
+		return false;
+	}
+
+	DWORD dwOffBits = Read_U32(pData + 10);
+	DWORD dwHeaderSize = Read_U32(pData + 14);
+	LONG Width = (LONG)Read_U32(pData + 18);
+	LONG Height = (LONG)Read_U32(pData + 22);
+	WORD wBitCount = Read_U16(pData + 28);
+	DWORD dwCompression = Read_U32(pData + 30);
+	DWORD dwClrUsed = Read_U32(pData + 46);
+
+	//negative height is a top-down bitmap
+	bool bTopDown = Height < 0;
+	if(bTopDown)
+		Height = -Height;
+
+	if(Width <= 0 || Height == 0 || dwCompression != 0 ||
+		(wBitCount != 8 && wBitCount != 24 && wBitCount != 32))
+	{
+		delete [] pData;
+		return false;
+	}
+
+	DWORD dwPitch = ((Width * wBitCount + 31) / 32) * 4;
+	if(dwOffBits + dwPitch * Height > (DWORD)Size)
+	{
+		delete [] pData;
+		return false;
+	}
+
+	DWORD Palette[256];
+	memset(Palette, 0, sizeof(Palette));
+	if(wBitCount == 8)
+	{
+		DWORD dwColors = dwClrUsed ? dwClrUsed : 256;
+		if(dwColors > 256)
+			dwColors = 256;
+
+		//RGBQUAD is blue, green, red, reserved, same as X8R8G8B8
+		const BYTE *pPal = pData + 14 + dwHeaderSize;
+		for(DWORD i = 0; i < dwColors && pPal + i * 4 + 4 <= pData + Size; i++)
+			Palette[i] = Read_U32(pPal + i * 4) & 0xffffff;
+	}
+
+	pBitmap->pBits = new(std::nothrow) DWORD[Width * Height];
+	if(!pBitmap->pBits)
+	{
+		delete [] pData;
+		return false;
+	}
+
+	pBitmap->dwWidth = Width;
+	pBitmap->dwHeight = Height;
+	pBitmap->dwBitCount = wBitCount;
+
+	for(LONG y = 0; y < Height; y++)
+	{
+		const BYTE *pSrc = pData + dwOffBits + dwPitch * (bTopDown ? y : Height - 1 - y);
+		DWORD *pDest = pBitmap->pBits + y * Width;
+
+		for(LONG x = 0; x < Width; x++)
+		{
+			if(wBitCount == 8)
+				pDest[x] = Palette[pSrc[x]];
+			else if(wBitCount == 24)
+				pDest[x] = pSrc[x * 3] | (pSrc[x * 3 + 1] << 8) | (pSrc[x * 3 + 2] << 16);
+			else
+				pDest[x] = Read_U32(pSrc + x * 4) & 0xffffff;
+		}
+	}
+
+	delete [] pData;
+
+	return true;
+}
+
+//next number of the PPM header, # starts a comment up to the end of the line
+static bool Read_PPM_Number(FILE *pFile, DWORD *pdwValue)
+{
+	int c = fgetc(pFile);
+	for(;;)
+	{
+		if(c == '#')
+		{
+			while(c != '\n' && c != EOF)
+				c = fgetc(pFile);
+		}
+		else if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			c = fgetc(pFile);
+		else
+			break;
+	}
+
+	if(c < '0' || c > '9')
+		return false;
+
+	DWORD dwValue = 0;
+	while(c >= '0' && c <= '9')
+	{
+		dwValue = dwValue * 10 + (c - '0');
+		if(dwValue > 65535)
+			return false;
+		c = fgetc(pFile);
+	}
+
+	//one white space character ends the header
+	*pdwValue = dwValue;
+	return c != EOF;
+}
+
+bool Bitmap_Load_PPM(const char *szFilename, bitmap *pBitmap)
+{
+	ZeroMemory(pBitmap, sizeof(bitmap));
+
+	FILE *pFile = fopen(szFilename, "rb");
+	if(!pFile)
+		return false;
+
+	DWORD dwWidth, dwHeight, dwMax;
+	if(fgetc(pFile) != 'P' || fgetc(pFile) != '6' ||
+		!Read_PPM_Number(pFile, &dwWidth) ||
+		!Read_PPM_Number(pFile, &dwHeight) ||
+		!Read_PPM_Number(pFile, &dwMax) ||
+		!dwWidth || !dwHeight || dwMax != 255)
+	{
+		fclose(pFile);
+		return false;
+	}
+
+	DWORD *pBits = new(std::nothrow) DWORD[dwWidth * dwHeight];
+	BYTE *pRow = new(std::nothrow) BYTE[dwWidth * 3];
+	if(!pBits || !pRow)
+	{
+		delete [] pBits;
+		delete [] pRow;
+		fclose(pFile);
+		return false;
+	}
+
+	bool bOk = true;
+	for(DWORD y = 0; y < dwHeight && bOk; y++)
+	{
+		bOk = fread(pRow, 1, dwWidth * 3, pFile) == dwWidth * 3;
+
+		DWORD *pDest = pBits + y * dwWidth;
+		for(DWORD x = 0; x < dwWidth && bOk; x++)
+			pDest[x] = ((DWORD)pRow[x * 3] << 16) | ((DWORD)pRow[x * 3 + 1] << 8) | pRow[x * 3 + 2];
+	}
+
+	delete [] pRow;
+	fclose(pFile);
+
+	if(!bOk)
+	{
+		delete [] pBits;
+		return false;
+	}
+
+	pBitmap->pBits = pBits;
+	pBitmap->dwWidth = dwWidth;
+	pBitmap->dwHeight = dwHeight;
+	pBitmap->dwBitCount = 24;
+
+	return true;
+}
+
+void Bitmap_Free(bitmap *pBitmap)
+{
+	delete [] pBitmap->pBits;
+	pBitmap->pBits = NULL;
+}
@@ -0,0 +1,26 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _BITMAP_H_
+#define _BITMAP_H_
+
+#include "Platform.h"
+
+//BMP file reader without LoadImage(), 8 bit with palette,
+//24 and 32 bit uncompressed files are read
+
+struct bitmap
+{
+	DWORD *pBits;		//X8R8G8B8, first row is the top of the image
+	DWORD dwWidth;
+	DWORD dwHeight;
+	DWORD dwBitCount;	//bits per pixel in the file
+};
+
+bool Bitmap_Load(const char *szFilename, bitmap *pBitmap);
+//binary PPM (P6) with 255 as the maximum, as Write_PPM() writes it
+bool Bitmap_Load_PPM(const char *szFilename, bitmap *pBitmap);
+void Bitmap_Free(bitmap *pBitmap);
+
+#endif
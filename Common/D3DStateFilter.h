@@ -0,0 +1,154 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _D3DSTATEFILTER_H_
+#define _D3DSTATEFILTER_H_
+
+#include <d3d.h>
+
+#include "StateCache.h"
+#include "StateBlock.h"
+
+//state calls of the samples go through a filter in front of the device,
+//a call that sets what the device already has does not reach the driver.
+//Attach() after the device is created, the other calls go straight to
+//the device as before. When a call fails the cache is reset, the device
+//may not have the value. Apply() sets the states of a block, only the
+//ones that are different go to the device
+
+class CD3D3StateFilter
+{
+public:
+	CD3D3StateFilter() { m_pDevice = NULL; ZeroMemory(&m_Cache, sizeof(state_cache)); }
+
+	void Attach(LPDIRECT3DDEVICE3 pDevice) { m_pDevice = pDevice; State_Cache_Reset(&m_Cache); }
+	const state_cache *Cache() { return &m_Cache; }
+
+	//the texture handle and SetTexture() of stage 0 set the same texture,
+	//when one goes to the device the other is not known any more
+	HRESULT SetRenderState(D3DRENDERSTATETYPE State, DWORD dwValue)
+	{
+		if(!State_Cache_Render(&m_Cache, (DWORD)State, dwValue))
+			return D3D_OK;
+		if(State == D3DRENDERSTATE_TEXTUREHANDLE)
+			State_Cache_Forget_Stage_Texture(&m_Cache, 0);
+		return Check(m_pDevice->SetRenderState(State, dwValue));
+	}
+
+	HRESULT SetTextureStageState(DWORD dwStage, D3DTEXTURESTAGESTATETYPE State, DWORD dwValue)
+	{
+		if(!State_Cache_Stage(&m_Cache, dwStage, (DWORD)State, dwValue))
+			return D3D_OK;
+		return Check(m_pDevice->SetTextureStageState(dwStage, State, dwValue));
+	}
+
+	HRESULT SetTexture(DWORD dwStage, LPDIRECT3DTEXTURE2 pTexture)
+	{
+		if(!State_Cache_Texture(&m_Cache, dwStage, pTexture))
+			return D3D_OK;
+		if(dwStage == 0)
+			State_Cache_Forget_Render(&m_Cache, (DWORD)D3DRENDERSTATE_TEXTUREHANDLE);
+		return Check(m_pDevice->SetTexture(dwStage, pTexture));
+	}
+
+	HRESULT SetTransform(D3DTRANSFORMSTATETYPE State, LPD3DMATRIX pMatrix)
+	{
+		if(!State_Cache_Transform(&m_Cache, (DWORD)State, (const float *)pMatrix))
+			return D3D_OK;
+		return Check(m_pDevice->SetTransform(State, pMatrix));
+	}
+
+	HRESULT Apply(const state_block *pBlock)
+	{
+		HRESULT hr = D3D_OK;
+
+		for(DWORD i = 0; i < pBlock->dwCount; i++)
+		{
+			const state_block_entry *pEntry = &pBlock->Entries[i];
+			HRESULT hrSet;
+
+			if(pEntry->dwStage == SB_RENDER)
+				hrSet = SetRenderState((D3DRENDERSTATETYPE)pEntry->dwState, pEntry->dwValue);
+			else
+				hrSet = SetTextureStageState(pEntry->dwStage, (D3DTEXTURESTAGESTATETYPE)pEntry->dwState, pEntry->dwValue);
+
+			if(FAILED(hrSet))
+				hr = hrSet;
+		}
+
+		return hr;
+	}
+
+private:
+	HRESULT Check(HRESULT hr)
+	{
+		if(FAILED(hr))
+			State_Cache_Reset(&m_Cache);
+		return hr;
+	}
+
+	LPDIRECT3DDEVICE3 m_pDevice;
+	state_cache m_Cache;
+};
+
+//Direct3D2 has no texture stages, the texture is a render state
+//(D3DRENDERSTATE_TEXTUREHANDLE), a block with texture stage states can
+//not be applied
+class CD3D2StateFilter
+{
+public:
+	CD3D2StateFilter() { m_pDevice = NULL; ZeroMemory(&m_Cache, sizeof(state_cache)); }
+
+	void Attach(LPDIRECT3DDEVICE2 pDevice) { m_pDevice = pDevice; State_Cache_Reset(&m_Cache); }
+	const state_cache *Cache() { return &m_Cache; }
+
+	HRESULT SetRenderState(D3DRENDERSTATETYPE State, DWORD dwValue)
+	{
+		if(!State_Cache_Render(&m_Cache, (DWORD)State, dwValue))
+			return D3D_OK;
+		return Check(m_pDevice->SetRenderState(State, dwValue));
+	}
+
+	HRESULT SetTransform(D3DTRANSFORMSTATETYPE State, LPD3DMATRIX pMatrix)
+	{
+		if(!State_Cache_Transform(&m_Cache, (DWORD)State, (const float *)pMatrix))
+			return D3D_OK;
+		return Check(m_pDevice->SetTransform(State, pMatrix));
+	}
+
+	HRESULT Apply(const state_block *pBlock)
+	{
+		HRESULT hr = D3D_OK;
+
+		for(DWORD i = 0; i < pBlock->dwCount; i++)
+		{
+			const state_block_entry *pEntry = &pBlock->Entries[i];
+
+			if(pEntry->dwStage != SB_RENDER)
+			{
+				hr = DDERR_INVALIDPARAMS;
+				continue;
+			}
+
+			HRESULT hrSet = SetRenderState((D3DRENDERSTATETYPE)pEntry->dwState, pEntry->dwValue);
+			if(FAILED(hrSet))
+				hr = hrSet;
+		}
+
+		return hr;
+	}
+
+private:
+	HRESULT Check(HRESULT hr)
+	{
+		if(FAILED(hr))
+			State_Cache_Reset(&m_Cache);
+		return hr;
+	}
+
+	LPDIRECT3DDEVICE2 m_pDevice;
+	state_cache m_Cache;
+};
+
+#endif
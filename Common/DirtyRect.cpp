@@ -0,0 +1,112 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <math.h>
+
+#include "DirtyRect.h"
+
+bool Rect_Is_Empty(const RECT *pRect)
+{
+	return pRect->left >= pRect->right || pRect->top >= pRect->bottom;
+}
+
+RECT Rect_Union(const RECT *pA, const RECT *pB)
+{
+	if(Rect_Is_Empty(pA))
+		return *pB;
+	if(Rect_Is_Empty(pB))
+		return *pA;
+
+	RECT Rc;
+	Rc.left = pA->left < pB->left ? pA->left : pB->left;
+	Rc.top = pA->top < pB->top ? pA->top : pB->top;
+	Rc.right = pA->right > pB->right ? pA->right : pB->right;
+	Rc.bottom = pA->bottom > pB->bottom ? pA->bottom : pB->bottom;
+
+	return Rc;
+}
+
+RECT Rect_Of_Vertices(const void *pVertices, DWORD dwCount, DWORD dwStride)
+{
+	RECT Rc = { 0, 0, 0, 0 };
+	if(!dwCount)
+		return Rc;
+
+	const BYTE *pVert = (const BYTE *)pVertices;
+	float MinX = ((const float *)pVert)[0], MaxX = MinX;
+	float MinY = ((const float *)pVert)[1], MaxY = MinY;
+
+	for(DWORD i = 1; i < dwCount; i++)
+	{
+		pVert += dwStride;
+		float x = ((const float *)pVert)[0];
+		float y = ((const float *)pVert)[1];
+		if(x < MinX) MinX = x;
+		if(x > MaxX) MaxX = x;
+		if(y < MinY) MinY = y;
+		if(y > MaxY) MaxY = y;
+	}
+
+	//a pixel more on every side, the rasterizer may round either way
+	Rc.left = (LONG)floorf(MinX) - 1;
+	Rc.top = (LONG)floorf(MinY) - 1;
+	Rc.right = (LONG)ceilf(MaxX) + 1;
+	Rc.bottom = (LONG)ceilf(MaxY) + 1;
+
+	return Rc;
+}
+
+//inside the screen and small enough to be worth it
+static bool Clip_Rect(const dirty_rect *pDirty, RECT *pRect)
+{
+	if(pRect->left < 0) pRect->left = 0;
+	if(pRect->top < 0) pRect->top = 0;
+	if(pRect->right > (LONG)pDirty->dwWidth) pRect->right = (LONG)pDirty->dwWidth;
+	if(pRect->bottom > (LONG)pDirty->dwHeight) pRect->bottom = (LONG)pDirty->dwHeight;
+
+	if(Rect_Is_Empty(pRect))
+		return true;
+
+	DWORD dwArea = (DWORD)(pRect->right - pRect->left) * (DWORD)(pRect->bottom - pRect->top);
+	return dwArea * 100 <= pDirty->dwWidth * pDirty->dwHeight * pDirty->dwMaxPercent;
+}
+
+void Dirty_Init(dirty_rect *pDirty, DWORD dwWidth, DWORD dwHeight, DWORD dwMaxPercent)
+{
+	pDirty->dwWidth = dwWidth;
+	pDirty->dwHeight = dwHeight;
+	pDirty->dwMaxPercent = dwMaxPercent;
+	RECT RcEmpty = { 0, 0, 0, 0 };
+	pDirty->RcLast = RcEmpty;
+	pDirty->bFull = true;
+}
+
+void Dirty_Invalidate(dirty_rect *pDirty)
+{
+	pDirty->bFull = true;
+}
+
+bool Dirty_Clear_Rect(const dirty_rect *pDirty, RECT *pRect)
+{
+	if(pDirty->bFull)
+		return false;
+
+	*pRect = pDirty->RcLast;
+	return Clip_Rect(pDirty, pRect);
+}
+
+bool Dirty_End_Frame(dirty_rect *pDirty, const RECT *pRcDrawn, RECT *pRcPresent)
+{
+	bool bFull = pDirty->bFull;
+
+	*pRcPresent = Rect_Union(&pDirty->RcLast, pRcDrawn);
+
+	pDirty->RcLast = *pRcDrawn;
+	pDirty->bFull = false;
+
+	if(bFull)
+		return false;
+
+	return Clip_Rect(pDirty, pRcPresent);
+}
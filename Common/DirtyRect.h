@@ -0,0 +1,55 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _DIRTYRECT_H_
+#define _DIRTYRECT_H_
+
+#include "Platform.h"
+
+//clear and present only the part of the screen that changed. A frame
+//clears what the frame before drew and presents that together with what
+//it draws itself, everything else of the back buffer and the screen is
+//still the background. One frame:
+//
+//  if(Dirty_Clear_Rect(&Dirty, &Rc)) clear Rc, else clear everything
+//  draw, the device gives the bounds of the pixels it drew
+//  if(Dirty_End_Frame(&Dirty, &RcDrawn, &Rc)) present Rc, else present everything
+//
+//when the rectangle is more than dwMaxPercent of the screen the whole
+//screen is cleared or presented, one big copy is cheaper than the checks
+
+#define DIRTY_MAX_PERCENT 50
+
+struct dirty_rect
+{
+	DWORD dwWidth;
+	DWORD dwHeight;
+	DWORD dwMaxPercent;
+	RECT RcLast;		//drawn by the last frame
+	bool bFull;			//the next frame clears and presents everything
+};
+
+void Dirty_Init(dirty_rect *pDirty, DWORD dwWidth, DWORD dwHeight, DWORD dwMaxPercent);
+
+//the screen lost its content: first frame, window moved or uncovered
+void Dirty_Invalidate(dirty_rect *pDirty);
+
+//the part to clear before drawing, false for all of it.
+//An empty rectangle is fine, nothing needs clearing
+bool Dirty_Clear_Rect(const dirty_rect *pDirty, RECT *pRect);
+
+//pRcDrawn is what the frame drew (empty when nothing), pRcPresent gets
+//the part to present, false for all of it
+bool Dirty_End_Frame(dirty_rect *pDirty, const RECT *pRcDrawn, RECT *pRcPresent);
+
+//rectangles with left >= right or top >= bottom are empty
+bool Rect_Is_Empty(const RECT *pRect);
+RECT Rect_Union(const RECT *pA, const RECT *pB);
+
+//pixels a draw of XYZRHW vertices can touch, x and y are the first two
+//floats of every vertex, dwStride bytes apart. For renderers that do not
+//report what they drew, like the Direct3D rasterizers
+RECT Rect_Of_Vertices(const void *pVertices, DWORD dwCount, DWORD dwStride);
+
+#endif
@@ -0,0 +1,747 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+
+#include "DrawTrace.h"
+
+static DWORD Float_Bits(float f)
+{
+	DWORD dw;
+	memcpy(&dw, &f, sizeof(DWORD));
+	return dw;
+}
+
+static float Bits_Float(DWORD dw)
+{
+	float f;
+	memcpy(&f, &dw, sizeof(float));
+	return f;
+}
+
+//FNV-1a, only finds the candidates, the bytes are compared after it
+static DWORD Hash_Data(const void *pData, DWORD dwSize)
+{
+	const BYTE *p = (const BYTE *)pData;
+	DWORD dwHash = 2166136261u;
+	for(DWORD i = 0; i < dwSize; i++)
+		dwHash = (dwHash ^ p[i]) * 16777619u;
+	return dwHash;
+}
+
+//-------------------------------------------------------------------------
+// recording
+//-------------------------------------------------------------------------
+
+CRecordDevice::CRecordDevice()
+{
+	m_pDevice = NULL;
+	m_pFile = NULL;
+	m_bGood = true;
+	m_dwNextBlob = 0;
+
+	ZeroMemory(m_Blobs, sizeof(m_Blobs));
+	ZeroMemory(m_pTextures, sizeof(m_pTextures));
+	ZeroMemory(m_bTexelsWritten, sizeof(m_bTexelsWritten));
+}
+
+CRecordDevice::~CRecordDevice()
+{
+	if(m_pFile)
+		fclose(m_pFile);
+
+	for(DWORD i = 0; i < DRAW_TRACE_BLOBS; i++)
+		delete [] m_Blobs[i].pData;
+}
+
+HRESULT Create_Record_Device(IRenderDevice *pDevice, const char *szFilename, CRecordDevice **ppRecorder)
+{
+	if(!pDevice || !ppRecorder)
+		return E_INVALIDARG;
+
+	*ppRecorder = NULL;
+
+	CRecordDevice *pRecorder = new(std::nothrow) CRecordDevice;
+	if(!pRecorder)
+		return E_OUTOFMEMORY;
+
+	pRecorder->m_pDevice = pDevice;
+	pRecorder->m_pFile = fopen(szFilename, "wb");
+	if(!pRecorder->m_pFile)
+	{
+		delete pRecorder;
+		return E_FAIL;
+	}
+
+	//draws write many small records, a big buffer keeps fwrite() cheap
+	setvbuf(pRecorder->m_pFile, NULL, _IOFBF, 1 << 20);
+
+	DWORD dwZEnable = FALSE;
+	pDevice->GetRenderState(SRRS_ZENABLE, &dwZEnable);
+
+	draw_trace_header Header;
+	Header.dwMagic = DRAW_TRACE_MAGIC;
+	Header.dwVersion = DRAW_TRACE_VERSION;
+	Header.dwWidth = pDevice->GetWidth();
+	Header.dwHeight = pDevice->GetHeight();
+	Header.dwZBuffer = dwZEnable ? TRUE : FALSE;
+
+	pRecorder->Write_Data(&Header, sizeof(Header));
+
+	*ppRecorder = pRecorder;
+
+	return S_OK;
+}
+
+ULONG CRecordDevice::Release()
+{
+	delete this;
+	return 0;
+}
+
+void CRecordDevice::Write_Data(const void *pData, DWORD dwSize)
+{
+	if(m_bGood && dwSize && fwrite(pData, 1, dwSize, m_pFile) != dwSize)
+		m_bGood = false;
+}
+
+//first DWORD of a record, nothing more is written when the payload does
+//not fit in its 24 bits
+DWORD CRecordDevice::Record_Head(DWORD dwType, LONGLONG Count)
+{
+	if(Count > DRAW_TRACE_MAX_COUNT)
+	{
+		m_bGood = false;
+		return dwType;
+	}
+
+	return dwType | ((DWORD)Count << 8);
+}
+
+void CRecordDevice::Write_Record(DWORD dwType, const DWORD *pData, DWORD dwCount)
+{
+	DWORD dwHead = Record_Head(dwType, dwCount);
+	Write_Data(&dwHead, sizeof(DWORD));
+	Write_Data(pData, dwCount * sizeof(DWORD));
+}
+
+//slot of the data, a blob record is written when no slot has it. dwKeep
+//is a slot the same record uses already, it is not given to the data
+DWORD CRecordDevice::Write_Blob(const void *pData, DWORD dwSize, DWORD dwKeep)
+{
+	DWORD dwHash = Hash_Data(pData, dwSize);
+
+	for(DWORD i = 0; i < DRAW_TRACE_BLOBS; i++)
+	{
+		blob *pBlob = &m_Blobs[i];
+		if(pBlob->pData && pBlob->dwHash == dwHash && pBlob->dwSize == dwSize &&
+			memcmp(pBlob->pData, pData, dwSize) == 0)
+			return i;
+	}
+
+	//slots are reused in turn
+	if(m_dwNextBlob == dwKeep)
+		m_dwNextBlob = (m_dwNextBlob + 1) % DRAW_TRACE_BLOBS;
+
+	DWORD dwSlot = m_dwNextBlob;
+	m_dwNextBlob = (m_dwNextBlob + 1) % DRAW_TRACE_BLOBS;
+
+	blob *pBlob = &m_Blobs[dwSlot];
+	delete [] pBlob->pData;
+	pBlob->pData = new(std::nothrow) BYTE[dwSize ? dwSize : 1];
+	pBlob->dwSize = dwSize;
+	pBlob->dwHash = dwHash;
+
+	if(pBlob->pData)
+		memcpy(pBlob->pData, pData, dwSize);
+	else
+		m_bGood = false;
+
+	DWORD dwWords = (dwSize + 3) / 4;
+	DWORD Head[3];
+	Head[0] = Record_Head(DTR_BLOB, 2 + (LONGLONG)dwWords);
+	Head[1] = dwSlot;
+	Head[2] = dwSize;
+	Write_Data(Head, sizeof(Head));
+	Write_Data(pData, dwSize);
+
+	DWORD dwPad = 0;
+	Write_Data(&dwPad, dwWords * 4 - dwSize);
+
+	return dwSlot;
+}
+
+//the texels go to the file the first time a texture is used,
+//the caller fills them after CreateTexture()
+DWORD CRecordDevice::Texture_Id(soft_texture *pTexture)
+{
+	if(!pTexture)
+		return 0;
+
+	DWORD dwId = m_pDevice->GetTextureHandle(pTexture);
+	if(!dwId || dwId > SR_MAX_TEXTURES)
+	{
+		m_bGood = false;
+		return 0;
+	}
+
+	if(!m_bTexelsWritten[dwId])
+	{
+		DWORD dwCount = pTexture->dwWidth * pTexture->dwHeight;
+		DWORD dwHead[2];
+		dwHead[0] = Record_Head(DTR_TEXTUREDATA, 1 + (LONGLONG)dwCount);
+		dwHead[1] = dwId;
+		Write_Data(dwHead, sizeof(dwHead));
+		Write_Data(pTexture->pBits, dwCount * sizeof(DWORD));
+
+		m_bTexelsWritten[dwId] = true;
+	}
+
+	return dwId;
+}
+
+HRESULT CRecordDevice::SetRenderState(DWORD dwState, DWORD dwValue)
+{
+	DWORD Data[2] = { dwState, dwValue };
+
+	//handles of the recorded device are the texture ids of the trace
+	if(dwState == SRRS_TEXTUREHANDLE && dwValue && dwValue <= SR_MAX_TEXTURES)
+		Texture_Id(m_pTextures[dwValue]);
+
+	Write_Record(DTR_RENDERSTATE, Data, 2);
+	return m_pDevice->SetRenderState(dwState, dwValue);
+}
+
+HRESULT CRecordDevice::GetRenderState(DWORD dwState, DWORD *pdwValue)
+{
+	return m_pDevice->GetRenderState(dwState, pdwValue);
+}
+
+HRESULT CRecordDevice::SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue)
+{
+	DWORD Data[3] = { dwStage, dwState, dwValue };
+	Write_Record(DTR_TEXTURESTAGESTATE, Data, 3);
+	return m_pDevice->SetTextureStageState(dwStage, dwState, dwValue);
+}
+
+HRESULT CRecordDevice::SetTexture(DWORD dwStage, soft_texture *pTexture)
+{
+	DWORD Data[2] = { dwStage, Texture_Id(pTexture) };
+	Write_Record(DTR_SETTEXTURE, Data, 2);
+	return m_pDevice->SetTexture(dwStage, pTexture);
+}
+
+HRESULT CRecordDevice::SetTransform(DWORD dwState, const matrix4x4 *pMatrix)
+{
+	if(!pMatrix)
+		return m_pDevice->SetTransform(dwState, pMatrix);
+
+	DWORD Data[17];
+	Data[0] = dwState;
+	for(int i = 0; i < 16; i++)
+		Data[1 + i] = Float_Bits(pMatrix->Mat[i]);
+
+	Write_Record(DTR_TRANSFORM, Data, 17);
+	return m_pDevice->SetTransform(dwState, pMatrix);
+}
+
+HRESULT CRecordDevice::SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight)
+{
+	DWORD Data[4] = { dwX, dwY, dwWidth, dwHeight };
+	Write_Record(DTR_VIEWPORT, Data, 4);
+	return m_pDevice->SetViewport(dwX, dwY, dwWidth, dwHeight);
+}
+
+//the trace has the states of the block one by one, a replay sets the
+//same values without the block
+HRESULT CRecordDevice::ApplyStateBlock(state_block *pBlock)
+{
+	if(!pBlock)
+		return m_pDevice->ApplyStateBlock(pBlock);
+
+	for(DWORD i = 0; i < pBlock->dwCount; i++)
+	{
+		const state_block_entry *pEntry = &pBlock->Entries[i];
+
+		if(pEntry->dwStage == SB_RENDER)
+		{
+			DWORD Data[2] = { pEntry->dwState, pEntry->dwValue };
+
+			if(pEntry->dwState == SRRS_TEXTUREHANDLE && pEntry->dwValue && pEntry->dwValue <= SR_MAX_TEXTURES)
+				Texture_Id(m_pTextures[pEntry->dwValue]);
+
+			Write_Record(DTR_RENDERSTATE, Data, 2);
+		}
+		else
+		{
+			DWORD Data[3] = { pEntry->dwStage, pEntry->dwState, pEntry->dwValue };
+			Write_Record(DTR_TEXTURESTAGESTATE, Data, 3);
+		}
+	}
+
+	return m_pDevice->ApplyStateBlock(pBlock);
+}
+
+HRESULT CRecordDevice::Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ)
+{
+	if(!pRects)
+		dwCount = 0;
+
+	DWORD Head[5];
+	Head[0] = Record_Head(DTR_CLEAR, 4 + (LONGLONG)dwCount * 4);
+	Head[1] = dwFlags;
+	Head[2] = dwColor;
+	Head[3] = Float_Bits(fZ);
+	Head[4] = dwCount;
+	Write_Data(Head, sizeof(Head));
+
+	//RECT is written as 4 DWORDs whatever LONG is
+	for(DWORD i = 0; i < dwCount; i++)
+	{
+		DWORD Rect[4] = { (DWORD)pRects[i].left, (DWORD)pRects[i].top,
+			(DWORD)pRects[i].right, (DWORD)pRects[i].bottom };
+		Write_Data(Rect, sizeof(Rect));
+	}
+
+	return m_pDevice->Clear(dwCount, pRects, dwFlags, dwColor, fZ);
+}
+
+HRESULT CRecordDevice::BeginScene()
+{
+	Write_Record(DTR_BEGINSCENE, NULL, 0);
+	return m_pDevice->BeginScene();
+}
+
+HRESULT CRecordDevice::EndScene()
+{
+	Write_Record(DTR_ENDSCENE, NULL, 0);
+	return m_pDevice->EndScene();
+}
+
+HRESULT CRecordDevice::DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags)
+{
+	if(pVertices && pIndices)
+	{
+		DWORD Data[7];
+		Data[0] = dwPrimType;
+		Data[1] = dwFVF;
+		Data[2] = dwVertexCount;
+		Data[3] = Write_Blob(pVertices, dwVertexCount * Soft_FVF_Stride(dwFVF));
+		Data[4] = dwIndexCount;
+		Data[5] = Write_Blob(pIndices, dwIndexCount * sizeof(WORD), Data[3]);
+		Data[6] = dwFlags;
+		Write_Record(DTR_DRAWINDEXED, Data, 7);
+	}
+
+	return m_pDevice->DrawIndexedPrimitive(dwPrimType, dwFVF, pVertices, dwVertexCount,
+		pIndices, dwIndexCount, dwFlags);
+}
+
+HRESULT CRecordDevice::DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags)
+{
+	if(pVertices)
+	{
+		DWORD Data[5];
+		Data[0] = dwPrimType;
+		Data[1] = dwFVF;
+		Data[2] = dwVertexCount;
+		Data[3] = Write_Blob(pVertices, dwVertexCount * Soft_FVF_Stride(dwFVF));
+		Data[4] = dwFlags;
+		Write_Record(DTR_DRAW, Data, 5);
+	}
+
+	return m_pDevice->DrawPrimitive(dwPrimType, dwFVF, pVertices, dwVertexCount, dwFlags);
+}
+
+HRESULT CRecordDevice::CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture)
+{
+	HRESULT hr = m_pDevice->CreateTexture(dwWidth, dwHeight, ppTexture);
+	if(FAILED(hr))
+		return hr;
+
+	DWORD dwId = m_pDevice->GetTextureHandle(*ppTexture);
+	if(!dwId || dwId > SR_MAX_TEXTURES)
+	{
+		m_bGood = false;
+		return hr;
+	}
+
+	m_pTextures[dwId] = *ppTexture;
+	m_bTexelsWritten[dwId] = false;
+
+	DWORD Data[3] = { dwId, dwWidth, dwHeight };
+	Write_Record(DTR_CREATETEXTURE, Data, 3);
+
+	return hr;
+}
+
+void CRecordDevice::DestroyTexture(soft_texture *pTexture)
+{
+	DWORD dwId = pTexture ? m_pDevice->GetTextureHandle(pTexture) : 0;
+	if(dwId && dwId <= SR_MAX_TEXTURES)
+	{
+		m_pTextures[dwId] = NULL;
+		m_bTexelsWritten[dwId] = false;
+		Write_Record(DTR_DESTROYTEXTURE, &dwId, 1);
+	}
+
+	m_pDevice->DestroyTexture(pTexture);
+}
+
+DWORD CRecordDevice::GetTextureHandle(soft_texture *pTexture)
+{
+	return m_pDevice->GetTextureHandle(pTexture);
+}
+
+DWORD CRecordDevice::GetWidth()
+{
+	return m_pDevice->GetWidth();
+}
+
+DWORD CRecordDevice::GetHeight()
+{
+	return m_pDevice->GetHeight();
+}
+
+//-------------------------------------------------------------------------
+// replay
+//-------------------------------------------------------------------------
+
+struct draw_trace
+{
+	BYTE *pFile;
+	DWORD dwSize;
+	draw_trace_header Header;
+	const DWORD *pRecords;
+	const DWORD *pEnd;
+	DWORD dwFrames;
+};
+
+//payload size each record type must have, ~0 for variable size
+static DWORD Record_Size(DWORD dwType)
+{
+	switch(dwType)
+	{
+		case DTR_RENDERSTATE: return 2;
+		case DTR_TEXTURESTAGESTATE: return 3;
+		case DTR_SETTEXTURE: return 2;
+		case DTR_TRANSFORM: return 17;
+		case DTR_VIEWPORT: return 4;
+		case DTR_BEGINSCENE: return 0;
+		case DTR_ENDSCENE: return 0;
+		case DTR_DRAW: return 5;
+		case DTR_DRAWINDEXED: return 7;
+		case DTR_CREATETEXTURE: return 3;
+		case DTR_DESTROYTEXTURE: return 1;
+	}
+
+	return ~0u;
+}
+
+//the checks are done once here, replay trusts the records. Sizes are
+//compared in 64 bits, a count times a size must not wrap around
+static bool Validate(draw_trace *pTrace)
+{
+	LONGLONG BlobSize[DRAW_TRACE_BLOBS];
+	bool bBlob[DRAW_TRACE_BLOBS];
+	DWORD TexSize[SR_MAX_TEXTURES + 1];
+
+	ZeroMemory(bBlob, sizeof(bBlob));
+	ZeroMemory(TexSize, sizeof(TexSize));
+
+	const DWORD *p = pTrace->pRecords;
+	while(p < pTrace->pEnd)
+	{
+		DWORD dwType = *p & 0xff;
+		DWORD dwCount = *p >> 8;
+		const DWORD *pData = p + 1;
+
+		if(dwType == 0 || dwType >= DTR_MAX || dwCount > (DWORD)(pTrace->pEnd - pData))
+			return false;
+
+		DWORD dwExpect = Record_Size(dwType);
+		if(dwExpect != ~0u && dwCount != dwExpect)
+			return false;
+
+		switch(dwType)
+		{
+			case DTR_SETTEXTURE:
+				if(pData[1] > SR_MAX_TEXTURES || (pData[1] && !TexSize[pData[1]]))
+					return false;
+				break;
+
+			case DTR_RENDERSTATE:
+				if(pData[0] == SRRS_TEXTUREHANDLE &&
+					(pData[1] > SR_MAX_TEXTURES || (pData[1] && !TexSize[pData[1]])))
+					return false;
+				break;
+
+			//inside the device of the header, replay makes one of that size
+			case DTR_VIEWPORT:
+				if((LONGLONG)pData[0] + (LONGLONG)pData[2] > (LONGLONG)pTrace->Header.dwWidth ||
+					(LONGLONG)pData[1] + (LONGLONG)pData[3] > (LONGLONG)pTrace->Header.dwHeight)
+					return false;
+				break;
+
+			case DTR_CLEAR:
+				if(dwCount < 4 || (LONGLONG)dwCount != 4 + (LONGLONG)pData[3] * 4)
+					return false;
+				break;
+
+			case DTR_DRAW:
+				if(pData[2] > DRAW_TRACE_MAX_COUNT ||
+					pData[3] >= DRAW_TRACE_BLOBS || !bBlob[pData[3]] ||
+					BlobSize[pData[3]] < (LONGLONG)pData[2] * (LONGLONG)Soft_FVF_Stride(pData[1]))
+					return false;
+				break;
+
+			case DTR_DRAWINDEXED:
+				if(pData[2] > DRAW_TRACE_MAX_COUNT || pData[4] > DRAW_TRACE_MAX_COUNT ||
+					pData[3] >= DRAW_TRACE_BLOBS || !bBlob[pData[3]] ||
+					BlobSize[pData[3]] < (LONGLONG)pData[2] * (LONGLONG)Soft_FVF_Stride(pData[1]) ||
+					pData[5] >= DRAW_TRACE_BLOBS || !bBlob[pData[5]] ||
+					BlobSize[pData[5]] < (LONGLONG)pData[4] * (LONGLONG)sizeof(WORD))
+					return false;
+				break;
+
+			case DTR_CREATETEXTURE:
+				if(!pData[0] || pData[0] > SR_MAX_TEXTURES || !pData[1] || !pData[2] ||
+					pData[1] > 4096 || pData[2] > 4096)
+					return false;
+				TexSize[pData[0]] = pData[1] * pData[2];
+				break;
+
+			case DTR_TEXTUREDATA:
+				if(dwCount < 1 || !pData[0] || pData[0] > SR_MAX_TEXTURES ||
+					!TexSize[pData[0]] || dwCount != 1 + TexSize[pData[0]])
+					return false;
+				break;
+
+			case DTR_DESTROYTEXTURE:
+				if(!pData[0] || pData[0] > SR_MAX_TEXTURES || !TexSize[pData[0]])
+					return false;
+				TexSize[pData[0]] = 0;
+				break;
+
+			case DTR_BLOB:
+				if(dwCount < 2 || pData[0] >= DRAW_TRACE_BLOBS || ((LONGLONG)pData[1] + 3) / 4 != (LONGLONG)dwCount - 2)
+					return false;
+				bBlob[pData[0]] = true;
+				BlobSize[pData[0]] = pData[1];
+				break;
+
+			case DTR_ENDSCENE:
+				pTrace->dwFrames++;
+				break;
+		}
+
+		p = pData + dwCount;
+	}
+
+	return true;
+}
+
+draw_trace *Draw_Trace_Load(const char *szFilename)
+{
+	FILE *pFile = fopen(szFilename, "rb");
+	if(!pFile)
+		return NULL;
+
+	fseek(pFile, 0, SEEK_END);
+	long Size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	if(Size < (long)sizeof(draw_trace_header) || (Size & 3))
+	{
+		fclose(pFile);
+		return NULL;
+	}
+
+	draw_trace *pTrace = new(std::nothrow) draw_trace;
+	if(!pTrace)
+	{
+		fclose(pFile);
+		return NULL;
+	}
+
+	ZeroMemory(pTrace, sizeof(draw_trace));
+	pTrace->dwSize = (DWORD)Size;
+	pTrace->pFile = (BYTE *)Aligned_Alloc(pTrace->dwSize, CACHE_LINE_SIZE);
+
+	bool bOk = pTrace->pFile && fread(pTrace->pFile, 1, pTrace->dwSize, pFile) == pTrace->dwSize;
+	fclose(pFile);
+
+	if(bOk)
+	{
+		memcpy(&pTrace->Header, pTrace->pFile, sizeof(draw_trace_header));
+		pTrace->pRecords = (const DWORD *)(pTrace->pFile + sizeof(draw_trace_header));
+		pTrace->pEnd = (const DWORD *)(pTrace->pFile + pTrace->dwSize);
+
+		bOk = pTrace->Header.dwMagic == DRAW_TRACE_MAGIC &&
+			pTrace->Header.dwVersion == DRAW_TRACE_VERSION &&
+			Validate(pTrace);
+	}
+
+	if(!bOk)
+	{
+		Draw_Trace_Free(pTrace);
+		return NULL;
+	}
+
+	return pTrace;
+}
+
+void Draw_Trace_Free(draw_trace *pTrace)
+{
+	if(!pTrace)
+		return;
+
+	Aligned_Free(pTrace->pFile);
+	delete pTrace;
+}
+
+const draw_trace_header *Draw_Trace_Header(draw_trace *pTrace)
+{
+	return &pTrace->Header;
+}
+
+DWORD Draw_Trace_Frames(draw_trace *pTrace)
+{
+	return pTrace->dwFrames;
+}
+
+HRESULT Draw_Trace_Replay(draw_trace *pTrace, IRenderDevice *pDevice, draw_trace_frame pfnFrame, void *pContext)
+{
+	soft_texture *pTextures[SR_MAX_TEXTURES + 1];
+	const void *pBlobs[DRAW_TRACE_BLOBS];
+
+	ZeroMemory(pTextures, sizeof(pTextures));
+	ZeroMemory(pBlobs, sizeof(pBlobs));
+
+	HRESULT hr = S_OK;
+	DWORD dwFrame = 0;
+
+	const DWORD *p = pTrace->pRecords;
+	while(p < pTrace->pEnd && SUCCEEDED(hr))
+	{
+		DWORD dwType = *p & 0xff;
+		DWORD dwCount = *p >> 8;
+		const DWORD *pData = p + 1;
+		p = pData + dwCount;
+
+		switch(dwType)
+		{
+			case DTR_RENDERSTATE:
+				if(pData[0] == SRRS_TEXTUREHANDLE)
+					pDevice->SetRenderState(pData[0], pDevice->GetTextureHandle(pTextures[pData[1]]));
+				else
+					pDevice->SetRenderState(pData[0], pData[1]);
+				break;
+
+			case DTR_TEXTURESTAGESTATE:
+				pDevice->SetTextureStageState(pData[0], pData[1], pData[2]);
+				break;
+
+			case DTR_SETTEXTURE:
+				pDevice->SetTexture(pData[0], pTextures[pData[1]]);
+				break;
+
+			case DTR_TRANSFORM:
+			{
+				matrix4x4 Mat;
+				for(int i = 0; i < 16; i++)
+					Mat.Mat[i] = Bits_Float(pData[1 + i]);
+				pDevice->SetTransform(pData[0], &Mat);
+				break;
+			}
+
+			case DTR_VIEWPORT:
+				pDevice->SetViewport(pData[0], pData[1], pData[2], pData[3]);
+				break;
+
+			case DTR_CLEAR:
+			{
+				RECT Rects[16];
+				DWORD dwRects = pData[3];
+				const DWORD *pRect = pData + 4;
+
+				//in groups of 16 so nothing is allocated
+				if(!dwRects)
+					pDevice->Clear(0, NULL, pData[0], pData[1], Bits_Float(pData[2]));
+
+				while(dwRects)
+				{
+					DWORD dwGroup = dwRects > 16 ? 16 : dwRects;
+					for(DWORD i = 0; i < dwGroup; i++, pRect += 4)
+					{
+						Rects[i].left = (LONG)pRect[0];
+						Rects[i].top = (LONG)pRect[1];
+						Rects[i].right = (LONG)pRect[2];
+						Rects[i].bottom = (LONG)pRect[3];
+					}
+
+					pDevice->Clear(dwGroup, Rects, pData[0], pData[1], Bits_Float(pData[2]));
+					dwRects -= dwGroup;
+				}
+				break;
+			}
+
+			case DTR_BEGINSCENE:
+				pDevice->BeginScene();
+				break;
+
+			case DTR_ENDSCENE:
+				pDevice->EndScene();
+				if(pfnFrame)
+					pfnFrame(pContext, dwFrame);
+				dwFrame++;
+				break;
+
+			case DTR_DRAW:
+				pDevice->DrawPrimitive(pData[0], pData[1], pBlobs[pData[3]], pData[2], pData[4]);
+				break;
+
+			case DTR_DRAWINDEXED:
+				pDevice->DrawIndexedPrimitive(pData[0], pData[1], pBlobs[pData[3]], pData[2],
+					(const WORD *)pBlobs[pData[5]], pData[4], pData[6]);
+				break;
+
+			case DTR_CREATETEXTURE:
+				if(pTextures[pData[0]])
+					pDevice->DestroyTexture(pTextures[pData[0]]);
+				pTextures[pData[0]] = NULL;
+				hr = pDevice->CreateTexture(pData[1], pData[2], &pTextures[pData[0]]);
+				break;
+
+			case DTR_TEXTUREDATA:
+			{
+				soft_texture *pTexture = pTextures[pData[0]];
+				memcpy(pTexture->pBits, pData + 1, (dwCount - 1) * sizeof(DWORD));
+				break;
+			}
+
+			case DTR_DESTROYTEXTURE:
+				pDevice->DestroyTexture(pTextures[pData[0]]);
+				pTextures[pData[0]] = NULL;
+				break;
+
+			case DTR_BLOB:
+				pBlobs[pData[0]] = pData + 2;
+				break;
+		}
+	}
+
+	for(DWORD i = 0; i <= SR_MAX_TEXTURES; i++)
+	{
+		if(pTextures[i])
+			pDevice->DestroyTexture(pTextures[i]);
+	}
+
+	return hr;
+}
@@ -0,0 +1,147 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _DRAWTRACE_H_
+#define _DRAWTRACE_H_
+
+#include <stdio.h>
+
+#include "Platform.h"
+#include "SoftDevice.h"
+
+//binary trace of the device calls. CRecordDevice is put between the
+//code that draws and the device, every call is written to the file and
+//passed on. Draw_Trace_Replay() sends the calls to another device, as
+//fast as it can, for benchmarks on exactly the same work.
+//
+//the file is a draw_trace_header and records, every record starts with
+//a DWORD: type in the low 8 bits, payload size in DWORDs above. Vertex
+//and index data go into blob records, draws point at a blob slot, so
+//data that does not change between frames is written only once.
+//Texture texels are written when the texture is first used.
+
+#define DRAW_TRACE_MAGIC	0x43525444	//"DTRC"
+#define DRAW_TRACE_VERSION	1
+
+#define DRAW_TRACE_BLOBS	64
+
+//the payload size has 24 bits, a call with more data can not be recorded
+//(IsGood() is false after it). A draw has at most as many vertices
+#define DRAW_TRACE_MAX_COUNT	0x00ffffff
+
+struct draw_trace_header
+{
+	DWORD dwMagic;
+	DWORD dwVersion;
+	DWORD dwWidth;
+	DWORD dwHeight;
+	DWORD dwZBuffer;		//device was created with a Z buffer
+};
+
+enum
+{
+	DTR_RENDERSTATE = 1,	//state, value
+	DTR_TEXTURESTAGESTATE,	//stage, state, value
+	DTR_SETTEXTURE,			//stage, texture id (0 for none)
+	DTR_TRANSFORM,			//state, 16 floats
+	DTR_VIEWPORT,			//x, y, width, height
+	DTR_CLEAR,				//flags, color, z, count, count rects
+	DTR_BEGINSCENE,
+	DTR_ENDSCENE,
+	DTR_DRAW,				//type, fvf, vertex count, vertex blob, flags
+	DTR_DRAWINDEXED,		//type, fvf, vertex count, vertex blob, index count, index blob, flags
+	DTR_CREATETEXTURE,		//texture id, width, height
+	DTR_TEXTUREDATA,		//texture id, texels
+	DTR_DESTROYTEXTURE,		//texture id
+	DTR_BLOB,				//slot, size in bytes, data padded to DWORDs
+	DTR_MAX
+};
+
+//texture ids are the handles of the recorded device, SRRS_TEXTUREHANDLE
+//values are written as the same ids
+
+class CRecordDevice : public IRenderDevice
+{
+public:
+	HRESULT SetRenderState(DWORD dwState, DWORD dwValue);
+	HRESULT GetRenderState(DWORD dwState, DWORD *pdwValue);
+	HRESULT SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue);
+	HRESULT SetTexture(DWORD dwStage, soft_texture *pTexture);
+	HRESULT SetTransform(DWORD dwState, const matrix4x4 *pMatrix);
+	HRESULT SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight);
+	HRESULT ApplyStateBlock(state_block *pBlock);
+
+	HRESULT Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ);
+	HRESULT BeginScene();
+	HRESULT EndScene();
+
+	HRESULT DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags);
+	HRESULT DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags);
+
+	HRESULT CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture);
+	void DestroyTexture(soft_texture *pTexture);
+	DWORD GetTextureHandle(soft_texture *pTexture);
+
+	DWORD GetWidth();
+	DWORD GetHeight();
+
+	//closes the file, the device under the recorder is not released
+	ULONG Release();
+
+	//false after a write failed or a record was too large, the calls still
+	//reach the device
+	bool IsGood() { return m_bGood; }
+
+private:
+	friend HRESULT Create_Record_Device(IRenderDevice *pDevice, const char *szFilename, CRecordDevice **ppRecorder);
+
+	CRecordDevice();
+	~CRecordDevice();
+
+	DWORD Record_Head(DWORD dwType, LONGLONG Count);
+	void Write_Record(DWORD dwType, const DWORD *pData, DWORD dwCount);
+	void Write_Data(const void *pData, DWORD dwSize);
+	DWORD Write_Blob(const void *pData, DWORD dwSize, DWORD dwKeep = ~0u);
+	DWORD Texture_Id(soft_texture *pTexture);
+
+	IRenderDevice *m_pDevice;
+	FILE *m_pFile;
+	bool m_bGood;
+
+	//copies of the blobs in the slots, to find data written before
+	struct blob
+	{
+		BYTE *pData;
+		DWORD dwSize;
+		DWORD dwHash;
+	};
+	blob m_Blobs[DRAW_TRACE_BLOBS];
+	DWORD m_dwNextBlob;
+
+	soft_texture *m_pTextures[SR_MAX_TEXTURES + 1];
+	bool m_bTexelsWritten[SR_MAX_TEXTURES + 1];
+};
+
+//pDevice must have a Z buffer when it is on by default (SRRS_ZENABLE)
+HRESULT Create_Record_Device(IRenderDevice *pDevice, const char *szFilename, CRecordDevice **ppRecorder);
+
+struct draw_trace;
+
+//reads the whole file and checks every record
+draw_trace *Draw_Trace_Load(const char *szFilename);
+void Draw_Trace_Free(draw_trace *pTrace);
+const draw_trace_header *Draw_Trace_Header(draw_trace *pTrace);
+//EndScene() calls in the trace
+DWORD Draw_Trace_Frames(draw_trace *pTrace);
+
+typedef void (*draw_trace_frame)(void *pContext, DWORD dwFrame);
+
+//sends all calls to pDevice, pfnFrame (may be NULL) is called after every
+//EndScene(). Textures the trace does not destroy are destroyed at the end
+HRESULT Draw_Trace_Replay(draw_trace *pTrace, IRenderDevice *pDevice, draw_trace_frame pfnFrame, void *pContext);
+
+#endif
@@ -0,0 +1,83 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DynamicRes.h"
+
+void Dynamic_Res_Init(dynamic_res *pDyn, float fTargetMs, float fMinScale)
+{
+	pDyn->fTargetMs = fTargetMs > 0.0f ? fTargetMs : DYNRES_TARGET_MS;
+	pDyn->fMinScale = fMinScale > 0.0f && fMinScale <= 1.0f ? fMinScale : DYNRES_MIN_SCALE;
+	pDyn->fScale = 1.0f;
+	pDyn->dwFrames = 0;
+	pDyn->fSumMs = 0.0f;
+}
+
+float Dynamic_Res_Parse_Options(const char *szCmdLine)
+{
+	const char *szDynRes = strstr(szCmdLine, "-dynres");
+	if(!szDynRes)
+		return 0.0f;
+
+	float fTargetMs = (float)atof(szDynRes + 7);
+
+	return fTargetMs > 0.0f ? fTargetMs : DYNRES_TARGET_MS;
+}
+
+bool Dynamic_Res_Frame(dynamic_res *pDyn, float fFrameMs)
+{
+	pDyn->fSumMs += fFrameMs;
+	if(++pDyn->dwFrames < DYNRES_INTERVAL)
+		return false;
+
+	float fAverageMs = pDyn->fSumMs / (float)pDyn->dwFrames;
+	pDyn->dwFrames = 0;
+	pDyn->fSumMs = 0.0f;
+
+	float fLow = pDyn->fTargetMs * (100 - DYNRES_TOLERANCE) / 100.0f;
+	float fHigh = pDyn->fTargetMs * (100 + DYNRES_TOLERANCE) / 100.0f;
+
+	if(fAverageMs >= fLow && fAverageMs <= fHigh)
+		return false;
+
+	//the time goes with the number of pixels, the square of the scale
+	float fStep = fAverageMs > 0.0f ? sqrtf(pDyn->fTargetMs / fAverageMs) : DYNRES_MAX_STEP;
+	if(fStep > DYNRES_MAX_STEP)
+		fStep = DYNRES_MAX_STEP;
+	if(fStep < 1.0f / DYNRES_MAX_STEP)
+		fStep = 1.0f / DYNRES_MAX_STEP;
+
+	float fScale = floorf(pDyn->fScale * fStep * 32.0f + 0.5f) / 32.0f;
+	if(fScale > 1.0f)
+		fScale = 1.0f;
+	if(fScale < pDyn->fMinScale)
+		fScale = pDyn->fMinScale;
+
+	if(fScale == pDyn->fScale)
+		return false;
+
+	pDyn->fScale = fScale;
+
+	return true;
+}
+
+RECT Dynamic_Res_Rect(const dynamic_res *pDyn, const RECT *pFull)
+{
+	LONG Width = (LONG)((float)(pFull->right - pFull->left) * pDyn->fScale + 0.5f);
+	LONG Height = (LONG)((float)(pFull->bottom - pFull->top) * pDyn->fScale + 0.5f);
+
+	RECT Rc = { pFull->left, pFull->top,
+		pFull->left + (Width > 1 ? Width : 1), pFull->top + (Height > 1 ? Height : 1) };
+
+	return Rc;
+}
+
+void Dynamic_Res_Reset(dynamic_res *pDyn)
+{
+	pDyn->dwFrames = 0;
+	pDyn->fSumMs = 0.0f;
+}
@@ -0,0 +1,53 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _DYNAMICRES_H_
+#define _DYNAMICRES_H_
+
+#include "Platform.h"
+
+//dynamic resolution: when the frames take longer than the budget the
+//scene is drawn into a smaller part of the back buffer and the present
+//stretches it over the window (Presenter_Set_Source()). The fill rate
+//falls with the square of the scale. Every DYNRES_INTERVAL frames the
+//average frame time gives the new scale:
+//
+//  scale = scale * sqrt(target / average)
+//
+//at most DYNRES_MAX_STEP times bigger or smaller and rounded to 1/32,
+//so it settles instead of moving a little every time. An average within
+//DYNRES_TOLERANCE percent of the target keeps the scale
+
+#define DYNRES_TARGET_MS 16.6f
+#define DYNRES_MIN_SCALE 0.5f
+#define DYNRES_INTERVAL 8
+#define DYNRES_TOLERANCE 10
+#define DYNRES_MAX_STEP 1.25f
+
+struct dynamic_res
+{
+	float fTargetMs;
+	float fMinScale;
+	float fScale;		//of the width and the height, 1.0 is the full size
+	DWORD dwFrames;		//measured since the last update
+	float fSumMs;
+};
+
+void Dynamic_Res_Init(dynamic_res *pDyn, float fTargetMs, float fMinScale);
+
+//option of the command line of the samples: -dynres with the budget in
+//ms, -dynres alone is DYNRES_TARGET_MS. 0 when it is not there
+float Dynamic_Res_Parse_Options(const char *szCmdLine);
+
+//the time of the frame just presented, true when the scale changed
+bool Dynamic_Res_Frame(dynamic_res *pDyn, float fFrameMs);
+
+//pFull scaled, from its left top corner, at least 1x1
+RECT Dynamic_Res_Rect(const dynamic_res *pDyn, const RECT *pFull);
+
+//a full size frame is due, after a resize or the like: the average
+//starts again with the next frame
+void Dynamic_Res_Reset(dynamic_res *pDyn);
+
+#endif
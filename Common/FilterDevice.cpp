@@ -0,0 +1,185 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <new>
+
+#include "FilterDevice.h"
+#include "RenderStats.h"
+
+CFilterDevice::CFilterDevice()
+{
+	m_pDevice = NULL;
+	ZeroMemory(&m_Cache, sizeof(state_cache));
+}
+
+CFilterDevice::~CFilterDevice()
+{
+}
+
+HRESULT Create_Filter_Device(IRenderDevice *pDevice, CFilterDevice **ppFilter)
+{
+	if(!pDevice || !ppFilter)
+		return E_INVALIDARG;
+
+	*ppFilter = new(std::nothrow) CFilterDevice;
+	if(!*ppFilter)
+		return E_OUTOFMEMORY;
+
+	(*ppFilter)->m_pDevice = pDevice;
+
+	return S_OK;
+}
+
+ULONG CFilterDevice::Release()
+{
+	delete this;
+	return 0;
+}
+
+bool CFilterDevice::Count(bool bForward)
+{
+	render_stats *pStats = Stats_Local();
+	pStats->dwStateCalls++;
+	if(!bForward)
+		pStats->dwStatesFiltered++;
+
+	return bForward;
+}
+
+//the device may not have the value after a failed call
+HRESULT CFilterDevice::Check(HRESULT hr)
+{
+	if(FAILED(hr))
+		State_Cache_Reset(&m_Cache);
+	return hr;
+}
+
+//the texture handle and the texture of stage 0 set the same texture, when
+//one goes to the device the other is not known any more
+HRESULT CFilterDevice::SetRenderState(DWORD dwState, DWORD dwValue)
+{
+	if(!Count(State_Cache_Render(&m_Cache, dwState, dwValue)))
+		return S_OK;
+	if(dwState == SRRS_TEXTUREHANDLE)
+		State_Cache_Forget_Stage_Texture(&m_Cache, 0);
+	return Check(m_pDevice->SetRenderState(dwState, dwValue));
+}
+
+HRESULT CFilterDevice::GetRenderState(DWORD dwState, DWORD *pdwValue)
+{
+	return m_pDevice->GetRenderState(dwState, pdwValue);
+}
+
+HRESULT CFilterDevice::SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue)
+{
+	if(!Count(State_Cache_Stage(&m_Cache, dwStage, dwState, dwValue)))
+		return S_OK;
+	return Check(m_pDevice->SetTextureStageState(dwStage, dwState, dwValue));
+}
+
+HRESULT CFilterDevice::SetTexture(DWORD dwStage, soft_texture *pTexture)
+{
+	if(!Count(State_Cache_Texture(&m_Cache, dwStage, pTexture)))
+		return S_OK;
+	if(dwStage == 0)
+		State_Cache_Forget_Render(&m_Cache, SRRS_TEXTUREHANDLE);
+	return Check(m_pDevice->SetTexture(dwStage, pTexture));
+}
+
+HRESULT CFilterDevice::SetTransform(DWORD dwState, const matrix4x4 *pMatrix)
+{
+	if(!Count(State_Cache_Transform(&m_Cache, dwState, pMatrix ? pMatrix->Mat : NULL)))
+		return S_OK;
+	return Check(m_pDevice->SetTransform(dwState, pMatrix));
+}
+
+HRESULT CFilterDevice::SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight)
+{
+	return m_pDevice->SetViewport(dwX, dwY, dwWidth, dwHeight);
+}
+
+//the block goes on as a whole when one of its states changes, the device
+//behind the filter sets the difference itself
+HRESULT CFilterDevice::ApplyStateBlock(state_block *pBlock)
+{
+	if(!pBlock)
+		return E_INVALIDARG;
+
+	bool bForward = false;
+	for(DWORD i = 0; i < pBlock->dwCount; i++)
+	{
+		const state_block_entry *pEntry = &pBlock->Entries[i];
+
+		if(pEntry->dwStage == SB_RENDER)
+		{
+			bool bSet = Count(State_Cache_Render(&m_Cache, pEntry->dwState, pEntry->dwValue));
+			if(bSet && pEntry->dwState == SRRS_TEXTUREHANDLE)
+				State_Cache_Forget_Stage_Texture(&m_Cache, 0);
+			bForward |= bSet;
+		}
+		else
+			bForward |= Count(State_Cache_Stage(&m_Cache, pEntry->dwStage, pEntry->dwState, pEntry->dwValue));
+	}
+
+	if(!bForward)
+		return S_OK;
+	return Check(m_pDevice->ApplyStateBlock(pBlock));
+}
+
+HRESULT CFilterDevice::Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ)
+{
+	return m_pDevice->Clear(dwCount, pRects, dwFlags, dwColor, fZ);
+}
+
+HRESULT CFilterDevice::BeginScene()
+{
+	return m_pDevice->BeginScene();
+}
+
+HRESULT CFilterDevice::EndScene()
+{
+	return m_pDevice->EndScene();
+}
+
+HRESULT CFilterDevice::DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags)
+{
+	return m_pDevice->DrawIndexedPrimitive(dwPrimType, dwFVF, pVertices, dwVertexCount,
+		pIndices, dwIndexCount, dwFlags);
+}
+
+HRESULT CFilterDevice::DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags)
+{
+	return m_pDevice->DrawPrimitive(dwPrimType, dwFVF, pVertices, dwVertexCount, dwFlags);
+}
+
+HRESULT CFilterDevice::CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture)
+{
+	return m_pDevice->CreateTexture(dwWidth, dwHeight, ppTexture);
+}
+
+void CFilterDevice::DestroyTexture(soft_texture *pTexture)
+{
+	State_Cache_Forget_Texture(&m_Cache, pTexture);
+	State_Cache_Forget_Render(&m_Cache, SRRS_TEXTUREHANDLE);
+
+	m_pDevice->DestroyTexture(pTexture);
+}
+
+DWORD CFilterDevice::GetTextureHandle(soft_texture *pTexture)
+{
+	return m_pDevice->GetTextureHandle(pTexture);
+}
+
+DWORD CFilterDevice::GetWidth()
+{
+	return m_pDevice->GetWidth();
+}
+
+DWORD CFilterDevice::GetHeight()
+{
+	return m_pDevice->GetHeight();
+}
@@ -0,0 +1,66 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _FILTERDEVICE_H_
+#define _FILTERDEVICE_H_
+
+#include "Platform.h"
+#include "SoftDevice.h"
+#include "StateCache.h"
+
+//IRenderDevice in front of another device that drops the state calls
+//which change nothing (StateCache.h). Forwarded and filtered calls are
+//counted in the render_stats of the frame and in the cache
+
+class CFilterDevice : public IRenderDevice
+{
+public:
+	HRESULT SetRenderState(DWORD dwState, DWORD dwValue);
+	HRESULT GetRenderState(DWORD dwState, DWORD *pdwValue);
+	HRESULT SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue);
+	HRESULT SetTexture(DWORD dwStage, soft_texture *pTexture);
+	HRESULT SetTransform(DWORD dwState, const matrix4x4 *pMatrix);
+	HRESULT SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight);
+	HRESULT ApplyStateBlock(state_block *pBlock);
+
+	HRESULT Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ);
+	HRESULT BeginScene();
+	HRESULT EndScene();
+
+	HRESULT DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags);
+	HRESULT DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags);
+
+	HRESULT CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture);
+	void DestroyTexture(soft_texture *pTexture);
+	DWORD GetTextureHandle(soft_texture *pTexture);
+
+	DWORD GetWidth();
+	DWORD GetHeight();
+
+	//the device behind the filter is not released
+	ULONG Release();
+
+	//call when the state of the device was changed past the filter
+	void Reset() { State_Cache_Reset(&m_Cache); }
+	const state_cache *Cache() { return &m_Cache; }
+
+private:
+	friend HRESULT Create_Filter_Device(IRenderDevice *pDevice, CFilterDevice **ppFilter);
+
+	CFilterDevice();
+	~CFilterDevice();
+
+	bool Count(bool bForward);
+	HRESULT Check(HRESULT hr);
+
+	IRenderDevice *m_pDevice;
+	state_cache m_Cache;
+};
+
+HRESULT Create_Filter_Device(IRenderDevice *pDevice, CFilterDevice **ppFilter);
+
+#endif
@@ -0,0 +1,193 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <new>
+
+#include "FrameArena.h"
+
+//heap allocation made when the block was full, the data starts one
+//cache line after the header
+struct arena_overflow
+{
+	arena_overflow *pNext;
+	size_t Size;
+};
+
+struct frame_arena
+{
+	BYTE *pBlock;
+	size_t Size;
+	size_t Offset;
+
+	arena_overflow *pOverflow;
+	size_t OverflowBytes;
+
+	size_t HighWater;
+
+	//memory came from the heap since the last reset
+	bool bOverflowed;
+};
+
+static THREAD_LOCAL frame_arena *t_pArena = NULL;
+
+static size_t Align_Size(size_t Size)
+{
+	return (Size + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+}
+
+static void Free_Overflow(frame_arena *pArena)
+{
+	arena_overflow *pNode = pArena->pOverflow;
+	while(pNode)
+	{
+		arena_overflow *pNext = pNode->pNext;
+		Aligned_Free(pNode);
+		pNode = pNext;
+	}
+
+	pArena->pOverflow = NULL;
+	pArena->OverflowBytes = 0;
+}
+
+frame_arena *Frame_Arena_Create(size_t Size)
+{
+	frame_arena *pArena = new(std::nothrow) frame_arena;
+	if(!pArena)
+		return NULL;
+
+	pArena->Size = Align_Size(Size ? Size : CACHE_LINE_SIZE);
+	pArena->pBlock = (BYTE *)Aligned_Alloc(pArena->Size, CACHE_LINE_SIZE);
+	pArena->Offset = 0;
+	pArena->pOverflow = NULL;
+	pArena->OverflowBytes = 0;
+	pArena->HighWater = 0;
+	pArena->bOverflowed = false;
+
+	if(!pArena->pBlock)
+	{
+		delete pArena;
+		return NULL;
+	}
+
+	return pArena;
+}
+
+void Frame_Arena_Destroy(frame_arena *pArena)
+{
+	if(!pArena)
+		return;
+
+	Free_Overflow(pArena);
+	Aligned_Free(pArena->pBlock);
+	delete pArena;
+}
+
+void *Frame_Arena_Alloc(frame_arena *pArena, size_t Size)
+{
+	Size = Align_Size(Size);
+
+	void *p;
+
+	if(Size <= pArena->Size - pArena->Offset)
+	{
+		p = pArena->pBlock + pArena->Offset;
+		pArena->Offset += Size;
+	}
+	else
+	{
+		BYTE *pNode = (BYTE *)Aligned_Alloc(CACHE_LINE_SIZE + Size, CACHE_LINE_SIZE);
+		if(!pNode)
+			return NULL;
+
+		arena_overflow *pOverflow = (arena_overflow *)pNode;
+		pOverflow->pNext = pArena->pOverflow;
+		pOverflow->Size = Size;
+		pArena->pOverflow = pOverflow;
+		pArena->OverflowBytes += Size;
+		pArena->bOverflowed = true;
+
+		p = pNode + CACHE_LINE_SIZE;
+	}
+
+	size_t Used = pArena->Offset + pArena->OverflowBytes;
+	if(Used > pArena->HighWater)
+		pArena->HighWater = Used;
+
+	return p;
+}
+
+arena_mark Frame_Arena_Mark(const frame_arena *pArena)
+{
+	arena_mark Mark = { pArena->Offset, pArena->pOverflow };
+	return Mark;
+}
+
+void Frame_Arena_Release(frame_arena *pArena, arena_mark Mark)
+{
+	//heap allocations made after the mark are at the front of the list
+	while(pArena->pOverflow && pArena->pOverflow != Mark.pOverflow)
+	{
+		arena_overflow *pNode = pArena->pOverflow;
+		pArena->pOverflow = pNode->pNext;
+		pArena->OverflowBytes -= pNode->Size;
+		Aligned_Free(pNode);
+
+		//the next reset still grows the block
+		pArena->bOverflowed = true;
+	}
+
+	if(Mark.Offset <= pArena->Offset)
+		pArena->Offset = Mark.Offset;
+}
+
+void Frame_Arena_Reset(frame_arena *pArena)
+{
+	if(pArena->bOverflowed)
+	{
+		Free_Overflow(pArena);
+		pArena->bOverflowed = false;
+
+		//the frame did not fit, the next one gets a block of the high
+		//water mark. If that fails the old block stays
+		size_t Size = Align_Size(pArena->HighWater);
+		BYTE *pBlock = (BYTE *)Aligned_Alloc(Size, CACHE_LINE_SIZE);
+		if(pBlock)
+		{
+			Aligned_Free(pArena->pBlock);
+			pArena->pBlock = pBlock;
+			pArena->Size = Size;
+		}
+	}
+
+	pArena->Offset = 0;
+}
+
+size_t Frame_Arena_Used(const frame_arena *pArena)
+{
+	return pArena->Offset + pArena->OverflowBytes;
+}
+
+size_t Frame_Arena_High_Water(const frame_arena *pArena)
+{
+	return pArena->HighWater;
+}
+
+size_t Frame_Arena_Size(const frame_arena *pArena)
+{
+	return pArena->Size;
+}
+
+frame_arena *Frame_Arena_Local()
+{
+	if(!t_pArena)
+		t_pArena = Frame_Arena_Create(ARENA_DEFAULT_SIZE);
+
+	return t_pArena;
+}
+
+void Frame_Arena_Local_Destroy()
+{
+	Frame_Arena_Destroy(t_pArena);
+	t_pArena = NULL;
+}
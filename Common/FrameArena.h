@@ -0,0 +1,59 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _FRAMEARENA_H_
+#define _FRAMEARENA_H_
+
+#include "Platform.h"
+
+//scratch memory that lives for one frame: transformed vertices, clipped
+//polygons, index lists. Frame_Arena_Alloc() moves a pointer forward in one
+//block, Frame_Arena_Reset() moves it back at the end of the frame, there
+//are no locks and no frees. Every thread has its own arena, Frame_Arena_Local().
+//
+//when the block is full the allocation comes from the heap and is freed by
+//Frame_Arena_Release() or the next reset. The reset after such a frame
+//makes the block as large as the high water mark, so after the first
+//frames there are no heap allocations at all
+
+#define ARENA_DEFAULT_SIZE (256 * 1024)
+
+struct frame_arena;
+struct arena_overflow;
+
+//position of the arena for Frame_Arena_Release()
+struct arena_mark
+{
+	size_t Offset;
+	arena_overflow *pOverflow;
+};
+
+frame_arena *Frame_Arena_Create(size_t Size);
+void Frame_Arena_Destroy(frame_arena *pArena);
+
+//cache line aligned, NULL when the heap is out of memory
+void *Frame_Arena_Alloc(frame_arena *pArena, size_t Size);
+
+//Frame_Arena_Release() gives back everything allocated after
+//Frame_Arena_Mark(), for scratch memory that is needed only inside one call
+arena_mark Frame_Arena_Mark(const frame_arena *pArena);
+void Frame_Arena_Release(frame_arena *pArena, arena_mark Mark);
+
+//all allocations of the frame are gone
+void Frame_Arena_Reset(frame_arena *pArena);
+
+//bytes in use now, the most bytes in use since the arena was created
+//and the size of the block
+size_t Frame_Arena_Used(const frame_arena *pArena);
+size_t Frame_Arena_High_Water(const frame_arena *pArena);
+size_t Frame_Arena_Size(const frame_arena *pArena);
+
+//arena of the calling thread, the first call creates it with
+//ARENA_DEFAULT_SIZE. NULL when there is no memory
+frame_arena *Frame_Arena_Local();
+
+//destroys the arena of the calling thread
+void Frame_Arena_Local_Destroy();
+
+#endif
@@ -0,0 +1,342 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+
+#include "FrameCapture.h"
+
+struct frame_capture
+{
+	FILE *pFile;
+	bool bY4M;
+	DWORD dwWidth;
+	DWORD dwHeight;
+	DWORD dwPolicy;
+
+	DWORD **ppBuffers;
+	DWORD dwBufferCount;
+	DWORD dwHead;		//next buffer the thread writes
+	DWORD dwTail;		//next buffer the caller fills
+	DWORD dwQueued;
+
+	//the frame converted for the file, made by the thread only
+	BYTE *pOut;
+	DWORD dwOutSize;
+
+	mutex Lock;
+	event WorkEvent;
+	event FreeEvent;
+	thread_handle Thread;
+	volatile LONG bQuit;
+
+	volatile LONG Frames;
+	volatile LONG Dropped;
+	volatile LONG Failed;
+	LONGLONG Bytes;			//under Lock
+	LONGLONG WriteTicks;	//under Lock
+	LONGLONG WaitTicks;		//caller thread
+};
+
+static DWORD Chroma_Size(DWORD dwSize)
+{
+	return (dwSize + 1) / 2;
+}
+
+//BT.601, studio range, 8 bit fixed point
+static BYTE Rgb_To_Y(int r, int g, int b)
+{
+	return (BYTE)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+//r, g and b are the sums of up to four pixels, n of them
+static void Rgb_To_UV(int r, int g, int b, int n, BYTE *pU, BYTE *pV)
+{
+	r /= n;
+	g /= n;
+	b /= n;
+	*pU = (BYTE)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+	*pV = (BYTE)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+static DWORD Convert_Y4M(const frame_capture *pCapture, const DWORD *pPixels)
+{
+	DWORD dwWidth = pCapture->dwWidth;
+	DWORD dwHeight = pCapture->dwHeight;
+	DWORD dwChromaWidth = Chroma_Size(dwWidth);
+	DWORD dwChromaHeight = Chroma_Size(dwHeight);
+
+	static const char szFrame[] = "FRAME\n";
+	memcpy(pCapture->pOut, szFrame, 6);
+
+	BYTE *pY = pCapture->pOut + 6;
+	BYTE *pU = pY + dwWidth * dwHeight;
+	BYTE *pV = pU + dwChromaWidth * dwChromaHeight;
+
+	for(DWORD y = 0; y < dwHeight; y++)
+	{
+		const DWORD *pSrc = pPixels + y * dwWidth;
+		for(DWORD x = 0; x < dwWidth; x++)
+			*pY++ = Rgb_To_Y((pSrc[x] >> 16) & 0xff, (pSrc[x] >> 8) & 0xff, pSrc[x] & 0xff);
+	}
+
+	//one chroma sample for 2x2 pixels, the last row and column of odd
+	//sizes have fewer
+	for(DWORD cy = 0; cy < dwChromaHeight; cy++)
+	{
+		for(DWORD cx = 0; cx < dwChromaWidth; cx++)
+		{
+			int r = 0, g = 0, b = 0, n = 0;
+			for(DWORD y = cy * 2; y < cy * 2 + 2 && y < dwHeight; y++)
+			{
+				for(DWORD x = cx * 2; x < cx * 2 + 2 && x < dwWidth; x++)
+				{
+					DWORD c = pPixels[y * dwWidth + x];
+					r += (c >> 16) & 0xff;
+					g += (c >> 8) & 0xff;
+					b += c & 0xff;
+					n++;
+				}
+			}
+
+			Rgb_To_UV(r, g, b, n, pU++, pV++);
+		}
+	}
+
+	return (DWORD)(pV - pCapture->pOut);
+}
+
+static DWORD Convert_PPM(const frame_capture *pCapture, const DWORD *pPixels)
+{
+	DWORD dwWidth = pCapture->dwWidth;
+	DWORD dwHeight = pCapture->dwHeight;
+
+	BYTE *pOut = pCapture->pOut;
+	pOut += sprintf((char *)pOut, "P6\n%u %u\n255\n", (unsigned)dwWidth, (unsigned)dwHeight);
+
+	for(DWORD i = 0; i < dwWidth * dwHeight; i++)
+	{
+		*pOut++ = (BYTE)(pPixels[i] >> 16);
+		*pOut++ = (BYTE)(pPixels[i] >> 8);
+		*pOut++ = (BYTE)pPixels[i];
+	}
+
+	return (DWORD)(pOut - pCapture->pOut);
+}
+
+static void Capture_Thread(void *pParam)
+{
+	frame_capture *pCapture = (frame_capture *)pParam;
+
+	for(;;)
+	{
+		Mutex_Lock(&pCapture->Lock);
+		DWORD dwQueued = pCapture->dwQueued;
+		DWORD dwHead = pCapture->dwHead;
+		Mutex_Unlock(&pCapture->Lock);
+
+		if(!dwQueued)
+		{
+			if(pCapture->bQuit)
+				break;
+
+			Event_Wait(&pCapture->WorkEvent, 100);
+			continue;
+		}
+
+		LONGLONG Start = Timer_Ticks();
+
+		const DWORD *pPixels = pCapture->ppBuffers[dwHead];
+		DWORD dwSize = pCapture->bY4M ? Convert_Y4M(pCapture, pPixels) : Convert_PPM(pCapture, pPixels);
+
+		//the buffer is free again before the disk is done
+		Mutex_Lock(&pCapture->Lock);
+		pCapture->dwHead = (pCapture->dwHead + 1) % pCapture->dwBufferCount;
+		pCapture->dwQueued--;
+		Mutex_Unlock(&pCapture->Lock);
+
+		Event_Signal(&pCapture->FreeEvent);
+
+		bool bOk = fwrite(pCapture->pOut, 1, dwSize, pCapture->pFile) == dwSize;
+		Atomic_Increment(bOk ? &pCapture->Frames : &pCapture->Failed);
+
+		LONGLONG Ticks = Timer_Ticks() - Start;
+
+		Mutex_Lock(&pCapture->Lock);
+		if(bOk)
+			pCapture->Bytes += dwSize;
+		pCapture->WriteTicks += Ticks;
+		Mutex_Unlock(&pCapture->Lock);
+	}
+}
+
+static void Free_Capture(frame_capture *pCapture)
+{
+	if(pCapture->ppBuffers)
+	{
+		for(DWORD i = 0; i < pCapture->dwBufferCount; i++)
+			Aligned_Free(pCapture->ppBuffers[i]);
+		delete [] pCapture->ppBuffers;
+	}
+
+	delete [] pCapture->pOut;
+
+	if(pCapture->pFile)
+		fclose(pCapture->pFile);
+
+	delete pCapture;
+}
+
+frame_capture *Capture_Create(const char *szFilename, DWORD dwWidth, DWORD dwHeight,
+	DWORD dwFps, DWORD dwBuffers, DWORD dwPolicy)
+{
+	if(!dwWidth || !dwHeight || !dwBuffers)
+		return NULL;
+
+	frame_capture *pCapture = new(std::nothrow) frame_capture;
+	if(!pCapture)
+		return NULL;
+
+	ZeroMemory(pCapture, sizeof(frame_capture));
+	pCapture->dwWidth = dwWidth;
+	pCapture->dwHeight = dwHeight;
+	pCapture->dwPolicy = dwPolicy;
+	pCapture->dwBufferCount = dwBuffers;
+
+	const char *pDot = strrchr(szFilename, '.');
+	pCapture->bY4M = pDot && !strcmp(pDot, ".y4m");
+
+	//"FRAME\n" and three planes, or a PPM header and RGB
+	pCapture->dwOutSize = pCapture->bY4M ?
+		6 + dwWidth * dwHeight + 2 * Chroma_Size(dwWidth) * Chroma_Size(dwHeight) :
+		32 + dwWidth * dwHeight * 3;
+
+	pCapture->pOut = new(std::nothrow) BYTE[pCapture->dwOutSize];
+	pCapture->ppBuffers = new(std::nothrow) DWORD*[dwBuffers];
+	if(!pCapture->pOut || !pCapture->ppBuffers)
+	{
+		Free_Capture(pCapture);
+		return NULL;
+	}
+
+	ZeroMemory(pCapture->ppBuffers, dwBuffers * sizeof(DWORD*));
+	for(DWORD i = 0; i < dwBuffers; i++)
+	{
+		pCapture->ppBuffers[i] = (DWORD *)Aligned_Alloc(dwWidth * dwHeight * sizeof(DWORD), CACHE_LINE_SIZE);
+		if(!pCapture->ppBuffers[i])
+		{
+			Free_Capture(pCapture);
+			return NULL;
+		}
+	}
+
+	pCapture->pFile = fopen(szFilename, "wb");
+	if(!pCapture->pFile)
+	{
+		Free_Capture(pCapture);
+		return NULL;
+	}
+
+	if(pCapture->bY4M)
+		fprintf(pCapture->pFile, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n",
+			(unsigned)dwWidth, (unsigned)dwHeight, (unsigned)(dwFps ? dwFps : CAPTURE_DEFAULT_FPS));
+
+	Mutex_Init(&pCapture->Lock);
+	Event_Init(&pCapture->WorkEvent);
+	Event_Init(&pCapture->FreeEvent);
+
+	if(!Thread_Create(&pCapture->Thread, Capture_Thread, pCapture))
+	{
+		Event_Destroy(&pCapture->FreeEvent);
+		Event_Destroy(&pCapture->WorkEvent);
+		Mutex_Destroy(&pCapture->Lock);
+		Free_Capture(pCapture);
+		return NULL;
+	}
+
+	return pCapture;
+}
+
+void Capture_Destroy(frame_capture *pCapture, capture_stats *pStats)
+{
+	if(!pCapture)
+		return;
+
+	Atomic_Exchange(&pCapture->bQuit, TRUE);
+	Event_Signal(&pCapture->WorkEvent);
+	Thread_Join(&pCapture->Thread);
+
+	if(pStats)
+		Capture_Get_Stats(pCapture, pStats);
+
+	Event_Destroy(&pCapture->FreeEvent);
+	Event_Destroy(&pCapture->WorkEvent);
+	Mutex_Destroy(&pCapture->Lock);
+
+	Free_Capture(pCapture);
+}
+
+DWORD *Capture_Acquire(frame_capture *pCapture, LONG *plPitch)
+{
+	LONGLONG Start = 0;
+
+	for(;;)
+	{
+		Mutex_Lock(&pCapture->Lock);
+		bool bFree = pCapture->dwQueued < pCapture->dwBufferCount;
+		DWORD dwTail = pCapture->dwTail;
+		Mutex_Unlock(&pCapture->Lock);
+
+		if(bFree)
+		{
+			if(Start)
+				pCapture->WaitTicks += Timer_Ticks() - Start;
+
+			*plPitch = pCapture->dwWidth * sizeof(DWORD);
+			return pCapture->ppBuffers[dwTail];
+		}
+
+		if(pCapture->dwPolicy == CAPTURE_DROP)
+		{
+			Atomic_Increment(&pCapture->Dropped);
+			return NULL;
+		}
+
+		if(!Start)
+			Start = Timer_Ticks();
+
+		Event_Wait(&pCapture->FreeEvent, 100);
+	}
+}
+
+void Capture_Submit(frame_capture *pCapture)
+{
+	Mutex_Lock(&pCapture->Lock);
+	pCapture->dwTail = (pCapture->dwTail + 1) % pCapture->dwBufferCount;
+	pCapture->dwQueued++;
+	Mutex_Unlock(&pCapture->Lock);
+
+	Event_Signal(&pCapture->WorkEvent);
+}
+
+void Capture_Get_Stats(frame_capture *pCapture, capture_stats *pStats)
+{
+	Mutex_Lock(&pCapture->Lock);
+	pStats->Bytes = pCapture->Bytes;
+	pStats->fWriteSeconds = Timer_Seconds(pCapture->WriteTicks);
+	Mutex_Unlock(&pCapture->Lock);
+
+	pStats->dwFrames = (DWORD)pCapture->Frames;
+	pStats->dwDropped = (DWORD)pCapture->Dropped;
+	pStats->dwFailed = (DWORD)pCapture->Failed;
+	pStats->fWaitSeconds = Timer_Seconds(pCapture->WaitTicks);
+}
+
+bool Capture_Parse_Options(const char *szCmdLine, DWORD *pdwPolicy)
+{
+	*pdwPolicy = strstr(szCmdLine, "-dropframes") ? CAPTURE_DROP : CAPTURE_BLOCK;
+
+	return strstr(szCmdLine, "-capture") != NULL;
+}
@@ -0,0 +1,68 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _FRAMECAPTURE_H_
+#define _FRAMECAPTURE_H_
+
+#include "Platform.h"
+
+//records the frames into one video file on a background thread, the
+//render loop only copies the frame into a buffer of a small pool:
+//
+//  LONG lPitch;
+//  DWORD *pPixels = Capture_Acquire(pCapture, &lPitch);
+//  if(pPixels)
+//  {
+//      pDevice->Present(pPixels, lPitch, NULL);     //after EndScene()
+//      Capture_Submit(pCapture);
+//  }
+//
+//.y4m files are YUV4MPEG2 4:2:0 (BT.601), everything else a stream of
+//PPM images one after the other, ffmpeg reads both (-f image2pipe for
+//the PPM stream). The queue is the pool, when the disk is slower than
+//the frames CAPTURE_BLOCK makes the render loop wait for a buffer and
+//CAPTURE_DROP leaves the frame out and counts it
+
+enum
+{
+	CAPTURE_BLOCK,
+	CAPTURE_DROP
+};
+
+#define CAPTURE_DEFAULT_BUFFERS 4
+#define CAPTURE_DEFAULT_FPS 60
+
+struct capture_stats
+{
+	DWORD dwFrames;			//written
+	DWORD dwDropped;		//CAPTURE_DROP, the pool was full
+	DWORD dwFailed;			//the file could not be written
+	LONGLONG Bytes;			//written to the file
+	double fWriteSeconds;	//the writer thread spent converting and writing
+	double fWaitSeconds;	//CAPTURE_BLOCK, the render loop waited for a buffer
+};
+
+struct frame_capture;
+
+//dwFps goes into the Y4M header, 0 is CAPTURE_DEFAULT_FPS. NULL when
+//the file can not be created
+frame_capture *Capture_Create(const char *szFilename, DWORD dwWidth, DWORD dwHeight,
+	DWORD dwFps, DWORD dwBuffers, DWORD dwPolicy);
+//writes the frames in the queue, then closes the file. pStats (can be
+//NULL) gets the counters of the whole capture
+void Capture_Destroy(frame_capture *pCapture, capture_stats *pStats);
+
+//a free buffer for the next frame, X8R8G8B8, NULL when CAPTURE_DROP
+//drops this frame
+DWORD *Capture_Acquire(frame_capture *pCapture, LONG *plPitch);
+//queues the acquired buffer
+void Capture_Submit(frame_capture *pCapture);
+
+void Capture_Get_Stats(frame_capture *pCapture, capture_stats *pStats);
+
+//options of the command line of the samples: -capture writes
+//capture.y4m, -dropframes drops the frames the disk can not take
+bool Capture_Parse_Options(const char *szCmdLine, DWORD *pdwPolicy);
+
+#endif
@@ -0,0 +1,107 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <new>
+
+#include "FramePipeline.h"
+
+struct frame_pipeline
+{
+	pipeline_func pSimulate;
+	void *pParam;
+
+	spsc_queue FreeQueue;		//drawing thread -> simulation thread
+	spsc_queue ReadyQueue;		//simulation thread -> drawing thread
+	event FreeEvent;
+	event ReadyEvent;
+
+	thread_handle Thread;
+	volatile LONG bQuit;
+};
+
+static void Simulation_Thread(void *pParam)
+{
+	frame_pipeline *pPipe = (frame_pipeline *)pParam;
+
+	for(DWORD dwFrame = 0; ; dwFrame++)
+	{
+		void *pSlot;
+		while(!(pSlot = Spsc_Pop(&pPipe->FreeQueue)))
+		{
+			if(pPipe->bQuit)
+				return;
+			Event_Wait(&pPipe->FreeEvent, 100);
+		}
+
+		if(pPipe->bQuit)
+			return;
+
+		pPipe->pSimulate(pPipe->pParam, pSlot, dwFrame);
+
+		//never full, there are not more snapshots than places
+		Spsc_Push(&pPipe->ReadyQueue, pSlot);
+		Event_Signal(&pPipe->ReadyEvent);
+	}
+}
+
+frame_pipeline *Pipeline_Create(void **ppSlots, DWORD dwSlots, pipeline_func pSimulate, void *pParam)
+{
+	if(dwSlots < 2 || dwSlots > PIPELINE_MAX_SLOTS)
+		return NULL;
+
+	frame_pipeline *pPipe = new(std::nothrow) frame_pipeline;
+	if(!pPipe)
+		return NULL;
+
+	pPipe->pSimulate = pSimulate;
+	pPipe->pParam = pParam;
+	pPipe->bQuit = FALSE;
+
+	Spsc_Init(&pPipe->FreeQueue);
+	Spsc_Init(&pPipe->ReadyQueue);
+	Event_Init(&pPipe->FreeEvent);
+	Event_Init(&pPipe->ReadyEvent);
+
+	for(DWORD i = 0; i < dwSlots; i++)
+		Spsc_Push(&pPipe->FreeQueue, ppSlots[i]);
+
+	if(!Thread_Create(&pPipe->Thread, Simulation_Thread, pPipe))
+	{
+		Event_Destroy(&pPipe->FreeEvent);
+		Event_Destroy(&pPipe->ReadyEvent);
+		delete pPipe;
+		return NULL;
+	}
+
+	return pPipe;
+}
+
+void *Pipeline_Begin_Frame(frame_pipeline *pPipe)
+{
+	void *pSlot;
+	while(!(pSlot = Spsc_Pop(&pPipe->ReadyQueue)))
+		Event_Wait(&pPipe->ReadyEvent, 100);
+
+	return pSlot;
+}
+
+void Pipeline_End_Frame(frame_pipeline *pPipe, void *pSlot)
+{
+	Spsc_Push(&pPipe->FreeQueue, pSlot);
+	Event_Signal(&pPipe->FreeEvent);
+}
+
+void Pipeline_Destroy(frame_pipeline *pPipe)
+{
+	if(!pPipe)
+		return;
+
+	Atomic_Exchange(&pPipe->bQuit, TRUE);
+	Event_Signal(&pPipe->FreeEvent);
+	Thread_Join(&pPipe->Thread);
+
+	Event_Destroy(&pPipe->FreeEvent);
+	Event_Destroy(&pPipe->ReadyEvent);
+	delete pPipe;
+}
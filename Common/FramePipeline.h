@@ -0,0 +1,42 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _FRAMEPIPELINE_H_
+#define _FRAMEPIPELINE_H_
+
+#include "Platform.h"
+#include "SpscQueue.h"
+
+//simulation and drawing on two threads. The pipeline thread simulates
+//frame N + 1 into a free snapshot while the caller draws frame N from
+//another one, the snapshots go back and forth through two spsc_queues:
+//
+//  simulation thread: free queue -> simulate -> ready queue
+//  drawing thread:    ready queue -> draw -> free queue
+//
+//with two snapshots the simulation is at most one frame ahead. The
+//snapshots are the caller's memory, the pipeline only passes pointers.
+//Presenting the frame can be a third stage after the drawing, the
+//image writer of Headless is one (ImageWriter.h)
+
+#define PIPELINE_MAX_SLOTS SPSC_CAPACITY
+
+//fills pSlot with frame dwFrame, runs on the pipeline thread
+typedef void (*pipeline_func)(void *pParam, void *pSlot, DWORD dwFrame);
+
+struct frame_pipeline;
+
+//dwSlots snapshots, 2 to PIPELINE_MAX_SLOTS. The thread starts at once
+//with frame 0
+frame_pipeline *Pipeline_Create(void **ppSlots, DWORD dwSlots, pipeline_func pSimulate, void *pParam);
+
+//the next simulated snapshot, in frame order, waits for the simulation
+void *Pipeline_Begin_Frame(frame_pipeline *pPipe);
+//the snapshot is drawn, the simulation may write it again
+void Pipeline_End_Frame(frame_pipeline *pPipe, void *pSlot);
+
+//stops the thread after the frame it is simulating
+void Pipeline_Destroy(frame_pipeline *pPipe);
+
+#endif
@@ -0,0 +1,146 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include "FrameRing.h"
+
+static DWORD Round_Up(DWORD dwSize, DWORD dwAlign)
+{
+	return (dwSize + dwAlign - 1) & ~(dwAlign - 1);
+}
+
+static BYTE *Frame_Pixels(const frame_ring_header *pHeader, DWORD dwSlot)
+{
+	return (BYTE *)pHeader + pHeader->dwFrameOffset + dwSlot * pHeader->dwFrameSize;
+}
+
+HRESULT Frame_Ring_Create(frame_ring *pRing, const char *szName, DWORD dwWidth, DWORD dwHeight, DWORD dwFrames)
+{
+	ZeroMemory(pRing, sizeof(frame_ring));
+
+	if(!dwWidth || !dwHeight || dwFrames < 2 || dwFrames > FRAME_RING_MAX_FRAMES)
+		return E_INVALIDARG;
+
+	//rows on cache lines, frames on pages
+	DWORD dwPitch = Round_Up(dwWidth * sizeof(DWORD), CACHE_LINE_SIZE);
+	DWORD dwFrameOffset = Round_Up(sizeof(frame_ring_header), FRAME_RING_PAGE_SIZE);
+	DWORD dwFrameSize = Round_Up(dwPitch * dwHeight, FRAME_RING_PAGE_SIZE);
+
+	if(!Shared_Memory_Create(&pRing->Memory, szName, dwFrameOffset + (size_t)dwFrameSize * dwFrames))
+		return E_FAIL;
+
+	frame_ring_header *pHeader = (frame_ring_header *)pRing->Memory.pData;
+	pHeader->dwVersion = FRAME_RING_VERSION;
+	pHeader->dwWidth = dwWidth;
+	pHeader->dwHeight = dwHeight;
+	pHeader->lPitch = (LONG)dwPitch;
+	pHeader->dwFormat = FRAME_RING_X8R8G8B8;
+	pHeader->dwFrames = dwFrames;
+	pHeader->dwFrameOffset = dwFrameOffset;
+	pHeader->dwFrameSize = dwFrameSize;
+
+	//a reader that opens the ring now sees a whole header or no magic
+	Memory_Barrier();
+	pHeader->dwMagic = FRAME_RING_MAGIC;
+
+	pRing->pHeader = pHeader;
+
+	return S_OK;
+}
+
+DWORD *Frame_Ring_Begin_Write(frame_ring *pRing, LONG *plPitch)
+{
+	frame_ring_header *pHeader = pRing->pHeader;
+
+	pRing->dwSlot = (DWORD)pHeader->Written % pHeader->dwFrames;
+
+	//odd, readers of the frame before in this slot see it is gone
+	Atomic_Increment(&pHeader->Slots[pRing->dwSlot].Sequence);
+
+	*plPitch = pHeader->lPitch;
+
+	return (DWORD *)Frame_Pixels(pHeader, pRing->dwSlot);
+}
+
+void Frame_Ring_End_Write(frame_ring *pRing)
+{
+	frame_ring_header *pHeader = pRing->pHeader;
+	frame_ring_slot *pSlot = &pHeader->Slots[pRing->dwSlot];
+
+	pSlot->dwFrame = (DWORD)pHeader->Written;
+
+	//the pixels and the number are out before the even sequence
+	Memory_Barrier();
+	Atomic_Increment(&pSlot->Sequence);
+	Atomic_Increment(&pHeader->Written);
+}
+
+HRESULT Frame_Ring_Open(frame_ring *pRing, const char *szName)
+{
+	ZeroMemory(pRing, sizeof(frame_ring));
+
+	if(!Shared_Memory_Open(&pRing->Memory, szName))
+		return E_FAIL;
+
+	const frame_ring_header *pHeader = (const frame_ring_header *)pRing->Memory.pData;
+
+	if(pRing->Memory.Size < sizeof(frame_ring_header) ||
+		pHeader->dwMagic != FRAME_RING_MAGIC || pHeader->dwVersion != FRAME_RING_VERSION ||
+		pHeader->dwFrames < 2 || pHeader->dwFrames > FRAME_RING_MAX_FRAMES ||
+		pHeader->dwFrameOffset + (size_t)pHeader->dwFrameSize * pHeader->dwFrames > pRing->Memory.Size)
+	{
+		Shared_Memory_Close(&pRing->Memory);
+		return E_FAIL;
+	}
+
+	pRing->pHeader = (frame_ring_header *)pHeader;
+
+	return S_OK;
+}
+
+bool Frame_Ring_Begin_Read(const frame_ring *pRing, DWORD dwAfter, frame_ring_read *pRead)
+{
+	const frame_ring_header *pHeader = pRing->pHeader;
+
+	DWORD dwWritten = (DWORD)pHeader->Written;
+	if(!dwWritten || dwWritten <= dwAfter)
+		return false;
+
+	DWORD dwSlot = (dwWritten - 1) % pHeader->dwFrames;
+	LONG Sequence = pHeader->Slots[dwSlot].Sequence;
+	Memory_Barrier();
+
+	//the writer already started the next round in this slot, the
+	//frame is lost, the caller tries again
+	if(Sequence & 1)
+		return false;
+
+	pRead->pPixels = (const DWORD *)Frame_Pixels(pHeader, dwSlot);
+	pRead->dwFrame = pHeader->Slots[dwSlot].dwFrame;
+	pRead->dwSlot = dwSlot;
+	pRead->Sequence = Sequence;
+
+	return true;
+}
+
+bool Frame_Ring_End_Read(const frame_ring *pRing, const frame_ring_read *pRead)
+{
+	Memory_Barrier();
+
+	return pRing->pHeader->Slots[pRead->dwSlot].Sequence == pRead->Sequence;
+}
+
+bool Frame_Ring_Closed(const frame_ring *pRing)
+{
+	return pRing->pHeader->bClosed != 0;
+}
+
+void Frame_Ring_Close(frame_ring *pRing)
+{
+	//readers still have the memory mapped after the name is gone
+	if(pRing->pHeader && pRing->Memory.bOwner)
+		Atomic_Exchange(&pRing->pHeader->bClosed, TRUE);
+
+	Shared_Memory_Close(&pRing->Memory);
+	pRing->pHeader = NULL;
+}
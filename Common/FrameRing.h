@@ -0,0 +1,99 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _FRAMERING_H_
+#define _FRAMERING_H_
+
+#include "Platform.h"
+
+//the frames of the software device in shared memory, a ring of N frames
+//another process maps and shows or encodes where they are, without a
+//copy. The writer presents into the next frame of the ring instead of a
+//back buffer:
+//
+//  LONG lPitch;
+//  DWORD *pPixels = Frame_Ring_Begin_Write(pRing, &lPitch);
+//  pDevice->Present(pPixels, lPitch, NULL);
+//  Frame_Ring_End_Write(pRing);
+//
+//every frame has a seqlock, odd while the writer is in it. A reader
+//takes the newest frame, reads the pixels in place and checks with
+//Frame_Ring_End_Read() the writer did not come round to the frame in the
+//meantime. With N frames the writer has to draw N - 1 more before that
+//happens.
+//
+//the layout is the same for both sides, 32 bit fields only, the frames
+//start on a page after the header
+
+#define FRAME_RING_MAGIC 0x474e5246		//"FRNG"
+#define FRAME_RING_VERSION 1
+#define FRAME_RING_MAX_FRAMES 8
+#define FRAME_RING_DEFAULT_FRAMES 3
+#define FRAME_RING_PAGE_SIZE 4096
+
+enum
+{
+	FRAME_RING_X8R8G8B8 = 1		//DWORD per pixel, blue in the low byte
+};
+
+struct frame_ring_slot
+{
+	volatile LONG Sequence;		//odd while written
+	DWORD dwFrame;				//number of the frame in it
+	DWORD dwReserved[14];		//one cache line per slot
+};
+
+struct frame_ring_header
+{
+	DWORD dwMagic;
+	DWORD dwVersion;
+	DWORD dwWidth;
+	DWORD dwHeight;
+	LONG lPitch;				//bytes
+	DWORD dwFormat;
+	DWORD dwFrames;				//frames in the ring
+	DWORD dwFrameOffset;		//of frame 0 from the header
+	DWORD dwFrameSize;			//bytes from one frame to the next
+	volatile LONG Written;		//frames finished, the newest is Written - 1
+	volatile LONG bClosed;		//the writer is gone
+	DWORD dwReserved[5];
+	frame_ring_slot Slots[FRAME_RING_MAX_FRAMES];
+};
+
+struct frame_ring
+{
+	shared_memory Memory;
+	frame_ring_header *pHeader;
+	DWORD dwSlot;				//writer: the frame being written
+};
+
+//a frame read in place
+struct frame_ring_read
+{
+	const DWORD *pPixels;
+	DWORD dwFrame;
+	DWORD dwSlot;
+	LONG Sequence;
+};
+
+//writer side, dwFrames 2 to FRAME_RING_MAX_FRAMES
+HRESULT Frame_Ring_Create(frame_ring *pRing, const char *szName, DWORD dwWidth, DWORD dwHeight, DWORD dwFrames);
+DWORD *Frame_Ring_Begin_Write(frame_ring *pRing, LONG *plPitch);
+void Frame_Ring_End_Write(frame_ring *pRing);
+
+//reader side, E_FAIL when there is no ring of that name or it is not
+//one of this version
+HRESULT Frame_Ring_Open(frame_ring *pRing, const char *szName);
+//the newest frame when it is newer than dwAfter (Written, 0 for any),
+//false when there is none
+bool Frame_Ring_Begin_Read(const frame_ring *pRing, DWORD dwAfter, frame_ring_read *pRead);
+//false when the writer wrote over the frame while it was read
+bool Frame_Ring_End_Read(const frame_ring *pRing, const frame_ring_read *pRead);
+//the writer closed the ring, no more frames come
+bool Frame_Ring_Closed(const frame_ring *pRing);
+
+//both sides
+void Frame_Ring_Close(frame_ring *pRing);
+
+#endif
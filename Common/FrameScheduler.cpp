@@ -0,0 +1,140 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "FrameScheduler.h"
+
+void Scheduler_Init(frame_scheduler *pSched, DWORD dwTicksPerSecond, DWORD dwMode, DWORD dwMaxFps)
+{
+	LONGLONG Frequency = Timer_Frequency();
+
+	if(!dwTicksPerSecond)
+		dwTicksPerSecond = SCHED_TICKS_PER_SECOND;
+
+	if(dwMode == SCHED_CAP && !dwMaxFps)
+		dwMode = SCHED_FREE;
+
+	pSched->dwMode = dwMode;
+	pSched->TickLength = Frequency / dwTicksPerSecond;
+	pSched->FrameLength = dwMaxFps ? Frequency / dwMaxFps : 0;
+	pSched->LastTime = Timer_Ticks();
+	pSched->Accumulator = 0;
+	pSched->NextFrame = pSched->LastTime;
+	pSched->bChanged = true;
+
+	//the waits between the frames need 1 ms, not the 15.6 ms of Windows
+	if(pSched->dwMode != SCHED_FREE)
+		Sleep_Precise(true);
+}
+
+void Scheduler_Shutdown(frame_scheduler *pSched)
+{
+	if(pSched->dwMode != SCHED_FREE)
+		Sleep_Precise(false);
+}
+
+void Scheduler_Parse_Options(const char *szCmdLine, DWORD *pdwMode, DWORD *pdwMaxFps)
+{
+	*pdwMode = SCHED_FREE;
+	*pdwMaxFps = 0;
+
+	const char *szFps = strstr(szCmdLine, "-fps ");
+	if(szFps)
+	{
+		*pdwMode = SCHED_CAP;
+		*pdwMaxFps = (DWORD)atoi(szFps + 5);
+	}
+	else if(strstr(szCmdLine, "-onchange"))
+	{
+		*pdwMode = SCHED_ON_CHANGE;
+	}
+}
+
+DWORD Scheduler_Update(frame_scheduler *pSched)
+{
+	LONGLONG Now = Timer_Ticks();
+	pSched->Accumulator += Now - pSched->LastTime;
+	pSched->LastTime = Now;
+
+	LONGLONG Ticks = pSched->Accumulator / pSched->TickLength;
+
+	if(Ticks > SCHED_MAX_TICKS)
+	{
+		Ticks = SCHED_MAX_TICKS;
+		pSched->Accumulator %= pSched->TickLength;
+	}
+	else
+	{
+		pSched->Accumulator -= Ticks * pSched->TickLength;
+	}
+
+	if(Ticks)
+		pSched->bChanged = true;
+
+	return (DWORD)Ticks;
+}
+
+float Scheduler_Alpha(const frame_scheduler *pSched)
+{
+	if(pSched->dwMode == SCHED_ON_CHANGE)
+		return 1.0f;
+
+	return (float)pSched->Accumulator / (float)pSched->TickLength;
+}
+
+bool Scheduler_Should_Render(const frame_scheduler *pSched)
+{
+	switch(pSched->dwMode)
+	{
+		case SCHED_CAP: return Timer_Ticks() >= pSched->NextFrame;
+		case SCHED_ON_CHANGE: return pSched->bChanged;
+	}
+
+	return true;
+}
+
+void Scheduler_Frame_Done(frame_scheduler *pSched)
+{
+	pSched->bChanged = false;
+
+	if(pSched->dwMode == SCHED_CAP)
+	{
+		//late frames keep the rhythm, after a long stall it starts again from now
+		LONGLONG Now = Timer_Ticks();
+		pSched->NextFrame += pSched->FrameLength;
+		if(pSched->NextFrame < Now)
+			pSched->NextFrame = Now;
+	}
+}
+
+DWORD Scheduler_Wait_Ms(const frame_scheduler *pSched)
+{
+	LONGLONG Now = Timer_Ticks();
+	LONGLONG Wait = 0;
+
+	switch(pSched->dwMode)
+	{
+		case SCHED_CAP:
+			Wait = pSched->NextFrame - Now;
+			break;
+		case SCHED_ON_CHANGE:
+			if(!pSched->bChanged)
+				Wait = pSched->TickLength - pSched->Accumulator - (Now - pSched->LastTime);
+			break;
+	}
+
+	if(Wait <= 0)
+		return 0;
+
+	//rounded up, a wait that ends early makes the loop spin until the time
+	LONGLONG Frequency = Timer_Frequency();
+	return (DWORD)((Wait * 1000 + Frequency - 1) / Frequency);
+}
+
+void Scheduler_Invalidate(frame_scheduler *pSched)
+{
+	pSched->bChanged = true;
+}
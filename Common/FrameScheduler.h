@@ -0,0 +1,77 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _FRAMESCHEDULER_H_
+#define _FRAMESCHEDULER_H_
+
+#include "Platform.h"
+
+//the simulation runs in fixed ticks, the frames are drawn at their own
+//rate between two ticks, so the speed of the animation does not depend
+//on the frame rate. One loop of the application:
+//
+//  DWORD dwTicks = Scheduler_Update(&Sched);    //ticks due since the last loop
+//  for(DWORD i = 0; i < dwTicks; i++)
+//      Tick_Scene();
+//  if(Scheduler_Should_Render(&Sched))
+//  {
+//      Draw(Scheduler_Alpha(&Sched));           //0..1 from the tick before to the last one
+//      Scheduler_Frame_Done(&Sched);
+//  }
+//  else
+//      wait for messages, at most Scheduler_Wait_Ms(&Sched)
+//
+//SCHED_FREE draws every loop, SCHED_CAP at most dwMaxFps frames per
+//second, SCHED_ON_CHANGE only after a tick or Scheduler_Invalidate().
+//The last two sleep between the frames instead of polling
+
+#define SCHED_TICKS_PER_SECOND 60
+
+//after a stall (debugger, window dragged) the simulation catches up at
+//most this many ticks, the rest of the time is dropped
+#define SCHED_MAX_TICKS 8
+
+enum
+{
+	SCHED_FREE,
+	SCHED_CAP,
+	SCHED_ON_CHANGE
+};
+
+struct frame_scheduler
+{
+	DWORD dwMode;
+	LONGLONG TickLength;		//in Timer_Ticks()
+	LONGLONG FrameLength;		//SCHED_CAP
+	LONGLONG LastTime;
+	LONGLONG Accumulator;		//time not simulated yet, less than one tick
+	LONGLONG NextFrame;			//SCHED_CAP
+	bool bChanged;				//SCHED_ON_CHANGE
+};
+
+//dwMaxFps is used by SCHED_CAP, 0 draws every loop
+void Scheduler_Init(frame_scheduler *pSched, DWORD dwTicksPerSecond, DWORD dwMode, DWORD dwMaxFps);
+void Scheduler_Shutdown(frame_scheduler *pSched);
+
+//options of the command line of the samples:
+//-fps N is SCHED_CAP with N, -onchange is SCHED_ON_CHANGE, else SCHED_FREE
+void Scheduler_Parse_Options(const char *szCmdLine, DWORD *pdwMode, DWORD *pdwMaxFps);
+
+//number of ticks the simulation has to run now
+DWORD Scheduler_Update(frame_scheduler *pSched);
+
+//how far the time is past the last tick, in ticks. SCHED_ON_CHANGE draws
+//the last tick, 1.0
+float Scheduler_Alpha(const frame_scheduler *pSched);
+
+bool Scheduler_Should_Render(const frame_scheduler *pSched);
+void Scheduler_Frame_Done(frame_scheduler *pSched);
+
+//milliseconds until a tick or a frame is due, 0 with SCHED_FREE
+DWORD Scheduler_Wait_Ms(const frame_scheduler *pSched);
+
+//the next loop draws a frame in SCHED_ON_CHANGE, for WM_PAINT and the like
+void Scheduler_Invalidate(frame_scheduler *pSched);
+
+#endif
@@ -0,0 +1,483 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <new>
+
+#include "ImageWriter.h"
+
+#define IMAGE_MAX_PATH 260
+
+struct image_slot
+{
+	DWORD *pPixels;
+	char szFilename[IMAGE_MAX_PATH];
+};
+
+struct image_writer
+{
+	DWORD dwWidth;
+	DWORD dwHeight;
+
+	image_slot *pSlots;
+	DWORD dwSlotCount;
+	DWORD dwHead;		//next slot the thread writes
+	DWORD dwTail;		//next slot the caller fills
+	DWORD dwQueued;
+
+	mutex Lock;
+	event WorkEvent;
+	event FreeEvent;
+	thread_handle Thread;
+	volatile LONG bQuit;
+
+	volatile LONG Written;
+	volatile LONG Failed;
+};
+
+static const char *Find_Extension(const char *szFilename)
+{
+	const char *pDot = strrchr(szFilename, '.');
+	return pDot ? pDot : "";
+}
+
+static void Writer_Thread(void *pParam)
+{
+	image_writer *pWriter = (image_writer *)pParam;
+
+	for(;;)
+	{
+		Mutex_Lock(&pWriter->Lock);
+		DWORD dwQueued = pWriter->dwQueued;
+		DWORD dwHead = pWriter->dwHead;
+		Mutex_Unlock(&pWriter->Lock);
+
+		if(!dwQueued)
+		{
+			if(pWriter->bQuit)
+				break;
+
+			Event_Wait(&pWriter->WorkEvent, 100);
+			continue;
+		}
+
+		image_slot *pSlot = &pWriter->pSlots[dwHead];
+		LONG lPitch = pWriter->dwWidth * sizeof(DWORD);
+
+		bool bPng = strcmp(Find_Extension(pSlot->szFilename), ".png") == 0;
+		bool bOk = bPng ?
+			Write_PNG(pSlot->szFilename, pSlot->pPixels, pWriter->dwWidth, pWriter->dwHeight, lPitch) :
+			Write_PPM(pSlot->szFilename, pSlot->pPixels, pWriter->dwWidth, pWriter->dwHeight, lPitch);
+
+		Atomic_Increment(bOk ? &pWriter->Written : &pWriter->Failed);
+
+		Mutex_Lock(&pWriter->Lock);
+		pWriter->dwHead = (pWriter->dwHead + 1) % pWriter->dwSlotCount;
+		pWriter->dwQueued--;
+		Mutex_Unlock(&pWriter->Lock);
+
+		Event_Signal(&pWriter->FreeEvent);
+	}
+}
+
+image_writer *Image_Writer_Create(DWORD dwWidth, DWORD dwHeight, DWORD dwBuffers)
+{
+	if(!dwWidth || !dwHeight || !dwBuffers)
+		return NULL;
+
+	image_writer *pWriter = new(std::nothrow) image_writer;
+	if(!pWriter)
+		return NULL;
+
+	ZeroMemory(pWriter, sizeof(image_writer));
+	pWriter->dwWidth = dwWidth;
+	pWriter->dwHeight = dwHeight;
+	pWriter->dwSlotCount = dwBuffers;
+
+	pWriter->pSlots = new(std::nothrow) image_slot[dwBuffers];
+	if(!pWriter->pSlots)
+	{
+		delete pWriter;
+		return NULL;
+	}
+
+	for(DWORD i = 0; i < dwBuffers; i++)
+	{
+		pWriter->pSlots[i].pPixels = (DWORD *)Aligned_Alloc(dwWidth * dwHeight * sizeof(DWORD), CACHE_LINE_SIZE);
+		pWriter->pSlots[i].szFilename[0] = 0;
+
+		if(!pWriter->pSlots[i].pPixels)
+		{
+			for(DWORD j = 0; j < i; j++)
+				Aligned_Free(pWriter->pSlots[j].pPixels);
+			delete [] pWriter->pSlots;
+			delete pWriter;
+			return NULL;
+		}
+	}
+
+	Mutex_Init(&pWriter->Lock);
+	Event_Init(&pWriter->WorkEvent);
+	Event_Init(&pWriter->FreeEvent);
+
+	if(!Thread_Create(&pWriter->Thread, Writer_Thread, pWriter))
+	{
+		pWriter->Thread.pHandle = NULL;
+		pWriter->bQuit = TRUE;
+	}
+
+	return pWriter;
+}
+
+DWORD *Image_Writer_Acquire(image_writer *pWriter, LONG *plPitch)
+{
+	for(;;)
+	{
+		Mutex_Lock(&pWriter->Lock);
+		bool bFree = pWriter->dwQueued < pWriter->dwSlotCount;
+		DWORD dwTail = pWriter->dwTail;
+		Mutex_Unlock(&pWriter->Lock);
+
+		if(bFree)
+		{
+			*plPitch = pWriter->dwWidth * sizeof(DWORD);
+			return pWriter->pSlots[dwTail].pPixels;
+		}
+
+		Event_Wait(&pWriter->FreeEvent, 100);
+	}
+}
+
+void Image_Writer_Submit(image_writer *pWriter, const char *szFilename)
+{
+	image_slot *pSlot = &pWriter->pSlots[pWriter->dwTail];
+	strncpy(pSlot->szFilename, szFilename, IMAGE_MAX_PATH - 1);
+	pSlot->szFilename[IMAGE_MAX_PATH - 1] = 0;
+
+	//no thread, write it here
+	if(!pWriter->Thread.pHandle)
+	{
+		LONG lPitch = pWriter->dwWidth * sizeof(DWORD);
+		bool bOk = strcmp(Find_Extension(szFilename), ".png") == 0 ?
+			Write_PNG(szFilename, pSlot->pPixels, pWriter->dwWidth, pWriter->dwHeight, lPitch) :
+			Write_PPM(szFilename, pSlot->pPixels, pWriter->dwWidth, pWriter->dwHeight, lPitch);
+		Atomic_Increment(bOk ? &pWriter->Written : &pWriter->Failed);
+		return;
+	}
+
+	Mutex_Lock(&pWriter->Lock);
+	pWriter->dwTail = (pWriter->dwTail + 1) % pWriter->dwSlotCount;
+	pWriter->dwQueued++;
+	Mutex_Unlock(&pWriter->Lock);
+
+	Event_Signal(&pWriter->WorkEvent);
+}
+
+void Image_Writer_Destroy(image_writer *pWriter)
+{
+	if(!pWriter)
+		return;
+
+	Atomic_Exchange(&pWriter->bQuit, TRUE);
+	Event_Signal(&pWriter->WorkEvent);
+
+	if(pWriter->Thread.pHandle)
+		Thread_Join(&pWriter->Thread);
+
+	Event_Destroy(&pWriter->FreeEvent);
+	Event_Destroy(&pWriter->WorkEvent);
+	Mutex_Destroy(&pWriter->Lock);
+
+	for(DWORD i = 0; i < pWriter->dwSlotCount; i++)
+		Aligned_Free(pWriter->pSlots[i].pPixels);
+
+	delete [] pWriter->pSlots;
+	delete pWriter;
+}
+
+DWORD Image_Writer_Written(image_writer *pWriter)
+{
+	return (DWORD)pWriter->Written;
+}
+
+DWORD Image_Writer_Failed(image_writer *pWriter)
+{
+	return (DWORD)pWriter->Failed;
+}
+
+//the conversion at pPercent, the width in *pWidth and the zero flag in
+//*pbZero, the length of the conversion or 0 when it is not %[0][N]d
+static int Frame_Conversion(const char *pPercent, int *pWidth, bool *pbZero)
+{
+	const char *p = pPercent + 1;
+
+	*pbZero = *p == '0';
+	if(*pbZero)
+		p++;
+
+	*pWidth = 0;
+	while(*p >= '0' && *p <= '9' && *pWidth < 100)
+		*pWidth = *pWidth * 10 + (*p++ - '0');
+
+	if(*p != 'd' || *pWidth > 20)
+		return 0;
+
+	return (int)(p - pPercent) + 1;
+}
+
+bool Frame_Name_Valid(const char *szPattern)
+{
+	int Conversions = 0;
+
+	for(const char *p = szPattern; *p; p++)
+	{
+		if(*p != '%')
+			continue;
+
+		if(p[1] == '%')
+		{
+			p++;
+			continue;
+		}
+
+		int Width;
+		bool bZero;
+		int Length = Frame_Conversion(p, &Width, &bZero);
+		if(!Length)
+			return false;
+
+		Conversions++;
+		p += Length - 1;
+	}
+
+	return Conversions == 1;
+}
+
+bool Frame_Name(char *szName, int Len, const char *szPattern, DWORD dwFrame)
+{
+	if(Len < 1 || !Frame_Name_Valid(szPattern))
+		return false;
+
+	int Pos = 0;
+
+	for(const char *p = szPattern; *p; p++)
+	{
+		char szNumber[32];
+		const char *pCopy = p;
+		int Count = 1;
+
+		if(*p == '%' && p[1] == '%')
+		{
+			p++;
+		}
+		else if(*p == '%')
+		{
+			int Width;
+			bool bZero;
+			p += Frame_Conversion(p, &Width, &bZero) - 1;
+
+			sprintf(szNumber, bZero ? "%0*u" : "%*u", Width, (unsigned)dwFrame);
+			pCopy = szNumber;
+			Count = (int)strlen(szNumber);
+		}
+
+		if(Pos + Count >= Len)
+		{
+			szName[0] = 0;
+			return false;
+		}
+
+		memcpy(szName + Pos, pCopy, Count);
+		Pos += Count;
+	}
+
+	szName[Pos] = 0;
+	return true;
+}
+
+bool Write_PPM(const char *szFilename, const DWORD *pPixels, DWORD dwWidth, DWORD dwHeight, LONG lPitch)
+{
+	FILE *pFile = fopen(szFilename, "wb");
+	if(!pFile)
+		return false;
+
+	fprintf(pFile, "P6\n%u %u\n255\n", (unsigned)dwWidth, (unsigned)dwHeight);
+
+	BYTE *pRow = new(std::nothrow) BYTE[dwWidth * 3];
+	if(!pRow)
+	{
+		fclose(pFile);
+		return false;
+	}
+
+	bool bOk = true;
+	for(DWORD y = 0; y < dwHeight && bOk; y++)
+	{
+		const DWORD *pSrc = (const DWORD *)((const BYTE *)pPixels + y * lPitch);
+		for(DWORD x = 0; x < dwWidth; x++)
+		{
+			pRow[x * 3 + 0] = (BYTE)(pSrc[x] >> 16);
+			pRow[x * 3 + 1] = (BYTE)(pSrc[x] >> 8);
+			pRow[x * 3 + 2] = (BYTE)pSrc[x];
+		}
+
+		bOk = fwrite(pRow, 1, dwWidth * 3, pFile) == dwWidth * 3;
+	}
+
+	delete [] pRow;
+
+	return fclose(pFile) == 0 && bOk;
+}
+
+//-------------------------------------------------------------------------
+// PNG without zlib: the image data is written as stored (not
+// compressed) deflate blocks, every viewer reads it
+//-------------------------------------------------------------------------
+
+static DWORD g_CrcTable[256];
+static volatile LONG g_CrcReady = 0;
+
+static void Crc_Init()
+{
+	if(g_CrcReady)
+		return;
+
+	for(DWORD n = 0; n < 256; n++)
+	{
+		DWORD c = n;
+		for(int k = 0; k < 8; k++)
+			c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		g_CrcTable[n] = c;
+	}
+
+	Atomic_Exchange(&g_CrcReady, 1);
+}
+
+static DWORD Crc_Update(DWORD dwCrc, const BYTE *pData, DWORD dwSize)
+{
+	for(DWORD i = 0; i < dwSize; i++)
+		dwCrc = g_CrcTable[(dwCrc ^ pData[i]) & 0xff] ^ (dwCrc >> 8);
+	return dwCrc;
+}
+
+static void Put_U32(BYTE *p, DWORD dwValue)
+{
+	p[0] = (BYTE)(dwValue >> 24);
+	p[1] = (BYTE)(dwValue >> 16);
+	p[2] = (BYTE)(dwValue >> 8);
+	p[3] = (BYTE)dwValue;
+}
+
+static bool Write_Chunk(FILE *pFile, const char *szType, const BYTE *pData, DWORD dwSize)
+{
+	BYTE Head[8];
+	Put_U32(Head, dwSize);
+	memcpy(Head + 4, szType, 4);
+
+	DWORD dwCrc = Crc_Update(0xffffffff, Head + 4, 4);
+	dwCrc = Crc_Update(dwCrc, pData, dwSize) ^ 0xffffffff;
+
+	BYTE Tail[4];
+	Put_U32(Tail, dwCrc);
+
+	return fwrite(Head, 1, 8, pFile) == 8 &&
+		(dwSize == 0 || fwrite(pData, 1, dwSize, pFile) == dwSize) &&
+		fwrite(Tail, 1, 4, pFile) == 4;
+}
+
+bool Write_PNG(const char *szFilename, const DWORD *pPixels, DWORD dwWidth, DWORD dwHeight, LONG lPitch)
+{
+	Crc_Init();
+
+	//filter byte and RGB for every row
+	DWORD dwRowSize = 1 + dwWidth * 3;
+	DWORD dwRawSize = dwRowSize * dwHeight;
+
+	//zlib header, 65535 byte stored blocks with 5 byte headers, adler32
+	DWORD dwBlocks = (dwRawSize + 65534) / 65535;
+	DWORD dwZSize = 2 + dwBlocks * 5 + dwRawSize + 4;
+
+	BYTE *pRaw = new(std::nothrow) BYTE[dwRawSize];
+	BYTE *pZ = new(std::nothrow) BYTE[dwZSize];
+	if(!pRaw || !pZ)
+	{
+		delete [] pRaw;
+		delete [] pZ;
+		return false;
+	}
+
+	for(DWORD y = 0; y < dwHeight; y++)
+	{
+		const DWORD *pSrc = (const DWORD *)((const BYTE *)pPixels + y * lPitch);
+		BYTE *pDest = pRaw + y * dwRowSize;
+
+		*pDest++ = 0;
+		for(DWORD x = 0; x < dwWidth; x++)
+		{
+			*pDest++ = (BYTE)(pSrc[x] >> 16);
+			*pDest++ = (BYTE)(pSrc[x] >> 8);
+			*pDest++ = (BYTE)pSrc[x];
+		}
+	}
+
+	BYTE *pOut = pZ;
+	*pOut++ = 0x78;
+	*pOut++ = 0x01;
+
+	DWORD a = 1, b = 0;
+	for(DWORD dwPos = 0; dwPos < dwRawSize; )
+	{
+		DWORD dwLen = dwRawSize - dwPos;
+		if(dwLen > 65535)
+			dwLen = 65535;
+
+		*pOut++ = dwPos + dwLen == dwRawSize ? 1 : 0;
+		*pOut++ = (BYTE)dwLen;
+		*pOut++ = (BYTE)(dwLen >> 8);
+		*pOut++ = (BYTE)~dwLen;
+		*pOut++ = (BYTE)(~dwLen >> 8);
+
+		memcpy(pOut, pRaw + dwPos, dwLen);
+		pOut += dwLen;
+
+		for(DWORD i = 0; i < dwLen; i++)
+		{
+			a = (a + pRaw[dwPos + i]) % 65521;
+			b = (b + a) % 65521;
+		}
+
+		dwPos += dwLen;
+	}
+
+	Put_U32(pOut, (b << 16) | a);
+
+	BYTE Header[13];
+	Put_U32(Header, dwWidth);
+	Put_U32(Header + 4, dwHeight);
+	Header[8] = 8;		//bits per channel
+	Header[9] = 2;		//RGB
+	Header[10] = 0;
+	Header[11] = 0;
+	Header[12] = 0;
+
+	static const BYTE Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	bool bOk = false;
+	FILE *pFile = fopen(szFilename, "wb");
+	if(pFile)
+	{
+		bOk = fwrite(Signature, 1, 8, pFile) == 8 &&
+			Write_Chunk(pFile, "IHDR", Header, 13) &&
+			Write_Chunk(pFile, "IDAT", pZ, dwZSize) &&
+			Write_Chunk(pFile, "IEND", NULL, 0);
+
+		bOk = fclose(pFile) == 0 && bOk;
+	}
+
+	delete [] pRaw;
+	delete [] pZ;
+
+	return bOk;
+}
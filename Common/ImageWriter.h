@@ -0,0 +1,41 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _IMAGEWRITER_H_
+#define _IMAGEWRITER_H_
+
+#include "Platform.h"
+
+//frames go to disk on a background thread so the render loop does not
+//wait for the file system. The writer owns a few frame buffers, the
+//caller fills one (for example with CSoftDevice::Present()) and hands
+//it back with a file name. One thread submits, one thread writes.
+
+struct image_writer;
+
+image_writer *Image_Writer_Create(DWORD dwWidth, DWORD dwHeight, DWORD dwBuffers);
+//free buffer for the next frame, waits while all buffers are queued.
+//pitch is in bytes, pixels are X8R8G8B8
+DWORD *Image_Writer_Acquire(image_writer *pWriter, LONG *plPitch);
+//queue the acquired buffer, .png files are PNG, everything else PPM
+void Image_Writer_Submit(image_writer *pWriter, const char *szFilename);
+//writes what is queued and stops the thread
+void Image_Writer_Destroy(image_writer *pWriter);
+
+DWORD Image_Writer_Written(image_writer *pWriter);
+DWORD Image_Writer_Failed(image_writer *pWriter);
+
+//file names of numbered frames (-out of the tools). The pattern has
+//exactly one %d, %Nd or %0Nd for the frame number, %% is a percent sign,
+//anything else is refused: the pattern is not a printf format
+bool Frame_Name_Valid(const char *szPattern);
+//false when the pattern is not valid or the name needs more than Len - 1
+//characters
+bool Frame_Name(char *szName, int Len, const char *szPattern, DWORD dwFrame);
+
+//synchronous writers, used by the thread and by the tools
+bool Write_PPM(const char *szFilename, const DWORD *pPixels, DWORD dwWidth, DWORD dwHeight, LONG lPitch);
+bool Write_PNG(const char *szFilename, const DWORD *pPixels, DWORD dwWidth, DWORD dwHeight, LONG lPitch);
+
+#endif
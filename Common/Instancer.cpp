@@ -0,0 +1,369 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <math.h>
+#include <new>
+
+#include "Instancer.h"
+#include "RenderStats.h"
+
+#ifdef PLATFORM_SSE
+#include <xmmintrin.h>
+#endif
+
+struct instancer
+{
+	job_pool *pPool;
+
+	//the mesh: positions with w = 1 (16 byte aligned for SSE), colors,
+	//texture coordinates
+	float *pPositions;
+	DWORD *pColors;
+	float *pTexCoords;
+	bool bMeshColor;
+	DWORD dwVertexCount;
+
+	//indices of INSTANCE_CHUNK copies, copy i uses vertices i * dwVertexCount...
+	WORD *pIndices;
+	DWORD dwIndexCount;
+	DWORD dwChunk;		//copies per draw
+
+	float Center[3];
+	float fRadius;
+
+	//output of one wave, chunk c starts at vertex c * dwChunk * dwVertexCount
+	instance_vertex *pOut;
+	DWORD *pChunkVisible;
+	DWORD dwWaveChunks;
+
+	//the wave in progress, read by the jobs
+	const matrix4x4 *pWorlds;
+	const DWORD *pInstColors;
+	float Planes[6][4];
+};
+
+static inline DWORD Modulate_Color(DWORD dwA, DWORD dwB)
+{
+	DWORD dwResult = 0;
+	for(int Shift = 0; Shift < 32; Shift += 8)
+	{
+		DWORD a = (dwA >> Shift) & 0xff;
+		DWORD b = (dwB >> Shift) & 0xff;
+		dwResult |= ((a * b + 127) / 255) << Shift;
+	}
+
+	return dwResult;
+}
+
+instancer *Instancer_Create(const instance_mesh *pMesh, job_pool *pPool)
+{
+	if(!pMesh || !pMesh->pVertices || !pMesh->pIndices || !pMesh->dwVertexCount ||
+		pMesh->dwVertexCount > SRMAXNUMVERTICES || (pMesh->dwFVF & SRFVF_XYZRHW))
+		return NULL;
+
+	instancer *pInst = new(std::nothrow) instancer;
+	if(!pInst)
+		return NULL;
+
+	ZeroMemory(pInst, sizeof(instancer));
+	pInst->pPool = pPool;
+	pInst->dwVertexCount = pMesh->dwVertexCount;
+	pInst->dwIndexCount = pMesh->dwIndexCount - pMesh->dwIndexCount % 3;
+	pInst->bMeshColor = (pMesh->dwFVF & SRFVF_DIFFUSE) != 0;
+
+	pInst->dwChunk = SRMAXNUMVERTICES / pMesh->dwVertexCount;
+	if(pInst->dwChunk > INSTANCE_CHUNK)
+		pInst->dwChunk = INSTANCE_CHUNK;
+
+	//two chunks for every thread, one thread can take the second when
+	//the other is slow
+	pInst->dwWaveChunks = 2 * (pPool ? Job_Pool_Threads(pPool) : 1);
+
+	DWORD dwVerts = pInst->dwVertexCount;
+	pInst->pPositions = (float *)Aligned_Alloc(dwVerts * 4 * sizeof(float), CACHE_LINE_SIZE);
+	pInst->pColors = (DWORD *)Aligned_Alloc(dwVerts * sizeof(DWORD), CACHE_LINE_SIZE);
+	pInst->pTexCoords = (float *)Aligned_Alloc(dwVerts * 2 * sizeof(float), CACHE_LINE_SIZE);
+	pInst->pIndices = (WORD *)Aligned_Alloc(pInst->dwChunk * pInst->dwIndexCount * sizeof(WORD) + sizeof(WORD), CACHE_LINE_SIZE);
+	pInst->pOut = (instance_vertex *)Aligned_Alloc(pInst->dwWaveChunks * pInst->dwChunk * dwVerts * sizeof(instance_vertex), CACHE_LINE_SIZE);
+	pInst->pChunkVisible = (DWORD *)Aligned_Alloc(pInst->dwWaveChunks * sizeof(DWORD), CACHE_LINE_SIZE);
+
+	if(!pInst->pPositions || !pInst->pColors || !pInst->pTexCoords || !pInst->pIndices ||
+		!pInst->pOut || !pInst->pChunkVisible)
+	{
+		Instancer_Destroy(pInst);
+		return NULL;
+	}
+
+	//the same offsets as CSoftDevice::Process_Vertices()
+	DWORD dwStride = Soft_FVF_Stride(pMesh->dwFVF);
+	DWORD dwOffset = 12;
+	if(pMesh->dwFVF & SRFVF_NORMAL) dwOffset += 12;
+	if(pMesh->dwFVF & SRFVF_RESERVED1) dwOffset += 4;
+	DWORD dwDiffuseOffset = dwOffset;
+	if(pMesh->dwFVF & SRFVF_DIFFUSE) dwOffset += 4;
+	if(pMesh->dwFVF & SRFVF_SPECULAR) dwOffset += 4;
+	DWORD dwTexOffset = dwOffset;
+	bool bTex = (pMesh->dwFVF & SRFVF_TEXCOUNT_MASK) != 0;
+
+	float Min[3] = { 1e30f, 1e30f, 1e30f };
+	float Max[3] = { -1e30f, -1e30f, -1e30f };
+
+	const BYTE *pIn = (const BYTE *)pMesh->pVertices;
+	for(DWORD i = 0; i < dwVerts; i++, pIn += dwStride)
+	{
+		const float *pPos = (const float *)pIn;
+		for(int c = 0; c < 3; c++)
+		{
+			pInst->pPositions[i * 4 + c] = pPos[c];
+			if(pPos[c] < Min[c]) Min[c] = pPos[c];
+			if(pPos[c] > Max[c]) Max[c] = pPos[c];
+		}
+		pInst->pPositions[i * 4 + 3] = 1.0f;
+
+		pInst->pColors[i] = pInst->bMeshColor ? *(const DWORD *)(pIn + dwDiffuseOffset) : 0xffffffff;
+
+		const float *pTex = (const float *)(pIn + dwTexOffset);
+		pInst->pTexCoords[i * 2] = bTex ? pTex[0] : 0.0f;
+		pInst->pTexCoords[i * 2 + 1] = bTex ? pTex[1] : 0.0f;
+	}
+
+	//bounding sphere around the center of the box
+	for(int c = 0; c < 3; c++)
+		pInst->Center[c] = (Min[c] + Max[c]) * 0.5f;
+
+	float fRadius2 = 0.0f;
+	for(DWORD i = 0; i < dwVerts; i++)
+	{
+		float dx = pInst->pPositions[i * 4] - pInst->Center[0];
+		float dy = pInst->pPositions[i * 4 + 1] - pInst->Center[1];
+		float dz = pInst->pPositions[i * 4 + 2] - pInst->Center[2];
+		float d2 = dx * dx + dy * dy + dz * dz;
+		if(d2 > fRadius2)
+			fRadius2 = d2;
+	}
+	pInst->fRadius = sqrtf(fRadius2);
+
+	//indices out of range are 0, the device would drop the triangle, here
+	//it has no area
+	for(DWORD c = 0; c < pInst->dwChunk; c++)
+	{
+		WORD *pOut = pInst->pIndices + c * pInst->dwIndexCount;
+		DWORD dwBase = c * dwVerts;
+
+		for(DWORD i = 0; i < pInst->dwIndexCount; i++)
+		{
+			DWORD dwIndex = pMesh->pIndices[i];
+			pOut[i] = (WORD)(dwBase + (dwIndex < dwVerts ? dwIndex : 0));
+		}
+	}
+
+	return pInst;
+}
+
+void Instancer_Destroy(instancer *pInst)
+{
+	if(!pInst)
+		return;
+
+	Aligned_Free(pInst->pPositions);
+	Aligned_Free(pInst->pColors);
+	Aligned_Free(pInst->pTexCoords);
+	Aligned_Free(pInst->pIndices);
+	Aligned_Free(pInst->pOut);
+	Aligned_Free(pInst->pChunkVisible);
+	delete pInst;
+}
+
+//planes of the clip volume of D3D (-w <= x, y <= w, 0 <= z <= w) in
+//world space, inside is positive. v' = v * M, so a plane is a column
+static void Frustum_Planes(const matrix4x4 &Mat, float Planes[6][4])
+{
+	const float *m = Mat.Mat;
+
+	for(int c = 0; c < 4; c++)
+	{
+		float Col0 = m[c * 4 + 0], Col1 = m[c * 4 + 1];
+		float Col2 = m[c * 4 + 2], Col3 = m[c * 4 + 3];
+
+		Planes[0][c] = Col3 + Col0;
+		Planes[1][c] = Col3 - Col0;
+		Planes[2][c] = Col3 + Col1;
+		Planes[3][c] = Col3 - Col1;
+		Planes[4][c] = Col2;
+		Planes[5][c] = Col3 - Col2;
+	}
+
+	for(int p = 0; p < 6; p++)
+	{
+		float fLen = sqrtf(Planes[p][0] * Planes[p][0] + Planes[p][1] * Planes[p][1] + Planes[p][2] * Planes[p][2]);
+		if(fLen > 0.0f)
+		{
+			for(int c = 0; c < 4; c++)
+				Planes[p][c] /= fLen;
+		}
+	}
+}
+
+static bool Instance_Visible(const instancer *pInst, const matrix4x4 &MatWorld)
+{
+	const float *m = MatWorld.Mat;
+	float x = pInst->Center[0], y = pInst->Center[1], z = pInst->Center[2];
+
+	float cx = x * m[M00] + y * m[M10] + z * m[M20] + m[M30];
+	float cy = x * m[M01] + y * m[M11] + z * m[M21] + m[M31];
+	float cz = x * m[M02] + y * m[M12] + z * m[M22] + m[M32];
+
+	//the longest axis of the matrix scales the radius
+	float fScale2 = m[M00] * m[M00] + m[M01] * m[M01] + m[M02] * m[M02];
+	float fRow2 = m[M10] * m[M10] + m[M11] * m[M11] + m[M12] * m[M12];
+	if(fRow2 > fScale2) fScale2 = fRow2;
+	fRow2 = m[M20] * m[M20] + m[M21] * m[M21] + m[M22] * m[M22];
+	if(fRow2 > fScale2) fScale2 = fRow2;
+
+	float fRadius = pInst->fRadius * sqrtf(fScale2);
+
+	for(int p = 0; p < 6; p++)
+	{
+		const float *pPlane = pInst->Planes[p];
+		if(cx * pPlane[0] + cy * pPlane[1] + cz * pPlane[2] + pPlane[3] < -fRadius)
+			return false;
+	}
+
+	return true;
+}
+
+static void Transform_Instance(const instancer *pInst, const matrix4x4 &MatWorld, DWORD dwColor,
+					instance_vertex *pOut)
+{
+	const float *pPos = pInst->pPositions;
+	const float *pTex = pInst->pTexCoords;
+	DWORD dwVerts = pInst->dwVertexCount;
+
+	//the copy color, the mesh colors or both multiplied
+	const DWORD *pMeshColor = pInst->bMeshColor ? pInst->pColors : NULL;
+	bool bModulate = pMeshColor && dwColor != 0xffffffff;
+
+#ifdef PLATFORM_SSE
+	__m128 Row0 = _mm_loadu_ps(&MatWorld.Mat[M00]);
+	__m128 Row1 = _mm_loadu_ps(&MatWorld.Mat[M10]);
+	__m128 Row2 = _mm_loadu_ps(&MatWorld.Mat[M20]);
+	__m128 Row3 = _mm_loadu_ps(&MatWorld.Mat[M30]);
+
+	for(DWORD i = 0; i < dwVerts; i++, pPos += 4, pTex += 2, pOut++)
+	{
+		__m128 Pos = _mm_load_ps(pPos);
+		__m128 Res = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(Pos, Pos, 0x00), Row0),
+					_mm_mul_ps(_mm_shuffle_ps(Pos, Pos, 0x55), Row1)),
+			_mm_add_ps(_mm_mul_ps(_mm_shuffle_ps(Pos, Pos, 0xaa), Row2), Row3));
+
+		//x, y, z and w, w is overwritten by the color
+		_mm_storeu_ps(&pOut->x, Res);
+#else
+	const float *m = MatWorld.Mat;
+
+	for(DWORD i = 0; i < dwVerts; i++, pPos += 4, pTex += 2, pOut++)
+	{
+		float x = pPos[0], y = pPos[1], z = pPos[2];
+		pOut->x = x * m[M00] + y * m[M10] + z * m[M20] + m[M30];
+		pOut->y = x * m[M01] + y * m[M11] + z * m[M21] + m[M31];
+		pOut->z = x * m[M02] + y * m[M12] + z * m[M22] + m[M32];
+#endif
+		if(bModulate)
+			pOut->dwColor = Modulate_Color(pMeshColor[i], dwColor);
+		else
+			pOut->dwColor = pMeshColor ? pMeshColor[i] : dwColor;
+
+		pOut->tu = pTex[0];
+		pOut->tv = pTex[1];
+	}
+}
+
+//one chunk: the visible copies of [dwFirst, dwFirst + dwCount) are
+//written one after another at the start of the chunk
+static void Instance_Job(void *pParam, DWORD dwFirst, DWORD dwCount)
+{
+	instancer *pInst = (instancer *)pParam;
+	DWORD dwChunkIndex = dwFirst / pInst->dwChunk;
+
+	instance_vertex *pOut = pInst->pOut + dwChunkIndex * pInst->dwChunk * pInst->dwVertexCount;
+	DWORD dwVisible = 0;
+
+	for(DWORD i = dwFirst; i < dwFirst + dwCount; i++)
+	{
+		if(!Instance_Visible(pInst, pInst->pWorlds[i]))
+			continue;
+
+		DWORD dwColor = pInst->pInstColors ? pInst->pInstColors[i] : 0xffffffff;
+		Transform_Instance(pInst, pInst->pWorlds[i], dwColor, pOut);
+
+		pOut += pInst->dwVertexCount;
+		dwVisible++;
+	}
+
+	pInst->pChunkVisible[dwChunkIndex] = dwVisible;
+	Stats_Local()->dwInstancesCulled += dwCount - dwVisible;
+}
+
+HRESULT Instancer_Draw(instancer *pInst, IRenderDevice *pDevice, const matrix4x4 *pViewProj,
+				const matrix4x4 *pWorlds, const DWORD *pColors, DWORD dwCount)
+{
+	if(!pInst || !pDevice || !pViewProj || (!pWorlds && dwCount))
+		return E_INVALIDARG;
+
+	if(!dwCount)
+		return S_OK;
+
+	Frustum_Planes(*pViewProj, pInst->Planes);
+	Stats_Local()->dwInstancesIn += dwCount;
+
+	matrix4x4 MatIdentity = Mat4x4_Identity();
+	HRESULT hr = pDevice->SetTransform(SRTS_WORLD, &MatIdentity);
+	if(FAILED(hr))
+		return hr;
+
+	//a wave of chunks is transformed and drawn before the next one, the
+	//vertices are still in the cache when the device reads them
+	DWORD dwWave = pInst->dwWaveChunks * pInst->dwChunk;
+
+	for(DWORD dwWaveFirst = 0; dwWaveFirst < dwCount; dwWaveFirst += dwWave)
+	{
+		DWORD dwWaveCount = dwCount - dwWaveFirst;
+		if(dwWaveCount > dwWave)
+			dwWaveCount = dwWave;
+
+		pInst->pWorlds = pWorlds + dwWaveFirst;
+		pInst->pInstColors = pColors ? pColors + dwWaveFirst : NULL;
+
+		if(pInst->pPool)
+		{
+			Job_Pool_Run(pInst->pPool, Instance_Job, pInst, dwWaveCount, pInst->dwChunk);
+		}
+		else
+		{
+			for(DWORD dwFirst = 0; dwFirst < dwWaveCount; dwFirst += pInst->dwChunk)
+			{
+				DWORD dwLeft = dwWaveCount - dwFirst;
+				Instance_Job(pInst, dwFirst, dwLeft < pInst->dwChunk ? dwLeft : pInst->dwChunk);
+			}
+		}
+
+		DWORD dwChunks = (dwWaveCount + pInst->dwChunk - 1) / pInst->dwChunk;
+
+		for(DWORD c = 0; c < dwChunks; c++)
+		{
+			DWORD dwVisible = pInst->pChunkVisible[c];
+			if(!dwVisible)
+				continue;
+
+			hr = pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, INSTANCE_FVF,
+				pInst->pOut + c * pInst->dwChunk * pInst->dwVertexCount, dwVisible * pInst->dwVertexCount,
+				pInst->pIndices, dwVisible * pInst->dwIndexCount, 0);
+			if(FAILED(hr))
+				return hr;
+		}
+	}
+
+	return S_OK;
+}
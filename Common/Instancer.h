@@ -0,0 +1,59 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _INSTANCER_H_
+#define _INSTANCER_H_
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "SoftDevice.h"
+#include "JobPool.h"
+
+//many copies of one mesh, each with its own world matrix and color, in a
+//few draw calls instead of a SetTransform() and a draw per copy. The
+//copies are tested against the view frustum with the bounding sphere of
+//the mesh, the ones that are visible are moved to world space (SSE when
+//PLATFORM_SSE) on the threads of the job pool and drawn with the identity
+//world matrix. A draw has at most INSTANCE_CHUNK copies and at most
+//SRMAXNUMVERTICES vertices, the indices are WORDs
+
+#define INSTANCE_CHUNK 512
+
+//the vertex the instancer draws, same layout as SRFVF_XYZ | SRFVF_DIFFUSE | SRFVF_TEX1
+struct instance_vertex
+{
+	float x, y, z;
+	DWORD dwColor;
+	float tu, tv;
+};
+
+#define INSTANCE_FVF (SRFVF_XYZ | SRFVF_DIFFUSE | SRFVF_TEX1)
+
+//triangle list in SRFVF_XYZ, normal, diffuse and one texture coordinate
+//may be in the vertex, the normal is not used
+struct instance_mesh
+{
+	DWORD dwFVF;
+	const void *pVertices;
+	DWORD dwVertexCount;
+	const WORD *pIndices;
+	DWORD dwIndexCount;
+};
+
+struct instancer;
+
+//the mesh is copied. pPool NULL does the work on the calling thread
+instancer *Instancer_Create(const instance_mesh *pMesh, job_pool *pPool);
+
+//world matrices are affine (last column 0 0 0 1), pViewProj is view *
+//projection of the device and is used only for the culling. The color of
+//a copy is multiplied with the diffuse color of the mesh, pColors NULL
+//draws the colors of the mesh. The world matrix of the device is the
+//identity after the call
+HRESULT Instancer_Draw(instancer *pInst, IRenderDevice *pDevice, const matrix4x4 *pViewProj,
+				const matrix4x4 *pWorlds, const DWORD *pColors, DWORD dwCount);
+
+void Instancer_Destroy(instancer *pInst);
+
+#endif
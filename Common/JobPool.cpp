@@ -0,0 +1,173 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <new>
+
+#include "JobPool.h"
+
+struct job_worker
+{
+	job_pool *pPool;
+	thread_handle Thread;
+	event WakeEvent;
+};
+
+struct job_pool
+{
+	job_worker *pWorkers;
+	int WorkerCount;
+
+	//the job of the current Job_Pool_Run()
+	job_func pFunc;
+	void *pParam;
+	DWORD dwCount;
+	DWORD dwGrain;
+
+	volatile LONG NextRange;
+	volatile LONG Busy;		//workers that have not finished the job
+	event DoneEvent;
+	volatile LONG bQuit;
+};
+
+static void Run_Ranges(job_pool *pPool)
+{
+	for(;;)
+	{
+		DWORD dwRange = (DWORD)(Atomic_Increment(&pPool->NextRange) - 1);
+		DWORD dwFirst = dwRange * pPool->dwGrain;
+		if(dwFirst >= pPool->dwCount)
+			break;
+
+		DWORD dwCount = pPool->dwCount - dwFirst;
+		if(dwCount > pPool->dwGrain)
+			dwCount = pPool->dwGrain;
+
+		pPool->pFunc(pPool->pParam, dwFirst, dwCount);
+	}
+}
+
+static void Worker_Thread(void *pParam)
+{
+	job_worker *pWorker = (job_worker *)pParam;
+	job_pool *pPool = pWorker->pPool;
+
+	for(;;)
+	{
+		if(!Event_Wait(&pWorker->WakeEvent, 100))
+		{
+			if(pPool->bQuit)
+				break;
+			continue;
+		}
+
+		if(pPool->bQuit)
+			break;
+
+		Run_Ranges(pPool);
+
+		if(Atomic_Decrement(&pPool->Busy) == 0)
+			Event_Signal(&pPool->DoneEvent);
+	}
+}
+
+job_pool *Job_Pool_Create(int Threads)
+{
+	if(Threads <= 0)
+		Threads = Cpu_Count();
+	if(Threads > JOB_MAX_THREADS)
+		Threads = JOB_MAX_THREADS;
+
+	//the calling thread is the last one
+	Threads--;
+
+	job_pool *pPool = new(std::nothrow) job_pool;
+	if(!pPool)
+		return NULL;
+
+	ZeroMemory(pPool, sizeof(job_pool));
+	Event_Init(&pPool->DoneEvent);
+
+	if(Threads)
+	{
+		pPool->pWorkers = new(std::nothrow) job_worker[Threads];
+		if(!pPool->pWorkers)
+		{
+			Job_Pool_Destroy(pPool);
+			return NULL;
+		}
+	}
+
+	for(int i = 0; i < Threads; i++)
+	{
+		job_worker *pWorker = &pPool->pWorkers[i];
+		pWorker->pPool = pPool;
+		Event_Init(&pWorker->WakeEvent);
+
+		if(!Thread_Create(&pWorker->Thread, Worker_Thread, pWorker))
+		{
+			Event_Destroy(&pWorker->WakeEvent);
+			break;
+		}
+
+		pPool->WorkerCount++;
+	}
+
+	return pPool;
+}
+
+void Job_Pool_Run(job_pool *pPool, job_func pFunc, void *pParam, DWORD dwCount, DWORD dwGrain)
+{
+	if(!dwCount)
+		return;
+
+	if(!dwGrain)
+		dwGrain = 1;
+
+	//one range is not worth waking the workers
+	if(!pPool->WorkerCount || dwCount <= dwGrain)
+	{
+		for(DWORD dwFirst = 0; dwFirst < dwCount; dwFirst += dwGrain)
+			pFunc(pParam, dwFirst, dwCount - dwFirst < dwGrain ? dwCount - dwFirst : dwGrain);
+		return;
+	}
+
+	pPool->pFunc = pFunc;
+	pPool->pParam = pParam;
+	pPool->dwCount = dwCount;
+	pPool->dwGrain = dwGrain;
+	pPool->NextRange = 0;
+	Atomic_Exchange(&pPool->Busy, pPool->WorkerCount);
+
+	for(int i = 0; i < pPool->WorkerCount; i++)
+		Event_Signal(&pPool->pWorkers[i].WakeEvent);
+
+	Run_Ranges(pPool);
+
+	while(pPool->Busy)
+		Event_Wait(&pPool->DoneEvent, 100);
+}
+
+void Job_Pool_Destroy(job_pool *pPool)
+{
+	if(!pPool)
+		return;
+
+	Atomic_Exchange(&pPool->bQuit, TRUE);
+
+	for(int i = 0; i < pPool->WorkerCount; i++)
+	{
+		Event_Signal(&pPool->pWorkers[i].WakeEvent);
+		Thread_Join(&pPool->pWorkers[i].Thread);
+		Event_Destroy(&pPool->pWorkers[i].WakeEvent);
+	}
+
+	delete[] pPool->pWorkers;
+	Event_Destroy(&pPool->DoneEvent);
+	delete pPool;
+}
+
+int Job_Pool_Threads(job_pool *pPool)
+{
+	return pPool->WorkerCount + 1;
+}
@@ -0,0 +1,32 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _JOBPOOL_H_
+#define _JOBPOOL_H_
+
+#include "Platform.h"
+
+//worker threads for loops over independent items. Job_Pool_Run() splits
+//dwCount items into ranges of dwGrain, the workers and the calling thread
+//take ranges until none is left, the call returns when all are done.
+//One thread calls Job_Pool_Run(), the function must not call it again.
+
+#define JOB_MAX_THREADS 32
+
+//pParam is the pointer given to Job_Pool_Run(), the range is
+//[dwFirst, dwFirst + dwCount)
+typedef void (*job_func)(void *pParam, DWORD dwFirst, DWORD dwCount);
+
+struct job_pool;
+
+//Threads counts the calling thread, 0 is one thread per CPU. The pool
+//starts Threads - 1 workers, with 1 everything runs in the caller
+job_pool *Job_Pool_Create(int Threads);
+void Job_Pool_Run(job_pool *pPool, job_func pFunc, void *pParam, DWORD dwCount, DWORD dwGrain);
+void Job_Pool_Destroy(job_pool *pPool);
+
+//workers plus the calling thread
+int Job_Pool_Threads(job_pool *pPool);
+
+#endif
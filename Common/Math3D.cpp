@@ -0,0 +1,148 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <math.h>
+#include <string.h>
+
+#include "Math3D.h"
+
+float Vec3_Dot(vector3 v1, vector3 v2)
+{
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+vector3 Vec3_Normalize(vector3 v)
+{
+	float len = sqrtf((v.x * v.x) + (v.y * v.y) + (v.z * v.z));
+	vector3 t = { v.x / len, v.y / len, v.z / len };
+	return t;
+}
+
+vector3 Vec3_Cross(vector3 v1, vector3 v2)
+{
+	vector3 t = { v1.y * v2.z - v1.z * v2.y,
+			v1.z * v2.x - v1.x * v2.z,
+			v1.x * v2.y - v1.y * v2.x };
+
+	return t;
+}
+
+vector4 Vec3_Mat4x4_Mul(const vector3 &VecIn, const matrix4x4 &MatIn)
+{
+	vector4 VecOut;
+
+	VecOut.x =	VecIn.x * MatIn.Mat[M00] +
+				VecIn.y * MatIn.Mat[M10] +
+				VecIn.z * MatIn.Mat[M20] +
+				MatIn.Mat[M30];
+
+	VecOut.y =	VecIn.x * MatIn.Mat[M01] +
+				VecIn.y * MatIn.Mat[M11] +
+				VecIn.z * MatIn.Mat[M21] +
+				MatIn.Mat[M31];
+
+	VecOut.z =	VecIn.x * MatIn.Mat[M02] +
+				VecIn.y * MatIn.Mat[M12] +
+				VecIn.z * MatIn.Mat[M22] +
+				MatIn.Mat[M32];
+
+	VecOut.w =	VecIn.x * MatIn.Mat[M03] +
+				VecIn.y * MatIn.Mat[M13] +
+				VecIn.z * MatIn.Mat[M23] +
+				MatIn.Mat[M33];
+
+	return VecOut;
+}
+
+vector3 Vec3_Mat4x4_Mul_Normal(const vector3 &VecIn, const matrix4x4 &MatIn)
+{
+	vector3 VecOut;
+
+	VecOut.x = VecIn.x * MatIn.Mat[M00] + VecIn.y * MatIn.Mat[M10] + VecIn.z * MatIn.Mat[M20];
+	VecOut.y = VecIn.x * MatIn.Mat[M01] + VecIn.y * MatIn.Mat[M11] + VecIn.z * MatIn.Mat[M21];
+	VecOut.z = VecIn.x * MatIn.Mat[M02] + VecIn.y * MatIn.Mat[M12] + VecIn.z * MatIn.Mat[M22];
+
+	return VecOut;
+}
+
+matrix4x4 Mat4x4_Mul(const matrix4x4 &MatA, const matrix4x4 &MatB)
+{
+	matrix4x4 MatOut;
+
+	for(int i = 0; i < 4; i++)
+	{
+		for(int j = 0; j < 4; j++)
+		{
+			MatOut.Mat[i * 4 + j] = MatA.Mat[i * 4 + 0] * MatB.Mat[0 * 4 + j] +
+									MatA.Mat[i * 4 + 1] * MatB.Mat[1 * 4 + j] +
+									MatA.Mat[i * 4 + 2] * MatB.Mat[2 * 4 + j] +
+									MatA.Mat[i * 4 + 3] * MatB.Mat[3 * 4 + j];
+		}
+	}
+
+	return MatOut;
+}
+
+matrix4x4 Mat4x4_Identity()
+{
+	return matrix4x4 (
+		1.0, 0.0, 0.0, 0.0,
+		0.0, 1.0, 0.0, 0.0,
+		0.0, 0.0, 1.0, 0.0,
+		0.0, 0.0, 0.0, 1.0 );
+}
+
+bool Mat4x4_Equal(const matrix4x4 &MatA, const matrix4x4 &MatB)
+{
+	return memcmp(MatA.Mat, MatB.Mat, sizeof(MatA.Mat)) == 0;
+}
+
+matrix4x4 Mat4x4_Rotation_Y(float Angle)
+{
+	//rotation around the Y axis, same as Update_Scene() in the samples
+	return matrix4x4 (
+		cosf(Angle),	0.0,	-sinf(Angle),	0.0,
+		0.0,			1.0,	0.0,			0.0,
+		sinf(Angle),	0.0,	cosf(Angle),	0.0,
+		0.0,			0.0,	0.0,			1.0 );
+}
+
+matrix4x4 Mat4x4_View(vector3 VecCamPos)
+{
+	vector3 VecRight = { 1.0f, 0.0f, 0.0 };
+	vector3 VecUp = { 0.0f, 1.0f, 0.0f };
+	vector3 VecLook = { -1.0f * VecCamPos.x, -1.0f * VecCamPos.y, -1.0f * VecCamPos.z };
+
+	VecLook = Vec3_Normalize(VecLook);
+
+	VecUp = Vec3_Cross(VecLook, VecRight);
+	VecUp = Vec3_Normalize(VecUp);
+	VecRight = Vec3_Cross(VecUp, VecLook);
+	VecRight = Vec3_Normalize(VecRight);
+
+	float xp = -Vec3_Dot(VecCamPos, VecRight);
+	float yp = -Vec3_Dot(VecCamPos, VecUp);
+	float zp = -Vec3_Dot(VecCamPos, VecLook);
+
+	return matrix4x4 (
+		VecRight.x,	VecUp.x,	VecLook.x,	0.0,
+		VecRight.y,	VecUp.y,	VecLook.y,	0.0,
+		VecRight.z,	VecUp.z,	VecLook.z,	0.0,
+		xp,			yp,			zp,			1.0 );
+}
+
+matrix4x4 Mat4x4_Projection(float fFov, float fAspect, float fZNear, float fZFar)
+{
+	float    h, w, Q;
+
+	w = (1.0f / tanf(fFov * 0.5f)) / fAspect;
+	h = 1.0f / tanf(fFov * 0.5f);
+	Q = fZFar / (fZFar - fZNear);
+
+	return matrix4x4 (
+		w,		0.0,	0.0,			0.0,
+		0.0,	h,		0.0,			0.0,
+		0.0,	0.0,	Q,				1.0,
+		0.0,	0.0,	-Q * fZNear,	0.0 );
+}
@@ -0,0 +1,62 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _MATH3D_H_
+#define _MATH3D_H_
+
+#define PI 3.14159265358979f
+#define PI2 (PI * 2.0f)
+
+//matrix offset
+enum {	M00, M01, M02, M03,
+		M10, M11, M12, M13,
+		M20, M21, M22, M23,
+		M30, M31, M32, M33	};
+
+//same memory layout as D3DMATRIX, row vector is multiplied
+//from the left: v' = v * M
+struct matrix4x4
+{
+	matrix4x4(){};
+
+	float Mat[16];
+
+	matrix4x4(float IR0C0, float IR0C1, float IR0C2, float IR0C3,
+			float IR1C0, float IR1C1, float IR1C2, float IR1C3,
+			float IR2C0, float IR2C1, float IR2C2, float IR2C3,
+			float IR3C0, float IR3C1, float IR3C2, float IR3C3)
+	{
+		Mat[M00] = IR0C0;	Mat[M01] = IR0C1;	Mat[M02] = IR0C2;	Mat[M03] = IR0C3;
+		Mat[M10] = IR1C0;	Mat[M11] = IR1C1;	Mat[M12] = IR1C2;	Mat[M13] = IR1C3;
+		Mat[M20] = IR2C0;	Mat[M21] = IR2C1;	Mat[M22] = IR2C2;	Mat[M23] = IR2C3;
+		Mat[M30] = IR3C0;	Mat[M31] = IR3C1;	Mat[M32] = IR3C2;	Mat[M33] = IR3C3;
+	}
+};
+
+struct vector3
+{
+	float x, y, z;
+};
+
+struct vector4
+{
+	float x, y, z, w;
+};
+
+float Vec3_Dot(vector3 v1, vector3 v2);
+vector3 Vec3_Normalize(vector3 v);
+vector3 Vec3_Cross(vector3 v1, vector3 v2);
+
+vector4 Vec3_Mat4x4_Mul(const vector3 &VecIn, const matrix4x4 &MatIn);
+vector3 Vec3_Mat4x4_Mul_Normal(const vector3 &VecIn, const matrix4x4 &MatIn);
+matrix4x4 Mat4x4_Mul(const matrix4x4 &MatA, const matrix4x4 &MatB);
+matrix4x4 Mat4x4_Identity();
+bool Mat4x4_Equal(const matrix4x4 &MatA, const matrix4x4 &MatB);
+
+//the matrices the samples build in Init_Scene() and Update_Scene()
+matrix4x4 Mat4x4_Rotation_Y(float Angle);
+matrix4x4 Mat4x4_View(vector3 VecCamPos);
+matrix4x4 Mat4x4_Projection(float fFov, float fAspect, float fZNear, float fZFar);
+
+#endif
@@ -0,0 +1,509 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <math.h>
+#include <new>
+
+#include "Mesh.h"
+#include "MeshOptimize.h"
+#include "SoftDevice.h"
+
+#define NO_VERTEX 0xffffffff
+
+static LONGLONG Align_Offset(LONGLONG Offset)
+{
+	return (Offset + MESH_ALIGN - 1) & ~(LONGLONG)(MESH_ALIGN - 1);
+}
+
+//the part is on MESH_ALIGN and inside the file
+static bool Part_In_File(DWORD dwOffset, LONGLONG Bytes, size_t FileSize)
+{
+	return (dwOffset % MESH_ALIGN) == 0 && dwOffset >= sizeof(mesh_header) &&
+		(LONGLONG)dwOffset + Bytes <= (LONGLONG)FileSize;
+}
+
+//extent of one batch in the first pass of Make_Batches()
+struct batch_plan
+{
+	DWORD dwFirstIndex;
+	DWORD dwIndexCount;
+	DWORD dwMin, dwMax;		//lowest and highest vertex
+	DWORD dwUsed;			//different vertices
+};
+
+//the triangles from dwFirst on as long as they use at most
+//MESH_MAX_WORD_VERTICES different vertices. Each batch is as long as it
+//can be, so going from the first triangle to the last gives the fewest
+//batches for the order of the triangles. pLocal is NO_VERTEX for every
+//vertex before and after
+static void Plan_Batch(const DWORD *pIndices, DWORD dwIndexCount, DWORD dwFirst,
+					DWORD *pLocal, DWORD *pUsed, batch_plan *pPlan)
+{
+	DWORD dwUsed = 0;
+	DWORD dwMin = NO_VERTEX;
+	DWORD dwMax = 0;
+	DWORD i = dwFirst;
+
+	for(; i < dwIndexCount; i += 3)
+	{
+		DWORD dwNew = 0;
+		for(DWORD k = 0; k < 3; k++)
+		{
+			DWORD v = pIndices[i + k];
+			if(pLocal[v] == NO_VERTEX)
+			{
+				pLocal[v] = dwUsed + dwNew;
+				pUsed[dwUsed + dwNew] = v;
+				dwNew++;
+			}
+		}
+
+		if(dwUsed + dwNew > MESH_MAX_WORD_VERTICES)
+		{
+			for(DWORD k = 0; k < dwNew; k++)
+				pLocal[pUsed[dwUsed + k]] = NO_VERTEX;
+			break;
+		}
+
+		for(DWORD k = 0; k < 3; k++)
+		{
+			DWORD v = pIndices[i + k];
+			if(v < dwMin) dwMin = v;
+			if(v > dwMax) dwMax = v;
+		}
+
+		dwUsed += dwNew;
+	}
+
+	for(DWORD k = 0; k < dwUsed; k++)
+		pLocal[pUsed[k]] = NO_VERTEX;
+
+	pPlan->dwFirstIndex = dwFirst;
+	pPlan->dwIndexCount = i - dwFirst;
+	pPlan->dwMin = dwMin;
+	pPlan->dwMax = dwMax;
+	pPlan->dwUsed = dwUsed;
+}
+
+//the indices of one batch, counted from the first vertex of its window
+//of the mapping, or from its copied vertices in the order of first use.
+//Returns the vertices copied to pCopy
+static DWORD Fill_Batch(mesh *pMesh, const batch_plan *pPlan, mesh_batch *pBatch,
+					mesh_vertex *pCopy, DWORD *pLocal, DWORD *pUsed)
+{
+	const DWORD *pIn = (const DWORD *)pMesh->pIndices + pPlan->dwFirstIndex;
+	WORD *pOut = pMesh->pBatchIndices + pPlan->dwFirstIndex;
+
+	if(pPlan->dwMax - pPlan->dwMin < MESH_MAX_WORD_VERTICES)
+	{
+		for(DWORD i = 0; i < pPlan->dwIndexCount; i++)
+			pOut[i] = (WORD)(pIn[i] - pPlan->dwMin);
+
+		pBatch->pVertices = &pMesh->pVertices[pPlan->dwMin];
+		pBatch->dwVertexCount = pPlan->dwMax - pPlan->dwMin + 1;
+	}
+	else
+	{
+		DWORD dwUsed = 0;
+		for(DWORD i = 0; i < pPlan->dwIndexCount; i++)
+		{
+			DWORD v = pIn[i];
+			if(pLocal[v] == NO_VERTEX)
+			{
+				pLocal[v] = dwUsed;
+				pUsed[dwUsed] = v;
+				pCopy[dwUsed] = pMesh->pVertices[v];
+				dwUsed++;
+			}
+			pOut[i] = (WORD)pLocal[v];
+		}
+
+		for(DWORD k = 0; k < dwUsed; k++)
+			pLocal[pUsed[k]] = NO_VERTEX;
+
+		pBatch->pVertices = pCopy;
+		pBatch->dwVertexCount = dwUsed;
+	}
+
+	pBatch->pIndices = pOut;
+	pBatch->dwIndexCount = pPlan->dwIndexCount;
+
+	return pBatch->pVertices == pCopy ? pBatch->dwVertexCount : 0;
+}
+
+static HRESULT Split_Indices(mesh *pMesh, DWORD *pLocal, DWORD *pUsed, batch_plan *pPlans)
+{
+	const DWORD *pIndices = (const DWORD *)pMesh->pIndices;
+	DWORD dwIndexCount = pMesh->pHeader->dwIndexCount;
+
+	for(DWORD i = 0; i < pMesh->pHeader->dwVertexCount; i++)
+		pLocal[i] = NO_VERTEX;
+
+	//first the extent of the batches and how many vertices need a copy
+	DWORD dwBatchCount = 0;
+	DWORD dwCopies = 0;
+	DWORD dwFirst = 0;
+	while(dwFirst < dwIndexCount)
+	{
+		batch_plan *pPlan = &pPlans[dwBatchCount++];
+		Plan_Batch(pIndices, dwIndexCount, dwFirst, pLocal, pUsed, pPlan);
+
+		if(pPlan->dwMax - pPlan->dwMin >= MESH_MAX_WORD_VERTICES)
+			dwCopies += pPlan->dwUsed;
+
+		dwFirst += pPlan->dwIndexCount;
+	}
+
+	pMesh->pBatchIndices = new(std::nothrow) WORD[dwIndexCount ? dwIndexCount : 1];
+	pMesh->pBatches = new(std::nothrow) mesh_batch[dwBatchCount ? dwBatchCount : 1];
+	if(!pMesh->pBatchIndices || !pMesh->pBatches)
+		return E_OUTOFMEMORY;
+
+	if(dwCopies)
+	{
+		pMesh->pBatchVertices = new(std::nothrow) mesh_vertex[dwCopies];
+		if(!pMesh->pBatchVertices)
+			return E_OUTOFMEMORY;
+	}
+
+	mesh_vertex *pCopy = pMesh->pBatchVertices;
+	for(DWORD b = 0; b < dwBatchCount; b++)
+		pCopy += Fill_Batch(pMesh, &pPlans[b], &pMesh->pBatches[b], pCopy, pLocal, pUsed);
+
+	pMesh->dwBatchCount = dwBatchCount;
+	pMesh->dwBatchCopies = dwCopies;
+	return S_OK;
+}
+
+static HRESULT Make_Batches(mesh *pMesh)
+{
+	const DWORD *pIndices = (const DWORD *)pMesh->pIndices;
+	DWORD dwIndexCount = pMesh->pHeader->dwIndexCount;
+	DWORD dwVertexCount = pMesh->pHeader->dwVertexCount;
+
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		if(pIndices[i] >= dwVertexCount)
+			return E_FAIL;
+	}
+
+	//a batch before the last one ended when the next triangle did not fit,
+	//so it has at least MESH_MAX_WORD_VERTICES - 2 vertices, 3 per triangle
+	DWORD dwMinTriangles = (MESH_MAX_WORD_VERTICES - 2 + 2) / 3;
+	DWORD dwMaxBatches = dwIndexCount / 3 / dwMinTriangles + 1;
+
+	DWORD *pLocal = new(std::nothrow) DWORD[dwVertexCount ? dwVertexCount : 1];
+	DWORD *pUsed = new(std::nothrow) DWORD[MESH_MAX_WORD_VERTICES + 3];
+	batch_plan *pPlans = new(std::nothrow) batch_plan[dwMaxBatches];
+
+	HRESULT hr = E_OUTOFMEMORY;
+	if(pLocal && pUsed && pPlans)
+		hr = Split_Indices(pMesh, pLocal, pUsed, pPlans);
+
+	delete[] pLocal;
+	delete[] pUsed;
+	delete[] pPlans;
+	return hr;
+}
+
+//one pass over WORD indices, DWORD indices are checked by Make_Batches()
+static bool Word_Indices_Valid(const WORD *pIndices, DWORD dwIndexCount, DWORD dwVertexCount)
+{
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		if(pIndices[i] >= dwVertexCount)
+			return false;
+	}
+
+	return true;
+}
+
+HRESULT Mesh_Open(mesh *pMesh, const char *szFilename)
+{
+	ZeroMemory(pMesh, sizeof(mesh));
+
+	if(!File_Map(&pMesh->File, szFilename))
+		return E_FAIL;
+
+	const mesh_header *pHeader = (const mesh_header *)pMesh->File.pData;
+	size_t Size = pMesh->File.Size;
+
+	bool bOk = Size >= sizeof(mesh_header) &&
+		pHeader->dwMagic == MESH_MAGIC &&
+		pHeader->dwVersion == MESH_VERSION &&
+		pHeader->dwFVF == SRFVF_VERTEX &&
+		pHeader->dwVertexStride == sizeof(mesh_vertex) &&
+		(pHeader->dwIndexSize == sizeof(WORD) || pHeader->dwIndexSize == sizeof(DWORD)) &&
+		(pHeader->dwIndexSize == sizeof(DWORD) || pHeader->dwVertexCount <= MESH_MAX_WORD_VERTICES) &&
+		pHeader->dwIndexCount % 3 == 0 &&
+		pHeader->dwFileSize == Size &&
+		Part_In_File(pHeader->dwVertexOffset, (LONGLONG)pHeader->dwVertexCount * sizeof(mesh_vertex), Size) &&
+		Part_In_File(pHeader->dwIndexOffset, (LONGLONG)pHeader->dwIndexCount * pHeader->dwIndexSize, Size);
+
+	if(!bOk)
+	{
+		Mesh_Close(pMesh);
+		return E_FAIL;
+	}
+
+	const BYTE *pData = (const BYTE *)pMesh->File.pData;
+	pMesh->pHeader = pHeader;
+	pMesh->pVertices = (const mesh_vertex *)(pData + pHeader->dwVertexOffset);
+	pMesh->pIndices = pData + pHeader->dwIndexOffset;
+
+	//a broken or foreign file must not make the draws read past the
+	//vertices, the indices are read once here
+	if(pHeader->dwIndexSize == sizeof(WORD) &&
+		!Word_Indices_Valid((const WORD *)pMesh->pIndices, pHeader->dwIndexCount, pHeader->dwVertexCount))
+	{
+		Mesh_Close(pMesh);
+		return E_FAIL;
+	}
+
+	if(pHeader->dwIndexSize == sizeof(DWORD))
+	{
+		HRESULT hr = Make_Batches(pMesh);
+		if(FAILED(hr))
+		{
+			Mesh_Close(pMesh);
+			return hr;
+		}
+	}
+
+	return S_OK;
+}
+
+static void Free_Batches(mesh *pMesh)
+{
+	delete[] pMesh->pBatches;
+	delete[] pMesh->pBatchIndices;
+	delete[] pMesh->pBatchVertices;
+	pMesh->pBatches = NULL;
+	pMesh->pBatchIndices = NULL;
+	pMesh->pBatchVertices = NULL;
+	pMesh->dwBatchCount = 0;
+	pMesh->dwBatchCopies = 0;
+}
+
+void Mesh_Close(mesh *pMesh)
+{
+	Free_Batches(pMesh);
+	delete[] pMesh->pOwnVertices;
+	delete[] (DWORD *)pMesh->pOwnIndices;
+
+	File_Unmap(&pMesh->File);
+	ZeroMemory(pMesh, sizeof(mesh));
+}
+
+HRESULT Mesh_Reorder(mesh *pMesh)
+{
+	const mesh_header *pHeader = pMesh->pHeader;
+	DWORD dwVertexCount = pHeader->dwVertexCount;
+	DWORD dwIndexCount = pHeader->dwIndexCount;
+
+	mesh_vertex *pVertices = new(std::nothrow) mesh_vertex[dwVertexCount ? dwVertexCount : 1];
+	DWORD *pIndices = new(std::nothrow) DWORD[dwIndexCount ? dwIndexCount : 1];
+	if(!pVertices || !pIndices)
+	{
+		delete[] pVertices;
+		delete[] pIndices;
+		return E_OUTOFMEMORY;
+	}
+
+	for(DWORD i = 0; i < dwVertexCount; i++)
+		pVertices[i] = pMesh->pVertices[i];
+
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		pIndices[i] = pHeader->dwIndexSize == sizeof(WORD) ?
+			((const WORD *)pMesh->pIndices)[i] : ((const DWORD *)pMesh->pIndices)[i];
+	}
+
+	HRESULT hr = Mesh_Optimize(pVertices, dwVertexCount, pIndices, dwIndexCount);
+	if(FAILED(hr))
+	{
+		delete[] pVertices;
+		delete[] pIndices;
+		return hr;
+	}
+
+	//back to WORDs in the front of the same memory
+	if(pHeader->dwIndexSize == sizeof(WORD))
+	{
+		WORD *pWords = (WORD *)pIndices;
+		for(DWORD i = 0; i < dwIndexCount; i++)
+			pWords[i] = (WORD)pIndices[i];
+	}
+
+	Free_Batches(pMesh);
+	delete[] pMesh->pOwnVertices;
+	delete[] (DWORD *)pMesh->pOwnIndices;
+
+	pMesh->pOwnVertices = pVertices;
+	pMesh->pOwnIndices = pIndices;
+	pMesh->pVertices = pVertices;
+	pMesh->pIndices = pIndices;
+
+	if(pHeader->dwIndexSize == sizeof(DWORD))
+		return Make_Batches(pMesh);
+
+	return S_OK;
+}
+
+HRESULT Mesh_Draw(IRenderDevice *pDevice, const mesh *pMesh)
+{
+	const mesh_header *pHeader = pMesh->pHeader;
+
+	if(pHeader->dwIndexSize == sizeof(WORD))
+	{
+		return pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, SRFVF_VERTEX,
+			pMesh->pVertices, pHeader->dwVertexCount,
+			(const WORD *)pMesh->pIndices, pHeader->dwIndexCount, 0);
+	}
+
+	//Mesh_Reorder() failed half way
+	if(!pMesh->pBatches)
+		return E_FAIL;
+
+	for(DWORD i = 0; i < pMesh->dwBatchCount; i++)
+	{
+		const mesh_batch *pBatch = &pMesh->pBatches[i];
+
+		HRESULT hr = pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, SRFVF_VERTEX,
+			pBatch->pVertices, pBatch->dwVertexCount,
+			pBatch->pIndices, pBatch->dwIndexCount, 0);
+		if(FAILED(hr))
+			return hr;
+	}
+
+	return S_OK;
+}
+
+static void Compute_Bounds(mesh_header *pHeader, const mesh_vertex *pVertices, DWORD dwVertexCount)
+{
+	vector3 Min = { 0.0f, 0.0f, 0.0f };
+	vector3 Max = { 0.0f, 0.0f, 0.0f };
+
+	if(dwVertexCount)
+	{
+		Min.x = Max.x = pVertices[0].x;
+		Min.y = Max.y = pVertices[0].y;
+		Min.z = Max.z = pVertices[0].z;
+	}
+
+	for(DWORD i = 1; i < dwVertexCount; i++)
+	{
+		const mesh_vertex *pVert = &pVertices[i];
+		if(pVert->x < Min.x) Min.x = pVert->x;
+		if(pVert->y < Min.y) Min.y = pVert->y;
+		if(pVert->z < Min.z) Min.z = pVert->z;
+		if(pVert->x > Max.x) Max.x = pVert->x;
+		if(pVert->y > Max.y) Max.y = pVert->y;
+		if(pVert->z > Max.z) Max.z = pVert->z;
+	}
+
+	//the sphere around the middle of the box, not the smallest one but
+	//never more than the half diagonal of the box
+	vector3 Center = { (Min.x + Max.x) * 0.5f, (Min.y + Max.y) * 0.5f, (Min.z + Max.z) * 0.5f };
+
+	float fRadius2 = 0.0f;
+	for(DWORD i = 0; i < dwVertexCount; i++)
+	{
+		float dx = pVertices[i].x - Center.x;
+		float dy = pVertices[i].y - Center.y;
+		float dz = pVertices[i].z - Center.z;
+		float fDist2 = dx * dx + dy * dy + dz * dz;
+		if(fDist2 > fRadius2)
+			fRadius2 = fDist2;
+	}
+
+	pHeader->BoxMin = Min;
+	pHeader->BoxMax = Max;
+	pHeader->Center = Center;
+	pHeader->fRadius = sqrtf(fRadius2);
+}
+
+static bool Write_Padding(FILE *pFile, LONGLONG Bytes)
+{
+	static const BYTE Zeros[MESH_ALIGN] = { 0 };
+	return !Bytes || fwrite(Zeros, (size_t)Bytes, 1, pFile) == 1;
+}
+
+HRESULT Mesh_Write(const char *szFilename, const mesh_vertex *pVertices, DWORD dwVertexCount,
+				const DWORD *pIndices, DWORD dwIndexCount, DWORD dwFlags)
+{
+	if(dwIndexCount % 3)
+		return E_INVALIDARG;
+
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		if(pIndices[i] >= dwVertexCount)
+			return E_INVALIDARG;
+	}
+
+	DWORD dwIndexSize = dwVertexCount <= MESH_MAX_WORD_VERTICES ? sizeof(WORD) : sizeof(DWORD);
+
+	LONGLONG VertexOffset = Align_Offset(sizeof(mesh_header));
+	LONGLONG VertexEnd = VertexOffset + (LONGLONG)dwVertexCount * sizeof(mesh_vertex);
+	LONGLONG IndexOffset = Align_Offset(VertexEnd);
+	LONGLONG FileSize = IndexOffset + (LONGLONG)dwIndexCount * dwIndexSize;
+
+	//the offsets in the header are DWORDs
+	if(FileSize > 0xffffffffLL)
+		return E_INVALIDARG;
+
+	mesh_header Header;
+	ZeroMemory(&Header, sizeof(mesh_header));
+	Header.dwMagic = MESH_MAGIC;
+	Header.dwVersion = MESH_VERSION;
+	Header.dwFVF = SRFVF_VERTEX;
+	Header.dwVertexStride = sizeof(mesh_vertex);
+	Header.dwVertexCount = dwVertexCount;
+	Header.dwVertexOffset = (DWORD)VertexOffset;
+	Header.dwIndexSize = dwIndexSize;
+	Header.dwIndexCount = dwIndexCount;
+	Header.dwIndexOffset = (DWORD)IndexOffset;
+	Header.dwFileSize = (DWORD)FileSize;
+	Header.dwFlags = dwFlags;
+	Compute_Bounds(&Header, pVertices, dwVertexCount);
+
+	FILE *pFile = fopen(szFilename, "wb");
+	if(!pFile)
+		return E_FAIL;
+
+	bool bOk = fwrite(&Header, sizeof(mesh_header), 1, pFile) == 1 &&
+		Write_Padding(pFile, VertexOffset - sizeof(mesh_header)) &&
+		(!dwVertexCount || fwrite(pVertices, sizeof(mesh_vertex), dwVertexCount, pFile) == dwVertexCount) &&
+		Write_Padding(pFile, IndexOffset - VertexEnd);
+
+	if(dwIndexSize == sizeof(DWORD))
+	{
+		bOk = bOk && (!dwIndexCount || fwrite(pIndices, sizeof(DWORD), dwIndexCount, pFile) == dwIndexCount);
+	}
+	else
+	{
+		//through a small buffer, the indices can be millions
+		WORD Words[4096];
+		for(DWORD i = 0; bOk && i < dwIndexCount; i += 4096)
+		{
+			DWORD dwCount = dwIndexCount - i < 4096 ? dwIndexCount - i : 4096;
+			for(DWORD j = 0; j < dwCount; j++)
+				Words[j] = (WORD)pIndices[i + j];
+
+			bOk = fwrite(Words, sizeof(WORD), dwCount, pFile) == dwCount;
+		}
+	}
+
+	if(fclose(pFile) != 0)
+		bOk = false;
+
+	if(!bOk)
+	{
+		remove(szFilename);
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
@@ -0,0 +1,121 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _MESH_H_
+#define _MESH_H_
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "RenderDevice.h"
+
+//binary mesh file, written once by MeshConv from an OBJ or PLY file and
+//mapped into memory at run time. The file is laid out the way the draw
+//calls take the data, so Mesh_Open() only checks the header and points
+//into the mapping:
+//
+//  mesh_header                 128 bytes
+//  vertices                    dwVertexCount * 32 bytes, SRFVF_VERTEX
+//  indices                     dwIndexCount WORDs or DWORDs, 3 per triangle
+//
+//the vertices and the indices start on a cache line (MESH_ALIGN) from
+//the start of the file, the mapping starts on a page, so they are
+//aligned in memory too. Indices are WORDs when there are at most 65535
+//vertices, DWORDs above that.
+//
+//DirectX 6 draws only WORD indices. For a mesh with DWORD indices
+//Mesh_Open() splits the triangles into batches of at most 65535
+//vertices, each with its own WORD indices counted from its first vertex.
+//A batch whose vertices are within 65535 of each other draws them from
+//the mapping, only the others get a copy of their vertices. CSoftDevice
+//draws the DWORD indices as they are (Mesh_Draw_Soft())
+
+#define MESH_MAGIC		0x4853454d		//"MESH"
+#define MESH_VERSION	1
+#define MESH_ALIGN		64
+
+#define MESH_MAX_WORD_VERTICES SRMAXNUMVERTICES
+
+//mesh_header dwFlags
+#define MESH_OPTIMIZED	0x00000001	//triangles and vertices in the order of MeshOptimize.h
+
+//same layout as D3DVERTEX
+struct mesh_vertex
+{
+	float x, y, z;
+	float nx, ny, nz;
+	float tu, tv;
+};
+
+struct mesh_header
+{
+	DWORD dwMagic;
+	DWORD dwVersion;
+	DWORD dwFVF;				//SRFVF_VERTEX
+	DWORD dwVertexStride;		//bytes
+	DWORD dwVertexCount;
+	DWORD dwVertexOffset;		//from the start of the file
+	DWORD dwIndexSize;			//2 or 4 bytes
+	DWORD dwIndexCount;
+	DWORD dwIndexOffset;
+	DWORD dwFileSize;
+	vector3 BoxMin;				//bounding box
+	vector3 BoxMax;
+	vector3 Center;				//bounding sphere
+	float fRadius;
+	DWORD dwFlags;				//MESH_OPTIMIZED
+	DWORD dwReserved[11];
+};
+
+//one DrawIndexedPrimitive() of a mesh with DWORD indices
+struct mesh_batch
+{
+	const mesh_vertex *pVertices;	//into the mapping or into pBatchVertices
+	DWORD dwVertexCount;
+	const WORD *pIndices;
+	DWORD dwIndexCount;
+};
+
+struct mesh
+{
+	mapped_file File;
+	const mesh_header *pHeader;
+	const mesh_vertex *pVertices;
+	const void *pIndices;		//WORD or DWORD, pHeader->dwIndexSize
+	mesh_batch *pBatches;		//NULL for WORD indices
+	DWORD dwBatchCount;
+	WORD *pBatchIndices;
+	mesh_vertex *pBatchVertices;	//NULL when every batch draws from the mapping
+	DWORD dwBatchCopies;			//vertices in pBatchVertices
+	mesh_vertex *pOwnVertices;		//copies of Mesh_Reorder(), NULL for the mapping
+	void *pOwnIndices;
+};
+
+class CSoftDevice;
+
+//maps the file and makes the batches of DWORD indices. E_FAIL when it
+//is not a mesh file of this version, its parts are not inside the file
+//or an index is past the vertices
+HRESULT Mesh_Open(mesh *pMesh, const char *szFilename);
+void Mesh_Close(mesh *pMesh);
+
+//for a file without MESH_OPTIMIZED: copies the vertices and the indices
+//out of the mapping and puts them in the order of Mesh_Optimize(), at
+//the cost of the time and the memory the mapping saves. The mesh is
+//unchanged when there is no memory for the copies, a failure after that
+//leaves it without batches and it has to be closed
+HRESULT Mesh_Reorder(mesh *pMesh);
+
+//all triangles in one DrawIndexedPrimitive() straight from the mapping,
+//or one per batch for DWORD indices
+HRESULT Mesh_Draw(IRenderDevice *pDevice, const mesh *pMesh);
+//always one draw, DrawIndexedPrimitive32() for DWORD indices; in
+//MeshSoft.cpp, MeshConv builds without CSoftDevice
+HRESULT Mesh_Draw_Soft(CSoftDevice *pDevice, const mesh *pMesh);
+
+//writes the mesh file, with WORD indices when the vertices allow it.
+//The bounds are computed from the vertices, dwFlags go to the header
+HRESULT Mesh_Write(const char *szFilename, const mesh_vertex *pVertices, DWORD dwVertexCount,
+				const DWORD *pIndices, DWORD dwIndexCount, DWORD dwFlags = 0);
+
+#endif
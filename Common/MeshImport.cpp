@@ -0,0 +1,902 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "MeshImport.h"
+
+//-------------------------------------------------------------------------
+// Growing arrays
+//-------------------------------------------------------------------------
+
+struct grow_array
+{
+	BYTE *pData;
+	DWORD dwCount;
+	DWORD dwCapacity;
+	size_t ElemSize;
+};
+
+static void Array_Init(grow_array *pArray, size_t ElemSize)
+{
+	pArray->pData = NULL;
+	pArray->dwCount = 0;
+	pArray->dwCapacity = 0;
+	pArray->ElemSize = ElemSize;
+}
+
+//the new element at the end, NULL when out of memory
+static void *Array_Push(grow_array *pArray)
+{
+	if(pArray->dwCount == pArray->dwCapacity)
+	{
+		DWORD dwCapacity = pArray->dwCapacity ? pArray->dwCapacity * 2 : 1024;
+		BYTE *pData = (BYTE *)realloc(pArray->pData, dwCapacity * pArray->ElemSize);
+		if(!pData)
+			return NULL;
+
+		pArray->pData = pData;
+		pArray->dwCapacity = dwCapacity;
+	}
+
+	return pArray->pData + pArray->ElemSize * pArray->dwCount++;
+}
+
+static void Array_Free(grow_array *pArray)
+{
+	free(pArray->pData);
+	Array_Init(pArray, pArray->ElemSize);
+}
+
+//-------------------------------------------------------------------------
+// Common
+//-------------------------------------------------------------------------
+
+void Mesh_Data_Free(mesh_data *pData)
+{
+	free(pData->pVertices);
+	free(pData->pIndices);
+	ZeroMemory(pData, sizeof(mesh_data));
+}
+
+//the arrays go to pData, it frees them
+static void Take_Arrays(mesh_data *pData, grow_array *pVertices, grow_array *pIndices)
+{
+	pData->pVertices = (mesh_vertex *)pVertices->pData;
+	pData->dwVertexCount = pVertices->dwCount;
+	pData->pIndices = (DWORD *)pIndices->pData;
+	pData->dwIndexCount = pIndices->dwCount;
+
+	Array_Init(pVertices, sizeof(mesh_vertex));
+	Array_Init(pIndices, sizeof(DWORD));
+}
+
+//pNoNormal[i] is set for the vertices that get the sum of the normals of
+//their faces, weighted by the area
+static void Make_Normals(mesh_data *pData, const BYTE *pNoNormal)
+{
+	mesh_vertex *pVerts = pData->pVertices;
+
+	for(DWORD i = 0; i < pData->dwVertexCount; i++)
+	{
+		if(pNoNormal[i])
+			pVerts[i].nx = pVerts[i].ny = pVerts[i].nz = 0.0f;
+	}
+
+	for(DWORD t = 0; t + 2 < pData->dwIndexCount; t += 3)
+	{
+		const DWORD *pTri = &pData->pIndices[t];
+		const mesh_vertex *p0 = &pVerts[pTri[0]];
+		const mesh_vertex *p1 = &pVerts[pTri[1]];
+		const mesh_vertex *p2 = &pVerts[pTri[2]];
+
+		vector3 e1 = { p1->x - p0->x, p1->y - p0->y, p1->z - p0->z };
+		vector3 e2 = { p2->x - p0->x, p2->y - p0->y, p2->z - p0->z };
+		//the faces are clockwise, e1 x e2 points out of the front
+		vector3 n = Vec3_Cross(e1, e2);
+
+		for(int k = 0; k < 3; k++)
+		{
+			if(!pNoNormal[pTri[k]])
+				continue;
+
+			mesh_vertex *pVert = &pVerts[pTri[k]];
+			pVert->nx += n.x;
+			pVert->ny += n.y;
+			pVert->nz += n.z;
+		}
+	}
+
+	for(DWORD i = 0; i < pData->dwVertexCount; i++)
+	{
+		if(!pNoNormal[i])
+			continue;
+
+		mesh_vertex *pVert = &pVerts[i];
+		float fLen = sqrtf(pVert->nx * pVert->nx + pVert->ny * pVert->ny + pVert->nz * pVert->nz);
+		if(fLen > 0.0f)
+		{
+			pVert->nx /= fLen;
+			pVert->ny /= fLen;
+			pVert->nz /= fLen;
+		}
+	}
+}
+
+//one polygon as a fan of triangles, the order of the corners is turned
+//around with z to keep the front faces in front
+static bool Push_Polygon(grow_array *pIndices, const DWORD *pCorners, DWORD dwCorners)
+{
+	for(DWORD i = 2; i < dwCorners; i++)
+	{
+		//one by one, a push can move the array
+		DWORD Tri[3] = { pCorners[0], pCorners[i], pCorners[i - 1] };
+		for(int k = 0; k < 3; k++)
+		{
+			DWORD *pIndex = (DWORD *)Array_Push(pIndices);
+			if(!pIndex)
+				return false;
+
+			*pIndex = Tri[k];
+		}
+	}
+
+	return true;
+}
+
+//-------------------------------------------------------------------------
+// OBJ
+//-------------------------------------------------------------------------
+
+#define OBJ_MAX_LINE	4096
+#define OBJ_MAX_CORNERS	64
+
+//position, texture coordinate and normal of a corner, -1 when missing
+struct obj_key
+{
+	int v, vt, vn;
+};
+
+//open addressing, the corners seen so far and their vertex
+struct obj_table
+{
+	obj_key *pKeys;
+	DWORD *pIndices;		//OBJ_EMPTY for a free place
+	DWORD dwSize;			//power of two
+	DWORD dwCount;
+};
+
+#define OBJ_EMPTY 0xffffffff
+
+static bool Table_Init(obj_table *pTable, DWORD dwSize)
+{
+	pTable->pKeys = (obj_key *)malloc(dwSize * sizeof(obj_key));
+	pTable->pIndices = (DWORD *)malloc(dwSize * sizeof(DWORD));
+	pTable->dwSize = dwSize;
+	pTable->dwCount = 0;
+
+	if(!pTable->pKeys || !pTable->pIndices)
+		return false;
+
+	memset(pTable->pIndices, 0xff, dwSize * sizeof(DWORD));
+	return true;
+}
+
+static void Table_Free(obj_table *pTable)
+{
+	free(pTable->pKeys);
+	free(pTable->pIndices);
+	pTable->pKeys = NULL;
+	pTable->pIndices = NULL;
+}
+
+static DWORD Hash_Key(const obj_key *pKey)
+{
+	DWORD h = (DWORD)pKey->v * 73856093u;
+	h ^= (DWORD)pKey->vt * 19349663u;
+	h ^= (DWORD)pKey->vn * 83492791u;
+	return h ^ (h >> 16);
+}
+
+//the place of the key, or the free place where it goes
+static DWORD Table_Find(const obj_table *pTable, const obj_key *pKey)
+{
+	DWORD dwMask = pTable->dwSize - 1;
+	DWORD i = Hash_Key(pKey) & dwMask;
+
+	while(pTable->pIndices[i] != OBJ_EMPTY)
+	{
+		const obj_key *pOther = &pTable->pKeys[i];
+		if(pOther->v == pKey->v && pOther->vt == pKey->vt && pOther->vn == pKey->vn)
+			break;
+		i = (i + 1) & dwMask;
+	}
+
+	return i;
+}
+
+//twice the size when half full
+static bool Table_Grow(obj_table *pTable)
+{
+	obj_table New;
+	if(!Table_Init(&New, pTable->dwSize * 2))
+	{
+		Table_Free(&New);
+		return false;
+	}
+
+	for(DWORD i = 0; i < pTable->dwSize; i++)
+	{
+		if(pTable->pIndices[i] == OBJ_EMPTY)
+			continue;
+
+		DWORD j = Table_Find(&New, &pTable->pKeys[i]);
+		New.pKeys[j] = pTable->pKeys[i];
+		New.pIndices[j] = pTable->pIndices[i];
+	}
+
+	New.dwCount = pTable->dwCount;
+	Table_Free(pTable);
+	*pTable = New;
+
+	return true;
+}
+
+//"3", "-1", an empty field gives 0. OBJ counts from 1, negative
+//numbers count back from the last one read
+static int Obj_Index(const char **ppText, DWORD dwCount)
+{
+	char *pEnd;
+	long Index = strtol(*ppText, &pEnd, 10);
+	*ppText = pEnd;
+
+	if(Index < 0)
+		Index += (long)dwCount + 1;
+
+	if(Index <= 0 || Index > (long)dwCount)
+		return -1;
+
+	return (int)Index - 1;
+}
+
+struct obj_reader
+{
+	grow_array Positions;	//vector3
+	grow_array TexCoords;	//float[2]
+	grow_array Normals;		//vector3
+	grow_array Vertices;	//mesh_vertex
+	grow_array Indices;		//DWORD
+	grow_array NoNormal;	//BYTE per vertex
+	obj_table Table;
+};
+
+//"f 1/1/1 2/2/2 3/3/3", "f 1//1 ...", "f 1/1 ...", "f 1 2 3 4"
+static HRESULT Obj_Face(obj_reader *pObj, const char *pText)
+{
+	DWORD Corners[OBJ_MAX_CORNERS];
+	DWORD dwCorners = 0;
+
+	for(;;)
+	{
+		while(*pText == ' ' || *pText == '\t')
+			pText++;
+		if(*pText == 0 || *pText == '\r' || *pText == '\n')
+			break;
+
+		if(dwCorners == OBJ_MAX_CORNERS)
+			return E_FAIL;
+
+		obj_key Key;
+		Key.v = Obj_Index(&pText, pObj->Positions.dwCount);
+		Key.vt = -1;
+		Key.vn = -1;
+
+		if(Key.v < 0)
+			return E_FAIL;
+
+		if(*pText == '/')
+		{
+			pText++;
+			if(*pText != '/')
+			{
+				Key.vt = Obj_Index(&pText, pObj->TexCoords.dwCount);
+				if(Key.vt < 0)
+					return E_FAIL;
+			}
+
+			if(*pText == '/')
+			{
+				pText++;
+				Key.vn = Obj_Index(&pText, pObj->Normals.dwCount);
+				if(Key.vn < 0)
+					return E_FAIL;
+			}
+		}
+
+		DWORD dwPlace = Table_Find(&pObj->Table, &Key);
+		if(pObj->Table.pIndices[dwPlace] == OBJ_EMPTY)
+		{
+			mesh_vertex *pVert = (mesh_vertex *)Array_Push(&pObj->Vertices);
+			BYTE *pNoNormal = (BYTE *)Array_Push(&pObj->NoNormal);
+			if(!pVert || !pNoNormal)
+				return E_OUTOFMEMORY;
+
+			const vector3 *pPos = (const vector3 *)pObj->Positions.pData + Key.v;
+			pVert->x = pPos->x;
+			pVert->y = pPos->y;
+			pVert->z = -pPos->z;
+
+			pVert->tu = 0.0f;
+			pVert->tv = 0.0f;
+			if(Key.vt >= 0)
+			{
+				const float *pTex = (const float *)pObj->TexCoords.pData + Key.vt * 2;
+				pVert->tu = pTex[0];
+				pVert->tv = 1.0f - pTex[1];
+			}
+
+			*pNoNormal = Key.vn < 0;
+			pVert->nx = pVert->ny = pVert->nz = 0.0f;
+			if(Key.vn >= 0)
+			{
+				const vector3 *pNormal = (const vector3 *)pObj->Normals.pData + Key.vn;
+				pVert->nx = pNormal->x;
+				pVert->ny = pNormal->y;
+				pVert->nz = -pNormal->z;
+			}
+
+			pObj->Table.pKeys[dwPlace] = Key;
+			pObj->Table.pIndices[dwPlace] = pObj->Vertices.dwCount - 1;
+
+			if(++pObj->Table.dwCount * 2 > pObj->Table.dwSize && !Table_Grow(&pObj->Table))
+				return E_OUTOFMEMORY;
+
+			Corners[dwCorners++] = pObj->Vertices.dwCount - 1;
+		}
+		else
+		{
+			Corners[dwCorners++] = pObj->Table.pIndices[dwPlace];
+		}
+
+		//the rest of the corner, "1/2/3x" is not one
+		if(*pText != 0 && *pText != ' ' && *pText != '\t' && *pText != '\r' && *pText != '\n')
+			return E_FAIL;
+	}
+
+	if(dwCorners < 3)
+		return E_FAIL;
+
+	return Push_Polygon(&pObj->Indices, Corners, dwCorners) ? S_OK : E_OUTOFMEMORY;
+}
+
+static bool Read_Floats(const char *pText, float *pValues, int Count)
+{
+	for(int i = 0; i < Count; i++)
+	{
+		char *pEnd;
+		pValues[i] = (float)strtod(pText, &pEnd);
+		if(pEnd == pText)
+			return false;
+		pText = pEnd;
+	}
+
+	return true;
+}
+
+HRESULT Mesh_Import_OBJ(const char *szFilename, mesh_data *pData)
+{
+	ZeroMemory(pData, sizeof(mesh_data));
+
+	FILE *pFile = fopen(szFilename, "rt");
+	if(!pFile)
+		return E_FAIL;
+
+	obj_reader Obj;
+	Array_Init(&Obj.Positions, sizeof(vector3));
+	Array_Init(&Obj.TexCoords, sizeof(float) * 2);
+	Array_Init(&Obj.Normals, sizeof(vector3));
+	Array_Init(&Obj.Vertices, sizeof(mesh_vertex));
+	Array_Init(&Obj.Indices, sizeof(DWORD));
+	Array_Init(&Obj.NoNormal, sizeof(BYTE));
+
+	HRESULT hr = Table_Init(&Obj.Table, 4096) ? S_OK : E_OUTOFMEMORY;
+
+	char szLine[OBJ_MAX_LINE];
+	while(SUCCEEDED(hr) && fgets(szLine, sizeof(szLine), pFile))
+	{
+		if(!strchr(szLine, '\n') && !feof(pFile))
+		{
+			hr = E_FAIL;		//line too long
+			break;
+		}
+
+		if(szLine[0] == 'v' && szLine[1] == ' ')
+		{
+			vector3 *pPos = (vector3 *)Array_Push(&Obj.Positions);
+			if(!pPos)
+				hr = E_OUTOFMEMORY;
+			else if(!Read_Floats(szLine + 2, &pPos->x, 3))
+				hr = E_FAIL;
+		}
+		else if(szLine[0] == 'v' && szLine[1] == 't' && szLine[2] == ' ')
+		{
+			float *pTex = (float *)Array_Push(&Obj.TexCoords);
+			if(!pTex)
+				hr = E_OUTOFMEMORY;
+			else if(!Read_Floats(szLine + 3, pTex, 2))
+				hr = E_FAIL;
+		}
+		else if(szLine[0] == 'v' && szLine[1] == 'n' && szLine[2] == ' ')
+		{
+			vector3 *pNormal = (vector3 *)Array_Push(&Obj.Normals);
+			if(!pNormal)
+				hr = E_OUTOFMEMORY;
+			else if(!Read_Floats(szLine + 3, &pNormal->x, 3))
+				hr = E_FAIL;
+		}
+		else if(szLine[0] == 'f' && szLine[1] == ' ')
+		{
+			hr = Obj_Face(&Obj, szLine + 2);
+		}
+		//groups, materials, smoothing groups, lines and points are skipped
+	}
+
+	if(ferror(pFile))
+		hr = E_FAIL;
+
+	fclose(pFile);
+
+	if(SUCCEEDED(hr))
+	{
+		const BYTE *pNoNormal = Obj.NoNormal.pData;
+		Take_Arrays(pData, &Obj.Vertices, &Obj.Indices);
+		Make_Normals(pData, pNoNormal);
+	}
+
+	Array_Free(&Obj.Positions);
+	Array_Free(&Obj.TexCoords);
+	Array_Free(&Obj.Normals);
+	Array_Free(&Obj.Vertices);
+	Array_Free(&Obj.Indices);
+	Array_Free(&Obj.NoNormal);
+	Table_Free(&Obj.Table);
+
+	return hr;
+}
+
+//-------------------------------------------------------------------------
+// PLY
+//-------------------------------------------------------------------------
+
+#define PLY_MAX_ELEMENTS	8
+#define PLY_MAX_PROPERTIES	32
+
+enum
+{
+	PLY_ASCII,
+	PLY_LITTLE_ENDIAN,
+	PLY_BIG_ENDIAN
+};
+
+enum
+{
+	PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+	PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64,
+	PLY_TYPES
+};
+
+//both the names of the first PLY files and the sized ones
+static const char *g_PlyTypes[PLY_TYPES][2] = {
+	{ "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+	{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" } };
+
+static const DWORD g_PlyTypeSize[PLY_TYPES] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+//what a vertex property is used for
+enum
+{
+	PLY_SKIP,
+	PLY_X, PLY_Y, PLY_Z,
+	PLY_NX, PLY_NY, PLY_NZ,
+	PLY_U, PLY_V,
+	PLY_FACE
+};
+
+struct ply_property
+{
+	DWORD dwType;
+	DWORD dwCountType;		//the type of the count of a list
+	bool bList;
+	int Use;
+};
+
+struct ply_element
+{
+	char szName[32];
+	DWORD dwCount;
+	ply_property Props[PLY_MAX_PROPERTIES];
+	DWORD dwProps;
+};
+
+struct ply_reader
+{
+	FILE *pFile;
+	DWORD dwFormat;
+	ply_element Elements[PLY_MAX_ELEMENTS];
+	DWORD dwElements;
+};
+
+static bool Ply_Type(const char *szName, DWORD *pdwType)
+{
+	for(DWORD i = 0; i < PLY_TYPES; i++)
+	{
+		if(!strcmp(szName, g_PlyTypes[i][0]) || !strcmp(szName, g_PlyTypes[i][1]))
+		{
+			*pdwType = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int Ply_Use(const char *szElement, const char *szName)
+{
+	if(!strcmp(szElement, "face"))
+		return (!strcmp(szName, "vertex_indices") || !strcmp(szName, "vertex_index")) ? PLY_FACE : PLY_SKIP;
+
+	if(strcmp(szElement, "vertex"))
+		return PLY_SKIP;
+
+	if(!strcmp(szName, "x")) return PLY_X;
+	if(!strcmp(szName, "y")) return PLY_Y;
+	if(!strcmp(szName, "z")) return PLY_Z;
+	if(!strcmp(szName, "nx")) return PLY_NX;
+	if(!strcmp(szName, "ny")) return PLY_NY;
+	if(!strcmp(szName, "nz")) return PLY_NZ;
+	if(!strcmp(szName, "u") || !strcmp(szName, "s") ||
+		!strcmp(szName, "texture_u") || !strcmp(szName, "texture_s")) return PLY_U;
+	if(!strcmp(szName, "v") || !strcmp(szName, "t") ||
+		!strcmp(szName, "texture_v") || !strcmp(szName, "texture_t")) return PLY_V;
+
+	return PLY_SKIP;
+}
+
+static HRESULT Ply_Header(ply_reader *pPly)
+{
+	char szLine[256];
+
+	if(!fgets(szLine, sizeof(szLine), pPly->pFile) || strncmp(szLine, "ply", 3))
+		return E_FAIL;
+
+	bool bFormat = false;
+	ply_element *pElement = NULL;
+
+	while(fgets(szLine, sizeof(szLine), pPly->pFile))
+	{
+		char szWord[3][64];
+		int Words = sscanf(szLine, "%63s %63s %63s", szWord[0], szWord[1], szWord[2]);
+		if(Words <= 0)
+			continue;
+
+		if(!strcmp(szWord[0], "end_header"))
+			return bFormat ? S_OK : E_FAIL;
+
+		if(!strcmp(szWord[0], "format") && Words >= 2)
+		{
+			if(!strcmp(szWord[1], "ascii"))
+				pPly->dwFormat = PLY_ASCII;
+			else if(!strcmp(szWord[1], "binary_little_endian"))
+				pPly->dwFormat = PLY_LITTLE_ENDIAN;
+			else if(!strcmp(szWord[1], "binary_big_endian"))
+				pPly->dwFormat = PLY_BIG_ENDIAN;
+			else
+				return E_FAIL;
+
+			bFormat = true;
+		}
+		else if(!strcmp(szWord[0], "element") && Words == 3)
+		{
+			if(pPly->dwElements == PLY_MAX_ELEMENTS)
+				return E_FAIL;
+
+			pElement = &pPly->Elements[pPly->dwElements++];
+			sscanf(szLine, "%*s %31s", pElement->szName);
+			pElement->dwCount = (DWORD)strtoul(szWord[2], NULL, 10);
+			pElement->dwProps = 0;
+		}
+		else if(!strcmp(szWord[0], "property"))
+		{
+			if(!pElement || pElement->dwProps == PLY_MAX_PROPERTIES)
+				return E_FAIL;
+
+			ply_property *pProp = &pElement->Props[pElement->dwProps++];
+			ZeroMemory(pProp, sizeof(ply_property));
+
+			if(!strcmp(szWord[1], "list"))
+			{
+				//property list uchar int vertex_indices
+				char szItem[64], szName[64];
+				if(sscanf(szLine, "%*s %*s %63s %63s %63s", szWord[2], szItem, szName) != 3 ||
+					!Ply_Type(szWord[2], &pProp->dwCountType) || !Ply_Type(szItem, &pProp->dwType))
+					return E_FAIL;
+
+				pProp->bList = true;
+				pProp->Use = Ply_Use(pElement->szName, szName);
+			}
+			else
+			{
+				if(Words != 3 || !Ply_Type(szWord[1], &pProp->dwType))
+					return E_FAIL;
+
+				pProp->Use = Ply_Use(pElement->szName, szWord[2]);
+			}
+		}
+		//comment, obj_info
+	}
+
+	return E_FAIL;
+}
+
+static bool Ply_Read(ply_reader *pPly, DWORD dwType, double *pValue)
+{
+	if(pPly->dwFormat == PLY_ASCII)
+		return fscanf(pPly->pFile, "%lf", pValue) == 1;
+
+	BYTE Bytes[8];
+	DWORD dwSize = g_PlyTypeSize[dwType];
+	if(fread(Bytes, dwSize, 1, pPly->pFile) != 1)
+		return false;
+
+	//the tools run on little endian machines
+	if(pPly->dwFormat == PLY_BIG_ENDIAN)
+	{
+		for(DWORD i = 0; i < dwSize / 2; i++)
+		{
+			BYTE b = Bytes[i];
+			Bytes[i] = Bytes[dwSize - 1 - i];
+			Bytes[dwSize - 1 - i] = b;
+		}
+	}
+
+	switch(dwType)
+	{
+		case PLY_INT8: *pValue = (signed char)Bytes[0]; break;
+		case PLY_UINT8: *pValue = Bytes[0]; break;
+		case PLY_INT16: { short s; memcpy(&s, Bytes, 2); *pValue = s; break; }
+		case PLY_UINT16: { WORD w; memcpy(&w, Bytes, 2); *pValue = w; break; }
+		case PLY_INT32: { int i; memcpy(&i, Bytes, 4); *pValue = i; break; }
+		case PLY_UINT32: { DWORD dw; memcpy(&dw, Bytes, 4); *pValue = dw; break; }
+		case PLY_FLOAT32: { float f; memcpy(&f, Bytes, 4); *pValue = f; break; }
+		default: { double d; memcpy(&d, Bytes, 8); *pValue = d; break; }
+	}
+
+	return true;
+}
+
+static HRESULT Ply_Vertices(ply_reader *pPly, const ply_element *pElement, mesh_vertex *pVerts, BYTE *pNoNormal)
+{
+	bool bNormals = false;
+	for(DWORD p = 0; p < pElement->dwProps; p++)
+	{
+		if(pElement->Props[p].Use == PLY_NX)
+			bNormals = true;
+	}
+
+	for(DWORD i = 0; i < pElement->dwCount; i++)
+	{
+		float Values[PLY_FACE];
+		ZeroMemory(Values, sizeof(Values));
+
+		for(DWORD p = 0; p < pElement->dwProps; p++)
+		{
+			const ply_property *pProp = &pElement->Props[p];
+			double Value;
+
+			if(pProp->bList)
+			{
+				if(!Ply_Read(pPly, pProp->dwCountType, &Value))
+					return E_FAIL;
+
+				for(DWORD n = (DWORD)Value; n; n--)
+				{
+					if(!Ply_Read(pPly, pProp->dwType, &Value))
+						return E_FAIL;
+				}
+				continue;
+			}
+
+			if(!Ply_Read(pPly, pProp->dwType, &Value))
+				return E_FAIL;
+
+			Values[pProp->Use] = (float)Value;
+		}
+
+		mesh_vertex *pVert = &pVerts[i];
+		pVert->x = Values[PLY_X];
+		pVert->y = Values[PLY_Y];
+		pVert->z = -Values[PLY_Z];
+		pVert->nx = Values[PLY_NX];
+		pVert->ny = Values[PLY_NY];
+		pVert->nz = -Values[PLY_NZ];
+		pVert->tu = Values[PLY_U];
+		pVert->tv = 1.0f - Values[PLY_V];
+		pNoNormal[i] = !bNormals;
+	}
+
+	return S_OK;
+}
+
+static HRESULT Ply_Faces(ply_reader *pPly, const ply_element *pElement, DWORD dwVertexCount, grow_array *pIndices)
+{
+	for(DWORD i = 0; i < pElement->dwCount; i++)
+	{
+		for(DWORD p = 0; p < pElement->dwProps; p++)
+		{
+			const ply_property *pProp = &pElement->Props[p];
+			double Value;
+
+			if(!pProp->bList)
+			{
+				if(!Ply_Read(pPly, pProp->dwType, &Value))
+					return E_FAIL;
+				continue;
+			}
+
+			if(!Ply_Read(pPly, pProp->dwCountType, &Value))
+				return E_FAIL;
+
+			DWORD dwCorners = (DWORD)Value;
+			if(pProp->Use == PLY_FACE && (dwCorners < 3 || dwCorners > OBJ_MAX_CORNERS))
+				return E_FAIL;
+
+			DWORD Corners[OBJ_MAX_CORNERS];
+			for(DWORD n = 0; n < dwCorners; n++)
+			{
+				if(!Ply_Read(pPly, pProp->dwType, &Value))
+					return E_FAIL;
+
+				if(pProp->Use != PLY_FACE)
+					continue;
+
+				if(Value < 0.0 || Value >= (double)dwVertexCount)
+					return E_FAIL;
+				Corners[n] = (DWORD)Value;
+			}
+
+			if(pProp->Use == PLY_FACE && !Push_Polygon(pIndices, Corners, dwCorners))
+				return E_OUTOFMEMORY;
+		}
+	}
+
+	return S_OK;
+}
+
+//the values of an element nobody uses
+static HRESULT Ply_Skip(ply_reader *pPly, const ply_element *pElement)
+{
+	for(DWORD i = 0; i < pElement->dwCount; i++)
+	{
+		for(DWORD p = 0; p < pElement->dwProps; p++)
+		{
+			const ply_property *pProp = &pElement->Props[p];
+			double Value;
+			DWORD dwValues = 1;
+
+			if(pProp->bList)
+			{
+				if(!Ply_Read(pPly, pProp->dwCountType, &Value))
+					return E_FAIL;
+				dwValues = (DWORD)Value;
+			}
+
+			for(DWORD n = 0; n < dwValues; n++)
+			{
+				if(!Ply_Read(pPly, pProp->dwType, &Value))
+					return E_FAIL;
+			}
+		}
+	}
+
+	return S_OK;
+}
+
+HRESULT Mesh_Import_PLY(const char *szFilename, mesh_data *pData)
+{
+	ZeroMemory(pData, sizeof(mesh_data));
+
+	ply_reader Ply;
+	ZeroMemory(&Ply, sizeof(ply_reader));
+
+	//binary, the header lines end with \n on every system
+	Ply.pFile = fopen(szFilename, "rb");
+	if(!Ply.pFile)
+		return E_FAIL;
+
+	grow_array Indices;
+	Array_Init(&Indices, sizeof(DWORD));
+	mesh_vertex *pVerts = NULL;
+	BYTE *pNoNormal = NULL;
+	DWORD dwVertexCount = 0;
+	bool bVertices = false;
+
+	HRESULT hr = Ply_Header(&Ply);
+
+	for(DWORD e = 0; SUCCEEDED(hr) && e < Ply.dwElements; e++)
+	{
+		const ply_element *pElement = &Ply.Elements[e];
+
+		if(!strcmp(pElement->szName, "vertex") && !bVertices)
+		{
+			dwVertexCount = pElement->dwCount;
+			pVerts = (mesh_vertex *)malloc((dwVertexCount ? dwVertexCount : 1) * sizeof(mesh_vertex));
+			pNoNormal = (BYTE *)malloc(dwVertexCount ? dwVertexCount : 1);
+			if(!pVerts || !pNoNormal)
+				hr = E_OUTOFMEMORY;
+			else
+				hr = Ply_Vertices(&Ply, pElement, pVerts, pNoNormal);
+			bVertices = true;
+		}
+		else if(!strcmp(pElement->szName, "face") && bVertices)
+		{
+			hr = Ply_Faces(&Ply, pElement, dwVertexCount, &Indices);
+		}
+		else
+		{
+			//faces before the vertices are not supported
+			if(!strcmp(pElement->szName, "face"))
+				hr = E_FAIL;
+			else
+				hr = Ply_Skip(&Ply, pElement);
+		}
+	}
+
+	fclose(Ply.pFile);
+
+	if(SUCCEEDED(hr) && !bVertices)
+		hr = E_FAIL;
+
+	if(SUCCEEDED(hr))
+	{
+		pData->pVertices = pVerts;
+		pData->dwVertexCount = dwVertexCount;
+		pData->pIndices = (DWORD *)Indices.pData;
+		pData->dwIndexCount = Indices.dwCount;
+		Array_Init(&Indices, sizeof(DWORD));
+		pVerts = NULL;
+
+		Make_Normals(pData, pNoNormal);
+	}
+
+	free(pVerts);
+	free(pNoNormal);
+	Array_Free(&Indices);
+
+	return hr;
+}
+
+HRESULT Mesh_Import(const char *szFilename, mesh_data *pData)
+{
+	ZeroMemory(pData, sizeof(mesh_data));
+
+	const char *szExt = strrchr(szFilename, '.');
+	if(!szExt)
+		return E_FAIL;
+
+	char szLower[8];
+	size_t i;
+	for(i = 0; i + 1 < sizeof(szLower) && szExt[i]; i++)
+		szLower[i] = (szExt[i] >= 'A' && szExt[i] <= 'Z') ? (char)(szExt[i] - 'A' + 'a') : szExt[i];
+	szLower[i] = 0;
+
+	if(!strcmp(szLower, ".obj"))
+		return Mesh_Import_OBJ(szFilename, pData);
+	if(!strcmp(szLower, ".ply"))
+		return Mesh_Import_PLY(szFilename, pData);
+
+	return E_FAIL;
+}
@@ -0,0 +1,39 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _MESHIMPORT_H_
+#define _MESHIMPORT_H_
+
+#include "Platform.h"
+#include "Mesh.h"
+
+//reads OBJ and PLY (ascii and binary) files into vertices and 32 bit
+//indices for Mesh_Write(). It is slow text parsing, MeshConv does it
+//once and the programs map the mesh file.
+//
+//polygons are split into triangles as fans. Both formats are right
+//handed with counterclockwise front faces, z and the order of the
+//corners are turned around so the faces are clockwise as Direct3D draws
+//them, tv is 1 - v. OBJ corners
+//with the same position, texture coordinate and normal become one
+//vertex. Vertices without a normal get the average of the normals of
+//their faces
+
+struct mesh_data
+{
+	mesh_vertex *pVertices;
+	DWORD dwVertexCount;
+	DWORD *pIndices;
+	DWORD dwIndexCount;
+};
+
+//by the extension, .obj or .ply. E_FAIL when the file can not be read
+//or is not one of the two
+HRESULT Mesh_Import(const char *szFilename, mesh_data *pData);
+HRESULT Mesh_Import_OBJ(const char *szFilename, mesh_data *pData);
+HRESULT Mesh_Import_PLY(const char *szFilename, mesh_data *pData);
+
+void Mesh_Data_Free(mesh_data *pData);
+
+#endif
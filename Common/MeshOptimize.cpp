@@ -0,0 +1,366 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <math.h>
+#include <new>
+
+#include "MeshOptimize.h"
+
+#define NO_VERTEX 0xffffffff
+#define NO_TRIANGLE 0xffffffff
+
+#define MAX_ACMR_CACHE 256
+
+//the constants of Forsyth's article
+#define CACHE_DECAY_POWER	1.5f
+#define LAST_TRI_SCORE		0.75f
+#define VALENCE_BOOST_SCALE	2.0f
+#define VALENCE_BOOST_POWER	0.5f
+
+#define VALENCE_TABLE 32
+
+struct forsyth
+{
+	DWORD dwVertexCount;
+	DWORD dwTriCount;
+	DWORD *pRemaining;		//triangles not out yet that use the vertex
+	DWORD *pFirst;			//its list of them in pAdjacent
+	DWORD *pAdjacent;
+	int *pCachePos;			//-1 outside the cache
+	float *pScore;
+	float *pTriScore;
+	BYTE *pTriDone;
+	DWORD *pOut;
+
+	float CacheScore[MESH_OPTIMIZE_CACHE];
+	float ValenceScore[VALENCE_TABLE];
+};
+
+static void Forsyth_Free(forsyth *pF)
+{
+	delete[] pF->pRemaining;
+	delete[] pF->pFirst;
+	delete[] pF->pAdjacent;
+	delete[] pF->pCachePos;
+	delete[] pF->pScore;
+	delete[] pF->pTriScore;
+	delete[] pF->pTriDone;
+	delete[] pF->pOut;
+}
+
+static float Vertex_Score(const forsyth *pF, DWORD v)
+{
+	DWORD dwRemaining = pF->pRemaining[v];
+	if(!dwRemaining)
+		return -1.0f;
+
+	float Score = 0.0f;
+	int Pos = pF->pCachePos[v];
+	if(Pos >= 0)
+		Score = pF->CacheScore[Pos];
+
+	if(dwRemaining < VALENCE_TABLE)
+		Score += pF->ValenceScore[dwRemaining];
+	else
+		Score += VALENCE_BOOST_SCALE * powf((float)dwRemaining, -VALENCE_BOOST_POWER);
+
+	return Score;
+}
+
+static void Tri_Score(forsyth *pF, const DWORD *pIndices, DWORD t)
+{
+	const DWORD *pTri = &pIndices[t * 3];
+	pF->pTriScore[t] = pF->pScore[pTri[0]] + pF->pScore[pTri[1]] + pF->pScore[pTri[2]];
+}
+
+//the triangle leaves the lists of its vertices
+static void Remove_Triangle(forsyth *pF, DWORD v, DWORD t)
+{
+	DWORD *pList = &pF->pAdjacent[pF->pFirst[v]];
+	DWORD dwLast = --pF->pRemaining[v];
+
+	for(DWORD i = 0; i < dwLast; i++)
+	{
+		if(pList[i] == t)
+		{
+			pList[i] = pList[dwLast];
+			break;
+		}
+	}
+}
+
+static HRESULT Forsyth_Init(forsyth *pF, const DWORD *pIndices, DWORD dwIndexCount, DWORD dwVertexCount)
+{
+	DWORD dwTriCount = dwIndexCount / 3;
+	pF->dwVertexCount = dwVertexCount;
+	pF->dwTriCount = dwTriCount;
+
+	pF->pRemaining = new(std::nothrow) DWORD[dwVertexCount];
+	pF->pFirst = new(std::nothrow) DWORD[dwVertexCount];
+	pF->pAdjacent = new(std::nothrow) DWORD[dwIndexCount];
+	pF->pCachePos = new(std::nothrow) int[dwVertexCount];
+	pF->pScore = new(std::nothrow) float[dwVertexCount];
+	pF->pTriScore = new(std::nothrow) float[dwTriCount];
+	pF->pTriDone = new(std::nothrow) BYTE[dwTriCount];
+	pF->pOut = new(std::nothrow) DWORD[dwIndexCount];
+
+	if(!pF->pRemaining || !pF->pFirst || !pF->pAdjacent || !pF->pCachePos ||
+		!pF->pScore || !pF->pTriScore || !pF->pTriDone || !pF->pOut)
+		return E_OUTOFMEMORY;
+
+	for(int i = 0; i < MESH_OPTIMIZE_CACHE; i++)
+	{
+		//the last triangle gets a fixed score, so its three vertices do not
+		//win over each other
+		if(i < 3)
+			pF->CacheScore[i] = LAST_TRI_SCORE;
+		else
+			pF->CacheScore[i] = powf(1.0f - (float)(i - 3) / (MESH_OPTIMIZE_CACHE - 3), CACHE_DECAY_POWER);
+	}
+
+	pF->ValenceScore[0] = 0.0f;
+	for(int i = 1; i < VALENCE_TABLE; i++)
+		pF->ValenceScore[i] = VALENCE_BOOST_SCALE * powf((float)i, -VALENCE_BOOST_POWER);
+
+	for(DWORD v = 0; v < dwVertexCount; v++)
+	{
+		pF->pRemaining[v] = 0;
+		pF->pCachePos[v] = -1;
+	}
+
+	for(DWORD i = 0; i < dwIndexCount; i++)
+		pF->pRemaining[pIndices[i]]++;
+
+	//the lists are filled from their ends, pFirst ends at their starts
+	DWORD dwOffset = 0;
+	for(DWORD v = 0; v < dwVertexCount; v++)
+	{
+		dwOffset += pF->pRemaining[v];
+		pF->pFirst[v] = dwOffset;
+	}
+
+	for(DWORD i = 0; i < dwIndexCount; i++)
+		pF->pAdjacent[--pF->pFirst[pIndices[i]]] = i / 3;
+
+	for(DWORD v = 0; v < dwVertexCount; v++)
+		pF->pScore[v] = Vertex_Score(pF, v);
+
+	for(DWORD t = 0; t < dwTriCount; t++)
+	{
+		pF->pTriDone[t] = 0;
+		Tri_Score(pF, pIndices, t);
+	}
+
+	return S_OK;
+}
+
+static void Forsyth_Run(forsyth *pF, const DWORD *pIndices)
+{
+	//the cache with room for the three vertices of the new triangle,
+	//what is past MESH_OPTIMIZE_CACHE falls out
+	DWORD Cache[MESH_OPTIMIZE_CACHE + 3];
+	DWORD NewCache[MESH_OPTIMIZE_CACHE + 3];
+	DWORD dwCached = 0;
+
+	DWORD dwBest = NO_TRIANGLE;
+	float BestScore = -1.0f;
+	for(DWORD t = 0; t < pF->dwTriCount; t++)
+	{
+		if(pF->pTriScore[t] > BestScore)
+		{
+			BestScore = pF->pTriScore[t];
+			dwBest = t;
+		}
+	}
+
+	DWORD dwScan = 0;
+
+	for(DWORD dwOut = 0; dwOut < pF->dwTriCount; dwOut++)
+	{
+		//none of the cached vertices has a triangle left: the next one
+		//in the old order, not the best of all, that would not be linear
+		if(dwBest == NO_TRIANGLE)
+		{
+			while(pF->pTriDone[dwScan])
+				dwScan++;
+			dwBest = dwScan;
+		}
+
+		const DWORD *pTri = &pIndices[dwBest * 3];
+		pF->pOut[dwOut * 3] = pTri[0];
+		pF->pOut[dwOut * 3 + 1] = pTri[1];
+		pF->pOut[dwOut * 3 + 2] = pTri[2];
+		pF->pTriDone[dwBest] = 1;
+
+		DWORD dwNew = 0;
+		for(int k = 0; k < 3; k++)
+		{
+			Remove_Triangle(pF, pTri[k], dwBest);
+			NewCache[dwNew++] = pTri[k];
+		}
+
+		for(DWORD i = 0; i < dwCached; i++)
+		{
+			DWORD v = Cache[i];
+			if(v != pTri[0] && v != pTri[1] && v != pTri[2])
+				NewCache[dwNew++] = v;
+		}
+
+		//new positions and scores, the vertices that fell out too
+		for(DWORD i = 0; i < dwNew; i++)
+		{
+			DWORD v = NewCache[i];
+			pF->pCachePos[v] = i < MESH_OPTIMIZE_CACHE ? (int)i : -1;
+			pF->pScore[v] = Vertex_Score(pF, v);
+		}
+
+		dwBest = NO_TRIANGLE;
+		BestScore = -1.0f;
+		for(DWORD i = 0; i < dwNew; i++)
+		{
+			DWORD v = NewCache[i];
+			const DWORD *pList = &pF->pAdjacent[pF->pFirst[v]];
+
+			for(DWORD j = 0; j < pF->pRemaining[v]; j++)
+			{
+				DWORD t = pList[j];
+				Tri_Score(pF, pIndices, t);
+
+				if(pF->pTriScore[t] > BestScore)
+				{
+					BestScore = pF->pTriScore[t];
+					dwBest = t;
+				}
+			}
+		}
+
+		dwCached = dwNew < MESH_OPTIMIZE_CACHE ? dwNew : MESH_OPTIMIZE_CACHE;
+		for(DWORD i = 0; i < dwCached; i++)
+			Cache[i] = NewCache[i];
+	}
+}
+
+HRESULT Mesh_Optimize_Cache(DWORD *pIndices, DWORD dwIndexCount, DWORD dwVertexCount)
+{
+	if(dwIndexCount % 3)
+		return E_INVALIDARG;
+
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		if(pIndices[i] >= dwVertexCount)
+			return E_INVALIDARG;
+	}
+
+	if(!dwIndexCount)
+		return S_OK;
+
+	forsyth F;
+	ZeroMemory(&F, sizeof(forsyth));
+
+	HRESULT hr = Forsyth_Init(&F, pIndices, dwIndexCount, dwVertexCount);
+	if(SUCCEEDED(hr))
+	{
+		Forsyth_Run(&F, pIndices);
+		for(DWORD i = 0; i < dwIndexCount; i++)
+			pIndices[i] = F.pOut[i];
+	}
+
+	Forsyth_Free(&F);
+	return hr;
+}
+
+HRESULT Mesh_Optimize_Fetch(mesh_vertex *pVertices, DWORD dwVertexCount, DWORD *pIndices, DWORD dwIndexCount)
+{
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		if(pIndices[i] >= dwVertexCount)
+			return E_INVALIDARG;
+	}
+
+	DWORD *pNew = new(std::nothrow) DWORD[dwVertexCount ? dwVertexCount : 1];
+	mesh_vertex *pOld = new(std::nothrow) mesh_vertex[dwVertexCount ? dwVertexCount : 1];
+	if(!pNew || !pOld)
+	{
+		delete[] pNew;
+		delete[] pOld;
+		return E_OUTOFMEMORY;
+	}
+
+	for(DWORD v = 0; v < dwVertexCount; v++)
+	{
+		pNew[v] = NO_VERTEX;
+		pOld[v] = pVertices[v];
+	}
+
+	DWORD dwNext = 0;
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		DWORD v = pIndices[i];
+		if(pNew[v] == NO_VERTEX)
+			pNew[v] = dwNext++;
+
+		pIndices[i] = pNew[v];
+	}
+
+	for(DWORD v = 0; v < dwVertexCount; v++)
+	{
+		if(pNew[v] == NO_VERTEX)
+			pNew[v] = dwNext++;
+
+		pVertices[pNew[v]] = pOld[v];
+	}
+
+	delete[] pNew;
+	delete[] pOld;
+	return S_OK;
+}
+
+HRESULT Mesh_Optimize(mesh_vertex *pVertices, DWORD dwVertexCount, DWORD *pIndices, DWORD dwIndexCount)
+{
+	HRESULT hr = Mesh_Optimize_Cache(pIndices, dwIndexCount, dwVertexCount);
+	if(FAILED(hr))
+		return hr;
+
+	return Mesh_Optimize_Fetch(pVertices, dwVertexCount, pIndices, dwIndexCount);
+}
+
+float Mesh_ACMR(const void *pIndices, DWORD dwIndexSize, DWORD dwIndexCount, DWORD dwCacheSize)
+{
+	if(dwIndexCount < 3)
+		return 0.0f;
+
+	if(dwCacheSize > MAX_ACMR_CACHE)
+		dwCacheSize = MAX_ACMR_CACHE;
+
+	DWORD Tags[MAX_ACMR_CACHE];
+	DWORD dwUsed = 0;
+	DWORD dwNext = 0;
+	DWORD dwMisses = 0;
+
+	for(DWORD i = 0; i < dwIndexCount; i++)
+	{
+		DWORD v = dwIndexSize == sizeof(WORD) ? ((const WORD *)pIndices)[i] : ((const DWORD *)pIndices)[i];
+
+		bool bHit = false;
+		for(DWORD j = 0; j < dwUsed; j++)
+		{
+			if(Tags[j] == v)
+			{
+				bHit = true;
+				break;
+			}
+		}
+
+		if(bHit)
+			continue;
+
+		dwMisses++;
+		Tags[dwNext] = v;
+		dwNext = dwNext + 1 < dwCacheSize ? dwNext + 1 : 0;
+		if(dwUsed < dwCacheSize)
+			dwUsed++;
+	}
+
+	return (float)dwMisses / (float)(dwIndexCount / 3);
+}
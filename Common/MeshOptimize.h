@@ -0,0 +1,43 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _MESHOPTIMIZE_H_
+#define _MESHOPTIMIZE_H_
+
+#include "Platform.h"
+#include "Mesh.h"
+
+//order of the triangles and vertices for the post transform cache of
+//CSoftDevice (SOFT_VERTEX_CACHE). MeshConv does it before Mesh_Write(),
+//Mesh_Reorder() when a mesh file was written without it.
+//
+//Mesh_Optimize_Cache() is Tom Forsyth's linear speed vertex cache
+//optimization: the next triangle is the one with the best score, the
+//score of a vertex is higher the more recently it was used and the
+//fewer triangles are left that use it, so triangles close together go
+//out together and lonely vertices are finished before they fall out of
+//the cache. Only the triangles of the cached vertices are scored again
+//after each triangle, the time is linear in the triangles.
+//
+//Mesh_Optimize_Fetch() then puts the vertices in the order the indices
+//use them first, so the vertex reads go forward through memory.
+//
+//ACMR, the average cache miss ratio, is the vertices transformed per
+//triangle: 3 without any reuse, about 0.5 for a large regular grid
+//with a cache that never forgets
+
+#define MESH_OPTIMIZE_CACHE 32		//the cache Forsyth's scores are made for
+
+HRESULT Mesh_Optimize_Cache(DWORD *pIndices, DWORD dwIndexCount, DWORD dwVertexCount);
+//vertices no index uses go to the end
+HRESULT Mesh_Optimize_Fetch(mesh_vertex *pVertices, DWORD dwVertexCount, DWORD *pIndices, DWORD dwIndexCount);
+//both, E_INVALIDARG for an index past the vertices
+HRESULT Mesh_Optimize(mesh_vertex *pVertices, DWORD dwVertexCount, DWORD *pIndices, DWORD dwIndexCount);
+
+//ACMR of a triangle list with a first in first out cache of
+//dwCacheSize vertices, as CSoftDevice has it. pIndices are WORDs or
+//DWORDs by dwIndexSize
+float Mesh_ACMR(const void *pIndices, DWORD dwIndexSize, DWORD dwIndexCount, DWORD dwCacheSize);
+
+#endif
@@ -0,0 +1,24 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+//apart from Mesh.cpp so that MeshConv builds without CSoftDevice
+
+#include "Mesh.h"
+#include "SoftDevice.h"
+
+HRESULT Mesh_Draw_Soft(CSoftDevice *pDevice, const mesh *pMesh)
+{
+	const mesh_header *pHeader = pMesh->pHeader;
+
+	if(pHeader->dwIndexSize == sizeof(WORD))
+	{
+		return pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, SRFVF_VERTEX,
+			pMesh->pVertices, pHeader->dwVertexCount,
+			(const WORD *)pMesh->pIndices, pHeader->dwIndexCount, 0);
+	}
+
+	return pDevice->DrawIndexedPrimitive32(SRPT_TRIANGLELIST, SRFVF_VERTEX,
+		pMesh->pVertices, pHeader->dwVertexCount,
+		(const DWORD *)pMesh->pIndices, pHeader->dwIndexCount, 0);
+}
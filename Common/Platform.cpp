@@ -0,0 +1,652 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include "Platform.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <mmsystem.h>
+#pragma comment (lib, "winmm.lib")
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+//thread parameters are passed to the entry point through this struct
+struct thread_start
+{
+	thread_proc pProc;
+	void *pParam;
+};
+
+#ifdef _WIN32
+
+static DWORD WINAPI Thread_Entry(LPVOID pParam)
+{
+	thread_start Start = *(thread_start*)pParam;
+	delete (thread_start*)pParam;
+
+	Start.pProc(Start.pParam);
+	return 0;
+}
+
+bool Thread_Create(thread_handle *pThread, thread_proc pProc, void *pParam)
+{
+	thread_start *pStart = new thread_start;
+	pStart->pProc = pProc;
+	pStart->pParam = pParam;
+
+	DWORD dwThreadId;
+	pThread->pHandle = CreateThread(NULL, 0, Thread_Entry, pStart, 0, &dwThreadId);
+	if(!pThread->pHandle)
+	{
+		delete pStart;
+		return false;
+	}
+
+	return true;
+}
+
+void Thread_Join(thread_handle *pThread)
+{
+	if(!pThread->pHandle)
+		return;
+
+	WaitForSingleObject((HANDLE)pThread->pHandle, INFINITE);
+	CloseHandle((HANDLE)pThread->pHandle);
+	pThread->pHandle = NULL;
+}
+
+DWORD Thread_Id()
+{
+	return GetCurrentThreadId();
+}
+
+int Cpu_Count()
+{
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return (int)si.dwNumberOfProcessors;
+}
+
+void Sleep_Ms(DWORD dwMilliseconds)
+{
+	Sleep(dwMilliseconds);
+}
+
+void Sleep_Precise(bool bEnable)
+{
+	if(bEnable)
+		timeBeginPeriod(1);
+	else
+		timeEndPeriod(1);
+}
+
+void Mutex_Init(mutex *pMutex)
+{
+	CRITICAL_SECTION *pCs = new CRITICAL_SECTION;
+	InitializeCriticalSection(pCs);
+	pMutex->pHandle = pCs;
+}
+
+void Mutex_Destroy(mutex *pMutex)
+{
+	if(!pMutex->pHandle)
+		return;
+
+	DeleteCriticalSection((CRITICAL_SECTION*)pMutex->pHandle);
+	delete (CRITICAL_SECTION*)pMutex->pHandle;
+	pMutex->pHandle = NULL;
+}
+
+void Mutex_Lock(mutex *pMutex)
+{
+	EnterCriticalSection((CRITICAL_SECTION*)pMutex->pHandle);
+}
+
+void Mutex_Unlock(mutex *pMutex)
+{
+	LeaveCriticalSection((CRITICAL_SECTION*)pMutex->pHandle);
+}
+
+void Event_Init(event *pEvent)
+{
+	pEvent->pHandle = CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+void Event_Destroy(event *pEvent)
+{
+	if(!pEvent->pHandle)
+		return;
+
+	CloseHandle((HANDLE)pEvent->pHandle);
+	pEvent->pHandle = NULL;
+}
+
+void Event_Signal(event *pEvent)
+{
+	SetEvent((HANDLE)pEvent->pHandle);
+}
+
+bool Event_Wait(event *pEvent, DWORD dwMilliseconds)
+{
+	return WaitForSingleObject((HANDLE)pEvent->pHandle, dwMilliseconds) == WAIT_OBJECT_0;
+}
+
+LONG Atomic_Increment(volatile LONG *pValue)
+{
+	return InterlockedIncrement(pValue);
+}
+
+LONG Atomic_Decrement(volatile LONG *pValue)
+{
+	return InterlockedDecrement(pValue);
+}
+
+LONG Atomic_Add(volatile LONG *pValue, LONG Add)
+{
+	return InterlockedExchangeAdd(pValue, Add) + Add;
+}
+
+LONG Atomic_Exchange(volatile LONG *pValue, LONG Value)
+{
+	return InterlockedExchange(pValue, Value);
+}
+
+LONG Atomic_Compare_Exchange(volatile LONG *pValue, LONG Exchange, LONG Comparand)
+{
+	return InterlockedCompareExchange(pValue, Exchange, Comparand);
+}
+
+void Memory_Barrier()
+{
+	MemoryBarrier();
+}
+
+LONGLONG Timer_Ticks()
+{
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+	return Counter.QuadPart;
+}
+
+LONGLONG Timer_Frequency()
+{
+	static LONGLONG Frequency = 0;
+
+	if(!Frequency)
+	{
+		LARGE_INTEGER Freq;
+		QueryPerformanceFrequency(&Freq);
+		Frequency = Freq.QuadPart;
+	}
+
+	return Frequency;
+}
+
+void *Aligned_Alloc(size_t Size, size_t Alignment)
+{
+	return _aligned_malloc(Size, Alignment);
+}
+
+void Aligned_Free(void *p)
+{
+	_aligned_free(p);
+}
+
+bool Shared_Memory_Create(shared_memory *pShared, const char *szName, size_t Size)
+{
+	ZeroMemory(pShared, sizeof(shared_memory));
+
+	//frames of a few MB, the size fits in the low DWORD
+	HANDLE hMapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)Size, szName);
+	if(!hMapping)
+		return false;
+
+	pShared->pData = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, Size);
+	if(!pShared->pData)
+	{
+		CloseHandle(hMapping);
+		return false;
+	}
+
+	pShared->Size = Size;
+	pShared->pHandle = hMapping;
+	pShared->bOwner = true;
+
+	//the pages of a mapping that was still open elsewhere keep their content
+	ZeroMemory(pShared->pData, Size);
+
+	return true;
+}
+
+bool Shared_Memory_Open(shared_memory *pShared, const char *szName)
+{
+	ZeroMemory(pShared, sizeof(shared_memory));
+
+	HANDLE hMapping = OpenFileMapping(FILE_MAP_READ, FALSE, szName);
+	if(!hMapping)
+		return false;
+
+	pShared->pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if(!pShared->pData)
+	{
+		CloseHandle(hMapping);
+		return false;
+	}
+
+	MEMORY_BASIC_INFORMATION Info;
+	VirtualQuery(pShared->pData, &Info, sizeof(Info));
+
+	pShared->Size = Info.RegionSize;
+	pShared->pHandle = hMapping;
+
+	return true;
+}
+
+void Shared_Memory_Close(shared_memory *pShared)
+{
+	if(pShared->pData)
+		UnmapViewOfFile(pShared->pData);
+	if(pShared->pHandle)
+		CloseHandle((HANDLE)pShared->pHandle);
+
+	ZeroMemory(pShared, sizeof(shared_memory));
+}
+
+bool File_Map(mapped_file *pFile, const char *szFilename)
+{
+	ZeroMemory(pFile, sizeof(mapped_file));
+
+	HANDLE hFile = CreateFile(szFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	DWORD dwSizeHigh = 0;
+	DWORD dwSize = GetFileSize(hFile, &dwSizeHigh);
+
+	//the mapping keeps the file open
+	HANDLE hMapping = NULL;
+	if(dwSize && !dwSizeHigh)
+		hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(hFile);
+
+	if(!hMapping)
+		return false;
+
+	pFile->pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if(!pFile->pData)
+	{
+		CloseHandle(hMapping);
+		return false;
+	}
+
+	pFile->Size = dwSize;
+	pFile->pHandle = hMapping;
+
+	return true;
+}
+
+void File_Unmap(mapped_file *pFile)
+{
+	if(pFile->pData)
+		UnmapViewOfFile(pFile->pData);
+	if(pFile->pHandle)
+		CloseHandle((HANDLE)pFile->pHandle);
+
+	ZeroMemory(pFile, sizeof(mapped_file));
+}
+
+#else
+
+static void *Thread_Entry(void *pParam)
+{
+	thread_start Start = *(thread_start*)pParam;
+	delete (thread_start*)pParam;
+
+	Start.pProc(Start.pParam);
+	return NULL;
+}
+
+bool Thread_Create(thread_handle *pThread, thread_proc pProc, void *pParam)
+{
+	thread_start *pStart = new thread_start;
+	pStart->pProc = pProc;
+	pStart->pParam = pParam;
+
+	pthread_t *pTid = new pthread_t;
+	if(pthread_create(pTid, NULL, Thread_Entry, pStart) != 0)
+	{
+		delete pStart;
+		delete pTid;
+		pThread->pHandle = NULL;
+		return false;
+	}
+
+	pThread->pHandle = pTid;
+	return true;
+}
+
+void Thread_Join(thread_handle *pThread)
+{
+	if(!pThread->pHandle)
+		return;
+
+	pthread_join(*(pthread_t*)pThread->pHandle, NULL);
+	delete (pthread_t*)pThread->pHandle;
+	pThread->pHandle = NULL;
+}
+
+DWORD Thread_Id()
+{
+	return (DWORD)syscall(SYS_gettid);
+}
+
+int Cpu_Count()
+{
+	long Count = sysconf(_SC_NPROCESSORS_ONLN);
+	return Count > 0 ? (int)Count : 1;
+}
+
+void Sleep_Ms(DWORD dwMilliseconds)
+{
+	timespec ts;
+	ts.tv_sec = dwMilliseconds / 1000;
+	ts.tv_nsec = (dwMilliseconds % 1000) * 1000000L;
+	while(nanosleep(&ts, &ts) == -1 && errno == EINTR)
+		;
+}
+
+void Sleep_Precise(bool bEnable)
+{
+	//nanosleep() is precise already
+	UNREFERENCED_PARAMETER(bEnable);
+}
+
+void Mutex_Init(mutex *pMutex)
+{
+	pthread_mutex_t *pMtx = new pthread_mutex_t;
+	pthread_mutex_init(pMtx, NULL);
+	pMutex->pHandle = pMtx;
+}
+
+void Mutex_Destroy(mutex *pMutex)
+{
+	if(!pMutex->pHandle)
+		return;
+
+	pthread_mutex_destroy((pthread_mutex_t*)pMutex->pHandle);
+	delete (pthread_mutex_t*)pMutex->pHandle;
+	pMutex->pHandle = NULL;
+}
+
+void Mutex_Lock(mutex *pMutex)
+{
+	pthread_mutex_lock((pthread_mutex_t*)pMutex->pHandle);
+}
+
+void Mutex_Unlock(mutex *pMutex)
+{
+	pthread_mutex_unlock((pthread_mutex_t*)pMutex->pHandle);
+}
+
+//pthreads has no event object, build it from a mutex and a condition
+struct posix_event
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Cond;
+	bool bSignaled;
+};
+
+void Event_Init(event *pEvent)
+{
+	posix_event *pEv = new posix_event;
+	pthread_mutex_init(&pEv->Mutex, NULL);
+	pthread_cond_init(&pEv->Cond, NULL);
+	pEv->bSignaled = false;
+	pEvent->pHandle = pEv;
+}
+
+void Event_Destroy(event *pEvent)
+{
+	if(!pEvent->pHandle)
+		return;
+
+	posix_event *pEv = (posix_event*)pEvent->pHandle;
+	pthread_cond_destroy(&pEv->Cond);
+	pthread_mutex_destroy(&pEv->Mutex);
+	delete pEv;
+	pEvent->pHandle = NULL;
+}
+
+void Event_Signal(event *pEvent)
+{
+	posix_event *pEv = (posix_event*)pEvent->pHandle;
+	pthread_mutex_lock(&pEv->Mutex);
+	pEv->bSignaled = true;
+	pthread_cond_signal(&pEv->Cond);
+	pthread_mutex_unlock(&pEv->Mutex);
+}
+
+bool Event_Wait(event *pEvent, DWORD dwMilliseconds)
+{
+	posix_event *pEv = (posix_event*)pEvent->pHandle;
+
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += dwMilliseconds / 1000;
+	ts.tv_nsec += (dwMilliseconds % 1000) * 1000000L;
+	if(ts.tv_nsec >= 1000000000L)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock(&pEv->Mutex);
+	while(!pEv->bSignaled)
+	{
+		if(pthread_cond_timedwait(&pEv->Cond, &pEv->Mutex, &ts) == ETIMEDOUT)
+			break;
+	}
+	bool bResult = pEv->bSignaled;
+	pEv->bSignaled = false;
+	pthread_mutex_unlock(&pEv->Mutex);
+
+	return bResult;
+}
+
+LONG Atomic_Increment(volatile LONG *pValue)
+{
+	return __sync_add_and_fetch(pValue, 1);
+}
+
+LONG Atomic_Decrement(volatile LONG *pValue)
+{
+	return __sync_sub_and_fetch(pValue, 1);
+}
+
+LONG Atomic_Add(volatile LONG *pValue, LONG Add)
+{
+	return __sync_add_and_fetch(pValue, Add);
+}
+
+LONG Atomic_Exchange(volatile LONG *pValue, LONG Value)
+{
+	__sync_synchronize();
+	return __sync_lock_test_and_set(pValue, Value);
+}
+
+LONG Atomic_Compare_Exchange(volatile LONG *pValue, LONG Exchange, LONG Comparand)
+{
+	return __sync_val_compare_and_swap(pValue, Comparand, Exchange);
+}
+
+void Memory_Barrier()
+{
+	__sync_synchronize();
+}
+
+LONGLONG Timer_Ticks()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (LONGLONG)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+LONGLONG Timer_Frequency()
+{
+	return 1000000000LL;
+}
+
+void *Aligned_Alloc(size_t Size, size_t Alignment)
+{
+	void *p = NULL;
+	if(posix_memalign(&p, Alignment, Size) != 0)
+		return NULL;
+	return p;
+}
+
+void Aligned_Free(void *p)
+{
+	free(p);
+}
+
+bool Shared_Memory_Create(shared_memory *pShared, const char *szName, size_t Size)
+{
+	ZeroMemory(pShared, sizeof(shared_memory));
+
+	if(strlen(szName) >= sizeof(pShared->szName))
+		return false;
+
+	//a new object, ftruncate() of a new one gives zeroed pages
+	shm_unlink(szName);
+	int fd = shm_open(szName, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if(fd < 0)
+		return false;
+
+	if(ftruncate(fd, (off_t)Size) != 0)
+	{
+		close(fd);
+		shm_unlink(szName);
+		return false;
+	}
+
+	void *pData = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(pData == MAP_FAILED)
+	{
+		shm_unlink(szName);
+		return false;
+	}
+
+	pShared->pData = pData;
+	pShared->Size = Size;
+	pShared->bOwner = true;
+	strcpy(pShared->szName, szName);
+
+	return true;
+}
+
+bool Shared_Memory_Open(shared_memory *pShared, const char *szName)
+{
+	ZeroMemory(pShared, sizeof(shared_memory));
+
+	int fd = shm_open(szName, O_RDONLY, 0);
+	if(fd < 0)
+		return false;
+
+	struct stat Stat;
+	if(fstat(fd, &Stat) != 0 || Stat.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *pData = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(pData == MAP_FAILED)
+		return false;
+
+	pShared->pData = pData;
+	pShared->Size = (size_t)Stat.st_size;
+
+	return true;
+}
+
+void Shared_Memory_Close(shared_memory *pShared)
+{
+	if(pShared->pData)
+		munmap(pShared->pData, pShared->Size);
+	if(pShared->bOwner)
+		shm_unlink(pShared->szName);
+
+	ZeroMemory(pShared, sizeof(shared_memory));
+}
+
+bool File_Map(mapped_file *pFile, const char *szFilename)
+{
+	ZeroMemory(pFile, sizeof(mapped_file));
+
+	int fd = open(szFilename, O_RDONLY);
+	if(fd < 0)
+		return false;
+
+	struct stat Stat;
+	if(fstat(fd, &Stat) != 0 || Stat.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *pData = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(pData == MAP_FAILED)
+		return false;
+
+	pFile->pData = pData;
+	pFile->Size = (size_t)Stat.st_size;
+
+	return true;
+}
+
+void File_Unmap(mapped_file *pFile)
+{
+	if(pFile->pData)
+		munmap((void *)pFile->pData, pFile->Size);
+
+	ZeroMemory(pFile, sizeof(mapped_file));
+}
+
+#endif
+
+double Timer_Seconds(LONGLONG Ticks)
+{
+	return (double)Ticks / (double)Timer_Frequency();
+}
+
+LONGLONG Cycle_Count()
+{
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+	return (LONGLONG)__rdtsc();
+#else
+	return Timer_Ticks();
+#endif
+}
@@ -0,0 +1,180 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _PLATFORM_H_
+#define _PLATFORM_H_
+
+//the samples are WinAPI programs, but the code in the Common folder
+//is also built on Linux (headless tools, benchmarks), so everything
+//that touches the OS goes through the small set of functions below
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+#define THREAD_LOCAL __declspec(thread)
+#define ALIGN_CACHE __declspec(align(64))
+
+#else
+
+#include <stddef.h>
+#include <string.h>
+
+typedef unsigned int	DWORD;
+typedef unsigned short	WORD;
+typedef unsigned char	BYTE;
+typedef int				BOOL;
+typedef int				LONG;
+typedef unsigned int	ULONG;
+typedef int				HRESULT;
+typedef long long		LONGLONG;
+
+#define TRUE	1
+#define FALSE	0
+
+#define S_OK			((HRESULT)0x00000000L)
+#define S_FALSE			((HRESULT)0x00000001L)
+#define E_FAIL			((HRESULT)0x80004005L)
+#define E_OUTOFMEMORY	((HRESULT)0x8007000EL)
+#define E_INVALIDARG	((HRESULT)0x80070057L)
+
+#define SUCCEEDED(hr)	((HRESULT)(hr) >= 0)
+#define FAILED(hr)		((HRESULT)(hr) < 0)
+
+struct RECT
+{
+	LONG left, top, right, bottom;
+};
+
+#define ZeroMemory(p, n) memset((p), 0, (n))
+#define UNREFERENCED_PARAMETER(p) (void)(p)
+
+#define THREAD_LOCAL __thread
+#define ALIGN_CACHE __attribute__((aligned(64)))
+
+#endif
+
+#define CACHE_LINE_SIZE 64
+
+//SSE for the vector loops: every x64 CPU has it, 32 bit Visual Studio
+//builds get it with /arch:SSE, gcc with x86_64 or -msse. Without it the
+//loops are plain C
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1) || defined(__SSE__)
+#define PLATFORM_SSE
+#endif
+
+//-------------------------------------------------------------------------
+// Threads
+//-------------------------------------------------------------------------
+
+typedef void (*thread_proc)(void *pParam);
+
+struct thread_handle
+{
+	void *pHandle;
+};
+
+bool Thread_Create(thread_handle *pThread, thread_proc pProc, void *pParam);
+void Thread_Join(thread_handle *pThread);
+DWORD Thread_Id();
+int Cpu_Count();
+void Sleep_Ms(DWORD dwMilliseconds);
+//true makes sleeps and waits of the process wake up within 1 ms, on
+//Windows they take a 15.6 ms tick without it. Calls with true and false pair
+void Sleep_Precise(bool bEnable);
+
+//-------------------------------------------------------------------------
+// Synchronization
+//-------------------------------------------------------------------------
+
+struct mutex
+{
+	void *pHandle;
+};
+
+void Mutex_Init(mutex *pMutex);
+void Mutex_Destroy(mutex *pMutex);
+void Mutex_Lock(mutex *pMutex);
+void Mutex_Unlock(mutex *pMutex);
+
+//auto reset event, one waiter
+struct event
+{
+	void *pHandle;
+};
+
+void Event_Init(event *pEvent);
+void Event_Destroy(event *pEvent);
+void Event_Signal(event *pEvent);
+//returns false on timeout
+bool Event_Wait(event *pEvent, DWORD dwMilliseconds);
+
+LONG Atomic_Increment(volatile LONG *pValue);
+LONG Atomic_Decrement(volatile LONG *pValue);
+LONG Atomic_Add(volatile LONG *pValue, LONG Add);
+LONG Atomic_Exchange(volatile LONG *pValue, LONG Value);
+//returns the value that was in *pValue before the call
+LONG Atomic_Compare_Exchange(volatile LONG *pValue, LONG Exchange, LONG Comparand);
+void Memory_Barrier();
+
+//-------------------------------------------------------------------------
+// Timer
+//-------------------------------------------------------------------------
+
+LONGLONG Timer_Ticks();
+LONGLONG Timer_Frequency();
+double Timer_Seconds(LONGLONG Ticks);
+
+//CPU time stamp counter, cheap enough to read for every scanline,
+//Timer_Ticks() where the CPU has no rdtsc
+LONGLONG Cycle_Count();
+
+//-------------------------------------------------------------------------
+// Memory
+//-------------------------------------------------------------------------
+
+void *Aligned_Alloc(size_t Size, size_t Alignment);
+void Aligned_Free(void *p);
+
+//-------------------------------------------------------------------------
+// Shared memory
+//-------------------------------------------------------------------------
+
+//named memory another process can map: a POSIX shm object, a file
+//mapping on Windows. Names start with a slash, "/frames"
+struct shared_memory
+{
+	void *pData;
+	size_t Size;
+	void *pHandle;		//the file mapping on Windows
+	bool bOwner;
+	char szName[64];
+};
+
+//a new zeroed object of Size bytes, one left by a crashed process is
+//replaced
+bool Shared_Memory_Create(shared_memory *pShared, const char *szName, size_t Size);
+//maps the object of another process, read only
+bool Shared_Memory_Open(shared_memory *pShared, const char *szName);
+//unmaps it, the creator also removes the name
+void Shared_Memory_Close(shared_memory *pShared);
+
+//-------------------------------------------------------------------------
+// Mapped files
+//-------------------------------------------------------------------------
+
+//a file mapped read only, the pages are read when they are touched.
+//pData is page aligned
+struct mapped_file
+{
+	const void *pData;
+	size_t Size;
+	void *pHandle;		//the file mapping on Windows
+};
+
+//false when the file can not be opened or is empty
+bool File_Map(mapped_file *pFile, const char *szFilename);
+void File_Unmap(mapped_file *pFile);
+
+#endif
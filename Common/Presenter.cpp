@@ -0,0 +1,374 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Presenter.h"
+#include "RenderStats.h"
+#include "Trace.h"
+
+void Presenter_Parse_Options(const char *szCmdLine, present_options *pOptions)
+{
+	ZeroMemory(pOptions, sizeof(present_options));
+	pOptions->dwMode = PRESENT_WINDOWED;
+	pOptions->dwBackBuffers = 2;
+	pOptions->dwWidth = 640;
+	pOptions->dwHeight = 480;
+	pOptions->dwBitCount = 32;
+
+	if(strstr(szCmdLine, "-fullscreen"))
+		pOptions->dwMode = PRESENT_FLIP;
+	else if(strstr(szCmdLine, "-headless"))
+		pOptions->dwMode = PRESENT_HEADLESS;
+
+	const char *szBuffers = strstr(szCmdLine, "-backbuffers ");
+	if(szBuffers)
+		pOptions->dwBackBuffers = (DWORD)atoi(szBuffers + 13);
+}
+
+static HRESULT Create_Flip_Chain(presenter *pPresenter, const present_options *pOptions)
+{
+	HRESULT hr = pPresenter->pDD->SetCooperativeLevel(pPresenter->hWnd, DDSCL_EXCLUSIVE | DDSCL_FULLSCREEN);
+	if(FAILED(hr))
+		return hr;
+
+	hr = pPresenter->pDD->SetDisplayMode(pOptions->dwWidth, pOptions->dwHeight, pOptions->dwBitCount, 0, 0);
+	if(FAILED(hr))
+		return hr;
+
+	DWORD dwBackBuffers = pOptions->dwBackBuffers;
+	if(dwBackBuffers < 1)
+		dwBackBuffers = 1;
+	if(dwBackBuffers > PRESENT_MAX_BACK_BUFFERS)
+		dwBackBuffers = PRESENT_MAX_BACK_BUFFERS;
+
+	DDSURFACEDESC2 ddsd;
+	ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
+	ddsd.dwSize = sizeof(DDSURFACEDESC2);
+	ddsd.dwFlags = DDSD_CAPS | DDSD_BACKBUFFERCOUNT;
+	ddsd.ddsCaps.dwCaps = DDSCAPS_PRIMARYSURFACE | DDSCAPS_FLIP | DDSCAPS_COMPLEX | pOptions->dwBackCaps;
+	ddsd.dwBackBufferCount = dwBackBuffers;
+
+	hr = pPresenter->pDD->CreateSurface(&ddsd, &pPresenter->pPrimary, NULL);
+	if(FAILED(hr))
+		return hr;
+
+	//the surface after the front buffer, a flip moves the memory and
+	//not the surface, so this stays the surface to draw into
+	DDSCAPS2 Caps;
+	ZeroMemory(&Caps, sizeof(DDSCAPS2));
+	Caps.dwCaps = DDSCAPS_BACKBUFFER;
+	hr = pPresenter->pPrimary->GetAttachedSurface(&Caps, &pPresenter->pBackBuffer);
+	if(FAILED(hr))
+		return hr;
+
+	SetRect(&pPresenter->RcViewport, 0, 0, pOptions->dwWidth, pOptions->dwHeight);
+	pPresenter->RcScreen = pPresenter->RcViewport;
+	pPresenter->dwBufferWidth = pOptions->dwWidth;
+	pPresenter->dwBufferHeight = pOptions->dwHeight;
+
+	return S_OK;
+}
+
+static HRESULT Create_Surface(presenter *pPresenter, DWORD dwWidth, DWORD dwHeight, LPDIRECTDRAWSURFACE4 *ppSurface)
+{
+	DDSURFACEDESC2 ddsd;
+	ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
+	ddsd.dwSize = sizeof(DDSURFACEDESC2);
+	ddsd.dwFlags = DDSD_WIDTH | DDSD_HEIGHT | DDSD_CAPS;
+	ddsd.ddsCaps.dwCaps = DDSCAPS_OFFSCREENPLAIN | pPresenter->dwBackCaps;
+	ddsd.dwWidth = dwWidth;
+	ddsd.dwHeight = dwHeight;
+
+	if(pPresenter->Format.dwSize)
+	{
+		ddsd.dwFlags |= DDSD_PIXELFORMAT;
+		ddsd.ddpfPixelFormat = pPresenter->Format;
+	}
+
+	return pPresenter->pDD->CreateSurface(&ddsd, ppSurface, NULL);
+}
+
+//the client area of the window on the desktop
+static void Client_Rects(presenter *pPresenter)
+{
+	GetClientRect(pPresenter->hWnd, &pPresenter->RcScreen);
+	GetClientRect(pPresenter->hWnd, &pPresenter->RcViewport);
+	ClientToScreen(pPresenter->hWnd, (POINT *)&pPresenter->RcScreen.left);
+	ClientToScreen(pPresenter->hWnd, (POINT *)&pPresenter->RcScreen.right);
+}
+
+static HRESULT Create_Back_Buffer(presenter *pPresenter, const present_options *pOptions)
+{
+	HRESULT hr = pPresenter->pDD->SetCooperativeLevel(pPresenter->hWnd, DDSCL_NORMAL);
+	if(FAILED(hr))
+		return hr;
+
+	DDSURFACEDESC2 ddsd;
+	ZeroMemory(&ddsd, sizeof(DDSURFACEDESC2));
+	ddsd.dwSize = sizeof(DDSURFACEDESC2);
+
+	if(pOptions->dwMode == PRESENT_WINDOWED)
+	{
+		ddsd.dwFlags = DDSD_CAPS;
+		ddsd.ddsCaps.dwCaps = DDSCAPS_PRIMARYSURFACE;
+
+		hr = pPresenter->pDD->CreateSurface(&ddsd, &pPresenter->pPrimary, NULL);
+		if(FAILED(hr))
+			return hr;
+
+		//the blits stay inside the visible part of the window
+		LPDIRECTDRAWCLIPPER pClipper;
+		hr = pPresenter->pDD->CreateClipper(0, &pClipper, NULL);
+		if(FAILED(hr))
+			return hr;
+
+		pClipper->SetHWnd(0, pPresenter->hWnd);
+		pPresenter->pPrimary->SetClipper(pClipper);
+		pClipper->Release();
+	}
+
+	Client_Rects(pPresenter);
+	pPresenter->dwBufferWidth = pPresenter->RcViewport.right;
+	pPresenter->dwBufferHeight = pPresenter->RcViewport.bottom;
+
+	hr = Create_Surface(pPresenter, pPresenter->dwBufferWidth, pPresenter->dwBufferHeight, &pPresenter->pBackBuffer);
+	if(FAILED(hr))
+		return hr;
+
+	//DDBLT_WAIT stops the CPU until the copy is done, a driver with a
+	//blit queue takes the copy and the next frame starts at once
+	DDCAPS HalCaps;
+	ZeroMemory(&HalCaps, sizeof(DDCAPS));
+	HalCaps.dwSize = sizeof(DDCAPS);
+	pPresenter->dwBltFlags = DDBLT_WAIT;
+	if(SUCCEEDED(pPresenter->pDD->GetCaps(&HalCaps, NULL)) && (HalCaps.dwCaps & DDCAPS_BLTQUEUE))
+		pPresenter->dwBltFlags = DDBLT_ASYNC;
+
+	return S_OK;
+}
+
+HRESULT Presenter_Create(presenter *pPresenter, LPDIRECTDRAW4 pDD, HWND hWnd, const present_options *pOptions)
+{
+	ZeroMemory(pPresenter, sizeof(presenter));
+	pPresenter->dwMode = pOptions->dwMode;
+	pPresenter->pDD = pDD;
+	pPresenter->hWnd = hWnd;
+	pPresenter->dwBackCaps = pOptions->dwBackCaps;
+	if(pOptions->pFormat)
+		pPresenter->Format = *pOptions->pFormat;
+
+	HRESULT hr;
+	if(pOptions->dwMode == PRESENT_FLIP)
+		hr = Create_Flip_Chain(pPresenter, pOptions);
+	else
+		hr = Create_Back_Buffer(pPresenter, pOptions);
+
+	if(FAILED(hr))
+		Presenter_Destroy(pPresenter);
+	else
+		pPresenter->RcSource = pPresenter->RcViewport;
+
+	return hr;
+}
+
+void Presenter_Destroy(presenter *pPresenter)
+{
+	Presenter_Cancel_Resize(pPresenter);
+
+	if(pPresenter->pBackBuffer)
+	{
+		pPresenter->pBackBuffer->Release();
+		pPresenter->pBackBuffer = NULL;
+	}
+
+	if(pPresenter->pPrimary)
+	{
+		pPresenter->pPrimary->Release();
+		pPresenter->pPrimary = NULL;
+	}
+
+	if(pPresenter->pDD && pPresenter->dwMode == PRESENT_FLIP)
+	{
+		pPresenter->pDD->RestoreDisplayMode();
+		pPresenter->pDD->SetCooperativeLevel(pPresenter->hWnd, DDSCL_NORMAL);
+	}
+
+	pPresenter->pDD = NULL;
+}
+
+void Presenter_Move(presenter *pPresenter, int x, int y)
+{
+	if(pPresenter->dwMode == PRESENT_FLIP)
+		return;
+
+	LONG lWidth = pPresenter->RcScreen.right - pPresenter->RcScreen.left;
+	LONG lHeight = pPresenter->RcScreen.bottom - pPresenter->RcScreen.top;
+	SetRect(&pPresenter->RcScreen, x, y, x + lWidth, y + lHeight);
+}
+
+//one side of the new back buffer
+static DWORD Grow_Size(DWORD dwSize, DWORD dwNeeded)
+{
+	if(dwNeeded <= dwSize)
+		return dwSize;
+
+	dwSize += dwSize / 2;
+	return dwSize > dwNeeded ? dwSize : dwNeeded;
+}
+
+HRESULT Presenter_Resize(presenter *pPresenter, DWORD dwWidth, DWORD dwHeight, bool *pbNewSurface)
+{
+	*pbNewSurface = false;
+	Presenter_Cancel_Resize(pPresenter);
+
+	//minimized, or the size of the display mode
+	if(!dwWidth || !dwHeight || pPresenter->dwMode == PRESENT_FLIP)
+		return S_OK;
+
+	pPresenter->dwNewWidth = dwWidth;
+	pPresenter->dwNewHeight = dwHeight;
+
+	if(dwWidth <= pPresenter->dwBufferWidth && dwHeight <= pPresenter->dwBufferHeight)
+	{
+		pPresenter->bResizing = true;
+		return S_OK;
+	}
+
+	DWORD dwBufferWidth = Grow_Size(pPresenter->dwBufferWidth, dwWidth);
+	DWORD dwBufferHeight = Grow_Size(pPresenter->dwBufferHeight, dwHeight);
+
+	//the old back buffer and viewport stay when there is no memory
+	HRESULT hr = Create_Surface(pPresenter, dwBufferWidth, dwBufferHeight, &pPresenter->pNewBuffer);
+	if(FAILED(hr))
+	{
+		pPresenter->pNewBuffer = NULL;
+		return hr;
+	}
+
+	pPresenter->dwNewBufferWidth = dwBufferWidth;
+	pPresenter->dwNewBufferHeight = dwBufferHeight;
+	pPresenter->bResizing = true;
+
+	*pbNewSurface = true;
+
+	return S_OK;
+}
+
+void Presenter_Commit_Resize(presenter *pPresenter)
+{
+	if(!pPresenter->bResizing)
+		return;
+
+	if(pPresenter->pNewBuffer)
+	{
+		pPresenter->pBackBuffer->Release();
+		pPresenter->pBackBuffer = pPresenter->pNewBuffer;
+		pPresenter->pNewBuffer = NULL;
+		pPresenter->dwBufferWidth = pPresenter->dwNewBufferWidth;
+		pPresenter->dwBufferHeight = pPresenter->dwNewBufferHeight;
+	}
+
+	Client_Rects(pPresenter);
+	SetRect(&pPresenter->RcViewport, 0, 0, pPresenter->dwNewWidth, pPresenter->dwNewHeight);
+	pPresenter->RcSource = pPresenter->RcViewport;
+
+	pPresenter->bResizing = false;
+}
+
+void Presenter_Cancel_Resize(presenter *pPresenter)
+{
+	if(pPresenter->pNewBuffer)
+	{
+		pPresenter->pNewBuffer->Release();
+		pPresenter->pNewBuffer = NULL;
+	}
+
+	pPresenter->bResizing = false;
+}
+
+HRESULT Presenter_Present(presenter *pPresenter, const RECT *pRect)
+{
+	TRACE_SCOPE("Presenter_Present");
+
+	LONGLONG Start = Timer_Ticks();
+	HRESULT hr = S_OK;
+
+	if(pPresenter->dwMode == PRESENT_FLIP)
+	{
+		hr = pPresenter->pPrimary->Flip(NULL, DDFLIP_WAIT);
+	}
+	else if(pPresenter->dwMode == PRESENT_WINDOWED)
+	{
+		//the same part of the window, the viewport starts at 0, 0
+		RECT RcSrc = pRect ? *pRect : pPresenter->RcViewport;
+		RECT RcDest = RcSrc;
+		OffsetRect(&RcDest, pPresenter->RcScreen.left, pPresenter->RcScreen.top);
+
+		//a smaller source is stretched over the whole window, a part of
+		//it would not line up with the filtering of the driver
+		if(!EqualRect(&pPresenter->RcSource, &pPresenter->RcViewport))
+		{
+			RcSrc = pPresenter->RcSource;
+			RcDest = pPresenter->RcScreen;
+		}
+
+		hr = pPresenter->pPrimary->Blt(&RcDest, pPresenter->pBackBuffer, &RcSrc, pPresenter->dwBltFlags, NULL);
+
+		//the blit queue is full, this one waits
+		if(hr == DDERR_WASSTILLDRAWING)
+			hr = pPresenter->pPrimary->Blt(&RcDest, pPresenter->pBackBuffer, &RcSrc, DDBLT_WAIT, NULL);
+	}
+
+	//another application took the display, the flip chain comes back
+	//with the primary surface
+	if(hr == DDERR_SURFACELOST)
+	{
+		pPresenter->pPrimary->Restore();
+		if(pPresenter->dwMode != PRESENT_FLIP)
+			pPresenter->pBackBuffer->Restore();
+	}
+
+	LONGLONG Wait = Timer_Ticks() - Start;
+	pPresenter->fWaitMs = (float)(Timer_Seconds(Wait) * 1000.0);
+
+	DWORD dwWaitUs = (DWORD)(pPresenter->fWaitMs * 1000.0f);
+	Stats_Local()->dwPresentWaitUs += dwWaitUs;
+	Trace_Counter("present wait us", (LONG)dwWaitUs);
+
+	return hr;
+}
+
+bool Presenter_Keeps_Frame(const presenter *pPresenter)
+{
+	return pPresenter->dwMode != PRESENT_FLIP;
+}
+
+bool Presenter_Can_Stretch(const presenter *pPresenter)
+{
+	return pPresenter->dwMode != PRESENT_FLIP;
+}
+
+void Presenter_Set_Source(presenter *pPresenter, const RECT *pRect)
+{
+	if(!pRect || !Presenter_Can_Stretch(pPresenter))
+	{
+		pPresenter->RcSource = pPresenter->RcViewport;
+		return;
+	}
+
+	//inside the viewport and at least one pixel
+	RECT Rc = *pRect;
+	if(Rc.right > pPresenter->RcViewport.right)
+		Rc.right = pPresenter->RcViewport.right;
+	if(Rc.bottom > pPresenter->RcViewport.bottom)
+		Rc.bottom = pPresenter->RcViewport.bottom;
+	if(Rc.right < 1)
+		Rc.right = 1;
+	if(Rc.bottom < 1)
+		Rc.bottom = 1;
+
+	SetRect(&pPresenter->RcSource, 0, 0, Rc.right, Rc.bottom);
+}
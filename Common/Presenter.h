@@ -0,0 +1,119 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _PRESENTER_H_
+#define _PRESENTER_H_
+
+#include <ddraw.h>
+
+#include "Platform.h"
+
+//the primary surface, the back buffer the frame is drawn into and the
+//way the back buffer gets to the screen:
+//
+//PRESENT_WINDOWED  Blt() of an offscreen back buffer into the window.
+//                  When the driver queues blits (DDCAPS_BLTQUEUE) the
+//                  Blt() is DDBLT_ASYNC and returns at once
+//PRESENT_FLIP      exclusive fullscreen with a flip chain of 1 to 3 back
+//                  buffers. With 2 (triple buffering) Flip() returns while
+//                  the flip before still waits for the vertical blank and
+//                  the next frame is drawn into the third buffer
+//PRESENT_HEADLESS  only the back buffer, Present() shows nothing. For
+//                  timing the drawing without the display
+//
+//the time Presenter_Present() waits is counted in render_stats
+//dwPresentWaitUs and written as a trace counter
+
+enum
+{
+	PRESENT_WINDOWED,
+	PRESENT_FLIP,
+	PRESENT_HEADLESS
+};
+
+#define PRESENT_MAX_BACK_BUFFERS 3
+
+struct present_options
+{
+	DWORD dwMode;
+	DWORD dwBackBuffers;		//PRESENT_FLIP, 1 to PRESENT_MAX_BACK_BUFFERS
+	DWORD dwWidth;				//PRESENT_FLIP display mode
+	DWORD dwHeight;
+	DWORD dwBitCount;
+	DWORD dwBackCaps;			//more caps of the back buffer, DDSCAPS_3DDEVICE
+	const DDPIXELFORMAT *pFormat;	//windowed and headless back buffer, NULL for the display format
+};
+
+struct presenter
+{
+	DWORD dwMode;
+	LPDIRECTDRAW4 pDD;
+	HWND hWnd;
+	LPDIRECTDRAWSURFACE4 pPrimary;		//NULL with PRESENT_HEADLESS
+	LPDIRECTDRAWSURFACE4 pBackBuffer;	//draw into this one
+	RECT RcScreen;			//the client area on the desktop
+	RECT RcViewport;		//the part of the back buffer in use, starts at 0, 0
+	RECT RcSource;			//the part drawn, smaller than the viewport with
+							//dynamic resolution (DynamicRes.h)
+	DWORD dwBufferWidth;	//size of the back buffer, can be bigger than
+	DWORD dwBufferHeight;	//the viewport after Presenter_Resize()
+	DWORD dwBackCaps;
+	DDPIXELFORMAT Format;	//dwSize 0 for the display format
+	DWORD dwBltFlags;		//PRESENT_WINDOWED
+	float fWaitMs;			//the last Presenter_Present()
+
+	//from Presenter_Resize() until it is committed or cancelled
+	bool bResizing;
+	LPDIRECTDRAWSURFACE4 pNewBuffer;	//NULL while the back buffer is big enough
+	DWORD dwNewWidth;		//the new viewport
+	DWORD dwNewHeight;
+	DWORD dwNewBufferWidth;	//size of pNewBuffer
+	DWORD dwNewBufferHeight;
+};
+
+//options of the command line of the samples: -fullscreen is PRESENT_FLIP
+//with 640x480x32, -backbuffers N, -headless is PRESENT_HEADLESS
+void Presenter_Parse_Options(const char *szCmdLine, present_options *pOptions);
+
+//sets the cooperative level of pDD for the mode and creates the surfaces.
+//The back buffer gets the size of the client area of hWnd, with
+//PRESENT_FLIP the size of the display mode
+HRESULT Presenter_Create(presenter *pPresenter, LPDIRECTDRAW4 pDD, HWND hWnd, const present_options *pOptions);
+void Presenter_Destroy(presenter *pPresenter);
+
+//the window moved, for WM_MOVE
+void Presenter_Move(presenter *pPresenter, int x, int y);
+
+//the client area has a new size, for WM_SIZE. A new back buffer is made
+//only when the size does not fit into the old one, half again as big as
+//needed, so a window dragged bigger does not make one on every message.
+//The presenter does not change yet: *pbNewSurface tells the caller to
+//attach its Z buffer and render target to pNewBuffer, then
+//Presenter_Commit_Resize() takes the new buffer and viewport, or
+//Presenter_Cancel_Resize() drops them when the caller could not move
+//over and everything stays as it was. Nothing changes in fullscreen,
+//bResizing is false then
+HRESULT Presenter_Resize(presenter *pPresenter, DWORD dwWidth, DWORD dwHeight, bool *pbNewSurface);
+void Presenter_Commit_Resize(presenter *pPresenter);
+void Presenter_Cancel_Resize(presenter *pPresenter);
+
+//shows the back buffer, pRect is the part of it that changed (NULL for
+//all). A flip always shows the whole buffer. When the source is smaller
+//than the viewport Blt() stretches all of it over the window, pRect is
+//not used
+HRESULT Presenter_Present(presenter *pPresenter, const RECT *pRect);
+
+//the next frame is drawn over the one before, only a windowed or a
+//headless back buffer keeps its content (DirtyRect.h)
+bool Presenter_Keeps_Frame(const presenter *pPresenter);
+
+//only a Blt() can stretch, a flip shows the back buffer as it is
+bool Presenter_Can_Stretch(const presenter *pPresenter);
+
+//the frame is drawn into pRect of the back buffer, from 0, 0 and inside
+//the viewport. NULL, or a flip chain, uses the whole viewport again.
+//Presenter_Create() and Presenter_Resize() reset it
+void Presenter_Set_Source(presenter *pPresenter, const RECT *pRect);
+
+#endif
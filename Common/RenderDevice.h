@@ -0,0 +1,61 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _RENDERDEVICE_H_
+#define _RENDERDEVICE_H_
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "StateBlock.h"
+
+//the calls of IDirect3DDevice3 the samples draw with. CSoftDevice
+//implements them, CRecordDevice (DrawTrace.h) writes them to a file and
+//passes them on, so code written against IRenderDevice can be recorded
+//without changes. Values of states and flags are the SR* constants of
+//SoftDevice.h, the same as in d3dtypes.h
+
+//the most vertices one draw with WORD indices takes, D3DMAXNUMVERTICES
+//of d3dtypes.h
+#define SRMAXNUMVERTICES 65535
+
+struct soft_texture;
+
+class IRenderDevice
+{
+public:
+	virtual HRESULT SetRenderState(DWORD dwState, DWORD dwValue) = 0;
+	virtual HRESULT GetRenderState(DWORD dwState, DWORD *pdwValue) = 0;
+	virtual HRESULT SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue) = 0;
+	virtual HRESULT SetTexture(DWORD dwStage, soft_texture *pTexture) = 0;
+	virtual HRESULT SetTransform(DWORD dwState, const matrix4x4 *pMatrix) = 0;
+	virtual HRESULT SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight) = 0;
+	//sets the states of the block that are different, the device may
+	//keep its own data in the block (StateBlock.h)
+	virtual HRESULT ApplyStateBlock(state_block *pBlock) = 0;
+
+	virtual HRESULT Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ) = 0;
+	virtual HRESULT BeginScene() = 0;
+	virtual HRESULT EndScene() = 0;
+
+	virtual HRESULT DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags) = 0;
+	virtual HRESULT DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags) = 0;
+
+	//the caller fills pBits of the new texture before it is used
+	virtual HRESULT CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture) = 0;
+	virtual void DestroyTexture(soft_texture *pTexture) = 0;
+	virtual DWORD GetTextureHandle(soft_texture *pTexture) = 0;
+
+	virtual DWORD GetWidth() = 0;
+	virtual DWORD GetHeight() = 0;
+
+	virtual ULONG Release() = 0;
+
+protected:
+	virtual ~IRenderDevice() {}
+};
+
+#endif
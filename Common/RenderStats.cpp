@@ -0,0 +1,126 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+
+#include "RenderStats.h"
+
+//each block takes whole cache lines so two threads never write the same line
+struct ALIGN_CACHE thread_stats
+{
+	render_stats Stats;
+	char Pad[CACHE_LINE_SIZE - sizeof(render_stats) % CACHE_LINE_SIZE];
+};
+
+static thread_stats g_ThreadStats[STATS_MAX_THREADS];
+static volatile LONG g_StatsThreadCount = 0;
+static render_stats g_FrameStats;
+
+static THREAD_LOCAL render_stats *t_pStats = NULL;
+
+//threads above the limit share the last block, counts may be off
+//for them but nothing breaks
+static render_stats g_OverflowStats;
+
+render_stats *Stats_Local()
+{
+	if(!t_pStats)
+	{
+		LONG Slot = Atomic_Increment(&g_StatsThreadCount) - 1;
+		if(Slot < STATS_MAX_THREADS)
+			t_pStats = &g_ThreadStats[Slot].Stats;
+		else
+			t_pStats = &g_OverflowStats;
+	}
+
+	return t_pStats;
+}
+
+void Stats_Add(render_stats *pDest, const render_stats *pSrc)
+{
+	pDest->dwTrianglesIn += pSrc->dwTrianglesIn;
+	pDest->dwTrianglesCulled += pSrc->dwTrianglesCulled;
+	pDest->dwTrianglesClipped += pSrc->dwTrianglesClipped;
+	pDest->dwTrianglesRasterized += pSrc->dwTrianglesRasterized;
+	pDest->dwFragmentsGenerated += pSrc->dwFragmentsGenerated;
+	pDest->dwFragmentsDepthRejected += pSrc->dwFragmentsDepthRejected;
+	pDest->dwFragmentsWritten += pSrc->dwFragmentsWritten;
+	pDest->dwTexelFetches += pSrc->dwTexelFetches;
+	pDest->dwBytesCleared += pSrc->dwBytesCleared;
+	pDest->dwBytesPresented += pSrc->dwBytesPresented;
+	pDest->dwStateCalls += pSrc->dwStateCalls;
+	pDest->dwStatesFiltered += pSrc->dwStatesFiltered;
+	pDest->dwBatchDrawsIn += pSrc->dwBatchDrawsIn;
+	pDest->dwBatchesOut += pSrc->dwBatchesOut;
+	pDest->dwInstancesIn += pSrc->dwInstancesIn;
+	pDest->dwInstancesCulled += pSrc->dwInstancesCulled;
+	pDest->dwVerticesProcessed += pSrc->dwVerticesProcessed;
+	pDest->dwVerticesReused += pSrc->dwVerticesReused;
+	pDest->dwVerticesTransformed += pSrc->dwVerticesTransformed;
+	pDest->dwVertexCacheHits += pSrc->dwVertexCacheHits;
+	pDest->dwPresentWaitUs += pSrc->dwPresentWaitUs;
+}
+
+void Stats_End_Frame()
+{
+	render_stats Frame;
+	ZeroMemory(&Frame, sizeof(render_stats));
+
+	LONG Count = g_StatsThreadCount;
+	if(Count > STATS_MAX_THREADS)
+		Count = STATS_MAX_THREADS;
+
+	for(LONG i = 0; i < Count; i++)
+	{
+		Stats_Add(&Frame, &g_ThreadStats[i].Stats);
+		ZeroMemory(&g_ThreadStats[i].Stats, sizeof(render_stats));
+	}
+
+	Stats_Add(&Frame, &g_OverflowStats);
+	ZeroMemory(&g_OverflowStats, sizeof(render_stats));
+
+	g_FrameStats = Frame;
+}
+
+const render_stats *Stats_Get_Frame()
+{
+	return &g_FrameStats;
+}
+
+int Stats_Format(const render_stats *pStats, DWORD dwScreenPixels, char *szLines[], int MaxLines, int LineLen)
+{
+	float fOverdraw = dwScreenPixels ? (float)pStats->dwFragmentsWritten / (float)dwScreenPixels : 0.0f;
+
+	char szText[6][128];
+
+	sprintf(szText[0], "tris in %u  culled %u  clipped %u  rasterized %u",
+		(unsigned)pStats->dwTrianglesIn, (unsigned)pStats->dwTrianglesCulled,
+		(unsigned)pStats->dwTrianglesClipped, (unsigned)pStats->dwTrianglesRasterized);
+	sprintf(szText[1], "fragments %u  depth rejected %u  written %u",
+		(unsigned)pStats->dwFragmentsGenerated, (unsigned)pStats->dwFragmentsDepthRejected,
+		(unsigned)pStats->dwFragmentsWritten);
+	sprintf(szText[2], "overdraw %.2f  texel fetches %u",
+		fOverdraw, (unsigned)pStats->dwTexelFetches);
+	sprintf(szText[3], "cleared %u KB  presented %u KB  present wait %u us",
+		(unsigned)(pStats->dwBytesCleared / 1024), (unsigned)(pStats->dwBytesPresented / 1024),
+		(unsigned)pStats->dwPresentWaitUs);
+	sprintf(szText[4], "state calls %u  filtered %u",
+		(unsigned)pStats->dwStateCalls, (unsigned)pStats->dwStatesFiltered);
+	sprintf(szText[5], "draws in %u  batches out %u  instances %u  culled %u",
+		(unsigned)pStats->dwBatchDrawsIn, (unsigned)pStats->dwBatchesOut,
+		(unsigned)pStats->dwInstancesIn, (unsigned)pStats->dwInstancesCulled);
+
+	int Count = 6;
+	if(Count > MaxLines)
+		Count = MaxLines;
+
+	for(int i = 0; i < Count; i++)
+	{
+		strncpy(szLines[i], szText[i], LineLen - 1);
+		szLines[i][LineLen - 1] = 0;
+	}
+
+	return Count;
+}
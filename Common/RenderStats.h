@@ -0,0 +1,65 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _RENDERSTATS_H_
+#define _RENDERSTATS_H_
+
+#include "Platform.h"
+
+//per frame counters of the software device.
+//every thread counts into its own block (no locks, no shared cache
+//lines), Stats_End_Frame() adds the blocks together once per frame
+
+struct render_stats
+{
+	DWORD dwTrianglesIn;
+	DWORD dwTrianglesCulled;
+	DWORD dwTrianglesClipped;
+	DWORD dwTrianglesRasterized;
+
+	DWORD dwFragmentsGenerated;
+	DWORD dwFragmentsDepthRejected;
+	DWORD dwFragmentsWritten;
+	DWORD dwTexelFetches;
+
+	DWORD dwBytesCleared;
+	DWORD dwBytesPresented;
+
+	DWORD dwStateCalls;			//state calls made to the filter (FilterDevice.h)
+	DWORD dwStatesFiltered;		//of them dropped because nothing changed
+
+	DWORD dwBatchDrawsIn;		//draws made to the batcher (BatchDevice.h)
+	DWORD dwBatchesOut;			//draws the batcher made to the device
+
+	DWORD dwInstancesIn;		//copies given to Instancer_Draw() (Instancer.h)
+	DWORD dwInstancesCulled;	//of them outside the view frustum
+
+	DWORD dwVerticesProcessed;	//transformed by Vertex_Buffer_Process() (VertexBuffer.h)
+	DWORD dwVerticesReused;		//still valid from a call before
+
+	DWORD dwVerticesTransformed;	//by the draws of CSoftDevice
+	DWORD dwVertexCacheHits;		//found in its post transform cache instead
+
+	DWORD dwPresentWaitUs;		//microseconds in Presenter_Present() (Presenter.h)
+};
+
+#define STATS_MAX_THREADS 64
+
+//counters of the calling thread, the first call registers the thread
+render_stats *Stats_Local();
+
+void Stats_Add(render_stats *pDest, const render_stats *pSrc);
+
+//merge the thread blocks into the frame result and zero them,
+//call when the workers of the frame are finished
+void Stats_End_Frame();
+
+//counters of the last finished frame
+const render_stats *Stats_Get_Frame();
+
+//overlay text, one counter group per line.
+//dwScreenPixels is used for the overdraw ratio
+int Stats_Format(const render_stats *pStats, DWORD dwScreenPixels, char *szLines[], int MaxLines, int LineLen);
+
+#endif
@@ -0,0 +1,654 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <new>
+
+#include "Scenes.h"
+#include "Bitmap.h"
+
+static const scene_desc g_Scenes[] = {
+	{ "001-Textured_Tri_D3D3", SCENE_TRIANGLE | SCENE_LINEAR_FILTER, "texture256.bmp", -8.0f, 3.14f / 2.0f },
+	{ "002-Textured_Cube_D3D3", SCENE_LINEAR_FILTER, "texture24.bmp", -15.0f, 3.14f / 2.0f },
+	{ "003-Textured_Cube_SoftRend_D3D3", SCENE_SOFT_TRANSFORM | SCENE_LINEAR_FILTER, "texture24.bmp", -15.0f, PI / 2.0f },
+	{ "004-Textured_Cube_ZBuff_D3D3", SCENE_ZBUFFER | SCENE_CLEAR_ZBUFFER | SCENE_LINEAR_FILTER, "texture24.bmp", -15.0f, 3.14f / 2.0f },
+	{ "005-Textured_Cube_ZBuff_LockTex_D3D3", SCENE_ZBUFFER | SCENE_CLEAR_ZBUFFER | SCENE_TEX_LOCK | SCENE_LINEAR_FILTER, "texture24.bmp", -15.0f, 3.14f / 2.0f },
+	{ "006-Textured_Cube_ZBuff_LockTex8bit_D3D3", SCENE_ZBUFFER | SCENE_CLEAR_ZBUFFER | SCENE_TEX_LOCK | SCENE_LINEAR_FILTER, "texture8.bmp", -15.0f, 3.14f / 2.0f },
+	{ "007-Color_Cube_D3D3", SCENE_COLOR_CUBE | SCENE_LINEAR_FILTER, NULL, -15.0f, 3.14f / 2.0f },
+	{ "008-Textured_Cube_TexHandle_D3D2", SCENE_TEX_HANDLE, "texture24.bmp", -15.0f, 3.14f / 2.0f },
+	{ "009-Textured_Cube_TexHandle_ZBuff_D3D2", SCENE_ZBUFFER | SCENE_TEX_HANDLE, "texture24.bmp", -15.0f, 3.14f / 2.0f },
+	{ "010-Textured_Cube_SoftDevice", SCENE_ZBUFFER | SCENE_CLEAR_ZBUFFER | SCENE_LINEAR_FILTER, "texture24.bmp", -15.0f, 3.14f / 2.0f }
+};
+
+//same layout as D3DVERTEX
+struct scene_vertex
+{
+	float x, y, z;
+	float nx, ny, nz;
+	float tu, tv;
+};
+
+//same layout as D3DLVERTEX
+struct scene_lvertex
+{
+	float x, y, z;
+	DWORD dwReserved;
+	DWORD dwColor;
+	DWORD dwSpecular;
+	float tu, tv;
+};
+
+static scene_vertex g_TriVerts[3] = {
+	{ -5.0f, -5.0f, 0.0f,	0.0f, 0.0f, 0.0f,	0.0f, 1.0f },
+	{ -5.0f,  5.0f, 0.0f,	0.0f, 0.0f, 0.0f,	0.0f, 0.0f },
+	{  5.0f,  5.0f, 0.0f,	0.0f, 0.0f, 0.0f,	1.0f, 0.0f } };
+
+static scene_vertex g_CubeVerts[24] = {
+	{ -5.0f,-5.0f,-5.0f,	0.0f, 0.0f, 0.0f,	1.0f,1.0f },
+	{ -5.0f,-5.0f,5.0f,		0.0f, 0.0f, 0.0f,	1.0f,0.0f },
+	{ 5.0f,-5.0f,5.0f,		0.0f, 0.0f, 0.0f,	0.0f,0.0f },
+	{ 5.0f,-5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	0.0f,1.0f },
+	{ -5.0f,5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	0.0f,1.0f },
+	{ 5.0f,5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	1.0f,1.0f },
+	{ 5.0f,5.0f,5.0f,		0.0f, 0.0f, 0.0f,	1.0f,0.0f },
+	{ -5.0f,5.0f,5.0f,		0.0f, 0.0f, 0.0f,	0.0f,0.0f },
+	{ -5.0f,-5.0f,-5.0f,	0.0f, 0.0f, 0.0f,	0.0f,1.0f },
+	{ 5.0f,-5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	1.0f,1.0f },
+	{ 5.0f,5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	1.0f,0.0f },
+	{ -5.0f,5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	0.0f,0.0f },
+	{ 5.0f,-5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	0.0f,1.0f },
+	{ 5.0f,-5.0f,5.0f,		0.0f, 0.0f, 0.0f,	1.0f,1.0f },
+	{ 5.0f,5.0f,5.0f,		0.0f, 0.0f, 0.0f,	1.0f,0.0f },
+	{ 5.0f,5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	0.0f,0.0f },
+	{ 5.0f,-5.0f,5.0f,		0.0f, 0.0f, 0.0f,	0.0f,1.0f },
+	{ -5.0f,-5.0f,5.0f,		0.0f, 0.0f, 0.0f,	1.0f,1.0f },
+	{ -5.0f,5.0f,5.0f,		0.0f, 0.0f, 0.0f,	1.0f,0.0f },
+	{ 5.0f,5.0f,5.0f,		0.0f, 0.0f, 0.0f,	0.0f,0.0f },
+	{ -5.0f,-5.0f,5.0f,		0.0f, 0.0f, 0.0f,	0.0f,1.0f },
+	{ -5.0f,-5.0f,-5.0f,	0.0f, 0.0f, 0.0f,	1.0f,1.0f },
+	{ -5.0f,5.0f,-5.0f,		0.0f, 0.0f, 0.0f,	1.0f,0.0f },
+	{ -5.0f,5.0f,5.0f,		0.0f, 0.0f, 0.0f,	0.0f,0.0f } };
+
+static WORD g_CubeIndices[36] = {
+	0,2,1,		2,0,3,
+	4,6,5,		6,4,7,
+	8,10,9,		10,8,11,
+	12,14,13,	14,12,15,
+	16,18,17,	18,16,19,
+	20,22,21,	22,20,23 };
+
+enum { A, B, C, D, E, F, G, H };
+
+static scene_lvertex g_ColorVerts[8] = {
+	{ -5.0f, -5.0f, -5.0f, 0x0, 0xffffffff, 0x0, 0.0f, 0.0f },	// A
+	{  5.0f, -5.0f, -5.0f, 0x0, 0xff000000, 0x0, 0.0f, 0.0f },	// B
+	{ -5.0f,  5.0f, -5.0f, 0x0, 0xffff0000, 0x0, 0.0f, 0.0f },	// C
+	{  5.0f,  5.0f, -5.0f, 0x0, 0xff00ff00, 0x0, 0.0f, 0.0f },	// D
+	{ -5.0f, -5.0f,  5.0f, 0x0, 0xff0000ff, 0x0, 0.0f, 0.0f },	// E
+	{  5.0f, -5.0f,  5.0f, 0x0, 0xffffff00, 0x0, 0.0f, 0.0f },	// F
+	{ -5.0f,  5.0f,  5.0f, 0x0, 0xff00ffff, 0x0, 0.0f, 0.0f },	// G
+	{  5.0f,  5.0f,  5.0f, 0x0, 0xffff00ff, 0x0, 0.0f, 0.0f } };	// H
+
+static WORD g_ColorIndices[36] = {
+	A, C, D,	A, D, B,	//front
+	E, G, C,	E, C, A,	//left
+	G, E, F,	G, F, H,	//back
+	B, D, H,	B, H, F,	//right
+	C, G, H,	C, H, D,	//top
+	E, A, B,	E, B, F };	//bottom
+
+int Scene_Count()
+{
+	return sizeof(g_Scenes) / sizeof(g_Scenes[0]);
+}
+
+const scene_desc *Scene_Get(int Index)
+{
+	if(Index < 0 || Index >= Scene_Count())
+		return NULL;
+
+	return &g_Scenes[Index];
+}
+
+const scene_desc *Scene_Find(const char *szName)
+{
+	size_t Len = strlen(szName);
+
+	for(int i = 0; i < Scene_Count(); i++)
+	{
+		if(strncmp(g_Scenes[i].szName, szName, Len) == 0)
+			return &g_Scenes[i];
+	}
+
+	return NULL;
+}
+
+static soft_texture *Load_Texture(IRenderDevice *pDevice, const char *szFilename, bool bLock)
+{
+	bitmap Bmp;
+	if(!Bitmap_Load(szFilename, &Bmp))
+		return NULL;
+
+	soft_texture *pTexture = NULL;
+	if(SUCCEEDED(pDevice->CreateTexture(Bmp.dwWidth, Bmp.dwHeight, &pTexture)))
+	{
+		for(DWORD y = 0; y < Bmp.dwHeight; y++)
+		{
+			//Get_Texture() of 005 and 006 copies the rows of the DIB
+			//as they are, the last row of the image comes first
+			DWORD dwSrcRow = bLock ? Bmp.dwHeight - 1 - y : y;
+			memcpy(pTexture->pBits + y * Bmp.dwWidth, Bmp.pBits + dwSrcRow * Bmp.dwWidth,
+				Bmp.dwWidth * sizeof(DWORD));
+		}
+	}
+
+	Bitmap_Free(&Bmp);
+
+	return pTexture;
+}
+
+//light colors, so the texture can still be seen
+static DWORD Grid_Color(DWORD i)
+{
+	DWORD r = 160 + (i * 97) % 96;
+	DWORD g = 160 + (i * 57) % 96;
+	DWORD b = 160 + (i * 31) % 96;
+
+	return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+static HRESULT Init_Instancer(scene *pScene, int Threads)
+{
+	DWORD dwFlags = pScene->pDesc->dwFlags;
+
+	instance_mesh Mesh;
+	Mesh.pIndices = g_CubeIndices;
+	Mesh.dwIndexCount = 36;
+
+	if(dwFlags & SCENE_COLOR_CUBE)
+	{
+		Mesh.dwFVF = SRFVF_LVERTEX;
+		Mesh.pVertices = g_ColorVerts;
+		Mesh.dwVertexCount = 8;
+		Mesh.pIndices = g_ColorIndices;
+	}
+	else
+	{
+		Mesh.dwFVF = SRFVF_VERTEX;
+		Mesh.pVertices = g_CubeVerts;
+		Mesh.dwVertexCount = 24;
+	}
+
+	pScene->pJobs = Job_Pool_Create(Threads);
+	pScene->pColors = new(std::nothrow) DWORD[pScene->dwObjects];
+	if(!pScene->pJobs || !pScene->pColors)
+		return E_OUTOFMEMORY;
+
+	pScene->pInstancer = Instancer_Create(&Mesh, pScene->pJobs);
+	if(!pScene->pInstancer)
+		return E_OUTOFMEMORY;
+
+	for(DWORD i = 0; i < pScene->dwObjects; i++)
+		pScene->pColors[i] = Grid_Color(i);
+
+	return S_OK;
+}
+
+//the mesh file is mapped, its bounding sphere is moved to the middle of
+//the cube and scaled to the sphere of the cube. A file MeshConv did not
+//optimize is put in the order of MeshOptimize.h here, unless bKeepOrder
+static HRESULT Init_Mesh(scene *pScene, const char *szMesh, bool bKeepOrder)
+{
+	if(pScene->pDesc->dwFlags & (SCENE_TRIANGLE | SCENE_COLOR_CUBE | SCENE_SOFT_TRANSFORM))
+		return E_INVALIDARG;
+
+	pScene->pMesh = new(std::nothrow) mesh;
+	if(!pScene->pMesh)
+		return E_OUTOFMEMORY;
+
+	HRESULT hr = Mesh_Open(pScene->pMesh, szMesh);
+	if(SUCCEEDED(hr) && !bKeepOrder && !(pScene->pMesh->pHeader->dwFlags & MESH_OPTIMIZED))
+	{
+		hr = Mesh_Reorder(pScene->pMesh);
+		if(FAILED(hr))
+			Mesh_Close(pScene->pMesh);
+	}
+
+	if(FAILED(hr))
+	{
+		delete pScene->pMesh;
+		pScene->pMesh = NULL;
+		return hr;
+	}
+
+	const mesh_header *pHeader = pScene->pMesh->pHeader;
+	pScene->MeshScale = pHeader->fRadius > 0.0f ? 5.0f * sqrtf(3.0f) / pHeader->fRadius : 1.0f;
+
+	return S_OK;
+}
+
+//the world matrix of the mesh, scaled and moved before MatWorld
+static matrix4x4 Mesh_World(const scene *pScene, const matrix4x4 &MatWorld)
+{
+	const vector3 &Center = pScene->pMesh->pHeader->Center;
+	float Scale = pScene->MeshScale;
+
+	matrix4x4 MatMesh = Mat4x4_Identity();
+	MatMesh.Mat[M00] = Scale;
+	MatMesh.Mat[M11] = Scale;
+	MatMesh.Mat[M22] = Scale;
+	MatMesh.Mat[M30] = -Center.x * Scale;
+	MatMesh.Mat[M31] = -Center.y * Scale;
+	MatMesh.Mat[M32] = -Center.z * Scale;
+
+	return Mat4x4_Mul(MatMesh, MatWorld);
+}
+
+HRESULT Scene_Init(scene *pScene, const scene_desc *pDesc, DWORD dwWidth, DWORD dwHeight,
+				const char *szRootDir, const scene_options *pOptions)
+{
+	scene_options Options;
+	ZeroMemory(&Options, sizeof(scene_options));
+	if(pOptions)
+		Options = *pOptions;
+
+	ZeroMemory(pScene, sizeof(scene));
+	pScene->pDesc = pDesc;
+	pScene->dwObjects = Options.dwObjects ? Options.dwObjects : 1;
+	pScene->bDirty = Options.bDirty;
+	pScene->bPresentAll = true;
+	Dirty_Init(&pScene->Dirty, dwWidth, dwHeight, DIRTY_MAX_PERCENT);
+
+	HRESULT hr = Create_Soft_Device(dwWidth, dwHeight, (pDesc->dwFlags & SCENE_ZBUFFER) != 0, &pScene->pDevice);
+	if(FAILED(hr))
+		return hr;
+
+	pScene->pDraw = pScene->pDevice;
+
+	if(Options.szTrace)
+	{
+		hr = Create_Record_Device(pScene->pDevice, Options.szTrace, &pScene->pRecorder);
+		if(FAILED(hr))
+		{
+			Scene_Release(pScene);
+			return hr;
+		}
+
+		pScene->pDraw = pScene->pRecorder;
+	}
+
+	if(Options.bBatch)
+	{
+		hr = Create_Batch_Device(pScene->pDraw, BATCH_WORLD, &pScene->pBatch);
+		if(FAILED(hr))
+		{
+			Scene_Release(pScene);
+			return hr;
+		}
+
+		pScene->pDraw = pScene->pBatch;
+	}
+
+	if(Options.bFilter)
+	{
+		hr = Create_Filter_Device(pScene->pDraw, &pScene->pFilter);
+		if(FAILED(hr))
+		{
+			Scene_Release(pScene);
+			return hr;
+		}
+
+		pScene->pDraw = pScene->pFilter;
+	}
+
+	IRenderDevice *pDevice = pScene->pDraw;
+
+	if(pDesc->szTexture)
+	{
+		//a root too long for the path is refused, not cut off
+		char szPath[512];
+		if(strlen(szRootDir) + strlen(pDesc->szName) + strlen(pDesc->szTexture) + 10 > sizeof(szPath))
+		{
+			Scene_Release(pScene);
+			return E_INVALIDARG;
+		}
+
+		sprintf(szPath, "%s/%s/Sample/%s", szRootDir, pDesc->szName, pDesc->szTexture);
+
+		pScene->pTexture = Load_Texture(pDevice, szPath, (pDesc->dwFlags & SCENE_TEX_LOCK) != 0);
+		if(!pScene->pTexture)
+		{
+			Scene_Release(pScene);
+			return E_FAIL;
+		}
+
+		pScene->dwTexHandle = pDevice->GetTextureHandle(pScene->pTexture);
+	}
+
+	vector3 VecCamPos = { 0.0f, 0.0f, pDesc->fCamZ };
+	matrix4x4 MatView = Mat4x4_View(VecCamPos);
+	matrix4x4 MatProj = Mat4x4_Projection(pDesc->fFov, (float)dwWidth / (float)dwHeight, 1.0f, 100.0f);
+	matrix4x4 MatWorld = Mat4x4_Identity();
+
+	pDevice->SetTransform(SRTS_WORLD, &MatWorld);
+	pDevice->SetTransform(SRTS_VIEW, &MatView);
+	pDevice->SetTransform(SRTS_PROJECTION, &MatProj);
+
+	if(pDesc->dwFlags & SCENE_SOFT_TRANSFORM)
+	{
+		pScene->pCubeVB = Vertex_Buffer_Create(SRFVF_VERTEX, 24);
+		pScene->pTLVB = Vertex_Buffer_Create(SRFVF_XYZRHW | SRFVF_TEX1, 24);
+		if(!pScene->pCubeVB || !pScene->pTLVB)
+		{
+			Scene_Release(pScene);
+			return E_OUTOFMEMORY;
+		}
+
+		memcpy(Vertex_Buffer_Lock(pScene->pCubeVB, 0, 24), g_CubeVerts, sizeof(g_CubeVerts));
+	}
+
+	if(Options.szMesh)
+	{
+		hr = Init_Mesh(pScene, Options.szMesh, Options.bKeepOrder);
+		if(FAILED(hr))
+		{
+			Scene_Release(pScene);
+			return hr;
+		}
+	}
+
+	if(Options.bInstance && pScene->dwObjects > 1 && !pScene->pMesh &&
+		!(pDesc->dwFlags & (SCENE_TRIANGLE | SCENE_SOFT_TRANSFORM)))
+	{
+		hr = Init_Instancer(pScene, Options.Threads);
+		if(FAILED(hr))
+		{
+			Scene_Release(pScene);
+			return hr;
+		}
+	}
+
+	hr = Scene_Frame_Init(pScene, &pScene->Frame);
+	if(FAILED(hr))
+	{
+		Scene_Release(pScene);
+		return hr;
+	}
+
+	//every state of the pixel pipeline is in the block, the software
+	//device switches to its pipeline without looking at the states
+	DWORD dwFilter = (pDesc->dwFlags & SCENE_LINEAR_FILTER) ? SRTF_LINEAR : SRTF_POINT;
+
+	State_Block_Init(&pScene->States);
+	State_Block_Render(&pScene->States, SRRS_CULLMODE, SRCULL_CCW);
+	State_Block_Render(&pScene->States, SRRS_TEXTUREPERSPECTIVE, TRUE);
+	State_Block_Render(&pScene->States, SRRS_ZENABLE, (pDesc->dwFlags & SCENE_ZBUFFER) ? TRUE : FALSE);
+	State_Block_Render(&pScene->States, SRRS_ZWRITEENABLE, TRUE);
+	State_Block_Render(&pScene->States, SRRS_ZFUNC, SRCMP_LESSEQUAL);
+	State_Block_Stage(&pScene->States, 0, SRTSS_COLOROP, SRTOP_MODULATE);
+	State_Block_Stage(&pScene->States, 0, SRTSS_MINFILTER, dwFilter);
+	State_Block_Stage(&pScene->States, 0, SRTSS_MAGFILTER, dwFilter);
+
+	return S_OK;
+}
+
+//Update_Scene() of 003
+static void Soft_Transform(scene *pScene, const matrix4x4 &MatWorld)
+{
+	vector3 VecCamPos = { 0.0f, 0.0f, pScene->pDesc->fCamZ };
+	DWORD dwWidth = pScene->pDevice->GetWidth();
+	DWORD dwHeight = pScene->pDevice->GetHeight();
+
+	matrix4x4 MatWVP = Mat4x4_Mul(Mat4x4_Mul(MatWorld, Mat4x4_View(VecCamPos)),
+		Mat4x4_Projection(pScene->pDesc->fFov, (float)dwWidth / (float)dwHeight, 1.0f, 100.0f));
+
+	vb_viewport Viewport = { 0, 0, dwWidth, dwHeight };
+	Vertex_Buffer_Process(pScene->pTLVB, 0, 24, pScene->pCubeVB, 0, &MatWVP, &Viewport);
+}
+
+//object i of a grid of dwCount cubes that fills the view at z = 0
+static matrix4x4 Grid_World(DWORD i, DWORD dwCount, float Angle)
+{
+	DWORD dwSide = 1;
+	while(dwSide * dwSide < dwCount)
+		dwSide++;
+
+	float Cell = 30.0f / (float)dwSide;
+	float Scale = Cell * 0.06f;
+
+	matrix4x4 MatWorld = Mat4x4_Rotation_Y(Angle + (float)i * 0.37f);
+	for(int m = M00; m <= M23; m++)
+		MatWorld.Mat[m] *= Scale;
+
+	MatWorld.Mat[M30] = -15.0f + Cell * ((float)(i % dwSide) + 0.5f);
+	MatWorld.Mat[M31] = 15.0f - Cell * ((float)(i / dwSide) + 0.5f);
+
+	return MatWorld;
+}
+
+//the objects are drawn in a grid, not only one cube
+static bool Is_Grid(const scene *pScene)
+{
+	return pScene->dwObjects > 1 && !(pScene->pDesc->dwFlags & (SCENE_TRIANGLE | SCENE_SOFT_TRANSFORM));
+}
+
+struct grid_job
+{
+	matrix4x4 *pWorlds;
+	DWORD dwObjects;
+	float Angle;
+};
+
+static void Grid_Job(void *pParam, DWORD dwFirst, DWORD dwCount)
+{
+	grid_job *pJob = (grid_job *)pParam;
+
+	for(DWORD i = dwFirst; i < dwFirst + dwCount; i++)
+		pJob->pWorlds[i] = Grid_World(i, pJob->dwObjects, pJob->Angle);
+}
+
+static void Draw_Object(scene *pScene)
+{
+	IRenderDevice *pDevice = pScene->pDraw;
+	DWORD dwFlags = pScene->pDesc->dwFlags;
+
+	//straight on CSoftDevice 32 bit indices are drawn as they are
+	if(pScene->pMesh && pDevice == pScene->pDevice)
+		Mesh_Draw_Soft(pScene->pDevice, pScene->pMesh);
+	else if(pScene->pMesh)
+		Mesh_Draw(pDevice, pScene->pMesh);
+	else if(dwFlags & SCENE_TRIANGLE)
+		pDevice->DrawPrimitive(SRPT_TRIANGLELIST, SRFVF_VERTEX, g_TriVerts, 3, 0);
+	else if(dwFlags & SCENE_COLOR_CUBE)
+		pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, SRFVF_LVERTEX, g_ColorVerts, 8, g_ColorIndices, 36, 0);
+	else if(dwFlags & SCENE_SOFT_TRANSFORM)
+		pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, Vertex_Buffer_FVF(pScene->pTLVB),
+			Vertex_Buffer_Data(pScene->pTLVB), 24, g_CubeIndices, 36, 0);
+	else if(dwFlags & SCENE_TEX_HANDLE)
+		pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, Soft_VT_To_FVF(SRVT_VERTEX), g_CubeVerts, 24, g_CubeIndices, 36, 0);
+	else
+		pDevice->DrawIndexedPrimitive(SRPT_TRIANGLELIST, SRFVF_VERTEX, g_CubeVerts, 24, g_CubeIndices, 36, 0);
+}
+
+HRESULT Scene_Frame_Init(const scene *pScene, scene_frame *pFrame)
+{
+	pFrame->Angle = 0.0f;
+	pFrame->pWorlds = NULL;
+
+	if(Is_Grid(pScene))
+	{
+		pFrame->pWorlds = new(std::nothrow) matrix4x4[pScene->dwObjects];
+		if(!pFrame->pWorlds)
+			return E_OUTOFMEMORY;
+	}
+
+	return S_OK;
+}
+
+void Scene_Frame_Release(scene_frame *pFrame)
+{
+	delete[] pFrame->pWorlds;
+	pFrame->pWorlds = NULL;
+}
+
+void Scene_Simulate(const scene *pScene, scene_frame *pFrame, float Angle, job_pool *pPool)
+{
+	pFrame->Angle = Angle;
+
+	if(!pFrame->pWorlds)
+		return;
+
+	grid_job Job = { pFrame->pWorlds, pScene->dwObjects, Angle };
+
+	if(pPool)
+		Job_Pool_Run(pPool, Grid_Job, &Job, pScene->dwObjects, 1024);
+	else
+		Grid_Job(&Job, 0, pScene->dwObjects);
+}
+
+void Scene_Draw(scene *pScene, const scene_frame *pFrame)
+{
+	IRenderDevice *pDevice = pScene->pDraw;
+	DWORD dwFlags = pScene->pDesc->dwFlags;
+
+	if(!(dwFlags & SCENE_TRIANGLE) && !pFrame->pWorlds)
+	{
+		matrix4x4 MatWorld = Mat4x4_Rotation_Y(pFrame->Angle);
+		if(pScene->pMesh)
+			MatWorld = Mesh_World(pScene, MatWorld);
+
+		if(dwFlags & SCENE_SOFT_TRANSFORM)
+			Soft_Transform(pScene, MatWorld);
+		else
+			pDevice->SetTransform(SRTS_WORLD, &MatWorld);
+	}
+
+	DWORD dwClear = SRCLEAR_TARGET;
+	if(dwFlags & SCENE_CLEAR_ZBUFFER)
+		dwClear |= SRCLEAR_ZBUFFER;
+
+	RECT RcClear;
+	if(pScene->bDirty && Dirty_Clear_Rect(&pScene->Dirty, &RcClear))
+		pDevice->Clear(1, &RcClear, dwClear, 0x00ffffff, 1.0f);
+	else
+		pDevice->Clear(0, NULL, dwClear, 0x00ffffff, 1.0f);
+
+	if(FAILED(pDevice->BeginScene()))
+		return;
+
+	pDevice->ApplyStateBlock(&pScene->States);
+
+	if(dwFlags & SCENE_TEX_HANDLE)
+		pDevice->SetRenderState(SRRS_TEXTUREHANDLE, pScene->dwTexHandle);
+	else
+		pDevice->SetTexture(0, pScene->pTexture);
+
+	if(pScene->pInstancer)
+	{
+		//the camera of Scene_Init(), for the culling
+		vector3 VecCamPos = { 0.0f, 0.0f, pScene->pDesc->fCamZ };
+		float fAspect = (float)pScene->pDevice->GetWidth() / (float)pScene->pDevice->GetHeight();
+		matrix4x4 MatViewProj = Mat4x4_Mul(Mat4x4_View(VecCamPos),
+			Mat4x4_Projection(pScene->pDesc->fFov, fAspect, 1.0f, 100.0f));
+
+		Instancer_Draw(pScene->pInstancer, pDevice, &MatViewProj,
+			pFrame->pWorlds, pScene->pColors, pScene->dwObjects);
+	}
+	else if(pFrame->pWorlds)
+	{
+		for(DWORD i = 0; i < pScene->dwObjects; i++)
+		{
+			if(pScene->pMesh)
+			{
+				matrix4x4 MatWorld = Mesh_World(pScene, pFrame->pWorlds[i]);
+				pDevice->SetTransform(SRTS_WORLD, &MatWorld);
+			}
+			else
+			{
+				pDevice->SetTransform(SRTS_WORLD, &pFrame->pWorlds[i]);
+			}
+
+			Draw_Object(pScene);
+		}
+	}
+	else
+	{
+		Draw_Object(pScene);
+	}
+
+	pDevice->EndScene();
+
+	//the batcher drew the rest in EndScene(), the bounds are complete now
+	if(pScene->bDirty)
+	{
+		RECT RcDrawn;
+		pScene->pDevice->GetDrawnRect(&RcDrawn);
+		pScene->bPresentAll = !Dirty_End_Frame(&pScene->Dirty, &RcDrawn, &pScene->RcPresent);
+	}
+}
+
+void Scene_Render(scene *pScene, float Angle)
+{
+	//the matrices are made on the threads of the instancer too
+	Scene_Simulate(pScene, &pScene->Frame, Angle, pScene->pJobs);
+	Scene_Draw(pScene, &pScene->Frame);
+}
+
+void Scene_Release(scene *pScene)
+{
+	Instancer_Destroy(pScene->pInstancer);
+	pScene->pInstancer = NULL;
+
+	if(pScene->pJobs)
+	{
+		Job_Pool_Destroy(pScene->pJobs);
+		pScene->pJobs = NULL;
+	}
+
+	Scene_Frame_Release(&pScene->Frame);
+	delete[] pScene->pColors;
+	pScene->pColors = NULL;
+
+	if(pScene->pMesh)
+	{
+		Mesh_Close(pScene->pMesh);
+		delete pScene->pMesh;
+		pScene->pMesh = NULL;
+	}
+
+	Vertex_Buffer_Destroy(pScene->pCubeVB);
+	pScene->pCubeVB = NULL;
+	Vertex_Buffer_Destroy(pScene->pTLVB);
+	pScene->pTLVB = NULL;
+
+	if(pScene->pFilter)
+	{
+		pScene->pFilter->Release();
+		pScene->pFilter = NULL;
+	}
+
+	if(pScene->pBatch)
+	{
+		pScene->pBatch->Release();
+		pScene->pBatch = NULL;
+	}
+
+	if(pScene->pRecorder)
+	{
+		pScene->pRecorder->Release();
+		pScene->pRecorder = NULL;
+	}
+
+	pScene->pDraw = NULL;
+
+	if(pScene->pDevice)
+	{
+		pScene->pDevice->Release();
+		pScene->pDevice = NULL;
+	}
+
+	pScene->pTexture = NULL;
+}
@@ -0,0 +1,115 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _SCENES_H_
+#define _SCENES_H_
+
+#include "Platform.h"
+#include "SoftDevice.h"
+#include "DrawTrace.h"
+#include "FilterDevice.h"
+#include "BatchDevice.h"
+#include "Instancer.h"
+#include "VertexBuffer.h"
+#include "DirtyRect.h"
+#include "Mesh.h"
+
+//the scenes of the samples described by flags, Scene_Render() does what
+//Update_Scene() and Render_Scene() of the sample do, but draws through
+//CSoftDevice, so tools can run any sample without a window
+
+#define SCENE_TRIANGLE			0x0001	//001: one triangle, DrawPrimitive(), no rotation
+#define SCENE_COLOR_CUBE		0x0002	//007: 8 lit vertices with colors, no texture
+#define SCENE_SOFT_TRANSFORM	0x0004	//003: vertices transformed on the CPU, XYZRHW
+#define SCENE_ZBUFFER			0x0008	//device has a Z buffer, Z test is on
+#define SCENE_CLEAR_ZBUFFER		0x0010	//009 has a Z buffer but never clears it
+#define SCENE_TEX_LOCK			0x0020	//005, 006: BMP rows copied with Lock(), image is upside down
+#define SCENE_TEX_HANDLE		0x0040	//008, 009: Direct3D2, texture handle and D3DVT_VERTEX
+#define SCENE_LINEAR_FILTER		0x0080	//bilinear min and mag filter
+
+struct scene_desc
+{
+	const char *szName;		//directory of the sample
+	DWORD dwFlags;
+	const char *szTexture;	//NULL for no texture
+	float fCamZ;
+	float fFov;
+};
+
+//what changes from frame to frame: Scene_Simulate() makes it, Scene_Draw()
+//draws it. The scene has one for Scene_Render(), a pipeline can use more
+//and simulate the next frame while the last one is drawn (FramePipeline.h)
+struct scene_frame
+{
+	float Angle;
+	matrix4x4 *pWorlds;		//world matrix of every object of the grid, NULL without the grid
+};
+
+struct scene
+{
+	const scene_desc *pDesc;
+	CSoftDevice *pDevice;
+	CRecordDevice *pRecorder;	//NULL when the scene is not recorded
+	CFilterDevice *pFilter;		//NULL when redundant state calls are not filtered
+	CBatchDevice *pBatch;		//NULL when draws are not batched
+	IRenderDevice *pDraw;		//the first of filter, batcher, recorder, pDevice, the scene draws with it
+	DWORD dwObjects;
+	job_pool *pJobs;			//threads of the instancer
+	instancer *pInstancer;		//NULL when the objects are drawn one by one
+	DWORD *pColors;				//color of every object for the instancer
+	soft_texture *pTexture;
+	DWORD dwTexHandle;
+	state_block States;		//cull mode, perspective, filters and Z of the sample
+	vertex_buffer *pCubeVB;	//SCENE_SOFT_TRANSFORM: the cube and its XYZRHW copy, made
+	vertex_buffer *pTLVB;	//again only when the matrix or the viewport change
+	scene_frame Frame;		//the frame of Scene_Render()
+	bool bDirty;			//clears only what the frame before drew
+	dirty_rect Dirty;
+	RECT RcPresent;			//part of the frame that changed,
+	bool bPresentAll;		//or the whole frame, after Scene_Draw()
+	mesh *pMesh;			//drawn instead of the cube, NULL for the cube
+	float MeshScale;		//scales the mesh to the size of the cube
+};
+
+//how the scene is drawn, NULL for one object drawn straight on CSoftDevice
+struct scene_options
+{
+	const char *szTrace;	//records all device calls into this file (DrawTrace.h)
+	bool bFilter;			//drops the state calls that change nothing (FilterDevice.h)
+	bool bBatch;			//draws go through CBatchDevice with BATCH_WORLD
+	DWORD dwObjects;		//cubes in a grid, each with its own world matrix
+	bool bInstance;			//the grid is drawn with Instancer_Draw(), each cube gets a color
+	int Threads;			//threads of the instancer, 0 for one per CPU
+	bool bDirty;			//clear and present only the changed part (DirtyRect.h), the
+							//screen presented into has to keep the frames before
+	const char *szMesh;		//mesh file (Mesh.h) drawn instead of the cube, by the scenes
+							//with the transform in the device and a texture
+	bool bKeepOrder;		//a mesh file MeshConv did not optimize is not reordered on load
+};
+
+int Scene_Count();
+const scene_desc *Scene_Get(int Index);
+//"004" or the whole directory name
+const scene_desc *Scene_Find(const char *szName);
+
+//creates the device and the texture and sets the states of Init_Scene(),
+//the texture is read from szRootDir/<sample>/Sample/<texture>.
+//the calls go through filter, batcher and recorder in this order, so the
+//trace has what reaches the device
+HRESULT Scene_Init(scene *pScene, const scene_desc *pDesc, DWORD dwWidth, DWORD dwHeight,
+				const char *szRootDir, const scene_options *pOptions = NULL);
+//one frame with the cube turned by Angle around Y, more objects are
+//drawn only by the scenes with the transformation in the device
+void Scene_Render(scene *pScene, float Angle);
+
+//Scene_Render() in two steps. Scene_Simulate() only writes pFrame and
+//may run on another thread while Scene_Draw() draws a different frame,
+//the grid matrices are made on pPool, NULL makes them on the calling thread
+HRESULT Scene_Frame_Init(const scene *pScene, scene_frame *pFrame);
+void Scene_Frame_Release(scene_frame *pFrame);
+void Scene_Simulate(const scene *pScene, scene_frame *pFrame, float Angle, job_pool *pPool);
+void Scene_Draw(scene *pScene, const scene_frame *pFrame);
+void Scene_Release(scene *pScene);
+
+#endif
@@ -0,0 +1,1597 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <math.h>
+#include <string.h>
+#include <new>
+
+#include "SoftDevice.h"
+#include "RenderStats.h"
+#include "FrameArena.h"
+
+//clip codes, the guard band is the area outside the viewport where
+//triangles are not clipped, the scanline loop just skips the pixels
+#define CLIP_LEFT	0x01
+#define CLIP_RIGHT	0x02
+#define CLIP_BOTTOM	0x04
+#define CLIP_TOP	0x08
+#define CLIP_NEAR	0x10
+#define CLIP_FAR	0x20
+#define CLIP_FRUSTUM (CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP | CLIP_NEAR | CLIP_FAR)
+
+#define CLIP_GUARD_LEFT		0x100
+#define CLIP_GUARD_RIGHT	0x200
+#define CLIP_GUARD_BOTTOM	0x400
+#define CLIP_GUARD_TOP		0x800
+#define CLIP_NEED (CLIP_NEAR | CLIP_FAR | CLIP_GUARD_LEFT | CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP)
+
+#define GUARD_BAND 8.0f
+
+//one plane can add one vertex to the polygon
+#define MAX_CLIP_VERTS (3 + 6)
+
+DWORD Soft_VT_To_FVF(DWORD dwVertexType)
+{
+	switch(dwVertexType)
+	{
+		case SRVT_VERTEX: return SRFVF_VERTEX;
+		case SRVT_LVERTEX: return SRFVF_LVERTEX;
+		case SRVT_TLVERTEX: return SRFVF_TLVERTEX;
+	}
+
+	return 0;
+}
+
+DWORD Soft_FVF_Stride(DWORD dwFVF)
+{
+	DWORD dwStride = (dwFVF & SRFVF_XYZRHW) ? 16 : 12;
+
+	if(dwFVF & SRFVF_NORMAL) dwStride += 12;
+	if(dwFVF & SRFVF_RESERVED1) dwStride += 4;
+	if(dwFVF & SRFVF_DIFFUSE) dwStride += 4;
+	if(dwFVF & SRFVF_SPECULAR) dwStride += 4;
+
+	dwStride += ((dwFVF & SRFVF_TEXCOUNT_MASK) >> SRFVF_TEXCOUNT_SHIFT) * 8;
+
+	return dwStride;
+}
+
+static inline int Fast_Floor(float f)
+{
+	int i = (int)f;
+	return i - (f < (float)i);
+}
+
+static inline int Fast_Ceil(float f)
+{
+	int i = (int)f;
+	return i + (f > (float)i);
+}
+
+//color channel interpolated in 0..255
+static inline DWORD Clamp_Channel(float f)
+{
+	int i = (int)(f + 0.5f);
+	if(i < 0) i = 0;
+	if(i > 255) i = 255;
+	return (DWORD)i;
+}
+
+static inline DWORD Modulate(DWORD dwA, DWORD dwB)
+{
+	DWORD r = ((((dwA >> 16) & 0xff) * ((dwB >> 16) & 0xff)) + 255) >> 8;
+	DWORD g = ((((dwA >> 8) & 0xff) * ((dwB >> 8) & 0xff)) + 255) >> 8;
+	DWORD b = (((dwA & 0xff) * (dwB & 0xff)) + 255) >> 8;
+	return (r << 16) | (g << 8) | b;
+}
+
+static inline DWORD Lerp_Texel(DWORD dwA, DWORD dwB, DWORD dwFrac)
+{
+	//dwFrac 0..256, red and blue are blended in one multiply
+	DWORD rb = dwA & 0xff00ff;
+	DWORD g = dwA & 0x00ff00;
+	rb = (rb + ((((dwB & 0xff00ff) - rb) * dwFrac) >> 8)) & 0xff00ff;
+	g = (g + ((((dwB & 0x00ff00) - g) * dwFrac) >> 8)) & 0x00ff00;
+	return rb | g;
+}
+
+//overdraw view gives every write count up to 6 its own color
+#define RAMP_KEYS 7
+#define OVERDRAW_MAX (RAMP_KEYS - 1)
+
+static void Build_Ramp(DWORD *pRamp)
+{
+	static const DWORD Keys[RAMP_KEYS] = { 0x000000, 0x0000ff, 0x00ffff,
+		0x00ff00, 0xffff00, 0xff0000, 0xffffff };
+
+	for(int i = 0; i < 256; i++)
+	{
+		int Segment = i * (RAMP_KEYS - 1) / 256;
+		DWORD dwFrac = (DWORD)((i * (RAMP_KEYS - 1) * 256 / 255) - Segment * 256);
+		if(dwFrac > 256)
+			dwFrac = 256;
+
+		pRamp[i] = Lerp_Texel(Keys[Segment], Keys[Segment + 1], dwFrac);
+	}
+}
+
+static bool Z_Test(DWORD dwFunc, float fZ, float fZBuf)
+{
+	switch(dwFunc)
+	{
+		case SRCMP_NEVER: return false;
+		case SRCMP_LESS: return fZ < fZBuf;
+		case SRCMP_EQUAL: return fZ == fZBuf;
+		case SRCMP_LESSEQUAL: return fZ <= fZBuf;
+		case SRCMP_GREATER: return fZ > fZBuf;
+		case SRCMP_NOTEQUAL: return fZ != fZBuf;
+		case SRCMP_GREATEREQUAL: return fZ >= fZBuf;
+	}
+
+	return true;
+}
+
+static DWORD Compute_Clip(const soft_vertex *pVert)
+{
+	DWORD dwClip = 0;
+	float w = pVert->w;
+	float g = pVert->w * GUARD_BAND;
+
+	if(pVert->x < -w) dwClip |= CLIP_LEFT;
+	if(pVert->x > w) dwClip |= CLIP_RIGHT;
+	if(pVert->y < -w) dwClip |= CLIP_BOTTOM;
+	if(pVert->y > w) dwClip |= CLIP_TOP;
+	if(pVert->z < 0.0f) dwClip |= CLIP_NEAR;
+	if(pVert->z > w) dwClip |= CLIP_FAR;
+
+	if(pVert->x < -g) dwClip |= CLIP_GUARD_LEFT;
+	if(pVert->x > g) dwClip |= CLIP_GUARD_RIGHT;
+	if(pVert->y < -g) dwClip |= CLIP_GUARD_BOTTOM;
+	if(pVert->y > g) dwClip |= CLIP_GUARD_TOP;
+
+	return dwClip;
+}
+
+//distance to the clip plane, the vertex is inside when it is >= 0
+static float Clip_Distance(const soft_vertex *pVert, DWORD dwPlane)
+{
+	switch(dwPlane)
+	{
+		case CLIP_NEAR: return pVert->z;
+		case CLIP_FAR: return pVert->w - pVert->z;
+		case CLIP_GUARD_LEFT: return pVert->x + pVert->w * GUARD_BAND;
+		case CLIP_GUARD_RIGHT: return pVert->w * GUARD_BAND - pVert->x;
+		case CLIP_GUARD_BOTTOM: return pVert->y + pVert->w * GUARD_BAND;
+		case CLIP_GUARD_TOP: return pVert->w * GUARD_BAND - pVert->y;
+	}
+
+	return 0.0f;
+}
+
+static void Lerp_Vertex(soft_vertex *pOut, const soft_vertex *pA, const soft_vertex *pB, float t)
+{
+	pOut->x = pA->x + (pB->x - pA->x) * t;
+	pOut->y = pA->y + (pB->y - pA->y) * t;
+	pOut->z = pA->z + (pB->z - pA->z) * t;
+	pOut->w = pA->w + (pB->w - pA->w) * t;
+	pOut->r = pA->r + (pB->r - pA->r) * t;
+	pOut->g = pA->g + (pB->g - pA->g) * t;
+	pOut->b = pA->b + (pB->b - pA->b) * t;
+	pOut->a = pA->a + (pB->a - pA->a) * t;
+	pOut->tu = pA->tu + (pB->tu - pA->tu) * t;
+	pOut->tv = pA->tv + (pB->tv - pA->tv) * t;
+	pOut->dwClip = 0;
+}
+
+CSoftDevice::CSoftDevice()
+{
+	m_dwWidth = 0;
+	m_dwHeight = 0;
+	m_dwCapacity = 0;
+	m_pColor = NULL;
+	m_pZ = NULL;
+	m_pVerts = NULL;
+	m_RcDrawn.left = m_RcDrawn.top = m_RcDrawn.right = m_RcDrawn.bottom = 0;
+	m_bVertexCache = false;
+	m_bInScene = false;
+	m_bMatrixDirty = true;
+	m_bPipelineDirty = true;
+	m_dwDebugMode = SRDEBUG_NONE;
+	m_pDebug = NULL;
+
+	Build_Ramp(m_Ramp);
+
+	memset(m_RenderState, 0, sizeof(m_RenderState));
+	memset(m_TextureState, 0, sizeof(m_TextureState));
+	memset(m_pTexture, 0, sizeof(m_pTexture));
+	memset(m_pTextures, 0, sizeof(m_pTextures));
+	memset(&m_Pipeline, 0, sizeof(m_Pipeline));
+
+	m_MatWorld = Mat4x4_Identity();
+	m_MatView = Mat4x4_Identity();
+	m_MatProj = Mat4x4_Identity();
+	m_MatWVP = Mat4x4_Identity();
+}
+
+CSoftDevice::~CSoftDevice()
+{
+	for(DWORD i = 0; i < SR_MAX_TEXTURES; i++)
+	{
+		if(m_pTextures[i])
+			DestroyTexture(m_pTextures[i]);
+	}
+
+	Aligned_Free(m_pColor);
+	Aligned_Free(m_pZ);
+	Aligned_Free(m_pDebug);
+}
+
+HRESULT CSoftDevice::Init(DWORD dwWidth, DWORD dwHeight, bool bZBuffer)
+{
+	if(!dwWidth || !dwHeight)
+		return E_INVALIDARG;
+
+	m_dwWidth = dwWidth;
+	m_dwHeight = dwHeight;
+	m_dwCapacity = dwWidth * dwHeight;
+
+	m_pColor = (DWORD *)Aligned_Alloc(dwWidth * dwHeight * sizeof(DWORD), CACHE_LINE_SIZE);
+	if(!m_pColor)
+		return E_OUTOFMEMORY;
+	memset(m_pColor, 0, dwWidth * dwHeight * sizeof(DWORD));
+
+	if(bZBuffer)
+	{
+		m_pZ = (float *)Aligned_Alloc(dwWidth * dwHeight * sizeof(float), CACHE_LINE_SIZE);
+		if(!m_pZ)
+			return E_OUTOFMEMORY;
+		for(DWORD i = 0; i < dwWidth * dwHeight; i++)
+			m_pZ[i] = 1.0f;
+	}
+
+	//defaults of IDirect3DDevice3, z test is on when the
+	//device is created with a z buffer
+	m_RenderState[SRRS_TEXTUREPERSPECTIVE] = TRUE;
+	m_RenderState[SRRS_ZENABLE] = bZBuffer ? TRUE : FALSE;
+	m_RenderState[SRRS_SHADEMODE] = SRSHADE_GOURAUD;
+	m_RenderState[SRRS_ZWRITEENABLE] = TRUE;
+	m_RenderState[SRRS_CULLMODE] = SRCULL_CCW;
+	m_RenderState[SRRS_ZFUNC] = SRCMP_LESSEQUAL;
+
+	for(DWORD i = 0; i < SR_MAX_TEXTURE_STAGES; i++)
+	{
+		m_TextureState[i][SRTSS_COLOROP] = i == 0 ? SRTOP_MODULATE : SRTOP_DISABLE;
+		m_TextureState[i][SRTSS_COLORARG1] = SRTA_TEXTURE;
+		m_TextureState[i][SRTSS_COLORARG2] = SRTA_CURRENT;
+		m_TextureState[i][SRTSS_ADDRESS] = SRTADDRESS_WRAP;
+		m_TextureState[i][SRTSS_MAGFILTER] = SRTF_POINT;
+		m_TextureState[i][SRTSS_MINFILTER] = SRTF_POINT;
+		m_TextureState[i][SRTSS_MIPFILTER] = 1;
+	}
+
+	SetViewport(0, 0, dwWidth, dwHeight);
+
+	return S_OK;
+}
+
+HRESULT Create_Soft_Device(DWORD dwWidth, DWORD dwHeight, bool bZBuffer, CSoftDevice **ppDevice)
+{
+	if(!ppDevice)
+		return E_INVALIDARG;
+
+	*ppDevice = NULL;
+
+	CSoftDevice *pDevice = new(std::nothrow) CSoftDevice();
+	if(!pDevice)
+		return E_OUTOFMEMORY;
+
+	HRESULT hResult = pDevice->Init(dwWidth, dwHeight, bZBuffer);
+	if(FAILED(hResult))
+	{
+		delete pDevice;
+		return hResult;
+	}
+
+	*ppDevice = pDevice;
+
+	return S_OK;
+}
+
+ULONG CSoftDevice::Release()
+{
+	delete this;
+	return 0;
+}
+
+HRESULT CSoftDevice::SetRenderState(DWORD dwState, DWORD dwValue)
+{
+	if(dwState >= SRRS_MAX)
+		return E_INVALIDARG;
+
+	if(m_RenderState[dwState] != dwValue)
+		m_bPipelineDirty = true;
+
+	m_RenderState[dwState] = dwValue;
+
+	//texture handle is the Direct3D2 way to set the texture of stage 0
+	if(dwState == SRRS_TEXTUREHANDLE)
+		m_pTexture[0] = (dwValue && dwValue <= SR_MAX_TEXTURES) ? m_pTextures[dwValue - 1] : NULL;
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::GetRenderState(DWORD dwState, DWORD *pdwValue)
+{
+	if(dwState >= SRRS_MAX || !pdwValue)
+		return E_INVALIDARG;
+
+	*pdwValue = m_RenderState[dwState];
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue)
+{
+	if(dwStage >= SR_MAX_TEXTURE_STAGES || dwState >= SRTSS_MAX)
+		return E_INVALIDARG;
+
+	if(dwStage == 0 && m_TextureState[0][dwState] != dwValue)
+		m_bPipelineDirty = true;
+
+	m_TextureState[dwStage][dwState] = dwValue;
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::SetTexture(DWORD dwStage, soft_texture *pTexture)
+{
+	if(dwStage >= SR_MAX_TEXTURE_STAGES)
+		return E_INVALIDARG;
+
+	m_pTexture[dwStage] = pTexture;
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::SetTransform(DWORD dwState, const matrix4x4 *pMatrix)
+{
+	if(!pMatrix)
+		return E_INVALIDARG;
+
+	switch(dwState)
+	{
+		case SRTS_WORLD: m_MatWorld = *pMatrix; break;
+		case SRTS_VIEW: m_MatView = *pMatrix; break;
+		case SRTS_PROJECTION: m_MatProj = *pMatrix; break;
+		default: return E_INVALIDARG;
+	}
+
+	m_bMatrixDirty = true;
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::Resize(DWORD dwWidth, DWORD dwHeight)
+{
+	if(!dwWidth || !dwHeight)
+		return E_INVALIDARG;
+
+	if(m_bInScene)
+		return E_FAIL;
+
+	if(dwWidth == m_dwWidth && dwHeight == m_dwHeight)
+		return S_OK;
+
+	DWORD dwPixels = dwWidth * dwHeight;
+
+	if(dwPixels > m_dwCapacity)
+	{
+		DWORD dwCapacity = m_dwCapacity + m_dwCapacity / 2;
+		if(dwCapacity < dwPixels)
+			dwCapacity = dwPixels;
+
+		DWORD *pColor = (DWORD *)Aligned_Alloc(dwCapacity * sizeof(DWORD), CACHE_LINE_SIZE);
+		float *pZ = m_pZ ? (float *)Aligned_Alloc(dwCapacity * sizeof(float), CACHE_LINE_SIZE) : NULL;
+		DWORD *pDebug = m_pDebug ? (DWORD *)Aligned_Alloc(dwCapacity * sizeof(DWORD), CACHE_LINE_SIZE) : NULL;
+
+		//the old buffers stay when one allocation fails
+		if(!pColor || (m_pZ && !pZ) || (m_pDebug && !pDebug))
+		{
+			Aligned_Free(pColor);
+			Aligned_Free(pZ);
+			Aligned_Free(pDebug);
+			return E_OUTOFMEMORY;
+		}
+
+		Aligned_Free(m_pColor);
+		Aligned_Free(m_pZ);
+		Aligned_Free(m_pDebug);
+		m_pColor = pColor;
+		m_pZ = pZ;
+		m_pDebug = pDebug;
+		m_dwCapacity = dwCapacity;
+	}
+
+	m_dwWidth = dwWidth;
+	m_dwHeight = dwHeight;
+
+	memset(m_pColor, 0, dwPixels * sizeof(DWORD));
+	if(m_pZ)
+	{
+		for(DWORD i = 0; i < dwPixels; i++)
+			m_pZ[i] = 1.0f;
+	}
+	if(m_pDebug)
+		memset(m_pDebug, 0, dwPixels * sizeof(DWORD));
+
+	m_RcDrawn.left = m_RcDrawn.top = m_RcDrawn.right = m_RcDrawn.bottom = 0;
+
+	return SetViewport(0, 0, dwWidth, dwHeight);
+}
+
+HRESULT CSoftDevice::SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight)
+{
+	//no sum, a large dwX must not wrap around
+	if(dwWidth > m_dwWidth || dwX > m_dwWidth - dwWidth ||
+		dwHeight > m_dwHeight || dwY > m_dwHeight - dwHeight)
+		return E_INVALIDARG;
+
+	m_dwViewX = dwX;
+	m_dwViewY = dwY;
+	m_dwViewWidth = dwWidth;
+	m_dwViewHeight = dwHeight;
+
+	return S_OK;
+}
+
+//states of the pixel pipeline, a block that sets all of them keeps the
+//key of its pipeline
+static bool Sets_Pipeline(const state_block *pBlock)
+{
+	static const DWORD RenderStates[] = { SRRS_TEXTUREPERSPECTIVE, SRRS_ZENABLE,
+		SRRS_ZWRITEENABLE, SRRS_ZFUNC };
+	static const DWORD StageStates[] = { SRTSS_COLOROP, SRTSS_MAGFILTER, SRTSS_MINFILTER };
+
+	DWORD dwValue;
+	for(int i = 0; i < (int)(sizeof(RenderStates) / sizeof(RenderStates[0])); i++)
+	{
+		if(!State_Block_Get_Render(pBlock, RenderStates[i], &dwValue))
+			return false;
+	}
+
+	for(int i = 0; i < (int)(sizeof(StageStates) / sizeof(StageStates[0])); i++)
+	{
+		if(!State_Block_Get_Stage(pBlock, 0, StageStates[i], &dwValue))
+			return false;
+	}
+
+	return true;
+}
+
+HRESULT CSoftDevice::ApplyStateBlock(state_block *pBlock)
+{
+	if(!pBlock)
+		return E_INVALIDARG;
+
+	//only the values that are different are set, the texture handle always,
+	//SetTexture() may have changed the texture of stage 0 since
+	for(DWORD i = 0; i < pBlock->dwCount; i++)
+	{
+		const state_block_entry *pEntry = &pBlock->Entries[i];
+
+		if(pEntry->dwStage == SB_RENDER)
+		{
+			if(pEntry->dwState < SRRS_MAX && (m_RenderState[pEntry->dwState] != pEntry->dwValue ||
+				pEntry->dwState == SRRS_TEXTUREHANDLE))
+				SetRenderState(pEntry->dwState, pEntry->dwValue);
+		}
+		else if(pEntry->dwStage < SR_MAX_TEXTURE_STAGES && pEntry->dwState < SRTSS_MAX &&
+			m_TextureState[pEntry->dwStage][pEntry->dwState] != pEntry->dwValue)
+		{
+			SetTextureStageState(pEntry->dwStage, pEntry->dwState, pEntry->dwValue);
+		}
+	}
+
+	if(!m_bPipelineDirty)
+		return S_OK;
+
+	//dwPipeline is the key + 1, 0 until the block was applied once
+	if(pBlock->dwPipeline)
+	{
+		Set_Pipeline(pBlock->dwPipeline - 1);
+		return S_OK;
+	}
+
+	Select_Pipeline();
+	if(Sets_Pipeline(pBlock))
+		pBlock->dwPipeline = m_Pipeline.dwKey + 1;
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ)
+{
+	render_stats Stats;
+	ZeroMemory(&Stats, sizeof(render_stats));
+
+	RECT RcFull = { 0, 0, (LONG)m_dwWidth, (LONG)m_dwHeight };
+	if(!pRects)
+	{
+		pRects = &RcFull;
+		dwCount = 1;
+	}
+
+	for(DWORD i = 0; i < dwCount; i++)
+	{
+		LONG x1 = pRects[i].left < 0 ? 0 : pRects[i].left;
+		LONG y1 = pRects[i].top < 0 ? 0 : pRects[i].top;
+		LONG x2 = pRects[i].right > (LONG)m_dwWidth ? (LONG)m_dwWidth : pRects[i].right;
+		LONG y2 = pRects[i].bottom > (LONG)m_dwHeight ? (LONG)m_dwHeight : pRects[i].bottom;
+
+		if(x1 >= x2 || y1 >= y2)
+			continue;
+
+		for(LONG y = y1; y < y2; y++)
+		{
+			if(dwFlags & SRCLEAR_TARGET)
+			{
+				DWORD *pDest = m_pColor + y * m_dwWidth;
+				for(LONG x = x1; x < x2; x++)
+					pDest[x] = dwColor & 0xffffff;
+
+				//debug counters start again with the new frame
+				if(m_pDebug)
+					memset(m_pDebug + y * m_dwWidth + x1, 0, (x2 - x1) * sizeof(DWORD));
+			}
+
+			if((dwFlags & SRCLEAR_ZBUFFER) && m_pZ)
+			{
+				float *pDest = m_pZ + y * m_dwWidth;
+				for(LONG x = x1; x < x2; x++)
+					pDest[x] = fZ;
+			}
+		}
+
+		DWORD dwBytes = (DWORD)((x2 - x1) * (y2 - y1)) * 4;
+		if(dwFlags & SRCLEAR_TARGET)
+			Stats.dwBytesCleared += dwBytes;
+		if((dwFlags & SRCLEAR_ZBUFFER) && m_pZ)
+			Stats.dwBytesCleared += dwBytes;
+	}
+
+	Stats_Add(Stats_Local(), &Stats);
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::BeginScene()
+{
+	if(m_bInScene)
+		return E_FAIL;
+
+	m_bInScene = true;
+
+	//empty, the first span makes it its own bounds
+	m_RcDrawn.left = (LONG)m_dwWidth;
+	m_RcDrawn.top = (LONG)m_dwHeight;
+	m_RcDrawn.right = m_RcDrawn.bottom = 0;
+
+	return S_OK;
+}
+
+void CSoftDevice::GetDrawnRect(RECT *pRect)
+{
+	if(m_RcDrawn.left >= m_RcDrawn.right)
+	{
+		pRect->left = pRect->top = pRect->right = pRect->bottom = 0;
+		return;
+	}
+
+	*pRect = m_RcDrawn;
+}
+
+HRESULT CSoftDevice::EndScene()
+{
+	if(!m_bInScene)
+		return E_FAIL;
+
+	m_bInScene = false;
+
+	//the scratch memory of the frame is free again
+	frame_arena *pArena = Frame_Arena_Local();
+	if(pArena)
+		Frame_Arena_Reset(pArena);
+
+	return S_OK;
+}
+
+HRESULT CSoftDevice::CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture)
+{
+	if(!ppTexture)
+		return E_INVALIDARG;
+
+	*ppTexture = NULL;
+
+	//wrap addressing is done with a mask
+	if(!dwWidth || !dwHeight || (dwWidth & (dwWidth - 1)) || (dwHeight & (dwHeight - 1)))
+		return E_INVALIDARG;
+
+	DWORD dwSlot = 0;
+	while(dwSlot < SR_MAX_TEXTURES && m_pTextures[dwSlot])
+		dwSlot++;
+
+	if(dwSlot == SR_MAX_TEXTURES)
+		return E_OUTOFMEMORY;
+
+	soft_texture *pTexture = new(std::nothrow) soft_texture;
+	if(!pTexture)
+		return E_OUTOFMEMORY;
+
+	pTexture->pBits = (DWORD *)Aligned_Alloc(dwWidth * dwHeight * sizeof(DWORD), CACHE_LINE_SIZE);
+	if(!pTexture->pBits)
+	{
+		delete pTexture;
+		return E_OUTOFMEMORY;
+	}
+
+	memset(pTexture->pBits, 0, dwWidth * dwHeight * sizeof(DWORD));
+	pTexture->dwWidth = dwWidth;
+	pTexture->dwHeight = dwHeight;
+	pTexture->dwHandle = dwSlot + 1;
+
+	m_pTextures[dwSlot] = pTexture;
+	*ppTexture = pTexture;
+
+	return S_OK;
+}
+
+void CSoftDevice::DestroyTexture(soft_texture *pTexture)
+{
+	if(!pTexture)
+		return;
+
+	for(DWORD i = 0; i < SR_MAX_TEXTURE_STAGES; i++)
+	{
+		if(m_pTexture[i] == pTexture)
+			m_pTexture[i] = NULL;
+	}
+
+	m_pTextures[pTexture->dwHandle - 1] = NULL;
+
+	Aligned_Free(pTexture->pBits);
+	delete pTexture;
+}
+
+DWORD CSoftDevice::GetTextureHandle(soft_texture *pTexture)
+{
+	return pTexture ? pTexture->dwHandle : 0;
+}
+
+DWORD *CSoftDevice::GetColorBuffer(DWORD *pdwPitch)
+{
+	if(pdwPitch)
+		*pdwPitch = m_dwWidth;
+
+	return m_pColor;
+}
+
+float *CSoftDevice::GetZBuffer(DWORD *pdwPitch)
+{
+	if(pdwPitch)
+		*pdwPitch = m_dwWidth;
+
+	return m_pZ;
+}
+
+HRESULT CSoftDevice::SetDebugMode(DWORD dwMode)
+{
+	if(dwMode > SRDEBUG_COST)
+		return E_INVALIDARG;
+
+	if(dwMode != SRDEBUG_NONE && !m_pDebug)
+	{
+		m_pDebug = (DWORD *)Aligned_Alloc(m_dwCapacity * sizeof(DWORD), CACHE_LINE_SIZE);
+		if(!m_pDebug)
+			return E_OUTOFMEMORY;
+	}
+
+	//counts of the other mode mean nothing in the new one
+	if(m_pDebug && dwMode != m_dwDebugMode)
+		memset(m_pDebug, 0, m_dwWidth * m_dwHeight * sizeof(DWORD));
+
+	m_dwDebugMode = dwMode;
+
+	return S_OK;
+}
+
+DWORD *CSoftDevice::GetDebugBuffer(DWORD *pdwPitch)
+{
+	if(pdwPitch)
+		*pdwPitch = m_dwWidth;
+
+	return m_pDebug;
+}
+
+void CSoftDevice::Present_Debug(void *pDest, LONG lDestPitch, const RECT *pRect)
+{
+	//white is four times the average cost of a drawn pixel, a few
+	//spans hit by an interrupt would make the rest of the frame black
+	DWORD dwMax = OVERDRAW_MAX;
+	if(m_dwDebugMode == SRDEBUG_COST)
+	{
+		double Sum = 0.0;
+		DWORD dwCount = 0;
+		for(LONG y = pRect->top; y < pRect->bottom; y++)
+		{
+			const DWORD *pSrc = m_pDebug + y * m_dwWidth;
+			for(LONG x = pRect->left; x < pRect->right; x++)
+			{
+				if(pSrc[x])
+				{
+					Sum += pSrc[x];
+					dwCount++;
+				}
+			}
+		}
+
+		dwMax = dwCount ? (DWORD)(Sum * 4.0 / dwCount) : 1;
+		if(dwMax == 0)
+			dwMax = 1;
+	}
+
+	for(LONG y = pRect->top; y < pRect->bottom; y++)
+	{
+		const DWORD *pSrc = m_pDebug + y * m_dwWidth;
+		DWORD *pRow = (DWORD *)((BYTE *)pDest + y * lDestPitch);
+
+		for(LONG x = pRect->left; x < pRect->right; x++)
+		{
+			DWORD dwValue = pSrc[x] < dwMax ? pSrc[x] : dwMax;
+			pRow[x] = m_Ramp[(DWORD)((double)dwValue * 255.0 / dwMax)];
+		}
+	}
+}
+
+HRESULT CSoftDevice::Present(void *pDest, LONG lDestPitch, const RECT *pRect)
+{
+	if(!pDest)
+		return E_INVALIDARG;
+
+	RECT Rc = { 0, 0, (LONG)m_dwWidth, (LONG)m_dwHeight };
+	if(pRect)
+	{
+		Rc.left = pRect->left < 0 ? 0 : pRect->left;
+		Rc.top = pRect->top < 0 ? 0 : pRect->top;
+		Rc.right = pRect->right > (LONG)m_dwWidth ? (LONG)m_dwWidth : pRect->right;
+		Rc.bottom = pRect->bottom > (LONG)m_dwHeight ? (LONG)m_dwHeight : pRect->bottom;
+	}
+
+	if(Rc.left >= Rc.right || Rc.top >= Rc.bottom)
+		return S_OK;
+
+	DWORD dwRowBytes = (DWORD)(Rc.right - Rc.left) * sizeof(DWORD);
+
+	if(m_dwDebugMode != SRDEBUG_NONE)
+	{
+		Present_Debug(pDest, lDestPitch, &Rc);
+	}
+	else
+	{
+		for(LONG y = Rc.top; y < Rc.bottom; y++)
+		{
+			BYTE *pRow = (BYTE *)pDest + y * lDestPitch + Rc.left * sizeof(DWORD);
+			memcpy(pRow, m_pColor + y * m_dwWidth + Rc.left, dwRowBytes);
+		}
+	}
+
+	render_stats *pStats = Stats_Local();
+	pStats->dwBytesPresented += dwRowBytes * (DWORD)(Rc.bottom - Rc.top);
+
+	return S_OK;
+}
+
+void CSoftDevice::Project(soft_vertex *pVert)
+{
+	float rhw = 1.0f / pVert->w;
+
+	pVert->sx = (float)m_dwViewX + (pVert->x * rhw + 1.0f) * (float)m_dwViewWidth * 0.5f;
+	pVert->sy = (float)m_dwViewY + (1.0f - pVert->y * rhw) * (float)m_dwViewHeight * 0.5f;
+	pVert->sz = pVert->z * rhw;
+	pVert->rhw = rhw;
+}
+
+void CSoftDevice::Setup_Fetch(DWORD dwFVF, soft_fetch *pFetch)
+{
+	if(m_bMatrixDirty)
+	{
+		m_MatWVP = Mat4x4_Mul(Mat4x4_Mul(m_MatWorld, m_MatView), m_MatProj);
+		m_bMatrixDirty = false;
+	}
+
+	pFetch->dwFVF = dwFVF;
+	pFetch->dwStride = Soft_FVF_Stride(dwFVF);
+	pFetch->dwTexCount = (dwFVF & SRFVF_TEXCOUNT_MASK) >> SRFVF_TEXCOUNT_SHIFT;
+	pFetch->bTransformed = (dwFVF & SRFVF_XYZRHW) != 0;
+
+	//offsets of the components in the input vertex
+	DWORD dwOffset = pFetch->bTransformed ? 16 : 12;
+	if(dwFVF & SRFVF_NORMAL) dwOffset += 12;
+	if(dwFVF & SRFVF_RESERVED1) dwOffset += 4;
+	pFetch->dwDiffuseOffset = dwOffset;
+	if(dwFVF & SRFVF_DIFFUSE) dwOffset += 4;
+	if(dwFVF & SRFVF_SPECULAR) dwOffset += 4;
+	pFetch->dwTexOffset = dwOffset;
+}
+
+inline void CSoftDevice::Process_Vertex(const soft_fetch *pFetch, const BYTE *pIn, soft_vertex *pOut)
+{
+	const float *pPos = (const float *)pIn;
+
+	if(pFetch->bTransformed)
+	{
+		//screen space vertex, the application did the clipping
+		pOut->sx = pPos[0];
+		pOut->sy = pPos[1];
+		pOut->sz = pPos[2];
+		pOut->rhw = pPos[3];
+		pOut->x = pOut->y = pOut->z = 0.0f;
+		pOut->w = pPos[3] != 0.0f ? 1.0f / pPos[3] : 1.0f;
+		pOut->dwClip = 0;
+	}
+	else
+	{
+		vector3 VecPos = { pPos[0], pPos[1], pPos[2] };
+		vector4 VecClip = Vec3_Mat4x4_Mul(VecPos, m_MatWVP);
+
+		pOut->x = VecClip.x;
+		pOut->y = VecClip.y;
+		pOut->z = VecClip.z;
+		pOut->w = VecClip.w;
+		pOut->dwClip = Compute_Clip(pOut);
+
+		if(!(pOut->dwClip & CLIP_NEED))
+			Project(pOut);
+	}
+
+	//no lights and no material: vertex color is white
+	if(pFetch->dwFVF & SRFVF_DIFFUSE)
+	{
+		DWORD dwColor = *(const DWORD *)(pIn + pFetch->dwDiffuseOffset);
+		pOut->a = (float)((dwColor >> 24) & 0xff) * (1.0f / 255.0f);
+		pOut->r = (float)((dwColor >> 16) & 0xff) * (1.0f / 255.0f);
+		pOut->g = (float)((dwColor >> 8) & 0xff) * (1.0f / 255.0f);
+		pOut->b = (float)(dwColor & 0xff) * (1.0f / 255.0f);
+	}
+	else
+	{
+		pOut->r = pOut->g = pOut->b = pOut->a = 1.0f;
+	}
+
+	if(pFetch->dwTexCount)
+	{
+		const float *pTex = (const float *)(pIn + pFetch->dwTexOffset);
+		pOut->tu = pTex[0];
+		pOut->tv = pTex[1];
+	}
+	else
+	{
+		pOut->tu = pOut->tv = 0.0f;
+	}
+}
+
+void CSoftDevice::Process_Vertices(DWORD dwFVF, const void *pVertices, DWORD dwVertexCount)
+{
+	soft_fetch Fetch;
+	Setup_Fetch(dwFVF, &Fetch);
+
+	const BYTE *pIn = (const BYTE *)pVertices;
+
+	for(DWORD i = 0; i < dwVertexCount; i++, pIn += Fetch.dwStride)
+		Process_Vertex(&Fetch, pIn, &m_pVerts[i]);
+}
+
+HRESULT CSoftDevice::DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags)
+{
+	UNREFERENCED_PARAMETER(dwFlags);
+
+	if(!pIndices)
+		return E_INVALIDARG;
+
+	return Draw(dwPrimType, dwFVF, pVertices, dwVertexCount, pIndices, sizeof(WORD), dwIndexCount);
+}
+
+HRESULT CSoftDevice::DrawIndexedPrimitive32(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const DWORD *pIndices, DWORD dwIndexCount, DWORD dwFlags)
+{
+	UNREFERENCED_PARAMETER(dwFlags);
+
+	if(!pIndices)
+		return E_INVALIDARG;
+
+	return Draw(dwPrimType, dwFVF, pVertices, dwVertexCount, pIndices, sizeof(DWORD), dwIndexCount);
+}
+
+HRESULT CSoftDevice::DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags)
+{
+	UNREFERENCED_PARAMETER(dwFlags);
+
+	return Draw(dwPrimType, dwFVF, pVertices, dwVertexCount, NULL, 0, dwVertexCount);
+}
+
+HRESULT CSoftDevice::Draw(DWORD dwPrimType, DWORD dwFVF, const void *pVertices, DWORD dwVertexCount,
+					const void *pIndices, DWORD dwIndexSize, DWORD dwIndexCount)
+{
+	if(!m_bInScene || !pVertices)
+		return E_FAIL;
+
+	if(!(dwFVF & (SRFVF_XYZ | SRFVF_XYZRHW)))
+		return E_INVALIDARG;
+
+	DWORD dwTriCount = 0;
+	switch(dwPrimType)
+	{
+		case SRPT_TRIANGLELIST: dwTriCount = dwIndexCount / 3; break;
+		case SRPT_TRIANGLESTRIP:
+		case SRPT_TRIANGLEFAN: dwTriCount = dwIndexCount >= 3 ? dwIndexCount - 2 : 0; break;
+		default: return E_INVALIDARG;
+	}
+
+	if(m_bPipelineDirty)
+		Select_Pipeline();
+
+	if(m_bVertexCache && pIndices && dwPrimType == SRPT_TRIANGLELIST)
+		return Draw_Cached(dwFVF, pVertices, dwVertexCount, pIndices, dwIndexSize, dwTriCount);
+
+	//the processed vertices are needed only during the call, they go
+	//to the frame arena of the thread and are given back at the end
+	frame_arena *pArena = Frame_Arena_Local();
+	if(!pArena)
+		return E_OUTOFMEMORY;
+
+	arena_mark Mark = Frame_Arena_Mark(pArena);
+
+	m_pVerts = (soft_vertex *)Frame_Arena_Alloc(pArena, (size_t)dwVertexCount * sizeof(soft_vertex));
+	if(!m_pVerts)
+		return E_OUTOFMEMORY;
+
+	Process_Vertices(dwFVF, pVertices, dwVertexCount);
+
+	//counters go to a local copy and are added once per call
+	render_stats Stats;
+	ZeroMemory(&Stats, sizeof(render_stats));
+	Stats.dwVerticesTransformed = dwVertexCount;
+
+	for(DWORD t = 0; t < dwTriCount; t++)
+	{
+		DWORD i0, i1, i2;
+
+		if(dwPrimType == SRPT_TRIANGLELIST)
+		{
+			i0 = t * 3; i1 = t * 3 + 1; i2 = t * 3 + 2;
+		}
+		else if(dwPrimType == SRPT_TRIANGLESTRIP)
+		{
+			//every second triangle of a strip has the other order
+			i0 = t;
+			i1 = (t & 1) ? t + 2 : t + 1;
+			i2 = (t & 1) ? t + 1 : t + 2;
+		}
+		else
+		{
+			i0 = 0; i1 = t + 1; i2 = t + 2;
+		}
+
+		if(dwIndexSize == sizeof(DWORD))
+		{
+			const DWORD *pDwords = (const DWORD *)pIndices;
+			i0 = pDwords[i0];
+			i1 = pDwords[i1];
+			i2 = pDwords[i2];
+		}
+		else if(pIndices)
+		{
+			const WORD *pWords = (const WORD *)pIndices;
+			i0 = pWords[i0];
+			i1 = pWords[i1];
+			i2 = pWords[i2];
+		}
+
+		if(i0 >= dwVertexCount || i1 >= dwVertexCount || i2 >= dwVertexCount)
+			continue;
+
+		Draw_Triangle(&m_pVerts[i0], &m_pVerts[i1], &m_pVerts[i2], &Stats);
+	}
+
+	Frame_Arena_Release(pArena, Mark);
+	m_pVerts = NULL;
+
+	Stats_Add(Stats_Local(), &Stats);
+
+	return S_OK;
+}
+
+//the vertex transformed by one of the last SOFT_VERTEX_CACHE misses, or
+//transformed now into the next slot of the ring. The ring has two slots
+//more than the cache, so the vertices found for the first corners of a
+//triangle are not written over by the misses of the other corners. The
+//slot is found by the low bits of the index, two cached vertices with
+//the same low bits make a miss a real cache would not have
+inline const soft_vertex *CSoftDevice::Cached_Vertex(soft_vertex_cache *pCache, DWORD v,
+					const soft_fetch *pFetch, const BYTE *pVertices)
+{
+	DWORD *pSlot = &pCache->Slots[v & (SOFT_CACHE_HASH - 1)];
+	DWORD dwSlot = *pSlot;
+
+	if(pCache->Tags[dwSlot] == v && pCache->dwMisses - pCache->Ages[dwSlot] <= SOFT_VERTEX_CACHE)
+	{
+		pCache->dwHits++;
+		return &pCache->pVerts[dwSlot];
+	}
+
+	dwSlot = pCache->dwNext;
+	pCache->dwNext = dwSlot + 1 < SOFT_CACHE_RING ? dwSlot + 1 : 0;
+
+	*pSlot = dwSlot;
+	pCache->Tags[dwSlot] = v;
+	pCache->Ages[dwSlot] = pCache->dwMisses++;
+	Process_Vertex(pFetch, pVertices + (size_t)v * pFetch->dwStride, &pCache->pVerts[dwSlot]);
+
+	return &pCache->pVerts[dwSlot];
+}
+
+//a triangle list transformed vertex by vertex as the indices need them,
+//a vertex is transformed again when it is used after it fell out of the
+//cache (MeshOptimize.h orders meshes for this)
+HRESULT CSoftDevice::Draw_Cached(DWORD dwFVF, const void *pVertices, DWORD dwVertexCount,
+					const void *pIndices, DWORD dwIndexSize, DWORD dwTriCount)
+{
+	frame_arena *pArena = Frame_Arena_Local();
+	if(!pArena)
+		return E_OUTOFMEMORY;
+
+	arena_mark Mark = Frame_Arena_Mark(pArena);
+
+	soft_vertex_cache Cache;
+	Cache.pVerts = (soft_vertex *)Frame_Arena_Alloc(pArena, SOFT_CACHE_RING * sizeof(soft_vertex));
+	if(!Cache.pVerts)
+		return E_OUTOFMEMORY;
+
+	for(DWORD i = 0; i < SOFT_CACHE_HASH; i++)
+		Cache.Slots[i] = 0;
+	for(DWORD i = 0; i < SOFT_CACHE_RING; i++)
+		Cache.Tags[i] = 0xffffffff;
+
+	Cache.dwNext = 0;
+	Cache.dwHits = 0;
+	Cache.dwMisses = 0;
+
+	soft_fetch Fetch;
+	Setup_Fetch(dwFVF, &Fetch);
+
+	const BYTE *pIn = (const BYTE *)pVertices;
+	const WORD *pWords = (const WORD *)pIndices;
+	const DWORD *pDwords = (const DWORD *)pIndices;
+
+	render_stats Stats;
+	ZeroMemory(&Stats, sizeof(render_stats));
+
+	for(DWORD t = 0; t < dwTriCount; t++)
+	{
+		DWORD i0, i1, i2;
+		if(dwIndexSize == sizeof(DWORD))
+		{
+			i0 = pDwords[t * 3]; i1 = pDwords[t * 3 + 1]; i2 = pDwords[t * 3 + 2];
+		}
+		else
+		{
+			i0 = pWords[t * 3]; i1 = pWords[t * 3 + 1]; i2 = pWords[t * 3 + 2];
+		}
+
+		if(i0 >= dwVertexCount || i1 >= dwVertexCount || i2 >= dwVertexCount)
+			continue;
+
+		const soft_vertex *pV0 = Cached_Vertex(&Cache, i0, &Fetch, pIn);
+		const soft_vertex *pV1 = Cached_Vertex(&Cache, i1, &Fetch, pIn);
+		const soft_vertex *pV2 = Cached_Vertex(&Cache, i2, &Fetch, pIn);
+
+		Draw_Triangle(pV0, pV1, pV2, &Stats);
+	}
+
+	Frame_Arena_Release(pArena, Mark);
+
+	Stats.dwVerticesTransformed = Cache.dwMisses;
+	Stats.dwVertexCacheHits = Cache.dwHits;
+	Stats_Add(Stats_Local(), &Stats);
+
+	return S_OK;
+}
+
+void CSoftDevice::Draw_Triangle(const soft_vertex *pV0, const soft_vertex *pV1, const soft_vertex *pV2, render_stats *pStats)
+{
+	pStats->dwTrianglesIn++;
+
+	//the whole triangle is outside one plane of the frustum
+	if(pV0->dwClip & pV1->dwClip & pV2->dwClip & CLIP_FRUSTUM)
+	{
+		pStats->dwTrianglesCulled++;
+		return;
+	}
+
+	if((pV0->dwClip | pV1->dwClip | pV2->dwClip) & CLIP_NEED)
+	{
+		pStats->dwTrianglesClipped++;
+		Draw_Clipped(pV0, pV1, pV2, pStats);
+		return;
+	}
+
+	if(Rasterize(pV0, pV1, pV2, pStats))
+		pStats->dwTrianglesRasterized++;
+	else
+		pStats->dwTrianglesCulled++;
+}
+
+void CSoftDevice::Draw_Clipped(const soft_vertex *pV0, const soft_vertex *pV1, const soft_vertex *pV2, render_stats *pStats)
+{
+	soft_vertex Buff[2][MAX_CLIP_VERTS];
+	soft_vertex *pIn = Buff[0];
+	soft_vertex *pOut = Buff[1];
+
+	pIn[0] = *pV0;
+	pIn[1] = *pV1;
+	pIn[2] = *pV2;
+	int InCount = 3;
+
+	static const DWORD Planes[] = { CLIP_NEAR, CLIP_FAR, CLIP_GUARD_LEFT,
+		CLIP_GUARD_RIGHT, CLIP_GUARD_BOTTOM, CLIP_GUARD_TOP };
+
+	DWORD dwClipOr = pV0->dwClip | pV1->dwClip | pV2->dwClip;
+
+	for(int p = 0; p < 6; p++)
+	{
+		if(!(dwClipOr & Planes[p]))
+			continue;
+
+		int OutCount = 0;
+
+		for(int i = 0; i < InCount; i++)
+		{
+			const soft_vertex *pA = &pIn[i];
+			const soft_vertex *pB = &pIn[(i + 1) % InCount];
+			float da = Clip_Distance(pA, Planes[p]);
+			float db = Clip_Distance(pB, Planes[p]);
+
+			if(da >= 0.0f)
+				pOut[OutCount++] = *pA;
+
+			if((da >= 0.0f) != (db >= 0.0f))
+				Lerp_Vertex(&pOut[OutCount++], pA, pB, da / (da - db));
+		}
+
+		soft_vertex *pTemp = pIn;
+		pIn = pOut;
+		pOut = pTemp;
+		InCount = OutCount;
+
+		if(InCount < 3)
+		{
+			pStats->dwTrianglesCulled++;
+			return;
+		}
+	}
+
+	for(int i = 0; i < InCount; i++)
+		Project(&pIn[i]);
+
+	bool bDrawn = false;
+	for(int i = 1; i < InCount - 1; i++)
+		bDrawn |= Rasterize(&pIn[0], &pIn[i], &pIn[i + 1], pStats);
+
+	if(bDrawn)
+		pStats->dwTrianglesRasterized++;
+	else
+		pStats->dwTrianglesCulled++;
+}
+
+//attributes the scanline loop interpolates
+enum { ATTR_Z, ATTR_RHW, ATTR_U, ATTR_V, ATTR_R, ATTR_G, ATTR_B, ATTR_COUNT };
+
+//template arguments of the span functions
+enum { ZMODE_OFF, ZMODE_TEST, ZMODE_WRITE };		//write is test and write
+enum { ZFUNC_ANY, ZFUNC_LESS, ZFUNC_LESSEQUAL };	//ANY calls Z_Test()
+enum { TEX_NONE, TEX_POINT, TEX_LINEAR };
+enum { OP_NONE, OP_MODULATE, OP_SELECT };			//OP_SELECT is the texel alone
+
+struct soft_span
+{
+	DWORD *pColor;
+	float *pZ;
+	DWORD *pOverdraw;		//NULL unless SRDEBUG_OVERDRAW
+	int x1, x2;
+
+	float A[ATTR_COUNT];
+	const float *pdAdx;
+
+	const DWORD *pBits;
+	DWORD dwTexWidth, dwTexHeight, dwWidthMask, dwHeightMask;
+	DWORD dwZFunc;
+
+	DWORD dwRejected, dwWritten, dwFetches;
+};
+
+template<int ZFunc>
+static inline bool Z_Pass(DWORD dwFunc, float fZ, float fZBuf)
+{
+	if(ZFunc == ZFUNC_LESS)
+		return fZ < fZBuf;
+	if(ZFunc == ZFUNC_LESSEQUAL)
+		return fZ <= fZBuf;
+	return Z_Test(dwFunc, fZ, fZBuf);
+}
+
+//the states are template arguments, the compiler drops every test of a
+//state from the pixel loop
+template<int ZMode, int ZFunc, int Tex, bool bPerspective, int ColorOp>
+static void Draw_Span(soft_span *pSpan)
+{
+	DWORD *pColor = pSpan->pColor;
+	float *pZ = pSpan->pZ;
+	DWORD *pOverdraw = pSpan->pOverdraw;
+	const float *dAdx = pSpan->pdAdx;
+	const DWORD *pBits = pSpan->pBits;
+	DWORD dwTexWidth = pSpan->dwTexWidth, dwTexHeight = pSpan->dwTexHeight;
+	DWORD dwWidthMask = pSpan->dwWidthMask, dwHeightMask = pSpan->dwHeightMask;
+
+	float A[ATTR_COUNT];
+	for(int a = 0; a < ATTR_COUNT; a++)
+		A[a] = pSpan->A[a];
+
+	DWORD dwRejected = 0, dwWritten = 0, dwFetches = 0;
+
+	for(int x = pSpan->x1; x < pSpan->x2; x++)
+	{
+		if(ZMode != ZMODE_OFF && !Z_Pass<ZFunc>(pSpan->dwZFunc, A[ATTR_Z], pZ[x]))
+		{
+			dwRejected++;
+		}
+		else
+		{
+			DWORD dwDiffuse = 0;
+			if(ColorOp != OP_SELECT)
+				dwDiffuse = (Clamp_Channel(A[ATTR_R]) << 16) |
+					(Clamp_Channel(A[ATTR_G]) << 8) | Clamp_Channel(A[ATTR_B]);
+
+			DWORD dwOut = dwDiffuse;
+
+			if(Tex != TEX_NONE)
+			{
+				float u = A[ATTR_U], v = A[ATTR_V];
+				if(bPerspective)
+				{
+					float w = 1.0f / A[ATTR_RHW];
+					u *= w;
+					v *= w;
+				}
+
+				DWORD dwTexel;
+				if(Tex == TEX_LINEAR)
+				{
+					float fu = u * dwTexWidth - 0.5f;
+					float fv = v * dwTexHeight - 0.5f;
+					int iu = Fast_Floor(fu), iv = Fast_Floor(fv);
+					DWORD dwFracU = (DWORD)((fu - iu) * 256.0f);
+					DWORD dwFracV = (DWORD)((fv - iv) * 256.0f);
+
+					DWORD u0 = iu & dwWidthMask, u1 = (iu + 1) & dwWidthMask;
+					const DWORD *pRow0 = pBits + (iv & dwHeightMask) * dwTexWidth;
+					const DWORD *pRow1 = pBits + ((iv + 1) & dwHeightMask) * dwTexWidth;
+
+					dwTexel = Lerp_Texel(Lerp_Texel(pRow0[u0], pRow0[u1], dwFracU),
+						Lerp_Texel(pRow1[u0], pRow1[u1], dwFracU), dwFracV);
+					dwFetches += 4;
+				}
+				else
+				{
+					DWORD iu = Fast_Floor(u * dwTexWidth) & dwWidthMask;
+					DWORD iv = Fast_Floor(v * dwTexHeight) & dwHeightMask;
+					dwTexel = pBits[iv * dwTexWidth + iu];
+					dwFetches++;
+				}
+
+				dwOut = ColorOp == OP_MODULATE ? Modulate(dwTexel, dwDiffuse) : dwTexel;
+			}
+
+			pColor[x] = dwOut & 0xffffff;
+			if(ZMode == ZMODE_WRITE)
+				pZ[x] = A[ATTR_Z];
+
+			if(pOverdraw)
+				pOverdraw[x]++;
+
+			dwWritten++;
+		}
+
+		for(int a = 0; a < ATTR_COUNT; a++)
+			A[a] += dAdx[a];
+	}
+
+	pSpan->dwRejected += dwRejected;
+	pSpan->dwWritten += dwWritten;
+	pSpan->dwFetches += dwFetches;
+}
+
+//one row for every Z mode and function, in a row the untextured span,
+//then point and linear filter, each without and with perspective, each
+//with modulate and select
+#define SPAN_ROW(Z, F) \
+	Draw_Span<Z, F, TEX_NONE, false, OP_NONE>, \
+	Draw_Span<Z, F, TEX_POINT, false, OP_MODULATE>, Draw_Span<Z, F, TEX_POINT, false, OP_SELECT>, \
+	Draw_Span<Z, F, TEX_POINT, true, OP_MODULATE>, Draw_Span<Z, F, TEX_POINT, true, OP_SELECT>, \
+	Draw_Span<Z, F, TEX_LINEAR, false, OP_MODULATE>, Draw_Span<Z, F, TEX_LINEAR, false, OP_SELECT>, \
+	Draw_Span<Z, F, TEX_LINEAR, true, OP_MODULATE>, Draw_Span<Z, F, TEX_LINEAR, true, OP_SELECT>
+
+#define SPAN_Z_ROWS		7
+#define SPAN_TEX_COLS	9
+
+static const soft_span_func g_Spans[SPAN_Z_ROWS][SPAN_TEX_COLS] = {
+	{ SPAN_ROW(ZMODE_OFF, ZFUNC_ANY) },
+	{ SPAN_ROW(ZMODE_TEST, ZFUNC_ANY) },
+	{ SPAN_ROW(ZMODE_TEST, ZFUNC_LESS) },
+	{ SPAN_ROW(ZMODE_TEST, ZFUNC_LESSEQUAL) },
+	{ SPAN_ROW(ZMODE_WRITE, ZFUNC_ANY) },
+	{ SPAN_ROW(ZMODE_WRITE, ZFUNC_LESS) },
+	{ SPAN_ROW(ZMODE_WRITE, ZFUNC_LESSEQUAL) }
+};
+
+//key of the pipeline, bits:
+//0-1 Z mode, 2-3 Z function, 4 perspective, 5-6 color op,
+//7 linear minify, 8 linear magnify
+#define KEY_ZMODE_MASK		0x003
+#define KEY_ZFUNC_SHIFT		2
+#define KEY_PERSPECTIVE		0x010
+#define KEY_OP_SHIFT		5
+#define KEY_MIN_LINEAR		0x080
+#define KEY_MAG_LINEAR		0x100
+
+static soft_span_func Span_Func(DWORD dwKey, bool bLinear)
+{
+	DWORD dwZMode = dwKey & KEY_ZMODE_MASK;
+	DWORD dwZFunc = (dwKey >> KEY_ZFUNC_SHIFT) & 3;
+	DWORD dwOp = (dwKey >> KEY_OP_SHIFT) & 3;
+
+	DWORD dwRow = dwZMode == ZMODE_OFF ? 0 : 1 + (dwZMode - ZMODE_TEST) * 3 + dwZFunc;
+	DWORD dwCol = 0;
+	if(dwOp != OP_NONE)
+		dwCol = 1 + (bLinear ? 4 : 0) + ((dwKey & KEY_PERSPECTIVE) ? 2 : 0) + (dwOp == OP_SELECT ? 1 : 0);
+
+	return g_Spans[dwRow][dwCol];
+}
+
+void CSoftDevice::Select_Pipeline()
+{
+	DWORD dwKey = 0;
+
+	if(m_RenderState[SRRS_ZENABLE])
+		dwKey |= m_RenderState[SRRS_ZWRITEENABLE] ? ZMODE_WRITE : ZMODE_TEST;
+
+	if(m_RenderState[SRRS_ZFUNC] == SRCMP_LESS)
+		dwKey |= ZFUNC_LESS << KEY_ZFUNC_SHIFT;
+	else if(m_RenderState[SRRS_ZFUNC] == SRCMP_LESSEQUAL)
+		dwKey |= ZFUNC_LESSEQUAL << KEY_ZFUNC_SHIFT;
+
+	if(m_RenderState[SRRS_TEXTUREPERSPECTIVE])
+		dwKey |= KEY_PERSPECTIVE;
+
+	//the other ops do not use the texel, the pixel is the diffuse color
+	if(m_TextureState[0][SRTSS_COLOROP] == SRTOP_MODULATE)
+		dwKey |= OP_MODULATE << KEY_OP_SHIFT;
+	else if(m_TextureState[0][SRTSS_COLOROP] == SRTOP_SELECTARG1)
+		dwKey |= OP_SELECT << KEY_OP_SHIFT;
+
+	if(m_TextureState[0][SRTSS_MINFILTER] == SRTF_LINEAR)
+		dwKey |= KEY_MIN_LINEAR;
+	if(m_TextureState[0][SRTSS_MAGFILTER] == SRTF_LINEAR)
+		dwKey |= KEY_MAG_LINEAR;
+
+	Set_Pipeline(dwKey);
+}
+
+void CSoftDevice::Set_Pipeline(DWORD dwKey)
+{
+	m_Pipeline.dwKey = dwKey;
+
+	//the key is made from the states only, without a Z buffer there is no Z test
+	if(!m_pZ)
+		dwKey &= ~KEY_ZMODE_MASK;
+
+	m_Pipeline.bTexture = ((dwKey >> KEY_OP_SHIFT) & 3) != OP_NONE;
+	m_Pipeline.bPerspective = (dwKey & KEY_PERSPECTIVE) != 0;
+	m_Pipeline.pfnUntextured = Span_Func(dwKey & ~(3 << KEY_OP_SHIFT), false);
+	m_Pipeline.pfnMinify = Span_Func(dwKey, (dwKey & KEY_MIN_LINEAR) != 0);
+	m_Pipeline.pfnMagnify = Span_Func(dwKey, (dwKey & KEY_MAG_LINEAR) != 0);
+
+	m_bPipelineDirty = false;
+}
+
+bool CSoftDevice::Rasterize(const soft_vertex *pV0, const soft_vertex *pV1, const soft_vertex *pV2, render_stats *pStats)
+{
+	//area of the triangle on the screen, y goes down so clockwise is positive
+	float Area = (pV1->sx - pV0->sx) * (pV2->sy - pV0->sy) - (pV2->sx - pV0->sx) * (pV1->sy - pV0->sy);
+
+	if(Area == 0.0f)
+		return false;
+
+	DWORD dwCull = m_RenderState[SRRS_CULLMODE];
+	if(dwCull == SRCULL_CCW && Area < 0.0f)
+		return false;
+	if(dwCull == SRCULL_CW && Area > 0.0f)
+		return false;
+
+	soft_texture *pTexture = m_Pipeline.bTexture ? m_pTexture[0] : NULL;
+	bool bPerspective = m_Pipeline.bPerspective;
+
+	const soft_vertex *pV[3] = { pV0, pV1, pV2 };
+	float Attr[3][ATTR_COUNT];
+
+	for(int i = 0; i < 3; i++)
+	{
+		//flat shading takes the color of the first vertex
+		const soft_vertex *pC = m_RenderState[SRRS_SHADEMODE] == SRSHADE_FLAT ? pV0 : pV[i];
+
+		Attr[i][ATTR_Z] = pV[i]->sz;
+		Attr[i][ATTR_RHW] = pV[i]->rhw;
+		Attr[i][ATTR_U] = bPerspective ? pV[i]->tu * pV[i]->rhw : pV[i]->tu;
+		Attr[i][ATTR_V] = bPerspective ? pV[i]->tv * pV[i]->rhw : pV[i]->tv;
+		Attr[i][ATTR_R] = pC->r * 255.0f;
+		Attr[i][ATTR_G] = pC->g * 255.0f;
+		Attr[i][ATTR_B] = pC->b * 255.0f;
+	}
+
+	//plane equation gradients
+	float dx1 = pV1->sx - pV0->sx, dy1 = pV1->sy - pV0->sy;
+	float dx2 = pV2->sx - pV0->sx, dy2 = pV2->sy - pV0->sy;
+	float InvArea = 1.0f / Area;
+
+	float dAdx[ATTR_COUNT], dAdy[ATTR_COUNT];
+	for(int a = 0; a < ATTR_COUNT; a++)
+	{
+		float d1 = Attr[1][a] - Attr[0][a];
+		float d2 = Attr[2][a] - Attr[0][a];
+		dAdx[a] = (d1 * dy2 - d2 * dy1) * InvArea;
+		dAdy[a] = (d2 * dx1 - d1 * dx2) * InvArea;
+	}
+
+	soft_span Span;
+	Span.pdAdx = dAdx;
+	Span.pBits = NULL;
+	Span.dwTexWidth = Span.dwTexHeight = Span.dwWidthMask = Span.dwHeightMask = 0;
+	Span.dwZFunc = m_RenderState[SRRS_ZFUNC];
+	Span.dwRejected = Span.dwWritten = Span.dwFetches = 0;
+
+	soft_span_func pfnSpan = m_Pipeline.pfnUntextured;
+
+	//minification when one pixel covers more than one texel
+	if(pTexture)
+	{
+		Span.pBits = pTexture->pBits;
+		Span.dwTexWidth = pTexture->dwWidth;
+		Span.dwTexHeight = pTexture->dwHeight;
+		Span.dwWidthMask = pTexture->dwWidth - 1;
+		Span.dwHeightMask = pTexture->dwHeight - 1;
+
+		pfnSpan = m_Pipeline.pfnMagnify;
+		if(m_Pipeline.pfnMinify != m_Pipeline.pfnMagnify)
+		{
+			float du1 = (pV1->tu - pV0->tu) * Span.dwTexWidth, dv1 = (pV1->tv - pV0->tv) * Span.dwTexHeight;
+			float du2 = (pV2->tu - pV0->tu) * Span.dwTexWidth, dv2 = (pV2->tv - pV0->tv) * Span.dwTexHeight;
+			float TexelArea = fabsf(du1 * dv2 - du2 * dv1);
+			if(TexelArea > fabsf(Area))
+				pfnSpan = m_Pipeline.pfnMinify;
+		}
+	}
+
+	//sort by y, top vertex first
+	int t = 0, m = 1, b = 2;
+	if(pV[m]->sy < pV[t]->sy) { int s = t; t = m; m = s; }
+	if(pV[b]->sy < pV[t]->sy) { int s = t; t = b; b = s; }
+	if(pV[b]->sy < pV[m]->sy) { int s = m; m = b; b = s; }
+
+	const soft_vertex *pTop = pV[t];
+	const soft_vertex *pMid = pV[m];
+	const soft_vertex *pBot = pV[b];
+
+	//middle vertex is on the right of the long edge when the sorted
+	//triangle is clockwise
+	float SortedArea = (pMid->sx - pTop->sx) * (pBot->sy - pTop->sy) - (pBot->sx - pTop->sx) * (pMid->sy - pTop->sy);
+	bool bMidRight = SortedArea > 0.0f;
+
+	float LongSlope = (pBot->sx - pTop->sx) / (pBot->sy - pTop->sy);
+	float TopSlope = pMid->sy > pTop->sy ? (pMid->sx - pTop->sx) / (pMid->sy - pTop->sy) : 0.0f;
+	float BotSlope = pBot->sy > pMid->sy ? (pBot->sx - pMid->sx) / (pBot->sy - pMid->sy) : 0.0f;
+
+	int ClipX1 = (int)m_dwViewX, ClipX2 = (int)(m_dwViewX + m_dwViewWidth);
+	int ClipY1 = (int)m_dwViewY, ClipY2 = (int)(m_dwViewY + m_dwViewHeight);
+
+	int y1 = Fast_Ceil(pTop->sy);
+	int y2 = Fast_Ceil(pBot->sy);
+	if(y1 < ClipY1) y1 = ClipY1;
+	if(y2 > ClipY2) y2 = ClipY2;
+
+	DWORD dwFragments = 0;
+
+	//bounds of the spans, for GetDrawnRect()
+	int MinX = ClipX2, MaxX = ClipX1, MinY = y2, MaxY = y1;
+
+	bool bCost = m_dwDebugMode == SRDEBUG_COST;
+
+	for(int y = y1; y < y2; y++)
+	{
+		float fy = (float)y;
+
+		float xLong = pTop->sx + (fy - pTop->sy) * LongSlope;
+		float xShort = fy < pMid->sy ?
+			pTop->sx + (fy - pTop->sy) * TopSlope :
+			pMid->sx + (fy - pMid->sy) * BotSlope;
+
+		float xl = bMidRight ? xLong : xShort;
+		float xr = bMidRight ? xShort : xLong;
+
+		int x1 = Fast_Ceil(xl);
+		int x2 = Fast_Ceil(xr);
+		if(x1 < ClipX1) x1 = ClipX1;
+		if(x2 > ClipX2) x2 = ClipX2;
+		if(x1 >= x2)
+			continue;
+
+		float ox = (float)x1 - pV0->sx;
+		float oy = fy - pV0->sy;
+
+		for(int a = 0; a < ATTR_COUNT; a++)
+			Span.A[a] = Attr[0][a] + dAdx[a] * ox + dAdy[a] * oy;
+
+		Span.pColor = m_pColor + y * m_dwWidth;
+		Span.pZ = m_pZ ? m_pZ + y * m_dwWidth : NULL;
+		Span.pOverdraw = m_dwDebugMode == SRDEBUG_OVERDRAW ? m_pDebug + y * m_dwWidth : NULL;
+		Span.x1 = x1;
+		Span.x2 = x2;
+
+		dwFragments += x2 - x1;
+
+		if(x1 < MinX) MinX = x1;
+		if(x2 > MaxX) MaxX = x2;
+		if(y < MinY) MinY = y;
+		MaxY = y + 1;
+
+		LONGLONG SpanStart = bCost ? Cycle_Count() : 0;
+
+		pfnSpan(&Span);
+
+		//the span is timed as a whole, every pixel gets an equal share
+		if(bCost)
+		{
+			DWORD *pDebug = m_pDebug + y * m_dwWidth;
+			DWORD dwCycles = (DWORD)((Cycle_Count() - SpanStart) / (x2 - x1));
+			for(int x = x1; x < x2; x++)
+				pDebug[x] += dwCycles;
+		}
+	}
+
+	if(dwFragments)
+	{
+		if(MinX < m_RcDrawn.left) m_RcDrawn.left = MinX;
+		if(MaxX > m_RcDrawn.right) m_RcDrawn.right = MaxX;
+		if(MinY < m_RcDrawn.top) m_RcDrawn.top = MinY;
+		if(MaxY > m_RcDrawn.bottom) m_RcDrawn.bottom = MaxY;
+	}
+
+	pStats->dwFragmentsGenerated += dwFragments;
+	pStats->dwFragmentsDepthRejected += Span.dwRejected;
+	pStats->dwFragmentsWritten += Span.dwWritten;
+	pStats->dwTexelFetches += Span.dwFetches;
+
+	return true;
+}
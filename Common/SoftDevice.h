@@ -0,0 +1,311 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _SOFTDEVICE_H_
+#define _SOFTDEVICE_H_
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "RenderDevice.h"
+
+//software rasterizer with the calls of IDirect3DDevice3 the samples use.
+//states, flags and vertex formats have the same values as in d3dtypes.h,
+//so D3D constants can be passed to CSoftDevice as they are
+
+enum
+{
+	SRRS_TEXTUREHANDLE		= 1,
+	SRRS_TEXTUREPERSPECTIVE	= 4,
+	SRRS_ZENABLE			= 7,
+	SRRS_SHADEMODE			= 9,
+	SRRS_ZWRITEENABLE		= 14,
+	SRRS_CULLMODE			= 22,
+	SRRS_ZFUNC				= 23,
+	SRRS_MAX				= 256
+};
+
+enum
+{
+	SRTSS_COLOROP		= 1,
+	SRTSS_COLORARG1		= 2,
+	SRTSS_COLORARG2		= 3,
+	SRTSS_ADDRESS		= 12,
+	SRTSS_MAGFILTER		= 16,
+	SRTSS_MINFILTER		= 17,
+	SRTSS_MIPFILTER		= 18,
+	SRTSS_MAX			= 32
+};
+
+#define SR_MAX_TEXTURE_STAGES 8
+
+//D3DTEXTUREOP
+#define SRTOP_DISABLE		1
+#define SRTOP_SELECTARG1	2
+#define SRTOP_SELECTARG2	3
+#define SRTOP_MODULATE		4
+
+//D3DTA_
+#define SRTA_DIFFUSE	0
+#define SRTA_CURRENT	1
+#define SRTA_TEXTURE	2
+
+//D3DTFG_ and D3DTFN_
+#define SRTF_POINT		1
+#define SRTF_LINEAR		2
+
+#define SRTADDRESS_WRAP	1
+
+#define SRCULL_NONE		1
+#define SRCULL_CW		2
+#define SRCULL_CCW		3
+
+#define SRSHADE_FLAT	1
+#define SRSHADE_GOURAUD	2
+
+#define SRCMP_NEVER			1
+#define SRCMP_LESS			2
+#define SRCMP_EQUAL			3
+#define SRCMP_LESSEQUAL		4
+#define SRCMP_GREATER		5
+#define SRCMP_NOTEQUAL		6
+#define SRCMP_GREATEREQUAL	7
+#define SRCMP_ALWAYS		8
+
+#define SRTS_WORLD		1
+#define SRTS_VIEW		2
+#define SRTS_PROJECTION	3
+
+#define SRPT_TRIANGLELIST	4
+#define SRPT_TRIANGLESTRIP	5
+#define SRPT_TRIANGLEFAN	6
+
+#define SRCLEAR_TARGET	1
+#define SRCLEAR_ZBUFFER	2
+
+#define SRFVF_XYZ			0x002
+#define SRFVF_XYZRHW		0x004
+#define SRFVF_NORMAL		0x010
+#define SRFVF_RESERVED1		0x020
+#define SRFVF_DIFFUSE		0x040
+#define SRFVF_SPECULAR		0x080
+#define SRFVF_TEXCOUNT_MASK	0xf00
+#define SRFVF_TEXCOUNT_SHIFT	8
+#define SRFVF_TEX1			0x100
+
+#define SRFVF_VERTEX	(SRFVF_XYZ | SRFVF_NORMAL | SRFVF_TEX1)
+#define SRFVF_LVERTEX	(SRFVF_XYZ | SRFVF_RESERVED1 | SRFVF_DIFFUSE | SRFVF_SPECULAR | SRFVF_TEX1)
+#define SRFVF_TLVERTEX	(SRFVF_XYZRHW | SRFVF_DIFFUSE | SRFVF_SPECULAR | SRFVF_TEX1)
+
+//Direct3D2 vertex types (D3DVT_)
+#define SRVT_VERTEX		1
+#define SRVT_LVERTEX	2
+#define SRVT_TLVERTEX	3
+
+DWORD Soft_VT_To_FVF(DWORD dwVertexType);
+DWORD Soft_FVF_Stride(DWORD dwFVF);
+
+#define SR_MAX_TEXTURES 1024
+
+//debug views, Present() shows a color ramp of a per pixel counter
+//instead of the frame: black, blue, cyan, green, yellow, red, white
+#define SRDEBUG_NONE		0
+#define SRDEBUG_OVERDRAW	1	//writes since the last Clear(), one color step per write
+#define SRDEBUG_COST		2	//CPU cycles of the pixel, white is 4x the average pixel
+
+//texture is X8R8G8B8, first row is the top of the image,
+//width and height must be powers of two
+struct soft_texture
+{
+	DWORD *pBits;
+	DWORD dwWidth;
+	DWORD dwHeight;
+	DWORD dwHandle;
+};
+
+//vertex after transformation: clip space and screen space
+struct soft_vertex
+{
+	float x, y, z, w;
+	float sx, sy, sz, rhw;
+	float r, g, b, a;
+	float tu, tv;
+	DWORD dwClip;
+};
+
+struct render_stats;
+
+//where the parts of an input vertex are, for the vertex format of a draw
+struct soft_fetch
+{
+	DWORD dwFVF;
+	DWORD dwStride;
+	DWORD dwDiffuseOffset;
+	DWORD dwTexOffset;
+	DWORD dwTexCount;
+	bool bTransformed;
+};
+
+//with SetVertexCache(true) indexed triangle lists transform the vertices
+//as the triangles use them and keep the last SOFT_VERTEX_CACHE, first in
+//first out like the post transform cache of a graphics card, so the
+//vertices transformed per triangle are the ACMR of the index order
+//(MeshOptimize.h). Without it every vertex of the draw is transformed
+//once before the triangles, that is the faster one on a CPU
+#define SOFT_VERTEX_CACHE		32
+#define SOFT_CACHE_RING			(SOFT_VERTEX_CACHE + 2)
+#define SOFT_CACHE_HASH			256
+
+struct soft_vertex_cache
+{
+	soft_vertex *pVerts;			//SOFT_CACHE_RING slots
+	DWORD Tags[SOFT_CACHE_RING];	//index of the vertex in the slot
+	DWORD Ages[SOFT_CACHE_RING];	//dwMisses when it was filled
+	DWORD Slots[SOFT_CACHE_HASH];	//last slot filled with these low bits of the index
+	DWORD dwNext;					//slot of the next miss
+	DWORD dwHits;
+	DWORD dwMisses;
+};
+
+//one scanline of a triangle, SoftDevice.cpp
+struct soft_span;
+typedef void (*soft_span_func)(soft_span *pSpan);
+
+//the pixel pipeline is a span function made for one set of states (Z
+//test and write, Z function, texture filter, perspective, color op), it
+//has no tests of states inside the pixel loop. The pipeline is picked
+//again only after a state it depends on was changed
+struct soft_pipeline
+{
+	DWORD dwKey;
+	bool bTexture;				//the color op reads the texture of stage 0
+	bool bPerspective;
+	soft_span_func pfnUntextured;	//stage 0 has no texture
+	soft_span_func pfnMinify;
+	soft_span_func pfnMagnify;
+};
+
+class CSoftDevice : public IRenderDevice
+{
+public:
+	HRESULT SetRenderState(DWORD dwState, DWORD dwValue);
+	HRESULT GetRenderState(DWORD dwState, DWORD *pdwValue);
+	HRESULT SetTextureStageState(DWORD dwStage, DWORD dwState, DWORD dwValue);
+	HRESULT SetTexture(DWORD dwStage, soft_texture *pTexture);
+	HRESULT SetTransform(DWORD dwState, const matrix4x4 *pMatrix);
+	HRESULT SetViewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight);
+	HRESULT ApplyStateBlock(state_block *pBlock);
+
+	HRESULT Clear(DWORD dwCount, const RECT *pRects, DWORD dwFlags, DWORD dwColor, float fZ);
+	HRESULT BeginScene();
+	HRESULT EndScene();
+
+	HRESULT DrawIndexedPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const WORD *pIndices, DWORD dwIndexCount, DWORD dwFlags);
+	HRESULT DrawPrimitive(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount, DWORD dwFlags);
+	//32 bit indices, for more than SRMAXNUMVERTICES vertices in one call. Not part of
+	//IRenderDevice, DirectX 6 has only 16 bit indices (Mesh_Draw() splits
+	//the meshes for the other devices)
+	HRESULT DrawIndexedPrimitive32(DWORD dwPrimType, DWORD dwFVF,
+					const void *pVertices, DWORD dwVertexCount,
+					const DWORD *pIndices, DWORD dwIndexCount, DWORD dwFlags);
+
+	HRESULT CreateTexture(DWORD dwWidth, DWORD dwHeight, soft_texture **ppTexture);
+	void DestroyTexture(soft_texture *pTexture);
+	//same as IDirect3DTexture2::GetHandle() for SRRS_TEXTUREHANDLE
+	DWORD GetTextureHandle(soft_texture *pTexture);
+
+	//new size of the color, Z and debug buffers, textures and states stay.
+	//The memory grows by half at least, so a window dragged bigger does
+	//not reallocate on every WM_SIZE, and is kept when the size goes down.
+	//The buffers are cleared and the viewport is the whole new size
+	HRESULT Resize(DWORD dwWidth, DWORD dwHeight);
+
+	DWORD GetWidth() { return m_dwWidth; }
+	DWORD GetHeight() { return m_dwHeight; }
+	//pitch is in pixels
+	DWORD *GetColorBuffer(DWORD *pdwPitch);
+	float *GetZBuffer(DWORD *pdwPitch);
+
+	HRESULT SetDebugMode(DWORD dwMode);
+	DWORD GetDebugMode() { return m_dwDebugMode; }
+
+	void SetVertexCache(bool bEnable) { m_bVertexCache = bEnable; }
+	//write counts or cycles, NULL when the debug mode was never set
+	DWORD *GetDebugBuffer(DWORD *pdwPitch);
+
+	//copy the color buffer into 32 bit memory, for example a locked
+	//DirectDraw surface, pRect NULL copies the whole buffer
+	HRESULT Present(void *pDest, LONG lDestPitch, const RECT *pRect);
+
+	//bounds of the pixels the triangles of this scene covered, from
+	//BeginScene() on, an empty rectangle when nothing was drawn. Clear()
+	//is not included (DirtyRect.h)
+	void GetDrawnRect(RECT *pRect);
+
+	ULONG Release();
+
+private:
+	friend HRESULT Create_Soft_Device(DWORD dwWidth, DWORD dwHeight, bool bZBuffer, CSoftDevice **ppDevice);
+
+	CSoftDevice();
+	~CSoftDevice();
+
+	HRESULT Init(DWORD dwWidth, DWORD dwHeight, bool bZBuffer);
+	void Setup_Fetch(DWORD dwFVF, soft_fetch *pFetch);
+	void Process_Vertex(const soft_fetch *pFetch, const BYTE *pIn, soft_vertex *pOut);
+	void Process_Vertices(DWORD dwFVF, const void *pVertices, DWORD dwVertexCount);
+	const soft_vertex *Cached_Vertex(soft_vertex_cache *pCache, DWORD v, const soft_fetch *pFetch, const BYTE *pVertices);
+	HRESULT Draw_Cached(DWORD dwFVF, const void *pVertices, DWORD dwVertexCount,
+					const void *pIndices, DWORD dwIndexSize, DWORD dwTriCount);
+	void Draw_Triangle(const soft_vertex *pV0, const soft_vertex *pV1, const soft_vertex *pV2, render_stats *pStats);
+	void Draw_Clipped(const soft_vertex *pV0, const soft_vertex *pV1, const soft_vertex *pV2, render_stats *pStats);
+	bool Rasterize(const soft_vertex *pV0, const soft_vertex *pV1, const soft_vertex *pV2, render_stats *pStats);
+	void Project(soft_vertex *pVert);
+	void Select_Pipeline();
+	void Set_Pipeline(DWORD dwKey);
+	void Present_Debug(void *pDest, LONG lDestPitch, const RECT *pRect);
+	//pIndices are WORDs or DWORDs by dwIndexSize, NULL draws the vertices in order
+	HRESULT Draw(DWORD dwPrimType, DWORD dwFVF, const void *pVertices, DWORD dwVertexCount,
+					const void *pIndices, DWORD dwIndexSize, DWORD dwIndexCount);
+
+	DWORD m_dwWidth;
+	DWORD m_dwHeight;
+	DWORD m_dwCapacity;		//pixels of the buffers
+	DWORD *m_pColor;
+	float *m_pZ;
+
+	DWORD m_dwViewX, m_dwViewY, m_dwViewWidth, m_dwViewHeight;
+
+	DWORD m_dwDebugMode;
+	DWORD *m_pDebug;
+	DWORD m_Ramp[256];
+
+	DWORD m_RenderState[SRRS_MAX];
+	DWORD m_TextureState[SR_MAX_TEXTURE_STAGES][SRTSS_MAX];
+	soft_texture *m_pTexture[SR_MAX_TEXTURE_STAGES];
+	soft_texture *m_pTextures[SR_MAX_TEXTURES];
+
+	soft_pipeline m_Pipeline;
+	bool m_bPipelineDirty;
+
+	matrix4x4 m_MatWorld;
+	matrix4x4 m_MatView;
+	matrix4x4 m_MatProj;
+	matrix4x4 m_MatWVP;
+	bool m_bMatrixDirty;
+
+	//vertices of the draw in progress, from the frame arena (FrameArena.h)
+	soft_vertex *m_pVerts;
+
+	RECT m_RcDrawn;
+
+	bool m_bVertexCache;
+	bool m_bInScene;
+};
+
+HRESULT Create_Soft_Device(DWORD dwWidth, DWORD dwHeight, bool bZBuffer, CSoftDevice **ppDevice);
+
+#endif
@@ -0,0 +1,45 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include "SpscQueue.h"
+
+void Spsc_Init(spsc_queue *pQueue)
+{
+	ZeroMemory(pQueue->pItems, sizeof(pQueue->pItems));
+	pQueue->Head = 0;
+	pQueue->Tail = 0;
+}
+
+bool Spsc_Push(spsc_queue *pQueue, void *pItem)
+{
+	LONG Tail = pQueue->Tail;
+	//unsigned, the counters may wrap around
+	if((DWORD)Tail - (DWORD)pQueue->Head == SPSC_CAPACITY)
+		return false;
+
+	pQueue->pItems[Tail & (SPSC_CAPACITY - 1)] = pItem;
+
+	//the item is written before the consumer can see the new Tail
+	Memory_Barrier();
+	pQueue->Tail = (LONG)((DWORD)Tail + 1);
+
+	return true;
+}
+
+void *Spsc_Pop(spsc_queue *pQueue)
+{
+	LONG Head = pQueue->Head;
+	if(Head == pQueue->Tail)
+		return NULL;
+
+	//the item is read after Tail said it is there
+	Memory_Barrier();
+	void *pItem = pQueue->pItems[Head & (SPSC_CAPACITY - 1)];
+
+	//and before the producer may write the place again
+	Memory_Barrier();
+	pQueue->Head = (LONG)((DWORD)Head + 1);
+
+	return pItem;
+}
@@ -0,0 +1,31 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _SPSCQUEUE_H_
+#define _SPSCQUEUE_H_
+
+#include "Platform.h"
+
+//ring of pointers between exactly one producer thread and one consumer
+//thread, no locks. The producer writes only Tail, the consumer only Head,
+//each on its own cache line. Spsc_Push() and Spsc_Pop() never wait, the
+//caller waits on an event when the queue is full or empty
+
+#define SPSC_CAPACITY 8		//power of two
+
+struct spsc_queue
+{
+	void *pItems[SPSC_CAPACITY];
+	ALIGN_CACHE volatile LONG Head;		//next item to pop
+	ALIGN_CACHE volatile LONG Tail;		//next free place
+};
+
+void Spsc_Init(spsc_queue *pQueue);
+
+//false when the queue is full
+bool Spsc_Push(spsc_queue *pQueue, void *pItem);
+//NULL when the queue is empty
+void *Spsc_Pop(spsc_queue *pQueue);
+
+#endif
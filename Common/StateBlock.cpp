@@ -0,0 +1,77 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include "StateBlock.h"
+
+void State_Block_Init(state_block *pBlock)
+{
+	ZeroMemory(pBlock, sizeof(state_block));
+}
+
+static state_block_entry *Find_Entry(const state_block *pBlock, DWORD dwStage, DWORD dwState)
+{
+	for(DWORD i = 0; i < pBlock->dwCount; i++)
+	{
+		const state_block_entry *pEntry = &pBlock->Entries[i];
+		if(pEntry->dwStage == dwStage && pEntry->dwState == dwState)
+			return (state_block_entry *)pEntry;
+	}
+
+	return NULL;
+}
+
+static bool Set_Entry(state_block *pBlock, DWORD dwStage, DWORD dwState, DWORD dwValue)
+{
+	state_block_entry *pEntry = Find_Entry(pBlock, dwStage, dwState);
+	if(!pEntry)
+	{
+		if(pBlock->dwCount >= SB_MAX_STATES)
+			return false;
+
+		pEntry = &pBlock->Entries[pBlock->dwCount++];
+		pEntry->dwStage = dwStage;
+		pEntry->dwState = dwState;
+	}
+
+	pEntry->dwValue = dwValue;
+	pBlock->dwPipeline = 0;
+
+	return true;
+}
+
+bool State_Block_Render(state_block *pBlock, DWORD dwState, DWORD dwValue)
+{
+	if(dwState >= SB_MAX_RENDERSTATES)
+		return false;
+
+	return Set_Entry(pBlock, SB_RENDER, dwState, dwValue);
+}
+
+bool State_Block_Stage(state_block *pBlock, DWORD dwStage, DWORD dwState, DWORD dwValue)
+{
+	if(dwStage >= SB_MAX_STAGES || dwState >= SB_MAX_STAGESTATES)
+		return false;
+
+	return Set_Entry(pBlock, dwStage, dwState, dwValue);
+}
+
+bool State_Block_Get_Render(const state_block *pBlock, DWORD dwState, DWORD *pdwValue)
+{
+	const state_block_entry *pEntry = Find_Entry(pBlock, SB_RENDER, dwState);
+	if(!pEntry)
+		return false;
+
+	*pdwValue = pEntry->dwValue;
+	return true;
+}
+
+bool State_Block_Get_Stage(const state_block *pBlock, DWORD dwStage, DWORD dwState, DWORD *pdwValue)
+{
+	const state_block_entry *pEntry = Find_Entry(pBlock, dwStage, dwState);
+	if(!pEntry)
+		return false;
+
+	*pdwValue = pEntry->dwValue;
+	return true;
+}
@@ -0,0 +1,55 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _STATEBLOCK_H_
+#define _STATEBLOCK_H_
+
+#include "Platform.h"
+
+//a set of render states and texture stage states that is applied in one
+//call. The block is filled once (Init_Scene()), the device compares it
+//with the state it has and sets only the values that are different.
+//
+//the block knows nothing about the device: the D3D samples apply it with
+//D3DStateFilter.h, code that draws through IRenderDevice with
+//ApplyStateBlock(). CSoftDevice keeps the pixel pipeline it picked for
+//the block in dwPipeline, a block that sets every state of the pipeline
+//switches it without looking at the states again
+
+#define SB_MAX_STATES			32
+#define SB_MAX_RENDERSTATES		256
+#define SB_MAX_STAGES			8
+#define SB_MAX_STAGESTATES		32
+
+//dwStage of a render state
+#define SB_RENDER				0xffffffff
+
+struct state_block_entry
+{
+	DWORD dwStage;
+	DWORD dwState;
+	DWORD dwValue;
+};
+
+struct state_block
+{
+	state_block_entry Entries[SB_MAX_STATES];
+	DWORD dwCount;
+
+	//for the device, 0 after every change of the block
+	DWORD dwPipeline;
+};
+
+void State_Block_Init(state_block *pBlock);
+
+//a state that is already in the block gets the new value. false when the
+//block is full or the state is out of range
+bool State_Block_Render(state_block *pBlock, DWORD dwState, DWORD dwValue);
+bool State_Block_Stage(state_block *pBlock, DWORD dwStage, DWORD dwState, DWORD dwValue);
+
+//false when the block does not set the state
+bool State_Block_Get_Render(const state_block *pBlock, DWORD dwState, DWORD *pdwValue);
+bool State_Block_Get_Stage(const state_block *pBlock, DWORD dwStage, DWORD dwState, DWORD *pdwValue);
+
+#endif
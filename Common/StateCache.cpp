@@ -0,0 +1,150 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+
+#include "StateCache.h"
+
+void State_Cache_Reset(state_cache *pCache)
+{
+	state_cache_stats Stats = pCache->Stats;
+	ZeroMemory(pCache, sizeof(state_cache));
+	pCache->Stats = Stats;
+}
+
+void State_Cache_Clear_Stats(state_cache *pCache)
+{
+	ZeroMemory(&pCache->Stats, sizeof(state_cache_stats));
+}
+
+static bool Count(state_cache *pCache, int Kind, bool bForward)
+{
+	if(bForward)
+		pCache->Stats.dwForwarded[Kind]++;
+	else
+		pCache->Stats.dwFiltered[Kind]++;
+
+	return bForward;
+}
+
+bool State_Cache_Render(state_cache *pCache, DWORD dwState, DWORD dwValue)
+{
+	if(dwState >= SC_MAX_RENDERSTATES)
+		return Count(pCache, SC_RENDERSTATE, true);
+
+	DWORD dwBit = 1u << (dwState & 31);
+	DWORD *pKnown = &pCache->RenderKnown[dwState >> 5];
+
+	if((*pKnown & dwBit) && pCache->RenderState[dwState] == dwValue)
+		return Count(pCache, SC_RENDERSTATE, false);
+
+	*pKnown |= dwBit;
+	pCache->RenderState[dwState] = dwValue;
+
+	return Count(pCache, SC_RENDERSTATE, true);
+}
+
+bool State_Cache_Stage(state_cache *pCache, DWORD dwStage, DWORD dwState, DWORD dwValue)
+{
+	if(dwStage >= SC_MAX_STAGES || dwState >= SC_MAX_STAGESTATES)
+		return Count(pCache, SC_STAGESTATE, true);
+
+	DWORD dwBit = 1u << dwState;
+
+	if((pCache->StageKnown[dwStage] & dwBit) && pCache->StageState[dwStage][dwState] == dwValue)
+		return Count(pCache, SC_STAGESTATE, false);
+
+	pCache->StageKnown[dwStage] |= dwBit;
+	pCache->StageState[dwStage][dwState] = dwValue;
+
+	return Count(pCache, SC_STAGESTATE, true);
+}
+
+bool State_Cache_Texture(state_cache *pCache, DWORD dwStage, const void *pTexture)
+{
+	if(dwStage >= SC_MAX_STAGES)
+		return Count(pCache, SC_TEXTURE, true);
+
+	DWORD dwBit = 1u << dwStage;
+
+	if((pCache->dwTextureKnown & dwBit) && pCache->pTexture[dwStage] == pTexture)
+		return Count(pCache, SC_TEXTURE, false);
+
+	pCache->dwTextureKnown |= dwBit;
+	pCache->pTexture[dwStage] = pTexture;
+
+	return Count(pCache, SC_TEXTURE, true);
+}
+
+//the matrices are compared bit by bit, -0.0 and 0.0 count as different
+bool State_Cache_Transform(state_cache *pCache, DWORD dwState, const float *pMatrix)
+{
+	if(dwState >= SC_MAX_TRANSFORMS || !pMatrix)
+		return Count(pCache, SC_TRANSFORM, true);
+
+	DWORD dwBit = 1u << dwState;
+
+	if((pCache->dwTransformKnown & dwBit) &&
+		memcmp(pCache->Transform[dwState], pMatrix, sizeof(float) * 16) == 0)
+		return Count(pCache, SC_TRANSFORM, false);
+
+	pCache->dwTransformKnown |= dwBit;
+	memcpy(pCache->Transform[dwState], pMatrix, sizeof(float) * 16);
+
+	return Count(pCache, SC_TRANSFORM, true);
+}
+
+void State_Cache_Forget_Texture(state_cache *pCache, const void *pTexture)
+{
+	for(DWORD i = 0; i < SC_MAX_STAGES; i++)
+	{
+		if(pCache->pTexture[i] == pTexture)
+			pCache->dwTextureKnown &= ~(1u << i);
+	}
+}
+
+void State_Cache_Forget_Render(state_cache *pCache, DWORD dwState)
+{
+	if(dwState < SC_MAX_RENDERSTATES)
+		pCache->RenderKnown[dwState >> 5] &= ~(1u << (dwState & 31));
+}
+
+void State_Cache_Forget_Stage_Texture(state_cache *pCache, DWORD dwStage)
+{
+	if(dwStage < SC_MAX_STAGES)
+		pCache->dwTextureKnown &= ~(1u << dwStage);
+}
+
+DWORD State_Cache_Forwarded(const state_cache *pCache)
+{
+	DWORD dwCount = 0;
+	for(int i = 0; i < SC_KINDS; i++)
+		dwCount += pCache->Stats.dwForwarded[i];
+	return dwCount;
+}
+
+DWORD State_Cache_Filtered(const state_cache *pCache)
+{
+	DWORD dwCount = 0;
+	for(int i = 0; i < SC_KINDS; i++)
+		dwCount += pCache->Stats.dwFiltered[i];
+	return dwCount;
+}
+
+void State_Cache_Format(const state_cache *pCache, char *szText, int Len)
+{
+	const state_cache_stats *pStats = &pCache->Stats;
+
+	char szLine[256];
+	sprintf(szLine, "state calls %u forwarded %u filtered (render %u/%u, stage %u/%u, texture %u/%u, transform %u/%u)",
+		(unsigned)State_Cache_Forwarded(pCache), (unsigned)State_Cache_Filtered(pCache),
+		(unsigned)pStats->dwForwarded[SC_RENDERSTATE], (unsigned)pStats->dwFiltered[SC_RENDERSTATE],
+		(unsigned)pStats->dwForwarded[SC_STAGESTATE], (unsigned)pStats->dwFiltered[SC_STAGESTATE],
+		(unsigned)pStats->dwForwarded[SC_TEXTURE], (unsigned)pStats->dwFiltered[SC_TEXTURE],
+		(unsigned)pStats->dwForwarded[SC_TRANSFORM], (unsigned)pStats->dwFiltered[SC_TRANSFORM]);
+
+	strncpy(szText, szLine, Len - 1);
+	szText[Len - 1] = 0;
+}
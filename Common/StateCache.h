@@ -0,0 +1,80 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _STATECACHE_H_
+#define _STATECACHE_H_
+
+#include "Platform.h"
+
+//shadow copy of the device state. Before a Set call goes to the device
+//the cache is asked, a call that sets the value the device already has
+//is dropped. Nothing is known after State_Cache_Reset(), the first call
+//of every state is passed on, so the defaults of the device do not
+//matter. Call State_Cache_Reset() when the device was changed around
+//the cache (new device, restored surfaces, state blocks).
+//
+//the cache knows nothing about the device, the D3D samples use it
+//through D3DStateFilter.h, the software device through FilterDevice.h
+
+#define SC_MAX_RENDERSTATES		256
+#define SC_MAX_STAGES			8
+#define SC_MAX_STAGESTATES		32
+#define SC_MAX_TRANSFORMS		4
+
+enum
+{
+	SC_RENDERSTATE,
+	SC_STAGESTATE,
+	SC_TEXTURE,
+	SC_TRANSFORM,
+	SC_KINDS
+};
+
+struct state_cache_stats
+{
+	DWORD dwForwarded[SC_KINDS];
+	DWORD dwFiltered[SC_KINDS];
+};
+
+struct state_cache
+{
+	DWORD RenderState[SC_MAX_RENDERSTATES];
+	DWORD StageState[SC_MAX_STAGES][SC_MAX_STAGESTATES];
+	const void *pTexture[SC_MAX_STAGES];
+	float Transform[SC_MAX_TRANSFORMS][16];
+
+	//one bit per value above, set when the value is known
+	DWORD RenderKnown[SC_MAX_RENDERSTATES / 32];
+	DWORD StageKnown[SC_MAX_STAGES];
+	DWORD dwTextureKnown;
+	DWORD dwTransformKnown;
+
+	state_cache_stats Stats;
+};
+
+//forget the state, the counters stay
+void State_Cache_Reset(state_cache *pCache);
+void State_Cache_Clear_Stats(state_cache *pCache);
+
+//true when the call must go to the device, the new value is stored.
+//states out of range are always passed on and never stored
+bool State_Cache_Render(state_cache *pCache, DWORD dwState, DWORD dwValue);
+bool State_Cache_Stage(state_cache *pCache, DWORD dwStage, DWORD dwState, DWORD dwValue);
+bool State_Cache_Texture(state_cache *pCache, DWORD dwStage, const void *pTexture);
+bool State_Cache_Transform(state_cache *pCache, DWORD dwState, const float *pMatrix);
+
+//a destroyed texture may come back at the same address or with the same
+//handle, the stages that had it and the handle state must be set again
+void State_Cache_Forget_Texture(state_cache *pCache, const void *pTexture);
+void State_Cache_Forget_Render(state_cache *pCache, DWORD dwState);
+//the texture of the stage was set another way (the texture handle)
+void State_Cache_Forget_Stage_Texture(state_cache *pCache, DWORD dwStage);
+
+DWORD State_Cache_Forwarded(const state_cache *pCache);
+DWORD State_Cache_Filtered(const state_cache *pCache);
+
+//one line of text: forwarded and filtered calls of every kind
+void State_Cache_Format(const state_cache *pCache, char *szText, int Len);
+
+#endif
@@ -0,0 +1,319 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include "Trace.h"
+
+#include <stdio.h>
+
+//one slot of the ring, Sequence tells who owns the slot:
+//Sequence == position - slot is free for the producer,
+//Sequence == position + 1 - slot is filled, the writer can take it
+struct trace_event
+{
+	volatile LONG Sequence;
+	char Phase;
+	const char *szName;
+	DWORD dwThreadId;
+	LONGLONG Start;
+	LONGLONG Value;
+};
+
+volatile LONG g_TraceEnabled = 0;
+
+static trace_event *g_pTraceRing = NULL;
+static DWORD g_dwTraceMask = 0;
+static volatile LONG g_TraceHead = 0;
+static LONG g_TraceTail = 0;
+static volatile LONG g_TraceDropped = 0;
+static volatile LONG g_TraceQuit = 0;
+
+static FILE *g_pTraceFile = NULL;
+static LONGLONG g_TraceStartTicks = 0;
+static bool g_bTraceFirst = true;
+
+static thread_handle g_TraceThread;
+static event g_TraceWake;
+
+//formatted text is collected here and written in big blocks
+static char g_TraceText[65536];
+static DWORD g_dwTraceTextLen = 0;
+
+static THREAD_LOCAL DWORD t_dwTraceThreadId = 0;
+
+static DWORD Trace_Thread_Id()
+{
+	if(!t_dwTraceThreadId)
+		t_dwTraceThreadId = Thread_Id();
+	return t_dwTraceThreadId;
+}
+
+static trace_event *Trace_Reserve()
+{
+	LONG Pos = g_TraceHead;
+
+	for(;;)
+	{
+		trace_event *pEvent = &g_pTraceRing[(DWORD)Pos & g_dwTraceMask];
+		LONG Diff = (LONG)((DWORD)pEvent->Sequence - (DWORD)Pos);
+
+		if(Diff == 0)
+		{
+			if(Atomic_Compare_Exchange(&g_TraceHead, Pos + 1, Pos) == Pos)
+			{
+				//wake the writer when half of the ring is used
+				if(((DWORD)Pos & (g_dwTraceMask >> 1)) == 0)
+					Event_Signal(&g_TraceWake);
+				return pEvent;
+			}
+		}
+		else if(Diff < 0)
+		{
+			//ring is full, the writer is behind
+			Atomic_Increment(&g_TraceDropped);
+			return NULL;
+		}
+
+		Pos = g_TraceHead;
+	}
+}
+
+static void Trace_Commit(trace_event *pEvent)
+{
+	LONG Pos = pEvent->Sequence;
+	Memory_Barrier();
+	pEvent->Sequence = Pos + 1;
+}
+
+static void Trace_Push(char Phase, const char *szName, LONGLONG Start, LONGLONG Value)
+{
+	trace_event *pEvent = Trace_Reserve();
+	if(!pEvent)
+		return;
+
+	pEvent->Phase = Phase;
+	pEvent->szName = szName;
+	pEvent->dwThreadId = Trace_Thread_Id();
+	pEvent->Start = Start;
+	pEvent->Value = Value;
+
+	Trace_Commit(pEvent);
+}
+
+static void Trace_Flush_Text()
+{
+	if(g_dwTraceTextLen)
+		fwrite(g_TraceText, 1, g_dwTraceTextLen, g_pTraceFile);
+	g_dwTraceTextLen = 0;
+}
+
+static double Trace_Microseconds(LONGLONG Ticks)
+{
+	return (double)Ticks * 1000000.0 / (double)Timer_Frequency();
+}
+
+static void Trace_Format(const trace_event *pEvent)
+{
+	if(g_dwTraceTextLen > sizeof(g_TraceText) - 512)
+		Trace_Flush_Text();
+
+	char *pOut = g_TraceText + g_dwTraceTextLen;
+	const char *szSep = g_bTraceFirst ? "" : ",\n";
+	int Len = 0;
+
+	switch(pEvent->Phase)
+	{
+		case 'X':
+			Len = sprintf(pOut, "%s{\"name\":\"%s\",\"cat\":\"app\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+				szSep, pEvent->szName, Trace_Microseconds(pEvent->Start - g_TraceStartTicks),
+				Trace_Microseconds(pEvent->Value), (unsigned)pEvent->dwThreadId);
+			break;
+		case 'i':
+			Len = sprintf(pOut, "%s{\"name\":\"%s\",\"cat\":\"app\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+				szSep, pEvent->szName, Trace_Microseconds(pEvent->Start - g_TraceStartTicks),
+				(unsigned)pEvent->dwThreadId);
+			break;
+		case 'C':
+			Len = sprintf(pOut, "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%ld}}",
+				szSep, pEvent->szName, Trace_Microseconds(pEvent->Start - g_TraceStartTicks),
+				(unsigned)pEvent->dwThreadId, (long)pEvent->Value);
+			break;
+		case 'M':
+			Len = sprintf(pOut, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				szSep, (unsigned)pEvent->dwThreadId, pEvent->szName);
+			break;
+	}
+
+	if(Len > 0)
+	{
+		g_dwTraceTextLen += Len;
+		g_bTraceFirst = false;
+	}
+}
+
+//the events of other threads, the writer's own (its name and the
+//flushes) are written but not counted
+static DWORD Trace_Drain()
+{
+	DWORD dwCount = 0;
+	DWORD dwWriter = Trace_Thread_Id();
+
+	for(;;)
+	{
+		trace_event *pEvent = &g_pTraceRing[(DWORD)g_TraceTail & g_dwTraceMask];
+		if(pEvent->Sequence != g_TraceTail + 1)
+			break;
+
+		Memory_Barrier();
+		Trace_Format(pEvent);
+		if(pEvent->dwThreadId != dwWriter)
+			dwCount++;
+		Memory_Barrier();
+
+		pEvent->Sequence = g_TraceTail + (LONG)(g_dwTraceMask + 1);
+		g_TraceTail++;
+	}
+
+	return dwCount;
+}
+
+static void Trace_Writer_Thread(void *pParam)
+{
+	UNREFERENCED_PARAMETER(pParam);
+
+	Trace_Set_Thread_Name("Trace_Writer");
+
+	while(!g_TraceQuit)
+	{
+		Event_Wait(&g_TraceWake, 20);
+
+		//an idle program writes nothing, the flush event alone does not
+		//make the next flush
+		LONGLONG Start = Timer_Ticks();
+		if(Trace_Drain())
+		{
+			Trace_Flush_Text();
+			if(g_TraceEnabled)
+				Trace_Complete("Trace_Flush", Start, Timer_Ticks());
+		}
+	}
+
+	Trace_Drain();
+	Trace_Flush_Text();
+}
+
+bool Trace_Init(const char *szFilename, DWORD dwCapacity)
+{
+	if(g_pTraceFile)
+		return true;
+
+	//capacity must be a power of two for the index mask
+	DWORD dwSize = 1024;
+	while(dwSize < dwCapacity)
+		dwSize <<= 1;
+
+	g_pTraceFile = fopen(szFilename, "wb");
+	if(!g_pTraceFile)
+		return false;
+
+	g_pTraceRing = (trace_event*)Aligned_Alloc(dwSize * sizeof(trace_event), CACHE_LINE_SIZE);
+	if(!g_pTraceRing)
+	{
+		fclose(g_pTraceFile);
+		g_pTraceFile = NULL;
+		return false;
+	}
+
+	for(DWORD i = 0; i < dwSize; i++)
+		g_pTraceRing[i].Sequence = (LONG)i;
+
+	g_dwTraceMask = dwSize - 1;
+	g_TraceHead = 0;
+	g_TraceTail = 0;
+	g_TraceDropped = 0;
+	g_TraceQuit = 0;
+	g_bTraceFirst = true;
+	g_TraceStartTicks = Timer_Ticks();
+
+	fputs("{\"traceEvents\":[\n", g_pTraceFile);
+
+	Event_Init(&g_TraceWake);
+	if(!Thread_Create(&g_TraceThread, Trace_Writer_Thread, NULL))
+	{
+		Event_Destroy(&g_TraceWake);
+		Aligned_Free(g_pTraceRing);
+		g_pTraceRing = NULL;
+		fclose(g_pTraceFile);
+		g_pTraceFile = NULL;
+		return false;
+	}
+
+	Trace_Set_Thread_Name("Main");
+	g_TraceEnabled = 1;
+
+	return true;
+}
+
+void Trace_Shutdown()
+{
+	if(!g_pTraceFile)
+		return;
+
+	g_TraceEnabled = 0;
+	Atomic_Exchange(&g_TraceQuit, 1);
+	Event_Signal(&g_TraceWake);
+	Thread_Join(&g_TraceThread);
+	Event_Destroy(&g_TraceWake);
+
+	fprintf(g_pTraceFile, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%u}}\n",
+		(unsigned)g_TraceDropped);
+	fclose(g_pTraceFile);
+	g_pTraceFile = NULL;
+
+	Aligned_Free(g_pTraceRing);
+	g_pTraceRing = NULL;
+}
+
+void Trace_Enable(bool bEnable)
+{
+	if(!g_pTraceFile)
+		return;
+
+	Atomic_Exchange(&g_TraceEnabled, bEnable ? 1 : 0);
+}
+
+bool Trace_Is_Open()
+{
+	return g_pTraceFile != NULL;
+}
+
+void Trace_Set_Thread_Name(const char *szName)
+{
+	//thread names are written even while tracing is paused,
+	//otherwise the viewer shows bare thread ids
+	if(g_pTraceFile)
+		Trace_Push('M', szName, 0, 0);
+}
+
+void Trace_Complete(const char *szName, LONGLONG Start, LONGLONG End)
+{
+	if(g_TraceEnabled)
+		Trace_Push('X', szName, Start, End - Start);
+}
+
+void Trace_Instant(const char *szName)
+{
+	if(g_TraceEnabled)
+		Trace_Push('i', szName, Timer_Ticks(), 0);
+}
+
+void Trace_Counter(const char *szName, LONG Value)
+{
+	if(g_TraceEnabled)
+		Trace_Push('C', szName, Timer_Ticks(), Value);
+}
+
+DWORD Trace_Dropped()
+{
+	return (DWORD)g_TraceDropped;
+}
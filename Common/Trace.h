@@ -0,0 +1,60 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "Platform.h"
+
+//trace events in Chrome about://tracing (Perfetto) JSON format.
+//events are written into a fixed ring buffer allocated in Trace_Init(),
+//a background thread formats the ring into the file. event names must
+//be string literals, only the pointer is stored.
+//when tracing is off a marker costs one load of g_TraceEnabled
+
+extern volatile LONG g_TraceEnabled;
+
+bool Trace_Init(const char *szFilename, DWORD dwCapacity = 65536);
+void Trace_Shutdown();
+
+//runtime switch, the file stays open while tracing is paused
+void Trace_Enable(bool bEnable);
+bool Trace_Is_Open();
+
+void Trace_Set_Thread_Name(const char *szName);
+void Trace_Complete(const char *szName, LONGLONG Start, LONGLONG End);
+void Trace_Instant(const char *szName);
+void Trace_Counter(const char *szName, LONG Value);
+
+//events lost because the ring was full
+DWORD Trace_Dropped();
+
+struct trace_scope
+{
+	const char *m_szName;
+	LONGLONG m_Start;
+
+	trace_scope(const char *szName)
+	{
+		m_szName = szName;
+		m_Start = g_TraceEnabled ? Timer_Ticks() : 0;
+	}
+
+	~trace_scope()
+	{
+		if(m_Start)
+			Trace_Complete(m_szName, m_Start, Timer_Ticks());
+	}
+};
+
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+
+#ifdef TRACE_DISABLE
+#define TRACE_SCOPE(Name)
+#else
+#define TRACE_SCOPE(Name) trace_scope TRACE_JOIN(TraceScope_, __LINE__)(Name)
+#endif
+
+#endif
@@ -0,0 +1,294 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <string.h>
+#include <new>
+
+#include "VertexBuffer.h"
+#include "RenderStats.h"
+
+//what a block of the destination holds: the vertices [dwValidFirst,
+//dwValidEnd) of the block were made from the buffer dwSrcId with the
+//matrix and the viewport, when the source had the version dwSrcVersion
+struct vb_block
+{
+	DWORD dwSrcId;			//0 when the block holds nothing
+	DWORD dwSrcFirst;		//source vertex of the first vertex of the block
+	DWORD dwSrcVersion;
+	DWORD dwValidFirst;
+	DWORD dwValidEnd;
+	float Mat[16];
+	vb_viewport Viewport;
+};
+
+//offsets of the components in a vertex of the format
+struct vb_layout
+{
+	DWORD dwStride;
+	DWORD dwDiffuse;
+	DWORD dwSpecular;
+	DWORD dwTex;
+	DWORD dwTexCount;
+};
+
+static volatile LONG g_NextId = 0;
+
+struct vertex_buffer
+{
+	DWORD dwId;		//a new buffer at the address of a destroyed one is not the same source
+	DWORD dwFVF;
+	DWORD dwCount;
+	vb_layout Layout;
+	BYTE *pData;
+
+	//version of every block as a source, a lock gives the blocks of the
+	//range the next dwVersion
+	DWORD *pBlockVersion;
+	DWORD dwVersion;
+
+	//SRFVF_XYZRHW only, what the blocks hold as a destination
+	vb_block *pBlocks;
+};
+
+static void Get_Layout(DWORD dwFVF, vb_layout *pLayout)
+{
+	//the same offsets as CSoftDevice::Process_Vertices()
+	DWORD dwOffset = (dwFVF & SRFVF_XYZRHW) ? 16 : 12;
+	if(dwFVF & SRFVF_NORMAL) dwOffset += 12;
+	if(dwFVF & SRFVF_RESERVED1) dwOffset += 4;
+	pLayout->dwDiffuse = dwOffset;
+	if(dwFVF & SRFVF_DIFFUSE) dwOffset += 4;
+	pLayout->dwSpecular = dwOffset;
+	if(dwFVF & SRFVF_SPECULAR) dwOffset += 4;
+	pLayout->dwTex = dwOffset;
+	pLayout->dwTexCount = (dwFVF & SRFVF_TEXCOUNT_MASK) >> SRFVF_TEXCOUNT_SHIFT;
+	pLayout->dwStride = dwOffset + pLayout->dwTexCount * 8;
+}
+
+static DWORD Block_Count(DWORD dwVertexCount)
+{
+	return (dwVertexCount + VB_BLOCK - 1) / VB_BLOCK;
+}
+
+vertex_buffer *Vertex_Buffer_Create(DWORD dwFVF, DWORD dwVertexCount)
+{
+	if(!dwVertexCount || !(dwFVF & (SRFVF_XYZ | SRFVF_XYZRHW)))
+		return NULL;
+
+	vertex_buffer *pVB = new(std::nothrow) vertex_buffer;
+	if(!pVB)
+		return NULL;
+
+	ZeroMemory(pVB, sizeof(vertex_buffer));
+	pVB->dwId = (DWORD)Atomic_Increment(&g_NextId);
+	pVB->dwFVF = dwFVF;
+	pVB->dwCount = dwVertexCount;
+	Get_Layout(dwFVF, &pVB->Layout);
+
+	DWORD dwBlocks = Block_Count(dwVertexCount);
+	pVB->pData = (BYTE *)Aligned_Alloc(dwVertexCount * pVB->Layout.dwStride, CACHE_LINE_SIZE);
+	pVB->pBlockVersion = (DWORD *)Aligned_Alloc(dwBlocks * sizeof(DWORD), CACHE_LINE_SIZE);
+
+	if(dwFVF & SRFVF_XYZRHW)
+		pVB->pBlocks = (vb_block *)Aligned_Alloc(dwBlocks * sizeof(vb_block), CACHE_LINE_SIZE);
+
+	if(!pVB->pData || !pVB->pBlockVersion || ((dwFVF & SRFVF_XYZRHW) && !pVB->pBlocks))
+	{
+		Vertex_Buffer_Destroy(pVB);
+		return NULL;
+	}
+
+	ZeroMemory(pVB->pData, dwVertexCount * pVB->Layout.dwStride);
+	ZeroMemory(pVB->pBlockVersion, dwBlocks * sizeof(DWORD));
+	if(pVB->pBlocks)
+		ZeroMemory(pVB->pBlocks, dwBlocks * sizeof(vb_block));
+
+	return pVB;
+}
+
+void Vertex_Buffer_Destroy(vertex_buffer *pVB)
+{
+	if(!pVB)
+		return;
+
+	Aligned_Free(pVB->pData);
+	Aligned_Free(pVB->pBlockVersion);
+	Aligned_Free(pVB->pBlocks);
+	delete pVB;
+}
+
+void *Vertex_Buffer_Lock(vertex_buffer *pVB, DWORD dwFirst, DWORD dwCount)
+{
+	if(dwFirst >= pVB->dwCount || dwCount > pVB->dwCount - dwFirst)
+		return NULL;
+
+	if(dwCount)
+	{
+		pVB->dwVersion++;
+
+		for(DWORD b = dwFirst / VB_BLOCK; b <= (dwFirst + dwCount - 1) / VB_BLOCK; b++)
+		{
+			pVB->pBlockVersion[b] = pVB->dwVersion;
+
+			//transformed vertices written by the application
+			if(pVB->pBlocks)
+				pVB->pBlocks[b].dwSrcId = 0;
+		}
+	}
+
+	return pVB->pData + dwFirst * pVB->Layout.dwStride;
+}
+
+const void *Vertex_Buffer_Data(const vertex_buffer *pVB)
+{
+	return pVB->pData;
+}
+
+DWORD Vertex_Buffer_FVF(const vertex_buffer *pVB)
+{
+	return pVB->dwFVF;
+}
+
+DWORD Vertex_Buffer_Count(const vertex_buffer *pVB)
+{
+	return pVB->dwCount;
+}
+
+//newest version of the source blocks under [dwFirst, dwEnd)
+static DWORD Source_Version(const vertex_buffer *pSrc, DWORD dwFirst, DWORD dwEnd)
+{
+	DWORD dwVersion = 0;
+	for(DWORD b = dwFirst / VB_BLOCK; b <= (dwEnd - 1) / VB_BLOCK; b++)
+	{
+		if(pSrc->pBlockVersion[b] > dwVersion)
+			dwVersion = pSrc->pBlockVersion[b];
+	}
+
+	return dwVersion;
+}
+
+static void Transform(vertex_buffer *pDest, DWORD dwDestIndex, const vertex_buffer *pSrc, DWORD dwSrcIndex,
+				DWORD dwCount, const matrix4x4 &Mat, const vb_viewport &Viewport)
+{
+	const vb_layout &In = pSrc->Layout;
+	const vb_layout &Out = pDest->Layout;
+
+	float fWidth = (float)Viewport.dwWidth;
+	float fHeight = (float)Viewport.dwHeight;
+	float fX = (float)Viewport.dwX;
+	float fY = (float)Viewport.dwY;
+
+	const BYTE *pIn = pSrc->pData + dwSrcIndex * In.dwStride;
+	BYTE *pOut = pDest->pData + dwDestIndex * Out.dwStride;
+
+	for(DWORD i = 0; i < dwCount; i++, pIn += In.dwStride, pOut += Out.dwStride)
+	{
+		const float *pPos = (const float *)pIn;
+		vector3 VecPos = { pPos[0], pPos[1], pPos[2] };
+		vector4 VecClip = Vec3_Mat4x4_Mul(VecPos, Mat);
+
+		//the same math as Update_Scene() of 003
+		float *pScreen = (float *)pOut;
+		pScreen[0] = fX + (VecClip.x / VecClip.w) * fWidth / 2.0f + fWidth / 2.0f;
+		pScreen[1] = fY - (VecClip.y / VecClip.w) * fHeight / 2.0f + fHeight / 2.0f;
+		pScreen[2] = VecClip.z / VecClip.w;
+		pScreen[3] = 1.0f / VecClip.w;
+
+		if(pDest->dwFVF & SRFVF_DIFFUSE)
+			*(DWORD *)(pOut + Out.dwDiffuse) = (pSrc->dwFVF & SRFVF_DIFFUSE) ? *(const DWORD *)(pIn + In.dwDiffuse) : 0xffffffff;
+
+		if(pDest->dwFVF & SRFVF_SPECULAR)
+			*(DWORD *)(pOut + Out.dwSpecular) = (pSrc->dwFVF & SRFVF_SPECULAR) ? *(const DWORD *)(pIn + In.dwSpecular) : 0;
+
+		for(DWORD t = 0; t < Out.dwTexCount; t++)
+		{
+			float *pTex = (float *)(pOut + Out.dwTex) + t * 2;
+			if(t < In.dwTexCount)
+			{
+				const float *pTexIn = (const float *)(pIn + In.dwTex) + t * 2;
+				pTex[0] = pTexIn[0];
+				pTex[1] = pTexIn[1];
+			}
+			else
+			{
+				pTex[0] = pTex[1] = 0.0f;
+			}
+		}
+	}
+}
+
+HRESULT Vertex_Buffer_Process(vertex_buffer *pDest, DWORD dwDestIndex, DWORD dwCount,
+				const vertex_buffer *pSrc, DWORD dwSrcIndex,
+				const matrix4x4 *pMatrix, const vb_viewport *pViewport)
+{
+	if(!pDest || !pSrc || !pMatrix || !pViewport || pDest == pSrc)
+		return E_INVALIDARG;
+
+	if(!(pDest->dwFVF & SRFVF_XYZRHW) || !(pSrc->dwFVF & SRFVF_XYZ))
+		return E_INVALIDARG;
+
+	if(dwDestIndex > pDest->dwCount || dwCount > pDest->dwCount - dwDestIndex ||
+		dwSrcIndex > pSrc->dwCount || dwCount > pSrc->dwCount - dwSrcIndex)
+		return E_INVALIDARG;
+
+	DWORD dwTransformed = 0;
+	DWORD dwEnd = dwDestIndex + dwCount;
+
+	for(DWORD dwFirst = dwDestIndex; dwFirst < dwEnd; )
+	{
+		DWORD b = dwFirst / VB_BLOCK;
+		DWORD dwBlockStart = b * VB_BLOCK;
+		DWORD dwLast = dwBlockStart + VB_BLOCK < dwEnd ? dwBlockStart + VB_BLOCK : dwEnd;
+
+		//the range in the block and in the source
+		DWORD dwLo = dwFirst - dwBlockStart;
+		DWORD dwHi = dwLast - dwBlockStart;
+		DWORD dwSrcFirst = dwSrcIndex + (dwFirst - dwDestIndex);
+		DWORD dwSrcBlockFirst = dwSrcFirst - dwLo;
+
+		vb_block *pBlock = &pDest->pBlocks[b];
+
+		bool bSame = pBlock->dwSrcId == pSrc->dwId && pBlock->dwSrcFirst == dwSrcBlockFirst &&
+			!memcmp(pBlock->Mat, pMatrix->Mat, sizeof(pBlock->Mat)) &&
+			!memcmp(&pBlock->Viewport, pViewport, sizeof(vb_viewport));
+
+		bool bCurrent = bSame &&
+			Source_Version(pSrc, dwSrcFirst, dwSrcFirst + (dwHi - dwLo)) <= pBlock->dwSrcVersion;
+
+		if(!bCurrent || dwLo < pBlock->dwValidFirst || dwHi > pBlock->dwValidEnd)
+		{
+			Transform(pDest, dwFirst, pSrc, dwSrcFirst, dwHi - dwLo, *pMatrix, *pViewport);
+			dwTransformed += dwHi - dwLo;
+
+			//the vertices that were valid before stay valid when the range
+			//touches them and their source did not change
+			bool bKeep = bSame && pBlock->dwValidFirst < pBlock->dwValidEnd &&
+				dwLo <= pBlock->dwValidEnd && dwHi >= pBlock->dwValidFirst &&
+				Source_Version(pSrc, dwSrcBlockFirst + pBlock->dwValidFirst,
+					dwSrcBlockFirst + pBlock->dwValidEnd) <= pBlock->dwSrcVersion;
+
+			if(bKeep)
+			{
+				if(pBlock->dwValidFirst < dwLo) dwLo = pBlock->dwValidFirst;
+				if(pBlock->dwValidEnd > dwHi) dwHi = pBlock->dwValidEnd;
+			}
+
+			pBlock->dwSrcId = pSrc->dwId;
+			pBlock->dwSrcFirst = dwSrcBlockFirst;
+			pBlock->dwSrcVersion = pSrc->dwVersion;
+			pBlock->dwValidFirst = dwLo;
+			pBlock->dwValidEnd = dwHi;
+			memcpy(pBlock->Mat, pMatrix->Mat, sizeof(pBlock->Mat));
+			pBlock->Viewport = *pViewport;
+		}
+
+		dwFirst = dwLast;
+	}
+
+	render_stats *pStats = Stats_Local();
+	pStats->dwVerticesProcessed += dwTransformed;
+	pStats->dwVerticesReused += dwCount - dwTransformed;
+
+	return S_OK;
+}
@@ -0,0 +1,59 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#ifndef _VERTEXBUFFER_H_
+#define _VERTEXBUFFER_H_
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "SoftDevice.h"
+
+//vertices in system memory with ProcessVertices() of the DirectX 6
+//IDirect3DVertexBuffer: Vertex_Buffer_Process() transforms vertices of a
+//source buffer into a destination buffer with SRFVF_XYZRHW, ready for
+//DrawIndexedPrimitive() without the transformation of the device.
+//
+//the destination remembers for every block of VB_BLOCK vertices the
+//matrix and the viewport it was made with and which source vertices it
+//holds. Vertex_Buffer_Lock() marks only the blocks of the locked range of
+//the source as changed, so a block is transformed again only when the
+//matrix, the viewport or its own source vertices are different, static
+//geometry with the same matrices is transformed once
+
+#define VB_BLOCK 64
+
+struct vertex_buffer;
+
+struct vb_viewport
+{
+	DWORD dwX;
+	DWORD dwY;
+	DWORD dwWidth;
+	DWORD dwHeight;
+};
+
+//the vertices are zero
+vertex_buffer *Vertex_Buffer_Create(DWORD dwFVF, DWORD dwVertexCount);
+void Vertex_Buffer_Destroy(vertex_buffer *pVB);
+
+//first vertex of the range for writing, the range counts as changed.
+//There is no unlock, the vertices are read by the next Vertex_Buffer_Process()
+void *Vertex_Buffer_Lock(vertex_buffer *pVB, DWORD dwFirst, DWORD dwCount);
+
+//the vertices for drawing
+const void *Vertex_Buffer_Data(const vertex_buffer *pVB);
+DWORD Vertex_Buffer_FVF(const vertex_buffer *pVB);
+DWORD Vertex_Buffer_Count(const vertex_buffer *pVB);
+
+//dwCount vertices of pSrc from dwSrcIndex go to pDest from dwDestIndex.
+//pSrc has SRFVF_XYZ, pDest SRFVF_XYZRHW, pMatrix is world * view *
+//projection. Diffuse, specular and texture coordinates of the source are
+//copied when pDest has them (white, black and 0 when pSrc has none).
+//Like ProcessVertices() there is no clipping, w must be positive.
+//render_stats counts the vertices transformed and the ones still valid
+HRESULT Vertex_Buffer_Process(vertex_buffer *pDest, DWORD dwDestIndex, DWORD dwCount,
+				const vertex_buffer *pSrc, DWORD dwSrcIndex,
+				const matrix4x4 *pMatrix, const vb_viewport *pViewport);
+
+#endif
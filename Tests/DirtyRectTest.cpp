@@ -0,0 +1,84 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <gtest/gtest.h>
+
+#include "DirtyRect.h"
+
+static RECT Make_Rect(LONG Left, LONG Top, LONG Right, LONG Bottom)
+{
+	RECT Rc = { Left, Top, Right, Bottom };
+	return Rc;
+}
+
+TEST(DirtyRect, UnionSkipsEmpty)
+{
+	RECT A = Make_Rect(10, 10, 20, 20);
+	RECT B = Make_Rect(15, 5, 30, 12);
+	RECT Empty = Make_Rect(0, 0, 0, 0);
+
+	RECT U = Rect_Union(&A, &B);
+	EXPECT_EQ(U.left, 10);
+	EXPECT_EQ(U.top, 5);
+	EXPECT_EQ(U.right, 30);
+	EXPECT_EQ(U.bottom, 20);
+
+	U = Rect_Union(&Empty, &A);
+	EXPECT_EQ(U.left, 10);
+	EXPECT_EQ(U.right, 20);
+	EXPECT_TRUE(Rect_Is_Empty(&Empty));
+}
+
+//the first frame clears and presents everything, the next ones the
+//union of the last and the new drawing
+TEST(DirtyRect, FrameSequence)
+{
+	dirty_rect Dirty;
+	Dirty_Init(&Dirty, 640, 480, DIRTY_MAX_PERCENT);
+
+	RECT Rc;
+	EXPECT_FALSE(Dirty_Clear_Rect(&Dirty, &Rc));
+
+	RECT Drawn = Make_Rect(100, 100, 150, 150);
+	EXPECT_FALSE(Dirty_End_Frame(&Dirty, &Drawn, &Rc));
+
+	ASSERT_TRUE(Dirty_Clear_Rect(&Dirty, &Rc));
+	EXPECT_EQ(Rc.left, 100);
+	EXPECT_EQ(Rc.bottom, 150);
+
+	RECT Moved = Make_Rect(120, 100, 170, 150);
+	ASSERT_TRUE(Dirty_End_Frame(&Dirty, &Moved, &Rc));
+	EXPECT_EQ(Rc.left, 100);
+	EXPECT_EQ(Rc.right, 170);
+
+	Dirty_Invalidate(&Dirty);
+	EXPECT_FALSE(Dirty_Clear_Rect(&Dirty, &Rc));
+}
+
+TEST(DirtyRect, LargeRectIsFullFrame)
+{
+	dirty_rect Dirty;
+	Dirty_Init(&Dirty, 100, 100, DIRTY_MAX_PERCENT);
+
+	RECT Rc;
+	RECT Big = Make_Rect(0, 0, 90, 90);
+	Dirty_End_Frame(&Dirty, &Big, &Rc);
+
+	EXPECT_FALSE(Dirty_Clear_Rect(&Dirty, &Rc));
+}
+
+TEST(DirtyRect, BoundsOfVertices)
+{
+	float Vertices[3][4] = {
+		{ 10.5f, 20.0f, 0.0f, 1.0f },
+		{ 30.0f, 25.5f, 0.0f, 1.0f },
+		{ 15.0f, 40.0f, 0.0f, 1.0f } };
+
+	RECT Rc = Rect_Of_Vertices(Vertices, 3, sizeof(Vertices[0]));
+
+	EXPECT_EQ(Rc.left, 9);
+	EXPECT_EQ(Rc.top, 19);
+	EXPECT_EQ(Rc.right, 31);
+	EXPECT_EQ(Rc.bottom, 41);
+}
@@ -0,0 +1,182 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "DrawTrace.h"
+
+//a trace of 64 x 48 with the records in Words
+static bool Load_Words(const std::vector<DWORD> &Records)
+{
+	std::vector<DWORD> Words;
+
+	draw_trace_header Header = { DRAW_TRACE_MAGIC, DRAW_TRACE_VERSION, 64, 48, FALSE };
+	const DWORD *pHeader = (const DWORD *)&Header;
+	Words.insert(Words.end(), pHeader, pHeader + sizeof(Header) / sizeof(DWORD));
+	Words.insert(Words.end(), Records.begin(), Records.end());
+
+	std::string Filename = ::testing::TempDir() + "DrawTraceTest.trc";
+	FILE *pFile = fopen(Filename.c_str(), "wb");
+	if(!pFile)
+		return false;
+	fwrite(&Words[0], sizeof(DWORD), Words.size(), pFile);
+	fclose(pFile);
+
+	draw_trace *pTrace = Draw_Trace_Load(Filename.c_str());
+	remove(Filename.c_str());
+
+	if(!pTrace)
+		return false;
+
+	Draw_Trace_Free(pTrace);
+	return true;
+}
+
+//a trace of one frame: a blob of one SRFVF_TLVERTEX vertex, a clear and
+//a draw, with the counts given
+static bool Load_Trace(DWORD dwVertexCount, DWORD dwRectCount, DWORD dwBlobSize)
+{
+	std::vector<DWORD> Words;
+
+	DWORD dwStride = Soft_FVF_Stride(SRFVF_TLVERTEX);
+	Words.push_back(DTR_BLOB | ((2 + dwStride / 4) << 8));
+	Words.push_back(0);
+	Words.push_back(dwBlobSize);
+	Words.insert(Words.end(), dwStride / 4, 0);
+
+	Words.push_back(DTR_CLEAR | (4 << 8));
+	Words.push_back(SRCLEAR_TARGET);
+	Words.push_back(0);
+	Words.push_back(0);
+	Words.push_back(dwRectCount);
+
+	Words.push_back(DTR_BEGINSCENE);
+	Words.push_back(DTR_DRAW | (5 << 8));
+	Words.push_back(SRPT_TRIANGLELIST);
+	Words.push_back(SRFVF_TLVERTEX);
+	Words.push_back(dwVertexCount);
+	Words.push_back(0);
+	Words.push_back(0);
+	Words.push_back(DTR_ENDSCENE);
+
+	return Load_Words(Words);
+}
+
+static bool Load_Viewport(DWORD dwX, DWORD dwY, DWORD dwWidth, DWORD dwHeight)
+{
+	DWORD Record[5] = { DTR_VIEWPORT | (4 << 8), dwX, dwY, dwWidth, dwHeight };
+	return Load_Words(std::vector<DWORD>(Record, Record + 5));
+}
+
+TEST(DrawTrace, CountsThatWrapAreRefused)
+{
+	DWORD dwStride = Soft_FVF_Stride(SRFVF_TLVERTEX);
+	EXPECT_TRUE(Load_Trace(1, 0, dwStride));
+
+	//the vertex count times the stride is 2^32
+	EXPECT_FALSE(Load_Trace(0x100000000ull / dwStride, 0, dwStride));
+	EXPECT_FALSE(Load_Trace(2, 0, dwStride));
+
+	//4 + count * 4 is 4 in 32 bits
+	EXPECT_FALSE(Load_Trace(1, 0x40000000, dwStride));
+
+	//a blob size far past its data
+	EXPECT_FALSE(Load_Trace(1, 0, 0xfffffffe));
+}
+
+//the viewport is inside the 64 x 48 of the header, x + width wraps
+//around in 32 bits
+TEST(DrawTrace, ViewportOutsideIsRefused)
+{
+	EXPECT_TRUE(Load_Viewport(0, 0, 64, 48));
+	EXPECT_TRUE(Load_Viewport(16, 8, 48, 40));
+
+	EXPECT_FALSE(Load_Viewport(1, 0, 64, 48));
+	EXPECT_FALSE(Load_Viewport(0, 0, 64, 49));
+	EXPECT_FALSE(Load_Viewport(0xfffffff0, 0, 0x20, 48));
+	EXPECT_FALSE(Load_Viewport(0, 0xfffffff0, 64, 0x20));
+}
+
+//a texture of 4096 x 4096 texels does not fit in the 24 bit size of a
+//record, the trace stops being good instead of writing a broken record
+TEST(DrawTrace, RecordTooLargeIsNotWritten)
+{
+	CSoftDevice *pDevice = NULL;
+	ASSERT_EQ(Create_Soft_Device(64, 48, false, &pDevice), S_OK);
+
+	std::string Filename = ::testing::TempDir() + "DrawTraceTest_large.trc";
+	CRecordDevice *pRecorder = NULL;
+	ASSERT_EQ(Create_Record_Device(pDevice, Filename.c_str(), &pRecorder), S_OK);
+
+	soft_texture *pSmall = NULL;
+	ASSERT_EQ(pRecorder->CreateTexture(16, 16, &pSmall), S_OK);
+	pRecorder->SetTexture(0, pSmall);
+	EXPECT_TRUE(pRecorder->IsGood());
+
+	soft_texture *pLarge = NULL;
+	ASSERT_EQ(pRecorder->CreateTexture(4096, 4096, &pLarge), S_OK);
+	pRecorder->SetTexture(0, pLarge);
+	EXPECT_FALSE(pRecorder->IsGood());
+
+	pRecorder->Release();
+	pDevice->Release();
+
+	//what was written before is a trace that loads
+	draw_trace *pTrace = Draw_Trace_Load(Filename.c_str());
+	EXPECT_TRUE(pTrace != NULL);
+	if(pTrace)
+		Draw_Trace_Free(pTrace);
+
+	remove(Filename.c_str());
+}
+
+//more draws than blob slots, all with the same vertices and their own
+//indices: the index blob of a draw never takes the slot of its vertices
+TEST(DrawTrace, DrawsKeepTheirVertexBlob)
+{
+	CSoftDevice *pDevice = NULL;
+	ASSERT_EQ(Create_Soft_Device(64, 48, false, &pDevice), S_OK);
+
+	std::string Filename = ::testing::TempDir() + "DrawTraceTest_blobs.trc";
+	CRecordDevice *pRecorder = NULL;
+	ASSERT_EQ(Create_Record_Device(pDevice, Filename.c_str(), &pRecorder), S_OK);
+
+	//the corners of one triangle again and again, each draw uses other
+	//ones, the index blobs are smaller than the vertex blob
+	const DWORD dwDraws = DRAW_TRACE_BLOBS * 2;
+	float Corners[3][2] = { { 0.0f, 0.0f }, { 32.0f, 0.0f }, { 0.0f, 24.0f } };
+	std::vector<float> Vertices(dwDraws * 3 * 8, 0.0f);
+	for(DWORD v = 0; v < dwDraws * 3; v++)
+	{
+		Vertices[v * 8 + 0] = Corners[v % 3][0];
+		Vertices[v * 8 + 1] = Corners[v % 3][1];
+		Vertices[v * 8 + 2] = 0.5f;
+		Vertices[v * 8 + 3] = 1.0f;
+	}
+
+	pRecorder->BeginScene();
+	for(DWORD i = 0; i < dwDraws; i++)
+	{
+		WORD Indices[3] = { (WORD)(i * 3), (WORD)(i * 3 + 1), (WORD)(i * 3 + 2) };
+		pRecorder->DrawIndexedPrimitive(SRPT_TRIANGLELIST, SRFVF_TLVERTEX, &Vertices[0], dwDraws * 3,
+			Indices, 3, 0);
+	}
+	pRecorder->EndScene();
+
+	EXPECT_TRUE(pRecorder->IsGood());
+	pRecorder->Release();
+
+	draw_trace *pTrace = Draw_Trace_Load(Filename.c_str());
+	ASSERT_TRUE(pTrace != NULL);
+	EXPECT_EQ(Draw_Trace_Frames(pTrace), 1u);
+	EXPECT_EQ(Draw_Trace_Replay(pTrace, pDevice, NULL, NULL), S_OK);
+	Draw_Trace_Free(pTrace);
+
+	pDevice->Release();
+	remove(Filename.c_str());
+}
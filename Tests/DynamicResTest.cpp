@@ -0,0 +1,60 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <gtest/gtest.h>
+
+#include "DynamicRes.h"
+
+//a frame costs fFullMs at full size and falls with the pixels
+static float Frame_Ms(const dynamic_res *pDyn, float fFullMs)
+{
+	return fFullMs * pDyn->fScale * pDyn->fScale;
+}
+
+TEST(DynamicRes, SettlesNearTheBudget)
+{
+	dynamic_res Dyn;
+	Dynamic_Res_Init(&Dyn, 16.6f, DYNRES_MIN_SCALE);
+
+	for(int i = 0; i < 200; i++)
+		Dynamic_Res_Frame(&Dyn, Frame_Ms(&Dyn, 40.0f));
+
+	float fMs = Frame_Ms(&Dyn, 40.0f);
+	EXPECT_LT(Dyn.fScale, 1.0f);
+	EXPECT_NEAR(fMs, 16.6f, 16.6f * DYNRES_TOLERANCE / 100.0f);
+}
+
+TEST(DynamicRes, StaysAtFullSizeWithinBudget)
+{
+	dynamic_res Dyn;
+	Dynamic_Res_Init(&Dyn, 16.6f, DYNRES_MIN_SCALE);
+
+	for(int i = 0; i < 100; i++)
+		EXPECT_FALSE(Dynamic_Res_Frame(&Dyn, 5.0f));
+
+	EXPECT_EQ(Dyn.fScale, 1.0f);
+}
+
+TEST(DynamicRes, NeverBelowMinimum)
+{
+	dynamic_res Dyn;
+	Dynamic_Res_Init(&Dyn, 16.6f, 0.5f);
+
+	for(int i = 0; i < 200; i++)
+		Dynamic_Res_Frame(&Dyn, 1000.0f);
+
+	EXPECT_EQ(Dyn.fScale, 0.5f);
+
+	RECT Full = { 0, 0, 640, 480 };
+	RECT Rc = Dynamic_Res_Rect(&Dyn, &Full);
+	EXPECT_EQ(Rc.right, 320);
+	EXPECT_EQ(Rc.bottom, 240);
+}
+
+TEST(DynamicRes, ParseOptions)
+{
+	EXPECT_EQ(Dynamic_Res_Parse_Options("-fps 30"), 0.0f);
+	EXPECT_EQ(Dynamic_Res_Parse_Options("-dynres"), DYNRES_TARGET_MS);
+	EXPECT_NEAR(Dynamic_Res_Parse_Options("-dynres 33.3 -trace"), 33.3f, 1e-4f);
+}
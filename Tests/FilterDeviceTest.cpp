@@ -0,0 +1,126 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <gtest/gtest.h>
+
+#include "FilterDevice.h"
+#include "SoftDevice.h"
+#include "StateBlock.h"
+
+//the same layout as D3DTLVERTEX
+struct filter_vertex
+{
+	float sx, sy, sz, rhw;
+	DWORD dwColor;
+	DWORD dwSpecular;
+	float tu, tv;
+};
+
+//a soft device behind the filter with a red and a green texture, the
+//pixel color is the texture
+class FilterDeviceTest : public ::testing::Test
+{
+protected:
+	void SetUp()
+	{
+		m_pDevice = NULL;
+		m_pFilter = NULL;
+		ASSERT_EQ(Create_Soft_Device(64, 48, false, &m_pDevice), S_OK);
+		ASSERT_EQ(Create_Filter_Device(m_pDevice, &m_pFilter), S_OK);
+
+		m_pFilter->SetRenderState(SRRS_CULLMODE, SRCULL_NONE);
+		m_pFilter->SetTextureStageState(0, SRTSS_COLOROP, SRTOP_SELECTARG1);
+		m_pFilter->SetTextureStageState(0, SRTSS_COLORARG1, SRTA_TEXTURE);
+
+		m_pRed = Make_Texture(0x00ff0000);
+		m_pGreen = Make_Texture(0x0000ff00);
+	}
+
+	void TearDown()
+	{
+		if(m_pFilter)
+			m_pFilter->Release();
+		if(m_pDevice)
+			m_pDevice->Release();
+	}
+
+	soft_texture *Make_Texture(DWORD dwColor)
+	{
+		soft_texture *pTexture = NULL;
+		EXPECT_EQ(m_pFilter->CreateTexture(4, 4, &pTexture), S_OK);
+		if(pTexture)
+		{
+			for(int i = 0; i < 16; i++)
+				pTexture->pBits[i] = dwColor;
+		}
+		return pTexture;
+	}
+
+	DWORD Draw_Pixel()
+	{
+		filter_vertex Tri[3] = {
+			{  0.0f,  0.0f, 0.5f, 1.0f, 0xffffffff, 0, 0.0f, 0.0f },
+			{ 32.0f,  0.0f, 0.5f, 1.0f, 0xffffffff, 0, 1.0f, 0.0f },
+			{  0.0f, 24.0f, 0.5f, 1.0f, 0xffffffff, 0, 0.0f, 1.0f } };
+
+		m_pFilter->Clear(0, NULL, SRCLEAR_TARGET, 0x00000000, 1.0f);
+		m_pFilter->BeginScene();
+		m_pFilter->DrawPrimitive(SRPT_TRIANGLELIST, SRFVF_TLVERTEX, Tri, 3, 0);
+		m_pFilter->EndScene();
+
+		DWORD dwPitch;
+		DWORD *pColor = m_pDevice->GetColorBuffer(&dwPitch);
+		return pColor[4 * dwPitch + 4] & 0x00ffffff;
+	}
+
+	CSoftDevice *m_pDevice;
+	CFilterDevice *m_pFilter;
+	soft_texture *m_pRed;
+	soft_texture *m_pGreen;
+};
+
+TEST_F(FilterDeviceTest, SameStateIsFiltered)
+{
+	DWORD dwForwarded = State_Cache_Forwarded(m_pFilter->Cache());
+	m_pFilter->SetRenderState(SRRS_CULLMODE, SRCULL_NONE);
+	m_pFilter->SetTexture(0, m_pRed);
+	m_pFilter->SetTexture(0, m_pRed);
+
+	EXPECT_EQ(State_Cache_Forwarded(m_pFilter->Cache()), dwForwarded + 1);
+	EXPECT_EQ(Draw_Pixel(), 0xff0000u);
+}
+
+//the handle and SetTexture() of stage 0 set the same texture, going back
+//to the handle set before must reach the device
+TEST_F(FilterDeviceTest, TextureHandleAfterSetTexture)
+{
+	DWORD dwRed = m_pDevice->GetTextureHandle(m_pRed);
+
+	m_pFilter->SetRenderState(SRRS_TEXTUREHANDLE, dwRed);
+	m_pFilter->SetTexture(0, m_pGreen);
+	m_pFilter->SetRenderState(SRRS_TEXTUREHANDLE, dwRed);
+	EXPECT_EQ(Draw_Pixel(), 0xff0000u);
+
+	m_pFilter->SetTexture(0, m_pRed);
+	EXPECT_EQ(Draw_Pixel(), 0xff0000u);
+
+	m_pFilter->SetRenderState(SRRS_TEXTUREHANDLE, m_pDevice->GetTextureHandle(m_pGreen));
+	m_pFilter->SetTexture(0, m_pRed);
+	EXPECT_EQ(Draw_Pixel(), 0xff0000u);
+}
+
+TEST_F(FilterDeviceTest, TextureHandleOfBlockAfterSetTexture)
+{
+	state_block Block;
+	State_Block_Init(&Block);
+	State_Block_Render(&Block, SRRS_TEXTUREHANDLE, m_pDevice->GetTextureHandle(m_pRed));
+
+	EXPECT_EQ(m_pFilter->ApplyStateBlock(&Block), S_OK);
+	m_pFilter->SetTexture(0, m_pGreen);
+	EXPECT_EQ(m_pFilter->ApplyStateBlock(&Block), S_OK);
+	EXPECT_EQ(Draw_Pixel(), 0xff0000u);
+
+	m_pFilter->SetTexture(0, m_pRed);
+	EXPECT_EQ(Draw_Pixel(), 0xff0000u);
+}
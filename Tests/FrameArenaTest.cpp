@@ -0,0 +1,57 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <gtest/gtest.h>
+
+#include "FrameArena.h"
+
+TEST(FrameArena, AllocationsAreCacheAligned)
+{
+	frame_arena *pArena = Frame_Arena_Create(4096);
+	ASSERT_TRUE(pArena != NULL);
+
+	for(int i = 1; i < 10; i++)
+	{
+		void *p = Frame_Arena_Alloc(pArena, i * 7);
+		ASSERT_TRUE(p != NULL);
+		EXPECT_EQ((size_t)p % CACHE_LINE_SIZE, 0u);
+	}
+
+	Frame_Arena_Destroy(pArena);
+}
+
+TEST(FrameArena, ReleaseGoesBackToTheMark)
+{
+	frame_arena *pArena = Frame_Arena_Create(4096);
+	ASSERT_TRUE(pArena != NULL);
+
+	Frame_Arena_Alloc(pArena, 100);
+	arena_mark Mark = Frame_Arena_Mark(pArena);
+	size_t Used = Frame_Arena_Used(pArena);
+
+	Frame_Arena_Alloc(pArena, 1000);
+	Frame_Arena_Alloc(pArena, 100000);		//from the heap
+	Frame_Arena_Release(pArena, Mark);
+
+	EXPECT_EQ(Frame_Arena_Used(pArena), Used);
+
+	Frame_Arena_Destroy(pArena);
+}
+
+//a frame that did not fit gets a block of its high water mark
+TEST(FrameArena, ResetGrowsAfterOverflow)
+{
+	frame_arena *pArena = Frame_Arena_Create(1024);
+	ASSERT_TRUE(pArena != NULL);
+
+	Frame_Arena_Alloc(pArena, 512);
+	Frame_Arena_Alloc(pArena, 4096);
+	size_t HighWater = Frame_Arena_High_Water(pArena);
+	Frame_Arena_Reset(pArena);
+
+	EXPECT_EQ(Frame_Arena_Used(pArena), 0u);
+	EXPECT_GE(Frame_Arena_Size(pArena), HighWater);
+
+	Frame_Arena_Destroy(pArena);
+}
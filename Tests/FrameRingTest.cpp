@@ -0,0 +1,90 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+
+#include <gtest/gtest.h>
+
+#include "FrameRing.h"
+
+//a name per process, tests running at the same time do not meet
+static void Ring_Name(char *szName, const char *szTest)
+{
+	sprintf(szName, "/frameringtest_%s_%u", szTest, (unsigned)Thread_Id());
+}
+
+TEST(FrameRing, ReaderSeesTheNewestFrame)
+{
+	char szName[64];
+	Ring_Name(szName, "newest");
+
+	frame_ring Writer;
+	ASSERT_EQ(Frame_Ring_Create(&Writer, szName, 16, 8, 3), S_OK);
+
+	frame_ring Reader;
+	ASSERT_EQ(Frame_Ring_Open(&Reader, szName), S_OK);
+	EXPECT_EQ(Reader.pHeader->dwWidth, 16u);
+	EXPECT_EQ(Reader.pHeader->dwHeight, 8u);
+
+	frame_ring_read Read;
+	EXPECT_FALSE(Frame_Ring_Begin_Read(&Reader, 0, &Read));
+
+	for(DWORD dwFrame = 0; dwFrame < 5; dwFrame++)
+	{
+		LONG lPitch;
+		DWORD *pPixels = Frame_Ring_Begin_Write(&Writer, &lPitch);
+		EXPECT_GE(lPitch, 16 * 4);
+		pPixels[0] = 0xff000000 | dwFrame;
+		Frame_Ring_End_Write(&Writer);
+	}
+
+	ASSERT_TRUE(Frame_Ring_Begin_Read(&Reader, 0, &Read));
+	EXPECT_EQ(Read.dwFrame, 4u);
+	EXPECT_EQ(Read.pPixels[0], 0xff000004u);
+	EXPECT_TRUE(Frame_Ring_End_Read(&Reader, &Read));
+
+	//nothing newer than frame 4
+	EXPECT_FALSE(Frame_Ring_Begin_Read(&Reader, 5, &Read));
+
+	Frame_Ring_Close(&Writer);
+	EXPECT_TRUE(Frame_Ring_Closed(&Reader));
+	Frame_Ring_Close(&Reader);
+}
+
+//the writer came round to the slot while it was read
+TEST(FrameRing, OverwrittenFrameIsTorn)
+{
+	char szName[64];
+	Ring_Name(szName, "torn");
+
+	frame_ring Writer;
+	ASSERT_EQ(Frame_Ring_Create(&Writer, szName, 4, 4, 2), S_OK);
+
+	frame_ring Reader;
+	ASSERT_EQ(Frame_Ring_Open(&Reader, szName), S_OK);
+
+	LONG lPitch;
+	Frame_Ring_Begin_Write(&Writer, &lPitch);
+	Frame_Ring_End_Write(&Writer);
+
+	frame_ring_read Read;
+	ASSERT_TRUE(Frame_Ring_Begin_Read(&Reader, 0, &Read));
+
+	for(int i = 0; i < 2; i++)
+	{
+		Frame_Ring_Begin_Write(&Writer, &lPitch);
+		Frame_Ring_End_Write(&Writer);
+	}
+
+	EXPECT_FALSE(Frame_Ring_End_Read(&Reader, &Read));
+
+	Frame_Ring_Close(&Reader);
+	Frame_Ring_Close(&Writer);
+}
+
+TEST(FrameRing, OpenFailsWithoutWriter)
+{
+	frame_ring Reader;
+	EXPECT_EQ(Frame_Ring_Open(&Reader, "/frameringtest_none"), E_FAIL);
+}
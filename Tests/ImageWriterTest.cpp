@@ -0,0 +1,37 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <gtest/gtest.h>
+
+#include "ImageWriter.h"
+
+TEST(ImageWriter, FrameNameTakesOneNumber)
+{
+	EXPECT_TRUE(Frame_Name_Valid("frame%04d.ppm"));
+	EXPECT_TRUE(Frame_Name_Valid("frames/%d.png"));
+	EXPECT_TRUE(Frame_Name_Valid("100%%_%3d.ppm"));
+
+	EXPECT_FALSE(Frame_Name_Valid("frame.ppm"));
+	EXPECT_FALSE(Frame_Name_Valid("%d_%d.ppm"));
+	EXPECT_FALSE(Frame_Name_Valid("/tmp/x%s%s%s.ppm"));
+	EXPECT_FALSE(Frame_Name_Valid("%n%d.ppm"));
+	EXPECT_FALSE(Frame_Name_Valid("%-4d.ppm"));
+	EXPECT_FALSE(Frame_Name_Valid("%999999d.ppm"));
+	EXPECT_FALSE(Frame_Name_Valid("%d%"));
+}
+
+TEST(ImageWriter, FrameNameIsBounded)
+{
+	char szName[16];
+
+	ASSERT_TRUE(Frame_Name(szName, sizeof(szName), "f%04d.ppm", 7));
+	EXPECT_STREQ(szName, "f0007.ppm");
+	ASSERT_TRUE(Frame_Name(szName, sizeof(szName), "%%%3d", 42));
+	EXPECT_STREQ(szName, "% 42");
+
+	EXPECT_TRUE(Frame_Name(szName, sizeof(szName), "0123456789%04d", 1));
+	EXPECT_STREQ(szName, "01234567890001");
+	EXPECT_FALSE(Frame_Name(szName, sizeof(szName), "0123456789%06d", 1));
+	EXPECT_FALSE(Frame_Name(szName, sizeof(szName), "%s", 1));
+}
@@ -0,0 +1,69 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <math.h>
+
+#include <gtest/gtest.h>
+
+#include "Math3D.h"
+
+static void Expect_Near(const matrix4x4 &MatA, const matrix4x4 &MatB)
+{
+	for(int i = 0; i < 16; i++)
+		EXPECT_NEAR(MatA.Mat[i], MatB.Mat[i], 1e-5f) << "element " << i;
+}
+
+TEST(Math3D, IdentityIsNeutral)
+{
+	matrix4x4 MatRot = Mat4x4_Rotation_Y(0.7f);
+
+	Expect_Near(Mat4x4_Mul(MatRot, Mat4x4_Identity()), MatRot);
+	Expect_Near(Mat4x4_Mul(Mat4x4_Identity(), MatRot), MatRot);
+}
+
+TEST(Math3D, RotationBackIsIdentity)
+{
+	matrix4x4 MatA = Mat4x4_Rotation_Y(1.3f);
+	matrix4x4 MatB = Mat4x4_Rotation_Y(-1.3f);
+
+	Expect_Near(Mat4x4_Mul(MatA, MatB), Mat4x4_Identity());
+}
+
+TEST(Math3D, RotationKeepsLengthAndY)
+{
+	vector3 Vec = { 3.0f, 2.0f, -4.0f };
+	vector4 Out = Vec3_Mat4x4_Mul(Vec, Mat4x4_Rotation_Y(2.1f));
+
+	EXPECT_NEAR(Out.y, 2.0f, 1e-5f);
+	EXPECT_NEAR(Out.x * Out.x + Out.z * Out.z, 25.0f, 1e-4f);
+	EXPECT_NEAR(Out.w, 1.0f, 1e-6f);
+}
+
+TEST(Math3D, CrossAndDot)
+{
+	vector3 X = { 1.0f, 0.0f, 0.0f };
+	vector3 Y = { 0.0f, 1.0f, 0.0f };
+	vector3 Z = Vec3_Cross(X, Y);
+
+	EXPECT_FLOAT_EQ(Z.z, 1.0f);
+	EXPECT_FLOAT_EQ(Vec3_Dot(X, Z), 0.0f);
+
+	vector3 V = { 3.0f, 0.0f, 4.0f };
+	vector3 N = Vec3_Normalize(V);
+	EXPECT_NEAR(Vec3_Dot(N, N), 1.0f, 1e-6f);
+}
+
+//z of the near plane goes to depth 0, of the far plane to depth 1
+TEST(Math3D, ProjectionDepthRange)
+{
+	matrix4x4 MatProj = Mat4x4_Projection(PI / 2.0f, 4.0f / 3.0f, 1.0f, 100.0f);
+
+	vector3 Near = { 0.0f, 0.0f, 1.0f };
+	vector3 Far = { 0.0f, 0.0f, 100.0f };
+	vector4 OutNear = Vec3_Mat4x4_Mul(Near, MatProj);
+	vector4 OutFar = Vec3_Mat4x4_Mul(Far, MatProj);
+
+	EXPECT_NEAR(OutNear.z / OutNear.w, 0.0f, 1e-5f);
+	EXPECT_NEAR(OutFar.z / OutFar.w, 1.0f, 1e-5f);
+}
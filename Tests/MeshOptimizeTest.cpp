@@ -0,0 +1,232 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Mesh.h"
+#include "MeshOptimize.h"
+#include "RenderStats.h"
+#include "SoftDevice.h"
+
+//a square of Size x Size vertices over -1..1 at z = 0, two triangles per
+//cell, the triangles in a mixed up order
+static void Make_Shuffled_Grid(DWORD Size, std::vector<mesh_vertex> &Vertices, std::vector<DWORD> &Indices)
+{
+	Vertices.resize(Size * Size);
+	for(DWORD y = 0; y < Size; y++)
+	{
+		for(DWORD x = 0; x < Size; x++)
+		{
+			float fx = (float)x / (Size - 1) * 2.0f - 1.0f;
+			float fy = (float)y / (Size - 1) * 2.0f - 1.0f;
+			mesh_vertex Vert = { fx, fy, 0.0f,	0.0f, 0.0f, -1.0f,	(fx + 1.0f) * 0.5f, (1.0f - fy) * 0.5f };
+			Vertices[y * Size + x] = Vert;
+		}
+	}
+
+	Indices.clear();
+	for(DWORD y = 0; y + 1 < Size; y++)
+	{
+		for(DWORD x = 0; x + 1 < Size; x++)
+		{
+			DWORD v = y * Size + x;
+			DWORD Tris[6] = { v, v + Size, v + Size + 1,	v, v + Size + 1, v + 1 };
+			Indices.insert(Indices.end(), Tris, Tris + 6);
+		}
+	}
+
+	DWORD dwSeed = 777;
+	for(DWORD t = (DWORD)Indices.size() / 3 - 1; t > 0; t--)
+	{
+		dwSeed = dwSeed * 1664525 + 1013904223;
+		DWORD r = (dwSeed >> 8) % (t + 1);
+		for(int k = 0; k < 3; k++)
+			std::swap(Indices[t * 3 + k], Indices[r * 3 + k]);
+	}
+}
+
+//the triangles by their corner positions, the corners turned so the
+//smallest index comes first, sorted
+static std::vector<std::vector<float> > Triangle_Set(const std::vector<mesh_vertex> &Vertices, const std::vector<DWORD> &Indices)
+{
+	std::vector<std::vector<float> > Set;
+	for(size_t t = 0; t < Indices.size(); t += 3)
+	{
+		size_t First = t;
+		for(size_t k = t + 1; k < t + 3; k++)
+		{
+			const mesh_vertex &A = Vertices[Indices[k]];
+			const mesh_vertex &B = Vertices[Indices[First]];
+			if(A.x < B.x || (A.x == B.x && A.y < B.y))
+				First = k;
+		}
+
+		std::vector<float> Tri;
+		for(size_t k = 0; k < 3; k++)
+		{
+			const mesh_vertex &V = Vertices[Indices[t + (First - t + k) % 3]];
+			Tri.push_back(V.x);
+			Tri.push_back(V.y);
+		}
+		Set.push_back(Tri);
+	}
+
+	std::sort(Set.begin(), Set.end());
+	return Set;
+}
+
+TEST(MeshOptimize, AcmrCountsFifoMisses)
+{
+	DWORD One[3] = { 0, 1, 2 };
+	EXPECT_FLOAT_EQ(Mesh_ACMR(One, sizeof(DWORD), 3, 32), 3.0f);
+
+	WORD Quad[6] = { 0, 1, 2,	0, 2, 3 };
+	EXPECT_FLOAT_EQ(Mesh_ACMR(Quad, sizeof(WORD), 6, 32), 2.0f);
+
+	//with 3 vertices 0 fell out when 3 came in, a hit does not move it
+	DWORD Fifo[9] = { 0, 1, 2,	0, 2, 3,	3, 2, 0 };
+	EXPECT_FLOAT_EQ(Mesh_ACMR(Fifo, sizeof(DWORD), 9, 3), 5.0f / 3.0f);
+}
+
+TEST(MeshOptimize, CacheOrderKeepsTheTriangles)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Shuffled_Grid(64, Vertices, Indices);
+
+	std::vector<DWORD> Before = Indices;
+	float Acmr = Mesh_ACMR(&Indices[0], sizeof(DWORD), (DWORD)Indices.size(), SOFT_VERTEX_CACHE);
+
+	ASSERT_EQ(Mesh_Optimize_Cache(&Indices[0], (DWORD)Indices.size(), (DWORD)Vertices.size()), S_OK);
+	EXPECT_TRUE(Triangle_Set(Vertices, Before) == Triangle_Set(Vertices, Indices));
+
+	float Optimized = Mesh_ACMR(&Indices[0], sizeof(DWORD), (DWORD)Indices.size(), SOFT_VERTEX_CACHE);
+	EXPECT_GT(Acmr, 1.5f);
+	EXPECT_LT(Optimized, 0.8f);
+}
+
+TEST(MeshOptimize, FetchOrderFollowsTheIndices)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Shuffled_Grid(16, Vertices, Indices);
+
+	//a vertex no triangle uses
+	mesh_vertex Lonely = { 5.0f, 5.0f, 5.0f,	0.0f, 0.0f, 0.0f,	0.0f, 0.0f };
+	Vertices.insert(Vertices.begin(), Lonely);
+	for(size_t i = 0; i < Indices.size(); i++)
+		Indices[i]++;
+
+	std::vector<std::vector<float> > Before = Triangle_Set(Vertices, Indices);
+
+	ASSERT_EQ(Mesh_Optimize_Fetch(&Vertices[0], (DWORD)Vertices.size(), &Indices[0], (DWORD)Indices.size()), S_OK);
+	EXPECT_TRUE(Before == Triangle_Set(Vertices, Indices));
+
+	DWORD dwNext = 0;
+	for(size_t i = 0; i < Indices.size(); i++)
+	{
+		ASSERT_LE(Indices[i], dwNext);
+		if(Indices[i] == dwNext)
+			dwNext++;
+	}
+
+	EXPECT_EQ(dwNext, Vertices.size() - 1);
+	EXPECT_EQ(Vertices.back().x, 5.0f);
+}
+
+TEST(MeshOptimize, BadIndicesAreRefused)
+{
+	mesh_vertex Vertices[3];
+	DWORD Indices[3] = { 0, 1, 3 };
+
+	EXPECT_EQ(Mesh_Optimize(Vertices, 3, Indices, 3), E_INVALIDARG);
+	EXPECT_EQ(Mesh_Optimize_Cache(Indices, 2, 3), E_INVALIDARG);
+}
+
+TEST(MeshOptimize, ReorderOnLoad)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Shuffled_Grid(64, Vertices, Indices);
+
+	std::string Filename = ::testing::TempDir() + "MeshOptimizeTest_reorder.mesh";
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], (DWORD)Vertices.size(),
+		&Indices[0], (DWORD)Indices.size()), S_OK);
+
+	mesh Mesh;
+	ASSERT_EQ(Mesh_Open(&Mesh, Filename.c_str()), S_OK);
+	EXPECT_EQ(Mesh.pHeader->dwFlags & MESH_OPTIMIZED, 0u);
+
+	float Acmr = Mesh_ACMR(Mesh.pIndices, sizeof(WORD), Mesh.pHeader->dwIndexCount, SOFT_VERTEX_CACHE);
+	ASSERT_EQ(Mesh_Reorder(&Mesh), S_OK);
+	float Reordered = Mesh_ACMR(Mesh.pIndices, sizeof(WORD), Mesh.pHeader->dwIndexCount, SOFT_VERTEX_CACHE);
+
+	EXPECT_TRUE(Mesh.pVertices == Mesh.pOwnVertices);
+	EXPECT_LT(Reordered, Acmr);
+
+	Mesh_Close(&Mesh);
+	remove(Filename.c_str());
+}
+
+//the post transform cache draws the same image, the vertices it
+//transforms per triangle are the ACMR of the order
+TEST(MeshOptimize, SoftVertexCacheTransformsTheAcmr)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Shuffled_Grid(64, Vertices, Indices);
+	ASSERT_EQ(Mesh_Optimize(&Vertices[0], (DWORD)Vertices.size(), &Indices[0], (DWORD)Indices.size()), S_OK);
+
+	CSoftDevice *pDevice = NULL;
+	ASSERT_EQ(Create_Soft_Device(64, 64, false, &pDevice), S_OK);
+
+	vector3 VecCam = { 0.0f, 0.0f, -2.0f };
+	matrix4x4 MatWorld = Mat4x4_Identity();
+	matrix4x4 MatView = Mat4x4_View(VecCam);
+	matrix4x4 MatProj = Mat4x4_Projection(PI / 2.0f, 1.0f, 1.0f, 100.0f);
+	pDevice->SetTransform(SRTS_WORLD, &MatWorld);
+	pDevice->SetTransform(SRTS_VIEW, &MatView);
+	pDevice->SetTransform(SRTS_PROJECTION, &MatProj);
+	pDevice->SetTextureStageState(0, SRTSS_COLOROP, SRTOP_SELECTARG2);
+	pDevice->SetTextureStageState(0, SRTSS_COLORARG2, SRTA_DIFFUSE);
+
+	DWORD dwPitch;
+	DWORD *pColor = pDevice->GetColorBuffer(&dwPitch);
+	std::vector<DWORD> Frames[2];
+	DWORD dwTransformed[2];
+
+	for(int i = 0; i < 2; i++)
+	{
+		pDevice->SetVertexCache(i == 1);
+
+		Stats_End_Frame();
+		pDevice->Clear(0, NULL, SRCLEAR_TARGET, 0x00000000, 1.0f);
+		pDevice->BeginScene();
+		EXPECT_EQ(pDevice->DrawIndexedPrimitive32(SRPT_TRIANGLELIST, SRFVF_VERTEX, &Vertices[0],
+			(DWORD)Vertices.size(), &Indices[0], (DWORD)Indices.size(), 0), S_OK);
+		pDevice->EndScene();
+		Stats_End_Frame();
+
+		dwTransformed[i] = Stats_Get_Frame()->dwVerticesTransformed;
+		Frames[i].assign(pColor, pColor + 64 * dwPitch);
+	}
+
+	EXPECT_NE(Frames[1][32 * dwPitch + 32] & 0x00ffffff, 0u);
+	EXPECT_TRUE(Frames[0] == Frames[1]);
+	EXPECT_EQ(dwTransformed[0], Vertices.size());
+
+	//the cache finds a slot by the low bits of the index, a few more
+	//misses than the simulation
+	float Acmr = Mesh_ACMR(&Indices[0], sizeof(DWORD), (DWORD)Indices.size(), SOFT_VERTEX_CACHE);
+	float Transformed = (float)dwTransformed[1] / (Indices.size() / 3);
+	EXPECT_GE(Transformed, Acmr);
+	EXPECT_LT(Transformed, Acmr * 1.05f);
+
+	pDevice->Release();
+}
@@ -0,0 +1,483 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Mesh.h"
+#include "MeshImport.h"
+#include "SoftDevice.h"
+
+static std::string Temp_File(const char *szName)
+{
+	return ::testing::TempDir() + "MeshTest_" + szName;
+}
+
+static void Write_Text(const std::string &Filename, const char *szText)
+{
+	FILE *pFile = fopen(Filename.c_str(), "wb");
+	ASSERT_TRUE(pFile != NULL);
+	fputs(szText, pFile);
+	fclose(pFile);
+}
+
+//a quad of two triangles at z = 0, clockwise seen from -z
+static void Make_Quad(std::vector<mesh_vertex> &Vertices, std::vector<DWORD> &Indices)
+{
+	mesh_vertex Quad[4] = {
+		{ -1.0f, -1.0f, 0.0f,	0.0f, 0.0f, -1.0f,	0.0f, 1.0f },
+		{ -1.0f,  1.0f, 0.0f,	0.0f, 0.0f, -1.0f,	0.0f, 0.0f },
+		{  1.0f,  1.0f, 0.0f,	0.0f, 0.0f, -1.0f,	1.0f, 0.0f },
+		{  1.0f, -1.0f, 0.0f,	0.0f, 0.0f, -1.0f,	1.0f, 1.0f } };
+	DWORD Tris[6] = { 0, 1, 2,	0, 2, 3 };
+
+	Vertices.assign(Quad, Quad + 4);
+	Indices.assign(Tris, Tris + 6);
+}
+
+TEST(Mesh, WriteAndMap)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Quad(Vertices, Indices);
+
+	std::string Filename = Temp_File("quad.mesh");
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], 4, &Indices[0], 6), S_OK);
+
+	mesh Mesh;
+	ASSERT_EQ(Mesh_Open(&Mesh, Filename.c_str()), S_OK);
+
+	const mesh_header *pHeader = Mesh.pHeader;
+	EXPECT_EQ(pHeader->dwVertexCount, 4u);
+	EXPECT_EQ(pHeader->dwIndexCount, 6u);
+	EXPECT_EQ(pHeader->dwIndexSize, sizeof(WORD));
+	EXPECT_EQ((size_t)Mesh.pVertices % MESH_ALIGN, 0u);
+	EXPECT_EQ((size_t)Mesh.pIndices % MESH_ALIGN, 0u);
+
+	EXPECT_EQ(pHeader->BoxMin.x, -1.0f);
+	EXPECT_EQ(pHeader->BoxMax.y, 1.0f);
+	EXPECT_NEAR(pHeader->fRadius, 1.41421f, 1e-4f);
+
+	EXPECT_EQ(Mesh.pVertices[2].x, 1.0f);
+	EXPECT_EQ(((const WORD *)Mesh.pIndices)[5], 3);
+
+	Mesh_Close(&Mesh);
+	remove(Filename.c_str());
+}
+
+TEST(Mesh, DwordIndicesAboveTheWordRange)
+{
+	//a draw takes at most 65535 vertices (D3DMAXNUMVERTICES)
+	DWORD dwCount = 65536;
+	std::vector<mesh_vertex> Vertices(dwCount);
+	for(DWORD i = 0; i < dwCount; i++)
+	{
+		mesh_vertex Vert = { (float)i, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		Vertices[i] = Vert;
+	}
+
+	DWORD Indices[3] = { 0, dwCount - 2, dwCount - 1 };
+
+	std::string Filename = Temp_File("big.mesh");
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], dwCount, Indices, 3), S_OK);
+
+	mesh Mesh;
+	ASSERT_EQ(Mesh_Open(&Mesh, Filename.c_str()), S_OK);
+	EXPECT_EQ(Mesh.pHeader->dwIndexSize, sizeof(DWORD));
+	EXPECT_EQ(((const DWORD *)Mesh.pIndices)[2], dwCount - 1);
+
+	Mesh_Close(&Mesh);
+	remove(Filename.c_str());
+}
+
+//a square of Size x Size vertices over -1..1 at z = 0, two triangles per
+//cell. bShuffle mixes up the order of the triangles
+static void Make_Grid(DWORD Size, bool bShuffle, std::vector<mesh_vertex> &Vertices, std::vector<DWORD> &Indices)
+{
+	Vertices.resize(Size * Size);
+	for(DWORD y = 0; y < Size; y++)
+	{
+		for(DWORD x = 0; x < Size; x++)
+		{
+			float fx = (float)x / (Size - 1) * 2.0f - 1.0f;
+			float fy = (float)y / (Size - 1) * 2.0f - 1.0f;
+			mesh_vertex Vert = { fx, fy, 0.0f,	0.0f, 0.0f, -1.0f,	(fx + 1.0f) * 0.5f, (1.0f - fy) * 0.5f };
+			Vertices[y * Size + x] = Vert;
+		}
+	}
+
+	Indices.clear();
+	for(DWORD y = 0; y + 1 < Size; y++)
+	{
+		for(DWORD x = 0; x + 1 < Size; x++)
+		{
+			DWORD v = y * Size + x;
+			DWORD Tris[6] = { v, v + Size, v + Size + 1,	v, v + Size + 1, v + 1 };
+			Indices.insert(Indices.end(), Tris, Tris + 6);
+		}
+	}
+
+	if(bShuffle)
+	{
+		DWORD dwSeed = 12345;
+		for(DWORD t = (DWORD)Indices.size() / 3 - 1; t > 0; t--)
+		{
+			dwSeed = dwSeed * 1664525 + 1013904223;
+			DWORD r = (dwSeed >> 8) % (t + 1);
+			for(int k = 0; k < 3; k++)
+				std::swap(Indices[t * 3 + k], Indices[r * 3 + k]);
+		}
+	}
+}
+
+//the batches draw the same triangles in the same order as the DWORD indices
+static void Expect_Batches_Match(const mesh &Mesh)
+{
+	const DWORD *pIndices = (const DWORD *)Mesh.pIndices;
+	DWORD dwIndex = 0;
+
+	for(DWORD b = 0; b < Mesh.dwBatchCount; b++)
+	{
+		const mesh_batch *pBatch = &Mesh.pBatches[b];
+		ASSERT_LE(pBatch->dwVertexCount, (DWORD)MESH_MAX_WORD_VERTICES);
+
+		for(DWORD i = 0; i < pBatch->dwIndexCount; i++, dwIndex++)
+		{
+			ASSERT_LT(pBatch->pIndices[i], pBatch->dwVertexCount);
+			const mesh_vertex *pA = &pBatch->pVertices[pBatch->pIndices[i]];
+			const mesh_vertex *pB = &Mesh.pVertices[pIndices[dwIndex]];
+			ASSERT_EQ(pA->x, pB->x);
+			ASSERT_EQ(pA->y, pB->y);
+		}
+	}
+
+	EXPECT_EQ(dwIndex, Mesh.pHeader->dwIndexCount);
+}
+
+TEST(Mesh, DwordMeshSplitsIntoWordBatches)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Grid(300, false, Vertices, Indices);
+
+	std::string Filename = Temp_File("grid.mesh");
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], (DWORD)Vertices.size(),
+		&Indices[0], (DWORD)Indices.size()), S_OK);
+
+	mesh Mesh;
+	ASSERT_EQ(Mesh_Open(&Mesh, Filename.c_str()), S_OK);
+	ASSERT_EQ(Mesh.pHeader->dwIndexSize, sizeof(DWORD));
+
+	//90000 vertices row by row: two batches, both windows of the mapping
+	EXPECT_EQ(Mesh.dwBatchCount, 2u);
+	EXPECT_TRUE(Mesh.pBatchVertices == NULL);
+	Expect_Batches_Match(Mesh);
+
+	Mesh_Close(&Mesh);
+	remove(Filename.c_str());
+}
+
+TEST(Mesh, ScatteredBatchesCopyTheirVertices)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Grid(300, true, Vertices, Indices);
+
+	std::string Filename = Temp_File("shuffled.mesh");
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], (DWORD)Vertices.size(),
+		&Indices[0], (DWORD)Indices.size()), S_OK);
+
+	mesh Mesh;
+	ASSERT_EQ(Mesh_Open(&Mesh, Filename.c_str()), S_OK);
+
+	EXPECT_GT(Mesh.dwBatchCount, 2u);
+	EXPECT_TRUE(Mesh.pBatchVertices != NULL);
+	EXPECT_GT(Mesh.dwBatchCopies, 0u);
+	Expect_Batches_Match(Mesh);
+
+	Mesh_Close(&Mesh);
+	remove(Filename.c_str());
+}
+
+TEST(Mesh, BadFilesAreRefused)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Quad(Vertices, Indices);
+
+	Indices[5] = 4;
+	EXPECT_EQ(Mesh_Write(Temp_File("bad.mesh").c_str(), &Vertices[0], 4, &Indices[0], 6), E_INVALIDARG);
+
+	std::string Filename = Temp_File("text.mesh");
+	Write_Text(Filename, "not a mesh file, but long enough to hold a header of the mesh format. "
+		"not a mesh file, but long enough to hold a header of the mesh format.");
+
+	mesh Mesh;
+	EXPECT_EQ(Mesh_Open(&Mesh, Filename.c_str()), E_FAIL);
+	EXPECT_EQ(Mesh_Open(&Mesh, Temp_File("missing.mesh").c_str()), E_FAIL);
+
+	//a 16 bit index past the vertices, put into the file after Mesh_Write()
+	Indices[5] = 3;
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], 4, &Indices[0], 6), S_OK);
+
+	FILE *pFile = fopen(Filename.c_str(), "r+b");
+	ASSERT_TRUE(pFile != NULL);
+	mesh_header Header;
+	ASSERT_EQ(fread(&Header, sizeof(Header), 1, pFile), 1u);
+	ASSERT_EQ(Header.dwIndexSize, sizeof(WORD));
+	WORD wBad = 4;
+	fseek(pFile, Header.dwIndexOffset + 5 * sizeof(WORD), SEEK_SET);
+	fwrite(&wBad, sizeof(WORD), 1, pFile);
+	fclose(pFile);
+
+	EXPECT_EQ(Mesh_Open(&Mesh, Filename.c_str()), E_FAIL);
+
+	remove(Filename.c_str());
+}
+
+TEST(Mesh, DrawFromTheMapping)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Quad(Vertices, Indices);
+
+	std::string Filename = Temp_File("draw.mesh");
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], 4, &Indices[0], 6), S_OK);
+
+	mesh Mesh;
+	ASSERT_EQ(Mesh_Open(&Mesh, Filename.c_str()), S_OK);
+
+	CSoftDevice *pDevice = NULL;
+	ASSERT_EQ(Create_Soft_Device(64, 64, false, &pDevice), S_OK);
+
+	vector3 VecCam = { 0.0f, 0.0f, -2.0f };
+	matrix4x4 MatWorld = Mat4x4_Identity();
+	matrix4x4 MatView = Mat4x4_View(VecCam);
+	matrix4x4 MatProj = Mat4x4_Projection(PI / 2.0f, 1.0f, 1.0f, 100.0f);
+	pDevice->SetTransform(SRTS_WORLD, &MatWorld);
+	pDevice->SetTransform(SRTS_VIEW, &MatView);
+	pDevice->SetTransform(SRTS_PROJECTION, &MatProj);
+	pDevice->SetRenderState(SRRS_CULLMODE, SRCULL_CCW);
+	pDevice->SetTextureStageState(0, SRTSS_COLOROP, SRTOP_SELECTARG2);
+	pDevice->SetTextureStageState(0, SRTSS_COLORARG2, SRTA_DIFFUSE);
+
+	pDevice->Clear(0, NULL, SRCLEAR_TARGET, 0x00000000, 1.0f);
+	pDevice->BeginScene();
+	EXPECT_EQ(Mesh_Draw(pDevice, &Mesh), S_OK);
+	pDevice->EndScene();
+
+	//the quad covers the middle of the screen
+	DWORD dwPitch;
+	DWORD *pColor = pDevice->GetColorBuffer(&dwPitch);
+	EXPECT_NE(pColor[32 * dwPitch + 32] & 0x00ffffff, 0u);
+	EXPECT_EQ(pColor[1 * dwPitch + 1] & 0x00ffffff, 0u);
+
+	pDevice->Release();
+	Mesh_Close(&Mesh);
+	remove(Filename.c_str());
+}
+
+//the batches on the device path and the DWORD indices on the software
+//path draw the same image
+TEST(Mesh, BatchesDrawLikeDwordIndices)
+{
+	std::vector<mesh_vertex> Vertices;
+	std::vector<DWORD> Indices;
+	Make_Grid(300, false, Vertices, Indices);
+
+	std::string Filename = Temp_File("drawgrid.mesh");
+	ASSERT_EQ(Mesh_Write(Filename.c_str(), &Vertices[0], (DWORD)Vertices.size(),
+		&Indices[0], (DWORD)Indices.size()), S_OK);
+
+	mesh Mesh;
+	ASSERT_EQ(Mesh_Open(&Mesh, Filename.c_str()), S_OK);
+
+	CSoftDevice *pDevice = NULL;
+	ASSERT_EQ(Create_Soft_Device(64, 64, false, &pDevice), S_OK);
+
+	vector3 VecCam = { 0.0f, 0.0f, -2.0f };
+	matrix4x4 MatWorld = Mat4x4_Identity();
+	matrix4x4 MatView = Mat4x4_View(VecCam);
+	matrix4x4 MatProj = Mat4x4_Projection(PI / 2.0f, 1.0f, 1.0f, 100.0f);
+	pDevice->SetTransform(SRTS_WORLD, &MatWorld);
+	pDevice->SetTransform(SRTS_VIEW, &MatView);
+	pDevice->SetTransform(SRTS_PROJECTION, &MatProj);
+	pDevice->SetRenderState(SRRS_CULLMODE, SRCULL_CCW);
+	pDevice->SetTextureStageState(0, SRTSS_COLOROP, SRTOP_SELECTARG2);
+	pDevice->SetTextureStageState(0, SRTSS_COLORARG2, SRTA_DIFFUSE);
+
+	DWORD dwPitch;
+	DWORD *pColor = pDevice->GetColorBuffer(&dwPitch);
+	std::vector<DWORD> Frames[2];
+
+	for(int i = 0; i < 2; i++)
+	{
+		pDevice->Clear(0, NULL, SRCLEAR_TARGET, 0x00000000, 1.0f);
+		pDevice->BeginScene();
+		if(i == 0)
+			EXPECT_EQ(Mesh_Draw(pDevice, &Mesh), S_OK);
+		else
+			EXPECT_EQ(Mesh_Draw_Soft(pDevice, &Mesh), S_OK);
+		pDevice->EndScene();
+
+		Frames[i].assign(pColor, pColor + 64 * dwPitch);
+	}
+
+	EXPECT_NE(Frames[1][32 * dwPitch + 32] & 0x00ffffff, 0u);
+	EXPECT_TRUE(Frames[0] == Frames[1]);
+
+	pDevice->Release();
+	Mesh_Close(&Mesh);
+	remove(Filename.c_str());
+}
+
+TEST(MeshImport, ObjSharesCornersAndTurnsZ)
+{
+	std::string Filename = Temp_File("quad.obj");
+	Write_Text(Filename,
+		"# a quad\n"
+		"o quad\n"
+		"v -1 -1 1\n"
+		"v 1 -1 1\n"
+		"v 1 1 1\n"
+		"v -1 1 1\n"
+		"vt 0 0\n"
+		"vt 1 0\n"
+		"vt 1 1\n"
+		"vt 0 1\n"
+		"vn 0 0 1\n"
+		"usemtl none\n"
+		"f 1/1/1 2/2/1 3/3/1\n"
+		"f -4/-4/-1 -2/-2/-1 -1/-1/-1\n");
+
+	mesh_data Data;
+	ASSERT_EQ(Mesh_Import(Filename.c_str(), &Data), S_OK);
+
+	EXPECT_EQ(Data.dwVertexCount, 4u);
+	ASSERT_EQ(Data.dwIndexCount, 6u);
+	EXPECT_EQ(Data.pIndices[3], Data.pIndices[0]);
+
+	EXPECT_EQ(Data.pVertices[0].z, -1.0f);
+	EXPECT_EQ(Data.pVertices[0].nz, -1.0f);
+	EXPECT_EQ(Data.pVertices[0].tv, 1.0f);
+	EXPECT_EQ(Data.pVertices[2].tu, 1.0f);
+
+	Mesh_Data_Free(&Data);
+	remove(Filename.c_str());
+}
+
+TEST(MeshImport, ObjPolygonsAndMadeNormals)
+{
+	std::string Filename = Temp_File("poly.obj");
+	Write_Text(Filename,
+		"v -1 -1 0\n"
+		"v 1 -1 0\n"
+		"v 1 1 0\n"
+		"v -1 1 0\n"
+		"f 1 2 3 4\n");
+
+	mesh_data Data;
+	ASSERT_EQ(Mesh_Import_OBJ(Filename.c_str(), &Data), S_OK);
+
+	EXPECT_EQ(Data.dwVertexCount, 4u);
+	EXPECT_EQ(Data.dwIndexCount, 6u);
+
+	//counterclockwise seen from +z in the file, the front looks at -z now
+	for(DWORD i = 0; i < Data.dwVertexCount; i++)
+		EXPECT_NEAR(Data.pVertices[i].nz, -1.0f, 1e-6f);
+
+	Mesh_Data_Free(&Data);
+
+	Write_Text(Filename, "v 0 0 0\nf 1 2 3\n");
+	EXPECT_EQ(Mesh_Import_OBJ(Filename.c_str(), &Data), E_FAIL);
+
+	remove(Filename.c_str());
+}
+
+TEST(MeshImport, PlyAscii)
+{
+	std::string Filename = Temp_File("quad.ply");
+	Write_Text(Filename,
+		"ply\n"
+		"format ascii 1.0\n"
+		"comment a quad\n"
+		"element vertex 4\n"
+		"property float x\n"
+		"property float y\n"
+		"property float z\n"
+		"property uchar red\n"
+		"element face 1\n"
+		"property list uchar int vertex_indices\n"
+		"element edge 1\n"
+		"property int vertex1\n"
+		"property int vertex2\n"
+		"end_header\n"
+		"-1 -1 0 255\n"
+		"1 -1 0 255\n"
+		"1 1 0 255\n"
+		"-1 1 0 255\n"
+		"4 0 1 2 3\n"
+		"0 1\n");
+
+	mesh_data Data;
+	ASSERT_EQ(Mesh_Import(Filename.c_str(), &Data), S_OK);
+
+	EXPECT_EQ(Data.dwVertexCount, 4u);
+	ASSERT_EQ(Data.dwIndexCount, 6u);
+	EXPECT_EQ(Data.pIndices[4], 3u);
+	EXPECT_EQ(Data.pIndices[5], 2u);
+	EXPECT_NEAR(Data.pVertices[0].nz, -1.0f, 1e-6f);
+
+	Mesh_Data_Free(&Data);
+	remove(Filename.c_str());
+}
+
+TEST(MeshImport, PlyBinary)
+{
+	std::string Filename = Temp_File("tri.ply");
+	const char *szHeader =
+		"ply\n"
+		"format binary_little_endian 1.0\n"
+		"element vertex 3\n"
+		"property float x\n"
+		"property float y\n"
+		"property float z\n"
+		"property float s\n"
+		"property float t\n"
+		"element face 1\n"
+		"property list uchar uint vertex_indices\n"
+		"end_header\n";
+
+	FILE *pFile = fopen(Filename.c_str(), "wb");
+	ASSERT_TRUE(pFile != NULL);
+	fputs(szHeader, pFile);
+
+	float Verts[3][5] = {
+		{ 0.0f, 0.0f, 2.0f, 0.0f, 0.0f },
+		{ 1.0f, 0.0f, 2.0f, 1.0f, 0.0f },
+		{ 0.0f, 1.0f, 2.0f, 0.0f, 1.0f } };
+	fwrite(Verts, sizeof(Verts), 1, pFile);
+
+	BYTE Count = 3;
+	DWORD Face[3] = { 0, 1, 2 };
+	fwrite(&Count, 1, 1, pFile);
+	fwrite(Face, sizeof(Face), 1, pFile);
+	fclose(pFile);
+
+	mesh_data Data;
+	ASSERT_EQ(Mesh_Import_PLY(Filename.c_str(), &Data), S_OK);
+
+	EXPECT_EQ(Data.dwVertexCount, 3u);
+	EXPECT_EQ(Data.dwIndexCount, 3u);
+	EXPECT_EQ(Data.pVertices[1].x, 1.0f);
+	EXPECT_EQ(Data.pVertices[1].z, -2.0f);
+	EXPECT_EQ(Data.pVertices[2].tv, 0.0f);
+
+	Mesh_Data_Free(&Data);
+	remove(Filename.c_str());
+}
@@ -0,0 +1,149 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <gtest/gtest.h>
+
+#include "SoftDevice.h"
+
+//the same layout as D3DTLVERTEX
+struct tl_vertex
+{
+	float sx, sy, sz, rhw;
+	DWORD dwColor;
+	DWORD dwSpecular;
+	float tu, tv;
+};
+
+class SoftDeviceTest : public ::testing::Test
+{
+protected:
+	void SetUp()
+	{
+		m_pDevice = NULL;
+		ASSERT_EQ(Create_Soft_Device(64, 48, true, &m_pDevice), S_OK);
+		m_pDevice->SetRenderState(SRRS_CULLMODE, SRCULL_NONE);
+		m_pDevice->SetTextureStageState(0, SRTSS_COLOROP, SRTOP_SELECTARG2);
+		m_pDevice->SetTextureStageState(0, SRTSS_COLORARG2, SRTA_DIFFUSE);
+	}
+
+	void TearDown()
+	{
+		if(m_pDevice)
+			m_pDevice->Release();
+	}
+
+	DWORD Pixel(DWORD x, DWORD y)
+	{
+		DWORD dwPitch;
+		DWORD *pColor = m_pDevice->GetColorBuffer(&dwPitch);
+		return pColor[y * dwPitch + x] & 0x00ffffff;
+	}
+
+	//a red triangle over the left top quarter of the screen
+	void Draw_Triangle()
+	{
+		tl_vertex Tri[3] = {
+			{  0.0f,  0.0f, 0.5f, 1.0f, 0xffff0000, 0, 0.0f, 0.0f },
+			{ 32.0f,  0.0f, 0.5f, 1.0f, 0xffff0000, 0, 0.0f, 0.0f },
+			{  0.0f, 24.0f, 0.5f, 1.0f, 0xffff0000, 0, 0.0f, 0.0f } };
+
+		ASSERT_EQ(m_pDevice->BeginScene(), S_OK);
+		m_pDevice->DrawPrimitive(SRPT_TRIANGLELIST, SRFVF_TLVERTEX, Tri, 3, 0);
+		m_pDevice->EndScene();
+	}
+
+	CSoftDevice *m_pDevice;
+};
+
+TEST_F(SoftDeviceTest, ClearFillsTheBuffers)
+{
+	m_pDevice->Clear(0, NULL, SRCLEAR_TARGET | SRCLEAR_ZBUFFER, 0x00123456, 1.0f);
+
+	EXPECT_EQ(Pixel(0, 0), 0x123456u);
+	EXPECT_EQ(Pixel(63, 47), 0x123456u);
+
+	DWORD dwPitch;
+	float *pZ = m_pDevice->GetZBuffer(&dwPitch);
+	ASSERT_TRUE(pZ != NULL);
+	EXPECT_EQ(pZ[47 * dwPitch + 63], 1.0f);
+}
+
+TEST_F(SoftDeviceTest, TriangleCoversItsPixelsOnly)
+{
+	m_pDevice->Clear(0, NULL, SRCLEAR_TARGET | SRCLEAR_ZBUFFER, 0x00ffffff, 1.0f);
+	Draw_Triangle();
+
+	EXPECT_EQ(Pixel(4, 4), 0xff0000u);
+	EXPECT_EQ(Pixel(60, 44), 0xffffffu);
+
+	RECT Rc;
+	m_pDevice->GetDrawnRect(&Rc);
+	EXPECT_GE(Rc.left, 0);
+	EXPECT_LE(Rc.right, 33);
+	EXPECT_LE(Rc.bottom, 25);
+	EXPECT_GT(Rc.right, Rc.left);
+}
+
+TEST_F(SoftDeviceTest, ZTestRejectsFartherPixels)
+{
+	m_pDevice->Clear(0, NULL, SRCLEAR_TARGET | SRCLEAR_ZBUFFER, 0x00ffffff, 0.25f);
+	m_pDevice->SetRenderState(SRRS_ZENABLE, TRUE);
+	m_pDevice->SetRenderState(SRRS_ZFUNC, SRCMP_LESSEQUAL);
+	Draw_Triangle();
+
+	EXPECT_EQ(Pixel(4, 4), 0xffffffu);
+}
+
+TEST_F(SoftDeviceTest, DwordIndicesDrawLikeWordIndices)
+{
+	//the fourth vertex is not used by the triangle
+	tl_vertex Verts[4] = {
+		{ 63.0f, 47.0f, 0.5f, 1.0f, 0xff0000ff, 0, 0.0f, 0.0f },
+		{  0.0f,  0.0f, 0.5f, 1.0f, 0xff0000ff, 0, 0.0f, 0.0f },
+		{ 32.0f,  0.0f, 0.5f, 1.0f, 0xff0000ff, 0, 0.0f, 0.0f },
+		{  0.0f, 24.0f, 0.5f, 1.0f, 0xff0000ff, 0, 0.0f, 0.0f } };
+	DWORD Indices[3] = { 1, 2, 3 };
+
+	m_pDevice->Clear(0, NULL, SRCLEAR_TARGET, 0x00ffffff, 1.0f);
+	ASSERT_EQ(m_pDevice->BeginScene(), S_OK);
+	EXPECT_EQ(m_pDevice->DrawIndexedPrimitive32(SRPT_TRIANGLELIST, SRFVF_TLVERTEX, Verts, 4, Indices, 3, 0), S_OK);
+	EXPECT_EQ(m_pDevice->DrawIndexedPrimitive32(SRPT_TRIANGLELIST, SRFVF_TLVERTEX, Verts, 4, NULL, 3, 0), E_INVALIDARG);
+	m_pDevice->EndScene();
+
+	EXPECT_EQ(Pixel(4, 4), 0x0000ffu);
+	EXPECT_EQ(Pixel(60, 44), 0xffffffu);
+}
+
+TEST_F(SoftDeviceTest, ViewportStaysInside)
+{
+	EXPECT_EQ(m_pDevice->SetViewport(0, 0, 64, 48), S_OK);
+	EXPECT_EQ(m_pDevice->SetViewport(32, 24, 32, 24), S_OK);
+	EXPECT_EQ(m_pDevice->SetViewport(33, 0, 32, 48), E_INVALIDARG);
+	EXPECT_EQ(m_pDevice->SetViewport(0xfffffff0, 0, 0x20, 48), E_INVALIDARG);
+	EXPECT_EQ(m_pDevice->SetViewport(0, 0xfffffff0, 64, 0x20), E_INVALIDARG);
+}
+
+TEST_F(SoftDeviceTest, ResizeKeepsWorking)
+{
+	ASSERT_EQ(m_pDevice->Resize(128, 96), S_OK);
+	EXPECT_EQ(m_pDevice->GetWidth(), 128u);
+	EXPECT_EQ(m_pDevice->GetHeight(), 96u);
+
+	m_pDevice->Clear(0, NULL, SRCLEAR_TARGET | SRCLEAR_ZBUFFER, 0x00ffffff, 1.0f);
+	Draw_Triangle();
+	EXPECT_EQ(Pixel(4, 4), 0xff0000u);
+	EXPECT_EQ(Pixel(127, 95), 0xffffffu);
+
+	EXPECT_EQ(m_pDevice->Resize(0, 10), E_INVALIDARG);
+}
+
+TEST_F(SoftDeviceTest, PresentCopiesTheFrame)
+{
+	m_pDevice->Clear(0, NULL, SRCLEAR_TARGET, 0x00abcdef, 1.0f);
+
+	static DWORD Dest[64 * 48];
+	ASSERT_EQ(m_pDevice->Present(Dest, 64 * sizeof(DWORD), NULL), S_OK);
+	EXPECT_EQ(Dest[0] & 0x00ffffff, 0xabcdefu);
+	EXPECT_EQ(Dest[64 * 48 - 1] & 0x00ffffff, 0xabcdefu);
+}
@@ -0,0 +1,82 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <gtest/gtest.h>
+
+#include "SpscQueue.h"
+
+TEST(SpscQueue, FirstInFirstOut)
+{
+	spsc_queue Queue;
+	Spsc_Init(&Queue);
+
+	int Items[4];
+	for(int i = 0; i < 4; i++)
+		ASSERT_TRUE(Spsc_Push(&Queue, &Items[i]));
+
+	for(int i = 0; i < 4; i++)
+		EXPECT_EQ(Spsc_Pop(&Queue), &Items[i]);
+
+	EXPECT_TRUE(Spsc_Pop(&Queue) == NULL);
+}
+
+TEST(SpscQueue, FullQueueRefuses)
+{
+	spsc_queue Queue;
+	Spsc_Init(&Queue);
+
+	int Item;
+	int Pushed = 0;
+	while(Pushed <= SPSC_CAPACITY && Spsc_Push(&Queue, &Item))
+		Pushed++;
+
+	EXPECT_GE(Pushed, SPSC_CAPACITY - 1);
+	EXPECT_LE(Pushed, SPSC_CAPACITY);
+}
+
+struct producer
+{
+	spsc_queue *pQueue;
+	int Count;
+};
+
+static void Produce(void *pParam)
+{
+	producer *pProducer = (producer *)pParam;
+
+	//the values are the pointers, 1 to Count
+	for(size_t i = 1; i <= (size_t)pProducer->Count; )
+	{
+		if(Spsc_Push(pProducer->pQueue, (void *)i))
+			i++;
+		else
+			Sleep_Ms(0);		//on one CPU the consumer has to run
+	}
+}
+
+TEST(SpscQueue, TwoThreadsKeepTheOrder)
+{
+	spsc_queue Queue;
+	Spsc_Init(&Queue);
+
+	producer Producer = { &Queue, 20000 };
+	thread_handle Thread;
+	ASSERT_TRUE(Thread_Create(&Thread, Produce, &Producer));
+
+	size_t Expected = 1;
+	while(Expected <= (size_t)Producer.Count)
+	{
+		void *pItem = Spsc_Pop(&Queue);
+		if(!pItem)
+		{
+			Sleep_Ms(0);
+			continue;
+		}
+
+		ASSERT_EQ((size_t)pItem, Expected);
+		Expected++;
+	}
+
+	Thread_Join(&Thread);
+}
@@ -0,0 +1,194 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "Platform.h"
+#include "FrameRing.h"
+#include "ImageWriter.h"
+
+//reads the frames a Headless -shm run draws, in the shared memory where
+//they are, without copying them first:
+//
+//  Headless -scene 004 -frames 100000 -shm /frames &
+//  FrameView -shm /frames -out view%04d.ppm -every 60
+//  FrameView -shm /frames -raw | ffplay -f rawvideo -pixel_format bgr0 -video_size 640x480 -i -
+//
+//only the newest frame is read, when the renderer is faster the frames
+//between are counted as skipped. A frame the renderer wrote over while
+//it was read is counted as torn (and its file removed)
+
+struct view_options
+{
+	const char *szShm;
+	const char *szOut;
+	bool bRaw;
+	DWORD dwEvery;
+	DWORD dwFrames;
+	DWORD dwWaitMs;
+};
+
+static void Print_Usage()
+{
+	fprintf(stderr, "FrameView [-shm /name] [-out file%%04d.ppm|.png] [-every N] [-raw]\n"
+		"          [-frames N] [-wait seconds]\n");
+}
+
+//rows go out one by one, the pitch of the ring can be wider than a row
+static bool Write_Raw(const frame_ring_header *pHeader, const DWORD *pPixels)
+{
+	for(DWORD y = 0; y < pHeader->dwHeight; y++)
+	{
+		const BYTE *pRow = (const BYTE *)pPixels + y * pHeader->lPitch;
+		if(fwrite(pRow, sizeof(DWORD), pHeader->dwWidth, stdout) != pHeader->dwWidth)
+			return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	view_options Opt;
+	Opt.szShm = "/frames";
+	Opt.szOut = NULL;
+	Opt.bRaw = false;
+	Opt.dwEvery = 1;
+	Opt.dwFrames = 0;
+	Opt.dwWaitMs = 5000;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool bValue = i + 1 < argc;
+
+		if(!strcmp(argv[i], "-shm") && bValue)
+			Opt.szShm = argv[++i];
+		else if(!strcmp(argv[i], "-out") && bValue)
+			Opt.szOut = argv[++i];
+		else if(!strcmp(argv[i], "-raw"))
+			Opt.bRaw = true;
+		else if(!strcmp(argv[i], "-every") && bValue)
+			Opt.dwEvery = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-frames") && bValue)
+			Opt.dwFrames = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-wait") && bValue)
+			Opt.dwWaitMs = (DWORD)(atof(argv[++i]) * 1000.0);
+		else
+		{
+			Print_Usage();
+			return 1;
+		}
+	}
+
+	if(!Opt.dwEvery)
+		Opt.dwEvery = 1;
+
+	if(Opt.szOut && !Frame_Name_Valid(Opt.szOut))
+	{
+		fprintf(stderr, "-out needs one frame number (%%d or %%04d) in the name and no other %%, for example view%%04d.ppm\n");
+		return 1;
+	}
+
+	//the frame number still fits in the 260 characters of the name
+	if(Opt.szOut && strlen(Opt.szOut) > 200)
+	{
+		fprintf(stderr, "-out %.40s... is too long, at most 200 characters\n", Opt.szOut);
+		return 1;
+	}
+
+#ifdef _WIN32
+	if(Opt.bRaw)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	//the renderer may start after the viewer
+	frame_ring Ring;
+	DWORD dwWaited = 0;
+	while(FAILED(Frame_Ring_Open(&Ring, Opt.szShm)))
+	{
+		if(dwWaited >= Opt.dwWaitMs)
+		{
+			fprintf(stderr, "no frames in %s\n", Opt.szShm);
+			return 1;
+		}
+
+		Sleep_Ms(10);
+		dwWaited += 10;
+	}
+
+	const frame_ring_header *pHeader = Ring.pHeader;
+	fprintf(stderr, "%s: %ux%u, %u frames in the ring\n", Opt.szShm,
+		(unsigned)pHeader->dwWidth, (unsigned)pHeader->dwHeight, (unsigned)pHeader->dwFrames);
+
+	DWORD dwShown = 0, dwSkipped = 0, dwTorn = 0;
+	DWORD dwNext = 0;		//the frame after the last one read
+	bool bOk = true;
+
+	LONGLONG Start = Timer_Ticks();
+
+	while(bOk && (!Opt.dwFrames || dwShown < Opt.dwFrames))
+	{
+		frame_ring_read Read;
+		if(!Frame_Ring_Begin_Read(&Ring, dwNext, &Read))
+		{
+			//the last frames are in the ring before it is closed
+			if(Frame_Ring_Closed(&Ring) && (DWORD)pHeader->Written <= dwNext)
+				break;
+
+			Sleep_Ms(1);
+			continue;
+		}
+
+		char szFilename[260];
+		bool bWrite = Opt.szOut && Read.dwFrame % Opt.dwEvery == 0;
+		if(bWrite)
+		{
+			Frame_Name(szFilename, sizeof(szFilename), Opt.szOut, Read.dwFrame);
+
+			size_t Length = strlen(szFilename);
+			if(Length > 4 && !strcmp(szFilename + Length - 4, ".png"))
+				bOk = Write_PNG(szFilename, Read.pPixels, pHeader->dwWidth, pHeader->dwHeight, pHeader->lPitch);
+			else
+				bOk = Write_PPM(szFilename, Read.pPixels, pHeader->dwWidth, pHeader->dwHeight, pHeader->lPitch);
+		}
+
+		if(bOk && Opt.bRaw)
+			bOk = Write_Raw(pHeader, Read.pPixels);
+
+		if(!Frame_Ring_End_Read(&Ring, &Read))
+		{
+			dwTorn++;
+			if(bWrite)
+				remove(szFilename);
+		}
+		else
+		{
+			dwSkipped += Read.dwFrame - dwNext;
+			dwShown++;
+		}
+
+		dwNext = Read.dwFrame + 1;
+	}
+
+	double Seconds = Timer_Seconds(Timer_Ticks() - Start);
+	if(Seconds <= 0.0)
+		Seconds = 1e-9;
+
+	fprintf(stderr, "%u frames read %u skipped %u torn, %.1f frames/s\n",
+		(unsigned)dwShown, (unsigned)dwSkipped, (unsigned)dwTorn, dwShown / Seconds);
+
+	if(!bOk)
+		fprintf(stderr, "can not write the frames\n");
+
+	Frame_Ring_Close(&Ring);
+
+	return bOk ? 0 : 1;
+}
@@ -0,0 +1,506 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "RenderStats.h"
+#include "Scenes.h"
+#include "ImageWriter.h"
+#include "FrameArena.h"
+#include "FramePipeline.h"
+#include "FrameRing.h"
+#include "FrameCapture.h"
+
+//renders the scene of a sample without a window and prints the speed:
+//
+//  Headless -scene 004 -frames 1000
+//  Headless -scene all -frames 200 -width 1024 -height 768
+//  Headless -scene 007 -frames 60 -out frames/007_%04d.png
+//  Headless -scene 004 -frames 300 -record 004.trc      (for Replay)
+//  Headless -scene all -filter      (drop state calls that change nothing)
+//  Headless -scene 004 -objects 1000 -filter -batch      (1000 cubes, batched)
+//  Headless -scene 004 -objects 100000 -instance      (instanced, one thread per CPU)
+//  Headless -scene 004 -objects 1000 -pipeline      (next frame simulated on another thread)
+//  Headless -scene 003 -dirty      (clear and present only the part that changed)
+//  Headless -scene 004 -frames 100000 -shm /frames      (live, Tools/FrameView shows it)
+//  Headless -scene 004 -frames 600 -capture 004.y4m -dropframes      (video, frames the disk can not take are dropped)
+//  Headless -scene 004 -mesh bunny.mesh      (a mesh file of MeshConv instead of the cube)
+//  Headless -scene 004 -mesh bunny.mesh -keeporder      (its triangles in the order of the file)
+//  Headless -scene 004 -mesh bunny.mesh -vcache      (vertices transformed through a 32 vertex cache)
+//
+//the cube turns by -step radians every frame (PI / 100 by default),
+//so every run draws exactly the same frames, -step 0 draws a still cube. With -scene all the
+//file names get the number of the sample in front: 004_frame0001.ppm
+
+struct headless_options
+{
+	const char *szScene;
+	const char *szRoot;
+	const char *szOut;
+	const char *szRecord;
+	const char *szShm;
+	const char *szCapture;
+	const char *szMesh;
+	bool bKeepOrder;
+	bool bVertexCache;
+	bool bDropFrames;
+	bool bFilter;
+	bool bBatch;
+	bool bInstance;
+	bool bPipeline;
+	bool bDirty;
+	bool bPrefix;
+	DWORD dwObjects;
+	int Threads;
+	DWORD dwFrames;
+	DWORD dwWidth;
+	DWORD dwHeight;
+	float fStep;
+};
+
+static void Print_Usage()
+{
+	printf("Headless -scene <001..010|all> [-frames N] [-width W] [-height H]\n"
+		"         [-step radians] [-out file%%04d.ppm|.png] [-record file.trc]\n"
+		"         [-filter] [-batch] [-objects N] [-instance] [-threads N] [-pipeline]\n"
+		"         [-dirty] [-shm /name] [-capture file.y4m|.ppm] [-dropframes]\n"
+		"         [-mesh file.mesh] [-keeporder] [-vcache] [-root dir] [-list]\n");
+}
+
+//longest -out, -record, -capture and -root name, with the sample number in
+//front and the frame number it still fits in HEADLESS_MAX_PATH
+#define HEADLESS_MAX_NAME	200
+#define HEADLESS_MAX_PATH	260
+
+//with -scene all every scene writes its own files, the number of the
+//sample goes in front of the file name. szFilename has HEADLESS_MAX_PATH
+//characters
+static void Scene_Filename(const char *szName, const scene_desc *pDesc, bool bPrefix, char *szFilename)
+{
+	if(!bPrefix)
+	{
+		sprintf(szFilename, "%.*s", HEADLESS_MAX_PATH - 1, szName);
+		return;
+	}
+
+	const char *pName = strrchr(szName, '/');
+	const char *pBack = strrchr(szName, '\\');
+	if(pBack > pName)
+		pName = pBack;
+	size_t Dir = pName ? pName - szName + 1 : 0;
+	sprintf(szFilename, "%.*s%.3s_%.*s", (int)Dir, szName, pDesc->szName,
+		HEADLESS_MAX_PATH - 5 - (int)Dir, szName + Dir);
+}
+
+//the simulation stage of -pipeline
+struct headless_sim
+{
+	const scene *pScene;
+	float fStep;
+};
+
+static void Simulate_Frame(void *pParam, void *pSlot, DWORD dwFrame)
+{
+	headless_sim *pSim = (headless_sim *)pParam;
+
+	//the job pool belongs to the drawing thread
+	Scene_Simulate(pSim->pScene, (scene_frame *)pSlot, pSim->fStep * (float)dwFrame, NULL);
+}
+
+//the frame of the device, or the screen of -dirty
+static void Copy_Frame(const scene *pScene, const DWORD *pScreen, const headless_options *pOpt, DWORD *pDest, LONG lPitch)
+{
+	if(!pScreen)
+	{
+		pScene->pDevice->Present(pDest, lPitch, NULL);
+		return;
+	}
+
+	for(DWORD y = 0; y < pOpt->dwHeight; y++)
+		memcpy((BYTE *)pDest + y * lPitch, pScreen + y * pOpt->dwWidth, pOpt->dwWidth * sizeof(DWORD));
+}
+
+static bool Run_Scene(const scene_desc *pDesc, const headless_options *pOpt)
+{
+	char szRecord[HEADLESS_MAX_PATH];
+	if(pOpt->szRecord)
+		Scene_Filename(pOpt->szRecord, pDesc, pOpt->bPrefix, szRecord);
+
+	scene_options Options;
+	Options.szTrace = pOpt->szRecord ? szRecord : NULL;
+	Options.bFilter = pOpt->bFilter;
+	Options.bBatch = pOpt->bBatch;
+	Options.dwObjects = pOpt->dwObjects;
+	Options.bInstance = pOpt->bInstance;
+	Options.Threads = pOpt->Threads;
+	Options.bDirty = pOpt->bDirty;
+	Options.szMesh = pOpt->szMesh;
+	Options.bKeepOrder = pOpt->bKeepOrder;
+
+	scene Scene;
+	if(FAILED(Scene_Init(&Scene, pDesc, pOpt->dwWidth, pOpt->dwHeight, pOpt->szRoot, &Options)))
+	{
+		if(pOpt->szMesh)
+			printf("%s: can not load the scene with %s (not a mesh file, or a scene without the device transform?)\n",
+				pDesc->szName, pOpt->szMesh);
+		else
+			printf("%s: can not load the scene (texture in %s?)\n", pDesc->szName, pOpt->szRoot);
+		return false;
+	}
+
+	Scene.pDevice->SetVertexCache(pOpt->bVertexCache);
+
+	image_writer *pWriter = NULL;
+	if(pOpt->szOut)
+		pWriter = Image_Writer_Create(pOpt->dwWidth, pOpt->dwHeight, 4);
+
+	//-shm presents every frame into a ring in shared memory, another
+	//process reads the frames there
+	frame_ring Ring;
+	ZeroMemory(&Ring, sizeof(frame_ring));
+	if(pOpt->szShm && FAILED(Frame_Ring_Create(&Ring, pOpt->szShm, pOpt->dwWidth, pOpt->dwHeight, FRAME_RING_DEFAULT_FRAMES)))
+	{
+		printf("%s: can not create the shared memory %s\n", pDesc->szName, pOpt->szShm);
+		Image_Writer_Destroy(pWriter);
+		Scene_Release(&Scene);
+		return false;
+	}
+
+	//-dirty presents every frame into this screen, only the part that
+	//changed, the rest is still the frame before. -out saves the screen
+	DWORD *pScreen = NULL;
+	LONG lScreenPitch = (LONG)(pOpt->dwWidth * sizeof(DWORD));
+	if(pOpt->bDirty)
+	{
+		pScreen = new(std::nothrow) DWORD[pOpt->dwWidth * pOpt->dwHeight];
+		if(!pScreen)
+		{
+			printf("%s: out of memory\n", pDesc->szName);
+			Frame_Ring_Close(&Ring);
+			Image_Writer_Destroy(pWriter);
+			Scene_Release(&Scene);
+			return false;
+		}
+	}
+
+	//-pipeline: frame N + 1 is simulated while frame N is drawn, then the
+	//image writer saves it on its own threads
+	scene_frame Frames[2];
+	ZeroMemory(Frames, sizeof(Frames));
+	frame_pipeline *pPipe = NULL;
+	headless_sim Sim = { &Scene, pOpt->fStep };
+
+	if(pOpt->bPipeline)
+	{
+		void *pSlots[2] = { &Frames[0], &Frames[1] };
+
+		if(FAILED(Scene_Frame_Init(&Scene, &Frames[0])) || FAILED(Scene_Frame_Init(&Scene, &Frames[1])) ||
+			!(pPipe = Pipeline_Create(pSlots, 2, Simulate_Frame, &Sim)))
+		{
+			printf("%s: can not start the pipeline\n", pDesc->szName);
+			Scene_Frame_Release(&Frames[0]);
+			Scene_Frame_Release(&Frames[1]);
+			delete[] pScreen;
+			Frame_Ring_Close(&Ring);
+			Image_Writer_Destroy(pWriter);
+			Scene_Release(&Scene);
+			return false;
+		}
+	}
+
+	//-capture records the frames into one video file on its own thread
+	frame_capture *pCapture = NULL;
+	if(pOpt->szCapture)
+	{
+		char szCapture[HEADLESS_MAX_PATH];
+		Scene_Filename(pOpt->szCapture, pDesc, pOpt->bPrefix, szCapture);
+
+		pCapture = Capture_Create(szCapture, pOpt->dwWidth, pOpt->dwHeight, 0, CAPTURE_DEFAULT_BUFFERS, pOpt->bDropFrames ? CAPTURE_DROP : CAPTURE_BLOCK);
+		if(!pCapture)
+			printf("%s: can not write %s, the frames are not captured\n", pDesc->szName, szCapture);
+	}
+
+	//counters of the frames before are dropped
+	Stats_End_Frame();
+
+	render_stats Total;
+	ZeroMemory(&Total, sizeof(render_stats));
+
+	LONGLONG Start = Timer_Ticks();
+
+	for(DWORD i = 0; i < pOpt->dwFrames; i++)
+	{
+		if(pPipe)
+		{
+			scene_frame *pFrame = (scene_frame *)Pipeline_Begin_Frame(pPipe);
+			Scene_Draw(&Scene, pFrame);
+			Pipeline_End_Frame(pPipe, pFrame);
+		}
+		else
+		{
+			Scene_Render(&Scene, pOpt->fStep * (float)i);
+		}
+
+		if(pScreen)
+			Scene.pDevice->Present(pScreen, lScreenPitch, Scene.bPresentAll ? NULL : &Scene.RcPresent);
+
+		if(Ring.pHeader)
+		{
+			LONG lPitch;
+			DWORD *pPixels = Frame_Ring_Begin_Write(&Ring, &lPitch);
+			Copy_Frame(&Scene, pScreen, pOpt, pPixels, lPitch);
+			Frame_Ring_End_Write(&Ring);
+		}
+
+		if(pWriter)
+		{
+			LONG lPitch;
+			DWORD *pPixels = Image_Writer_Acquire(pWriter, &lPitch);
+			Copy_Frame(&Scene, pScreen, pOpt, pPixels, lPitch);
+
+			char szFrame[HEADLESS_MAX_PATH - 4];
+			Frame_Name(szFrame, sizeof(szFrame), pOpt->szOut, i);
+
+			char szFilename[HEADLESS_MAX_PATH];
+			Scene_Filename(szFrame, pDesc, pOpt->bPrefix, szFilename);
+
+			Image_Writer_Submit(pWriter, szFilename);
+		}
+
+		if(pCapture)
+		{
+			LONG lPitch;
+			DWORD *pPixels = Capture_Acquire(pCapture, &lPitch);
+			if(pPixels)
+			{
+				Copy_Frame(&Scene, pScreen, pOpt, pPixels, lPitch);
+				Capture_Submit(pCapture);
+			}
+		}
+
+		Stats_End_Frame();
+		Stats_Add(&Total, Stats_Get_Frame());
+	}
+
+	double Seconds = Timer_Seconds(Timer_Ticks() - Start);
+
+	Pipeline_Destroy(pPipe);
+	Scene_Frame_Release(&Frames[0]);
+	Scene_Frame_Release(&Frames[1]);
+	delete[] pScreen;
+	Frame_Ring_Close(&Ring);
+
+	if(pWriter)
+	{
+		Image_Writer_Destroy(pWriter);
+		pWriter = NULL;
+	}
+
+	//the rest of the queue is written before the counters are read
+	capture_stats Capture;
+	ZeroMemory(&Capture, sizeof(capture_stats));
+	bool bCaptured = pCapture != NULL;
+	if(pCapture)
+	{
+		Capture_Destroy(pCapture, &Capture);
+		pCapture = NULL;
+	}
+
+	if(Seconds <= 0.0)
+		Seconds = 1e-9;
+
+	printf("%-42s %6u frames %8.3f s %9.1f frames/s %8.3f Mtri/s %8.2f Mpix/s\n",
+		pDesc->szName, (unsigned)pOpt->dwFrames, Seconds,
+		pOpt->dwFrames / Seconds,
+		Total.dwTrianglesIn / Seconds / 1e6,
+		Total.dwFragmentsWritten / Seconds / 1e6);
+
+	if(Scene.pFilter)
+		printf("%-42s %6u state calls %6u filtered\n", "",
+			(unsigned)Total.dwStateCalls, (unsigned)Total.dwStatesFiltered);
+
+	if(Scene.pBatch)
+		printf("%-42s %6u draws in %6u batches out\n", "",
+			(unsigned)Total.dwBatchDrawsIn, (unsigned)Total.dwBatchesOut);
+
+	if(Scene.pTLVB)
+		printf("%-42s %6u vertices transformed %6u reused\n", "",
+			(unsigned)Total.dwVerticesProcessed, (unsigned)Total.dwVerticesReused);
+
+	if(Scene.pMesh && Total.dwTrianglesIn)
+		printf("%-42s %6u vertices transformed %6u cache hits %6.3f per triangle\n", "",
+			(unsigned)Total.dwVerticesTransformed, (unsigned)Total.dwVertexCacheHits,
+			(float)Total.dwVerticesTransformed / Total.dwTrianglesIn);
+
+	if(pOpt->bDirty && pOpt->dwFrames)
+		printf("%-42s %6u KB cleared %6u KB presented per frame\n", "",
+			(unsigned)(Total.dwBytesCleared / pOpt->dwFrames / 1024),
+			(unsigned)(Total.dwBytesPresented / pOpt->dwFrames / 1024));
+
+	if(bCaptured)
+		printf("%-42s %6u frames captured %6u dropped %6u failed %8.1f MB/s written %8.3f s waited\n", "",
+			(unsigned)Capture.dwFrames, (unsigned)Capture.dwDropped, (unsigned)Capture.dwFailed,
+			Capture.fWriteSeconds > 0.0 ? Capture.Bytes / Capture.fWriteSeconds / 1e6 : 0.0,
+			Capture.fWaitSeconds);
+
+	if(Scene.pInstancer)
+		printf("%-42s %6u instances %6u culled, %d threads\n", "",
+			(unsigned)Total.dwInstancesIn, (unsigned)Total.dwInstancesCulled,
+			Job_Pool_Threads(Scene.pJobs));
+
+	//scratch memory of the device, the arena of this thread
+	frame_arena *pArena = Frame_Arena_Local();
+	if(pArena)
+		printf("%-42s %6u KB frame arena high water %6u KB block\n", "",
+			(unsigned)(Frame_Arena_High_Water(pArena) / 1024), (unsigned)(Frame_Arena_Size(pArena) / 1024));
+
+	if(Scene.pRecorder && !Scene.pRecorder->IsGood())
+	{
+		printf("%s: can not write the trace %s\n", pDesc->szName, szRecord);
+		Scene_Release(&Scene);
+		return false;
+	}
+
+	Scene_Release(&Scene);
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	headless_options Opt;
+	Opt.szScene = NULL;
+	Opt.szRoot = ".";
+	Opt.szOut = NULL;
+	Opt.szRecord = NULL;
+	Opt.szShm = NULL;
+	Opt.szCapture = NULL;
+	Opt.szMesh = NULL;
+	Opt.bKeepOrder = false;
+	Opt.bVertexCache = false;
+	Opt.bDropFrames = false;
+	Opt.bFilter = false;
+	Opt.bBatch = false;
+	Opt.bInstance = false;
+	Opt.bPipeline = false;
+	Opt.bDirty = false;
+	Opt.bPrefix = false;
+	Opt.dwObjects = 1;
+	Opt.Threads = 0;
+	Opt.dwFrames = 100;
+	Opt.dwWidth = 640;
+	Opt.dwHeight = 480;
+	Opt.fStep = PI / 100.0f;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool bValue = i + 1 < argc;
+
+		if(!strcmp(argv[i], "-list"))
+		{
+			for(int s = 0; s < Scene_Count(); s++)
+				printf("%s\n", Scene_Get(s)->szName);
+			return 0;
+		}
+		else if(!strcmp(argv[i], "-scene") && bValue)
+			Opt.szScene = argv[++i];
+		else if(!strcmp(argv[i], "-root") && bValue)
+			Opt.szRoot = argv[++i];
+		else if(!strcmp(argv[i], "-out") && bValue)
+			Opt.szOut = argv[++i];
+		else if(!strcmp(argv[i], "-filter"))
+			Opt.bFilter = true;
+		else if(!strcmp(argv[i], "-batch"))
+			Opt.bBatch = true;
+		else if(!strcmp(argv[i], "-objects") && bValue)
+			Opt.dwObjects = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-instance"))
+			Opt.bInstance = true;
+		else if(!strcmp(argv[i], "-pipeline"))
+			Opt.bPipeline = true;
+		else if(!strcmp(argv[i], "-dirty"))
+			Opt.bDirty = true;
+		else if(!strcmp(argv[i], "-threads") && bValue)
+			Opt.Threads = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-record") && bValue)
+			Opt.szRecord = argv[++i];
+		else if(!strcmp(argv[i], "-shm") && bValue)
+			Opt.szShm = argv[++i];
+		else if(!strcmp(argv[i], "-capture") && bValue)
+			Opt.szCapture = argv[++i];
+		else if(!strcmp(argv[i], "-mesh") && bValue)
+			Opt.szMesh = argv[++i];
+		else if(!strcmp(argv[i], "-keeporder"))
+			Opt.bKeepOrder = true;
+		else if(!strcmp(argv[i], "-vcache"))
+			Opt.bVertexCache = true;
+		else if(!strcmp(argv[i], "-dropframes"))
+			Opt.bDropFrames = true;
+		else if(!strcmp(argv[i], "-frames") && bValue)
+			Opt.dwFrames = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-width") && bValue)
+			Opt.dwWidth = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-height") && bValue)
+			Opt.dwHeight = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-step") && bValue)
+			Opt.fStep = (float)atof(argv[++i]);
+		else
+		{
+			Print_Usage();
+			return 1;
+		}
+	}
+
+	if(!Opt.szScene || !Opt.dwWidth || !Opt.dwHeight)
+	{
+		Print_Usage();
+		return 1;
+	}
+
+	//one file per frame, the name needs the frame number
+	if(Opt.szOut && !Frame_Name_Valid(Opt.szOut))
+	{
+		printf("-out needs one frame number (%%d or %%04d) in the name and no other %%, for example frame%%04d.ppm\n");
+		return 1;
+	}
+
+	const char *szNames[4] = { Opt.szOut, Opt.szRecord, Opt.szCapture, Opt.szRoot };
+	for(int n = 0; n < 4; n++)
+	{
+		if(szNames[n] && strlen(szNames[n]) > HEADLESS_MAX_NAME)
+		{
+			printf("%.40s... is too long, file names have at most %d characters\n", szNames[n], HEADLESS_MAX_NAME);
+			return 1;
+		}
+	}
+
+	bool bOk = true;
+
+	if(!strcmp(Opt.szScene, "all"))
+	{
+		Opt.bPrefix = true;
+		for(int s = 0; s < Scene_Count(); s++)
+			bOk &= Run_Scene(Scene_Get(s), &Opt);
+	}
+	else
+	{
+		const scene_desc *pDesc = Scene_Find(Opt.szScene);
+		if(!pDesc)
+		{
+			printf("no scene %s, -list shows the scenes\n", Opt.szScene);
+			return 1;
+		}
+
+		bOk = Run_Scene(pDesc, &Opt);
+	}
+
+	Frame_Arena_Local_Destroy();
+
+	return bOk ? 0 : 1;
+}
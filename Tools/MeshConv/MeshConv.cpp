@@ -0,0 +1,156 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Platform.h"
+#include "Mesh.h"
+#include "MeshImport.h"
+#include "MeshOptimize.h"
+#include "SoftDevice.h"
+
+//converts an OBJ or PLY file into the mesh file the programs map
+//(Mesh.h), or shows what is in a mesh file. The triangles and vertices
+//are put in the order of MeshOptimize.h, -keeporder writes them as they
+//are in the file:
+//
+//  MeshConv bunny.obj bunny.mesh
+//  MeshConv -keeporder bunny.obj bunny_unordered.mesh
+//  MeshConv -info bunny.mesh
+
+static void Print_Usage()
+{
+	printf("MeshConv [-keeporder] <input.obj|input.ply> <output.mesh>\n"
+		"MeshConv -info <file.mesh>\n");
+}
+
+static void Print_Header(const mesh_header *pHeader)
+{
+	printf("vertices   %u, %u bytes each at %u\n", (unsigned)pHeader->dwVertexCount,
+		(unsigned)pHeader->dwVertexStride, (unsigned)pHeader->dwVertexOffset);
+	printf("triangles  %u, %u bit indices at %u\n", (unsigned)(pHeader->dwIndexCount / 3),
+		(unsigned)pHeader->dwIndexSize * 8, (unsigned)pHeader->dwIndexOffset);
+	printf("box        %g %g %g - %g %g %g\n",
+		pHeader->BoxMin.x, pHeader->BoxMin.y, pHeader->BoxMin.z,
+		pHeader->BoxMax.x, pHeader->BoxMax.y, pHeader->BoxMax.z);
+	printf("sphere     %g %g %g radius %g\n",
+		pHeader->Center.x, pHeader->Center.y, pHeader->Center.z, pHeader->fRadius);
+	printf("file       %.2f MB%s\n", pHeader->dwFileSize / (1024.0 * 1024.0),
+		(pHeader->dwFlags & MESH_OPTIMIZED) ? ", optimized" : "");
+}
+
+//vertices transformed per triangle with the cache of CSoftDevice
+static void Print_ACMR(const char *szWhat, const void *pIndices, DWORD dwIndexSize, DWORD dwIndexCount)
+{
+	printf("ACMR %-6s %.3f with %u vertices cached\n", szWhat,
+		Mesh_ACMR(pIndices, dwIndexSize, dwIndexCount, SOFT_VERTEX_CACHE), (unsigned)SOFT_VERTEX_CACHE);
+}
+
+//the 16 bit draws of a mesh with 32 bit indices (Mesh_Draw())
+static void Print_Batches(const mesh *pMesh)
+{
+	if(!pMesh->pBatches)
+		return;
+
+	printf("batches    %u of 16 bit indices, %u vertices copied\n",
+		(unsigned)pMesh->dwBatchCount, (unsigned)pMesh->dwBatchCopies);
+}
+
+static int Show_Info(const char *szFilename)
+{
+	LONGLONG Start = Timer_Ticks();
+
+	mesh Mesh;
+	if(FAILED(Mesh_Open(&Mesh, szFilename)))
+	{
+		printf("%s is not a mesh file of version %u\n", szFilename, (unsigned)MESH_VERSION);
+		return 1;
+	}
+
+	double OpenMs = Timer_Seconds(Timer_Ticks() - Start) * 1000.0;
+
+	Print_Header(Mesh.pHeader);
+	Print_Batches(&Mesh);
+	Print_ACMR("order", Mesh.pIndices, Mesh.pHeader->dwIndexSize, Mesh.pHeader->dwIndexCount);
+	printf("opened in  %.3f ms\n", OpenMs);
+
+	Mesh_Close(&Mesh);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc == 3 && !strcmp(argv[1], "-info"))
+		return Show_Info(argv[2]);
+
+	bool bKeepOrder = argc == 4 && !strcmp(argv[1], "-keeporder");
+	const char *szIn = argv[argc - 2];
+	const char *szOut = argv[argc - 1];
+
+	if((argc != 3 && !bKeepOrder) || szIn[0] == '-')
+	{
+		Print_Usage();
+		return 1;
+	}
+
+	LONGLONG Start = Timer_Ticks();
+
+	mesh_data Data;
+	HRESULT hr = Mesh_Import(szIn, &Data);
+	if(FAILED(hr))
+	{
+		printf("can not import %s%s\n", szIn, hr == E_OUTOFMEMORY ? ", out of memory" : "");
+		return 1;
+	}
+
+	double ImportMs = Timer_Seconds(Timer_Ticks() - Start) * 1000.0;
+	double OptimizeMs = 0.0;
+
+	if(!bKeepOrder)
+	{
+		Print_ACMR("before", Data.pIndices, sizeof(DWORD), Data.dwIndexCount);
+
+		Start = Timer_Ticks();
+		hr = Mesh_Optimize(Data.pVertices, Data.dwVertexCount, Data.pIndices, Data.dwIndexCount);
+		OptimizeMs = Timer_Seconds(Timer_Ticks() - Start) * 1000.0;
+
+		if(FAILED(hr))
+		{
+			printf("can not optimize %s, out of memory\n", szIn);
+			Mesh_Data_Free(&Data);
+			return 1;
+		}
+
+		Print_ACMR("after", Data.pIndices, sizeof(DWORD), Data.dwIndexCount);
+	}
+
+	Start = Timer_Ticks();
+
+	hr = Mesh_Write(szOut, Data.pVertices, Data.dwVertexCount, Data.pIndices, Data.dwIndexCount,
+		bKeepOrder ? 0 : MESH_OPTIMIZED);
+	Mesh_Data_Free(&Data);
+
+	if(FAILED(hr))
+	{
+		printf("can not write %s\n", szOut);
+		return 1;
+	}
+
+	double WriteMs = Timer_Seconds(Timer_Ticks() - Start) * 1000.0;
+
+	mesh Mesh;
+	if(FAILED(Mesh_Open(&Mesh, szOut)))
+	{
+		printf("%s can not be read back\n", szOut);
+		return 1;
+	}
+
+	Print_Header(Mesh.pHeader);
+	Print_Batches(&Mesh);
+	printf("imported in %.1f ms, optimized in %.1f ms, written in %.1f ms\n", ImportMs, OptimizeMs, WriteMs);
+
+	Mesh_Close(&Mesh);
+	return 0;
+}
@@ -0,0 +1,448 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "Bitmap.h"
+#include "RenderStats.h"
+#include "Scenes.h"
+#include "ImageWriter.h"
+
+//golden image regression of the sample scenes. Every scene is drawn at
+//a few fixed angles and compared with Golden/<sample>_<n>.ppm, then
+//timed for a number of frames at the timing size:
+//
+//  Regress                          check all scenes
+//  Regress -scene 004 -diff out     check one scene, write the images that fail
+//  Regress -update                  write new golden images
+//  Regress -timing now.txt          save the frame times
+//  Regress -baseline now.txt        fail when a scene got slower
+//
+//run it from the root of the repository or give -root and -golden
+
+//golden images are small so the repository stays small
+#define REGRESS_WIDTH	128
+#define REGRESS_HEIGHT	96
+
+static const float g_Angles[] = { 0.0f, 0.7f, 2.3f };
+#define REGRESS_ANGLES (sizeof(g_Angles) / sizeof(g_Angles[0]))
+
+#define REGRESS_MAX_SCENES 64
+
+//-golden and -diff are directories, the image names after them still
+//fit in REGRESS_MAX_PATH
+#define REGRESS_MAX_DIR		200
+#define REGRESS_MAX_PATH	260
+
+struct regress_options
+{
+	const char *szScene;
+	const char *szRoot;
+	const char *szGolden;
+	const char *szDiff;
+	const char *szTiming;
+	const char *szBaseline;
+	bool bUpdate;
+	DWORD dwTolerance;		//largest difference of a channel that is still equal
+	float fMaxBad;			//percent of the pixels allowed over the tolerance
+	float fSlower;			//percent a scene may be slower than the baseline
+	DWORD dwFrames;
+	DWORD dwWidth;
+	DWORD dwHeight;
+};
+
+struct regress_result
+{
+	const scene_desc *pDesc;
+	bool bImageOk;
+	DWORD dwWorst;			//largest channel difference of all angles
+	DWORD dwBad;			//pixels over the tolerance, all angles
+	double FrameMs;
+	double BaselineMs;		//0 when the baseline has no such scene
+};
+
+static void Print_Usage()
+{
+	printf("Regress [-scene <001..010|all>] [-root dir] [-golden dir] [-update]\n"
+		"        [-tolerance N] [-maxbad percent] [-diff dir]\n"
+		"        [-frames N] [-width W] [-height H]\n"
+		"        [-timing file] [-baseline file] [-slower percent]\n");
+}
+
+//scene number, the golden images and timing files use it
+static void Short_Name(const scene_desc *pDesc, char *szShort)
+{
+	sprintf(szShort, "%.3s", pDesc->szName);
+}
+
+//the triangle of 001 does not turn, one angle is enough
+static DWORD Angle_Count(const scene_desc *pDesc)
+{
+	return (pDesc->dwFlags & SCENE_TRIANGLE) ? 1 : REGRESS_ANGLES;
+}
+
+//every angle gets a new scene: 009 never clears its Z buffer, so
+//the image would depend on the frames drawn before
+static bool Render_Angle(const scene_desc *pDesc, const char *szRoot, float Angle, DWORD *pPixels)
+{
+	scene Scene;
+	if(FAILED(Scene_Init(&Scene, pDesc, REGRESS_WIDTH, REGRESS_HEIGHT, szRoot)))
+		return false;
+
+	Scene_Render(&Scene, Angle);
+	Scene.pDevice->Present(pPixels, REGRESS_WIDTH * sizeof(DWORD), NULL);
+
+	Scene_Release(&Scene);
+	Stats_End_Frame();
+
+	return true;
+}
+
+static DWORD Channel_Diff(DWORD dwA, DWORD dwB, int Shift)
+{
+	int a = (dwA >> Shift) & 0xff;
+	int b = (dwB >> Shift) & 0xff;
+	return (DWORD)(a > b ? a - b : b - a);
+}
+
+//compares with the golden image, pDiff gets the difference scaled up
+//so small errors are visible, red where the pixel is over the tolerance
+static void Compare(const DWORD *pImage, const DWORD *pGolden, DWORD dwTolerance,
+			DWORD *pDiff, DWORD *pdwWorst, DWORD *pdwBad)
+{
+	for(DWORD i = 0; i < REGRESS_WIDTH * REGRESS_HEIGHT; i++)
+	{
+		DWORD dwMax = Channel_Diff(pImage[i], pGolden[i], 16);
+		DWORD dwG = Channel_Diff(pImage[i], pGolden[i], 8);
+		DWORD dwB = Channel_Diff(pImage[i], pGolden[i], 0);
+		if(dwG > dwMax)
+			dwMax = dwG;
+		if(dwB > dwMax)
+			dwMax = dwB;
+
+		if(dwMax > *pdwWorst)
+			*pdwWorst = dwMax;
+
+		if(dwMax > dwTolerance)
+		{
+			(*pdwBad)++;
+			pDiff[i] = 0x00ff0000;
+		}
+		else
+		{
+			DWORD dwGray = dwMax * 16 > 255 ? 255 : dwMax * 16;
+			pDiff[i] = dwGray * 0x00010101;
+		}
+	}
+}
+
+static bool Check_Images(const scene_desc *pDesc, const regress_options *pOpt, regress_result *pResult)
+{
+	DWORD *pImage = new(std::nothrow) DWORD[REGRESS_WIDTH * REGRESS_HEIGHT];
+	DWORD *pDiff = new(std::nothrow) DWORD[REGRESS_WIDTH * REGRESS_HEIGHT];
+	if(!pImage || !pDiff)
+	{
+		delete [] pImage;
+		delete [] pDiff;
+		return false;
+	}
+
+	char szShort[8];
+	Short_Name(pDesc, szShort);
+
+	bool bOk = true;
+
+	for(DWORD a = 0; a < Angle_Count(pDesc) && bOk; a++)
+	{
+		char szGolden[REGRESS_MAX_PATH];
+		sprintf(szGolden, "%.*s/%s_%u.ppm", REGRESS_MAX_DIR, pOpt->szGolden, szShort, (unsigned)a);
+
+		if(!Render_Angle(pDesc, pOpt->szRoot, g_Angles[a], pImage))
+		{
+			printf("%s: can not load the scene (texture in %s?)\n", pDesc->szName, pOpt->szRoot);
+			bOk = false;
+			break;
+		}
+
+		if(pOpt->bUpdate)
+		{
+			if(!Write_PPM(szGolden, pImage, REGRESS_WIDTH, REGRESS_HEIGHT, REGRESS_WIDTH * sizeof(DWORD)))
+			{
+				printf("%s: can not write %s\n", pDesc->szName, szGolden);
+				bOk = false;
+			}
+			continue;
+		}
+
+		bitmap Golden;
+		if(!Bitmap_Load_PPM(szGolden, &Golden))
+		{
+			printf("%s: no golden image %s (-update writes it)\n", pDesc->szName, szGolden);
+			bOk = false;
+			break;
+		}
+
+		if(Golden.dwWidth != REGRESS_WIDTH || Golden.dwHeight != REGRESS_HEIGHT)
+		{
+			printf("%s: %s is %ux%u, not %ux%u\n", pDesc->szName, szGolden,
+				(unsigned)Golden.dwWidth, (unsigned)Golden.dwHeight, REGRESS_WIDTH, REGRESS_HEIGHT);
+			Bitmap_Free(&Golden);
+			bOk = false;
+			break;
+		}
+
+		DWORD dwBad = 0;
+		Compare(pImage, Golden.pBits, pOpt->dwTolerance, pDiff, &pResult->dwWorst, &dwBad);
+		Bitmap_Free(&Golden);
+
+		pResult->dwBad += dwBad;
+
+		bool bAngleOk = dwBad * 100.0f <= pOpt->fMaxBad * REGRESS_WIDTH * REGRESS_HEIGHT;
+		if(!bAngleOk && pOpt->szDiff)
+		{
+			char szFilename[REGRESS_MAX_PATH];
+			sprintf(szFilename, "%.*s/%s_%u.ppm", REGRESS_MAX_DIR, pOpt->szDiff, szShort, (unsigned)a);
+			Write_PPM(szFilename, pImage, REGRESS_WIDTH, REGRESS_HEIGHT, REGRESS_WIDTH * sizeof(DWORD));
+			sprintf(szFilename, "%.*s/%s_%u_diff.ppm", REGRESS_MAX_DIR, pOpt->szDiff, szShort, (unsigned)a);
+			Write_PPM(szFilename, pDiff, REGRESS_WIDTH, REGRESS_HEIGHT, REGRESS_WIDTH * sizeof(DWORD));
+		}
+
+		bOk = bAngleOk;
+	}
+
+	delete [] pImage;
+	delete [] pDiff;
+
+	return bOk;
+}
+
+//average time of a frame at the timing size, the cube turns as in Headless
+static bool Time_Frames(const scene_desc *pDesc, const regress_options *pOpt, double *pMs)
+{
+	scene Scene;
+	if(FAILED(Scene_Init(&Scene, pDesc, pOpt->dwWidth, pOpt->dwHeight, pOpt->szRoot)))
+		return false;
+
+	//a few frames so the caches and the memory are warm
+	for(DWORD i = 0; i < 4; i++)
+		Scene_Render(&Scene, 0.0f);
+
+	LONGLONG Start = Timer_Ticks();
+
+	for(DWORD i = 0; i < pOpt->dwFrames; i++)
+	{
+		Scene_Render(&Scene, (PI / 100.0f) * (float)i);
+		Stats_End_Frame();
+	}
+
+	double Seconds = Timer_Seconds(Timer_Ticks() - Start);
+
+	Scene_Release(&Scene);
+
+	*pMs = pOpt->dwFrames ? Seconds * 1000.0 / pOpt->dwFrames : 0.0;
+	return true;
+}
+
+//timing file: one line per scene, "004 1.234" (ms per frame)
+static double Find_Baseline(const char *szFilename, const scene_desc *pDesc)
+{
+	FILE *pFile = fopen(szFilename, "rt");
+	if(!pFile)
+		return 0.0;
+
+	char szShort[8];
+	Short_Name(pDesc, szShort);
+
+	double Ms = 0.0;
+	char szName[64];
+	double Value;
+	while(fscanf(pFile, "%63s %lf", szName, &Value) == 2)
+	{
+		if(!strcmp(szName, szShort))
+		{
+			Ms = Value;
+			break;
+		}
+	}
+
+	fclose(pFile);
+	return Ms;
+}
+
+int main(int argc, char *argv[])
+{
+	regress_options Opt;
+	Opt.szScene = "all";
+	Opt.szRoot = ".";
+	Opt.szGolden = "Tools/Regress/Golden";
+	Opt.szDiff = NULL;
+	Opt.szTiming = NULL;
+	Opt.szBaseline = NULL;
+	Opt.bUpdate = false;
+	Opt.dwTolerance = 4;
+	Opt.fMaxBad = 0.5f;
+	Opt.fSlower = 20.0f;
+	Opt.dwFrames = 100;
+	Opt.dwWidth = 640;
+	Opt.dwHeight = 480;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool bValue = i + 1 < argc;
+
+		if(!strcmp(argv[i], "-update"))
+			Opt.bUpdate = true;
+		else if(!strcmp(argv[i], "-scene") && bValue)
+			Opt.szScene = argv[++i];
+		else if(!strcmp(argv[i], "-root") && bValue)
+			Opt.szRoot = argv[++i];
+		else if(!strcmp(argv[i], "-golden") && bValue)
+			Opt.szGolden = argv[++i];
+		else if(!strcmp(argv[i], "-diff") && bValue)
+			Opt.szDiff = argv[++i];
+		else if(!strcmp(argv[i], "-timing") && bValue)
+			Opt.szTiming = argv[++i];
+		else if(!strcmp(argv[i], "-baseline") && bValue)
+			Opt.szBaseline = argv[++i];
+		else if(!strcmp(argv[i], "-tolerance") && bValue)
+			Opt.dwTolerance = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-maxbad") && bValue)
+			Opt.fMaxBad = (float)atof(argv[++i]);
+		else if(!strcmp(argv[i], "-slower") && bValue)
+			Opt.fSlower = (float)atof(argv[++i]);
+		else if(!strcmp(argv[i], "-frames") && bValue)
+			Opt.dwFrames = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-width") && bValue)
+			Opt.dwWidth = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-height") && bValue)
+			Opt.dwHeight = (DWORD)atoi(argv[++i]);
+		else
+		{
+			Print_Usage();
+			return 1;
+		}
+	}
+
+	if(!Opt.dwWidth || !Opt.dwHeight)
+	{
+		Print_Usage();
+		return 1;
+	}
+
+	const char *szDirs[2] = { Opt.szGolden, Opt.szDiff };
+	for(int d = 0; d < 2; d++)
+	{
+		if(szDirs[d] && strlen(szDirs[d]) > REGRESS_MAX_DIR)
+		{
+			printf("%.40s... is too long, directories have at most %d characters\n", szDirs[d], REGRESS_MAX_DIR);
+			return 1;
+		}
+	}
+
+	const scene_desc *pScenes[REGRESS_MAX_SCENES];
+	int SceneCount = 0;
+
+	if(!strcmp(Opt.szScene, "all"))
+	{
+		for(int s = 0; s < Scene_Count() && s < REGRESS_MAX_SCENES; s++)
+			pScenes[SceneCount++] = Scene_Get(s);
+	}
+	else
+	{
+		pScenes[0] = Scene_Find(Opt.szScene);
+		if(!pScenes[0])
+		{
+			printf("no scene %s\n", Opt.szScene);
+			return 1;
+		}
+		SceneCount = 1;
+	}
+
+	regress_result Results[REGRESS_MAX_SCENES];
+	int Failed = 0;
+
+	for(int s = 0; s < SceneCount; s++)
+	{
+		regress_result *pResult = &Results[s];
+		ZeroMemory(pResult, sizeof(regress_result));
+		pResult->pDesc = pScenes[s];
+
+		pResult->bImageOk = Check_Images(pScenes[s], &Opt, pResult);
+
+		if(!Opt.bUpdate && Opt.dwFrames && pResult->bImageOk)
+		{
+			Time_Frames(pScenes[s], &Opt, &pResult->FrameMs);
+			if(Opt.szBaseline)
+				pResult->BaselineMs = Find_Baseline(Opt.szBaseline, pScenes[s]);
+		}
+	}
+
+	if(Opt.bUpdate)
+	{
+		for(int s = 0; s < SceneCount; s++)
+		{
+			printf("%-42s %s\n", Results[s].pDesc->szName, Results[s].bImageOk ? "written" : "FAILED");
+			if(!Results[s].bImageOk)
+				Failed++;
+		}
+
+		return Failed ? 1 : 0;
+	}
+
+	printf("%-42s %-6s %5s %6s %10s %10s %8s\n",
+		"scene", "image", "worst", "bad", "ms/frame", "baseline", "change");
+
+	for(int s = 0; s < SceneCount; s++)
+	{
+		const regress_result *pResult = &Results[s];
+
+		bool bSlow = false;
+		char szBaseline[32] = "-";
+		char szChange[32] = "-";
+		if(pResult->BaselineMs > 0.0)
+		{
+			double Change = (pResult->FrameMs / pResult->BaselineMs - 1.0) * 100.0;
+			bSlow = Change > Opt.fSlower;
+			sprintf(szBaseline, "%.3f", pResult->BaselineMs);
+			sprintf(szChange, "%+.1f%%", Change);
+		}
+
+		printf("%-42s %-6s %5u %6u %10.3f %10s %8s%s\n",
+			pResult->pDesc->szName, pResult->bImageOk ? "ok" : "FAILED",
+			(unsigned)pResult->dwWorst, (unsigned)pResult->dwBad,
+			pResult->FrameMs, szBaseline, szChange, bSlow ? " SLOWER" : "");
+
+		if(!pResult->bImageOk || bSlow)
+			Failed++;
+	}
+
+	if(Opt.szTiming)
+	{
+		FILE *pFile = fopen(Opt.szTiming, "wt");
+		if(pFile)
+		{
+			for(int s = 0; s < SceneCount; s++)
+			{
+				char szShort[8];
+				Short_Name(Results[s].pDesc, szShort);
+				fprintf(pFile, "%s %.4f\n", szShort, Results[s].FrameMs);
+			}
+			fclose(pFile);
+		}
+		else
+		{
+			printf("can not write %s\n", Opt.szTiming);
+			Failed++;
+		}
+	}
+
+	printf("%d of %d scenes failed\n", Failed, SceneCount);
+
+	return Failed ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Platform.h"
+#include "RenderStats.h"
+#include "SoftDevice.h"
+#include "DrawTrace.h"
+#include "ImageWriter.h"
+
+//plays a trace of device calls (Headless -record) on CSoftDevice as
+//fast as it can, no window and no message loop:
+//
+//  Replay 004.trc                     play once
+//  Replay 004.trc -loops 20           play 20 times, best and average time
+//  Replay 004.trc -out f%04d.png      write the frames of the first loop
+//
+//the whole trace is in memory before the clock starts, so the time is
+//the time of the device only
+
+struct replay_context
+{
+	CSoftDevice *pDevice;
+	image_writer *pWriter;
+	const char *szOut;
+	render_stats Total;
+};
+
+static void Print_Usage()
+{
+	printf("Replay file.trc [-loops N] [-out file%%04d.ppm|.png]\n");
+}
+
+static void On_Frame(void *pContext, DWORD dwFrame)
+{
+	replay_context *pReplay = (replay_context *)pContext;
+
+	if(pReplay->pWriter)
+	{
+		LONG lPitch;
+		DWORD *pPixels = Image_Writer_Acquire(pReplay->pWriter, &lPitch);
+		pReplay->pDevice->Present(pPixels, lPitch, NULL);
+
+		char szFilename[260];
+		Frame_Name(szFilename, sizeof(szFilename), pReplay->szOut, dwFrame);
+		Image_Writer_Submit(pReplay->pWriter, szFilename);
+	}
+
+	Stats_End_Frame();
+	Stats_Add(&pReplay->Total, Stats_Get_Frame());
+}
+
+int main(int argc, char *argv[])
+{
+	const char *szTrace = NULL;
+	const char *szOut = NULL;
+	DWORD dwLoops = 1;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool bValue = i + 1 < argc;
+
+		if(!strcmp(argv[i], "-loops") && bValue)
+			dwLoops = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-out") && bValue)
+			szOut = argv[++i];
+		else if(argv[i][0] != '-' && !szTrace)
+			szTrace = argv[i];
+		else
+		{
+			Print_Usage();
+			return 1;
+		}
+	}
+
+	if(!szTrace || !dwLoops)
+	{
+		Print_Usage();
+		return 1;
+	}
+
+	if(szOut && !Frame_Name_Valid(szOut))
+	{
+		printf("-out needs one frame number (%%d or %%04d) in the name and no other %%, for example frame%%04d.ppm\n");
+		return 1;
+	}
+
+	//the frame number still fits in the 260 characters of the name
+	if(szOut && strlen(szOut) > 200)
+	{
+		printf("-out %.40s... is too long, at most 200 characters\n", szOut);
+		return 1;
+	}
+
+	draw_trace *pTrace = Draw_Trace_Load(szTrace);
+	if(!pTrace)
+	{
+		printf("can not read %s or it is not a trace\n", szTrace);
+		return 1;
+	}
+
+	const draw_trace_header *pHeader = Draw_Trace_Header(pTrace);
+
+	replay_context Replay;
+	ZeroMemory(&Replay, sizeof(replay_context));
+	Replay.szOut = szOut;
+
+	if(FAILED(Create_Soft_Device(pHeader->dwWidth, pHeader->dwHeight, pHeader->dwZBuffer != 0, &Replay.pDevice)))
+	{
+		printf("can not create a %ux%u device\n", (unsigned)pHeader->dwWidth, (unsigned)pHeader->dwHeight);
+		Draw_Trace_Free(pTrace);
+		return 1;
+	}
+
+	Stats_End_Frame();
+
+	double Best = 0.0;
+	double Total = 0.0;
+	bool bOk = true;
+
+	for(DWORD l = 0; l < dwLoops && bOk; l++)
+	{
+		//the frames go to disk on the first loop only
+		if(l == 0 && szOut)
+			Replay.pWriter = Image_Writer_Create(pHeader->dwWidth, pHeader->dwHeight, 4);
+
+		LONGLONG Start = Timer_Ticks();
+
+		bOk = SUCCEEDED(Draw_Trace_Replay(pTrace, Replay.pDevice, On_Frame, &Replay));
+
+		double Seconds = Timer_Seconds(Timer_Ticks() - Start);
+
+		if(Replay.pWriter)
+		{
+			Image_Writer_Destroy(Replay.pWriter);
+			Replay.pWriter = NULL;
+		}
+
+		if(l == 0 || Seconds < Best)
+			Best = Seconds;
+		Total += Seconds;
+	}
+
+	if(!bOk)
+		printf("%s: replay failed\n", szTrace);
+
+	DWORD dwFrames = Draw_Trace_Frames(pTrace);
+	double Average = Total / dwLoops;
+	if(Best <= 0.0)
+		Best = 1e-9;
+
+	printf("%s: %ux%u, %u frames, %u loops\n", szTrace,
+		(unsigned)pHeader->dwWidth, (unsigned)pHeader->dwHeight,
+		(unsigned)dwFrames, (unsigned)dwLoops);
+	printf("best %.3f s  average %.3f s  %.1f frames/s  %.3f ms/frame\n",
+		Best, Average, dwFrames / Best, dwFrames ? Best * 1000.0 / dwFrames : 0.0);
+	printf("%.3f Mtri/s  %.2f Mpix/s (average of all loops)\n",
+		Replay.Total.dwTrianglesIn / Total / 1e6,
+		Replay.Total.dwFragmentsWritten / Total / 1e6);
+
+	Replay.pDevice->Release();
+	Draw_Trace_Free(pTrace);
+
+	return bOk ? 0 : 1;
+}
@@ -0,0 +1,475 @@
+//======================================================================================
+//      Ed Kurlyak 2023 DirectX 6.1
+//======================================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "Platform.h"
+#include "Math3D.h"
+#include "RenderStats.h"
+#include "Scenes.h"
+
+//one program for the variants of the samples. Every -run is a
+//configuration, a sample or a sample changed by words joined with '+':
+//
+//  Runner                                    the ten samples as they are
+//  Runner -run 002 -run 003                  hardware against software transform
+//  Runner -run 004 -run 004+lock -run 004+8bit -run 004+handle
+//  Runner -run cube -run cube+z -run tri -run color+z
+//  Runner -run 004+filter+batch -objects 1000
+//  Runner -run 002 -run 004 -mesh bunny.mesh    a mesh file instead of the cube
+//  Runner -run 004+keeporder -run 004 -mesh scan.mesh    with and without the vertex cache order
+//
+//the configurations run one after the other in rounds, each round runs
+//all of them with the same size, frames and angles, so a slow moment of
+//the machine does not hit one configuration only. Load time is
+//Scene_Init(): device, texture file and states
+//
+//run it from the root of the repository or give -root
+
+#define RUNNER_MAX_CONFIGS 32
+
+#define RUNNER_TEX_NONE		0
+#define RUNNER_TEX_24BIT	1		//002, the GDI upload of the samples
+#define RUNNER_TEX_8BIT		2		//006
+#define RUNNER_TEX_256		3		//001
+
+//what a word changes, Texture is -1 when it keeps the texture
+struct runner_word
+{
+	const char *szWord;
+	DWORD dwClear;
+	DWORD dwSet;
+	int Texture;
+	const char *szHelp;
+};
+
+#define GEOMETRY_FLAGS	(SCENE_TRIANGLE | SCENE_COLOR_CUBE)
+#define PATH_FLAGS		(SCENE_SOFT_TRANSFORM | SCENE_TEX_HANDLE)
+#define Z_FLAGS			(SCENE_ZBUFFER | SCENE_CLEAR_ZBUFFER)
+
+static const runner_word g_Words[] = {
+	{ "tri",	GEOMETRY_FLAGS,		SCENE_TRIANGLE,			-1,					"one triangle (001)" },
+	{ "cube",	GEOMETRY_FLAGS,		0,						-1,					"textured cube (002)" },
+	{ "color",	GEOMETRY_FLAGS,		SCENE_COLOR_CUBE,		RUNNER_TEX_NONE,	"vertex colors, no texture (007)" },
+	{ "hw",		PATH_FLAGS,			0,						-1,					"transform in the device (002)" },
+	{ "soft",	PATH_FLAGS,			SCENE_SOFT_TRANSFORM,	-1,					"transform on the CPU, XYZRHW (003)" },
+	{ "handle",	PATH_FLAGS,			SCENE_TEX_HANDLE,		-1,					"Direct3D2 texture handle (008)" },
+	{ "z",		Z_FLAGS,			Z_FLAGS,				-1,					"Z buffer, cleared every frame (004)" },
+	{ "zkeep",	Z_FLAGS,			SCENE_ZBUFFER,			-1,					"Z buffer, never cleared (009)" },
+	{ "noz",	Z_FLAGS,			0,						-1,					"no Z buffer" },
+	{ "gdi",	SCENE_TEX_LOCK,		0,						RUNNER_TEX_24BIT,	"24 bit texture, GDI upload (002)" },
+	{ "lock",	SCENE_TEX_LOCK,		SCENE_TEX_LOCK,			RUNNER_TEX_24BIT,	"24 bit texture, Lock() upload (005)" },
+	{ "8bit",	SCENE_TEX_LOCK,		SCENE_TEX_LOCK,			RUNNER_TEX_8BIT,	"8 bit texture, Lock() upload (006)" },
+	{ "linear",	SCENE_LINEAR_FILTER, SCENE_LINEAR_FILTER,	-1,					"bilinear texture filter" },
+	{ "point",	SCENE_LINEAR_FILTER, 0,						-1,					"point texture filter" }
+};
+
+#define RUNNER_WORDS (sizeof(g_Words) / sizeof(g_Words[0]))
+
+//the words of the draw pipeline, they go into scene_options
+static const char *g_PipelineWords[][2] = {
+	{ "filter",		"drop the state calls that change nothing" },
+	{ "batch",		"draws through CBatchDevice" },
+	{ "instance",	"grid drawn by the instancer, with -objects" },
+	{ "dirty",		"clear and present only the changed part" },
+	{ "keeporder",	"-mesh in the order of the file, not reordered on load" }
+};
+
+#define RUNNER_PIPELINE_WORDS (sizeof(g_PipelineWords) / sizeof(g_PipelineWords[0]))
+
+struct runner_config
+{
+	char szLabel[64];
+	scene_desc Desc;
+	scene_options Options;
+
+	float *pFrameMs;		//every timed frame of all rounds
+	DWORD dwFrameCount;
+	float *pLoadMs;			//every load of all rounds
+	DWORD dwLoadCount;
+	bool bFailed;
+};
+
+struct runner_options
+{
+	const char *szRoot;
+	DWORD dwFrames;
+	DWORD dwWarmup;
+	DWORD dwRounds;
+	DWORD dwLoads;			//Scene_Init() timed this many times per round
+	DWORD dwWidth;
+	DWORD dwHeight;
+	DWORD dwObjects;
+	const char *szMesh;
+};
+
+static void Print_Usage()
+{
+	printf("Runner [-run config]... [-frames N] [-warmup N] [-rounds N] [-loads N]\n"
+		"       [-width W] [-height H] [-objects N] [-mesh file.mesh] [-root dir]\n"
+		"config is a sample (001..010) and/or words joined with '+', 004+8bit, cube+soft+z\n");
+
+	for(DWORD i = 0; i < RUNNER_WORDS; i++)
+		printf("  %-8s %s\n", g_Words[i].szWord, g_Words[i].szHelp);
+
+	for(DWORD i = 0; i < RUNNER_PIPELINE_WORDS; i++)
+		printf("  %-8s %s\n", g_PipelineWords[i][0], g_PipelineWords[i][1]);
+}
+
+//the sample directory the texture is read from
+static const char *Texture_Dir(int Texture)
+{
+	switch(Texture)
+	{
+		case RUNNER_TEX_8BIT: return Scene_Find("006")->szName;
+		case RUNNER_TEX_256: return Scene_Find("001")->szName;
+	}
+
+	return Scene_Find("002")->szName;
+}
+
+static const char *Texture_File(int Texture)
+{
+	switch(Texture)
+	{
+		case RUNNER_TEX_8BIT: return "texture8.bmp";
+		case RUNNER_TEX_256: return "texture256.bmp";
+		case RUNNER_TEX_24BIT: return "texture24.bmp";
+	}
+
+	return NULL;
+}
+
+static bool Apply_Pipeline_Word(const char *szWord, scene_options *pOptions)
+{
+	if(!strcmp(szWord, "filter"))
+		pOptions->bFilter = true;
+	else if(!strcmp(szWord, "batch"))
+		pOptions->bBatch = true;
+	else if(!strcmp(szWord, "instance"))
+		pOptions->bInstance = true;
+	else if(!strcmp(szWord, "dirty"))
+		pOptions->bDirty = true;
+	else if(!strcmp(szWord, "keeporder"))
+		pOptions->bKeepOrder = true;
+	else
+		return false;
+
+	return true;
+}
+
+//a sample number first takes that sample, else the words change the
+//textured cube of 002
+static bool Parse_Config(const char *szSpec, runner_config *pConfig)
+{
+	ZeroMemory(pConfig, sizeof(runner_config));
+	strncpy(pConfig->szLabel, szSpec, sizeof(pConfig->szLabel) - 1);
+
+	char szWords[256];
+	strncpy(szWords, szSpec, sizeof(szWords) - 1);
+	szWords[sizeof(szWords) - 1] = 0;
+
+	DWORD dwFlags = SCENE_LINEAR_FILTER;
+	int Texture = RUNNER_TEX_24BIT;
+
+	char *szWord = strtok(szWords, "+");
+	if(szWord && szWord[0] >= '0' && szWord[0] <= '9')
+	{
+		const scene_desc *pDesc = Scene_Find(szWord);
+		if(!pDesc)
+		{
+			printf("no scene %s\n", szWord);
+			return false;
+		}
+
+		dwFlags = pDesc->dwFlags;
+		Texture = !pDesc->szTexture ? RUNNER_TEX_NONE :
+			!strcmp(pDesc->szTexture, "texture8.bmp") ? RUNNER_TEX_8BIT :
+			!strcmp(pDesc->szTexture, "texture256.bmp") ? RUNNER_TEX_256 : RUNNER_TEX_24BIT;
+
+		szWord = strtok(NULL, "+");
+	}
+
+	for(; szWord; szWord = strtok(NULL, "+"))
+	{
+		if(Apply_Pipeline_Word(szWord, &pConfig->Options))
+			continue;
+
+		DWORD i;
+		for(i = 0; i < RUNNER_WORDS; i++)
+		{
+			if(!strcmp(szWord, g_Words[i].szWord))
+				break;
+		}
+
+		if(i == RUNNER_WORDS)
+		{
+			printf("%s: unknown word %s\n", szSpec, szWord);
+			return false;
+		}
+
+		dwFlags = (dwFlags & ~g_Words[i].dwClear) | g_Words[i].dwSet;
+		if(g_Words[i].Texture >= 0)
+			Texture = g_Words[i].Texture;
+	}
+
+	//the color cube has no texture, the others need one
+	if(dwFlags & SCENE_COLOR_CUBE)
+		Texture = RUNNER_TEX_NONE;
+	else if(Texture == RUNNER_TEX_NONE)
+		Texture = RUNNER_TEX_24BIT;
+
+	if((dwFlags & SCENE_TRIANGLE) && (dwFlags & PATH_FLAGS))
+	{
+		printf("%s: the triangle is drawn only with the device transform\n", szSpec);
+		return false;
+	}
+
+	if((dwFlags & SCENE_COLOR_CUBE) && (dwFlags & PATH_FLAGS))
+	{
+		printf("%s: the color cube is drawn only with the device transform\n", szSpec);
+		return false;
+	}
+
+	pConfig->Desc.szName = Texture_Dir(Texture);
+	pConfig->Desc.dwFlags = dwFlags;
+	pConfig->Desc.szTexture = Texture_File(Texture);
+	pConfig->Desc.fCamZ = (dwFlags & SCENE_TRIANGLE) ? -8.0f : -15.0f;
+	pConfig->Desc.fFov = PI / 2.0f;
+
+	return true;
+}
+
+//one round of one configuration: dwLoads loads, then the frames of the
+//last load are timed one by one
+static bool Run_Config(runner_config *pConfig, const runner_options *pOpt)
+{
+	scene Scene;
+
+	for(DWORD l = 0; l < pOpt->dwLoads; l++)
+	{
+		LONGLONG Start = Timer_Ticks();
+		HRESULT hr = Scene_Init(&Scene, &pConfig->Desc, pOpt->dwWidth, pOpt->dwHeight,
+			pOpt->szRoot, &pConfig->Options);
+		double Seconds = Timer_Seconds(Timer_Ticks() - Start);
+
+		if(FAILED(hr))
+		{
+			printf("%s: Scene_Init failed 0x%08x\n", pConfig->szLabel, (unsigned)hr);
+			return false;
+		}
+
+		pConfig->pLoadMs[pConfig->dwLoadCount++] = (float)(Seconds * 1000.0);
+
+		if(l + 1 < pOpt->dwLoads)
+			Scene_Release(&Scene);
+	}
+
+	for(DWORD i = 0; i < pOpt->dwWarmup; i++)
+	{
+		Scene_Render(&Scene, 0.0f);
+		Stats_End_Frame();
+	}
+
+	for(DWORD i = 0; i < pOpt->dwFrames; i++)
+	{
+		LONGLONG Start = Timer_Ticks();
+		Scene_Render(&Scene, (PI / 100.0f) * (float)i);
+		double Seconds = Timer_Seconds(Timer_Ticks() - Start);
+
+		Stats_End_Frame();
+
+		pConfig->pFrameMs[pConfig->dwFrameCount++] = (float)(Seconds * 1000.0);
+	}
+
+	Scene_Release(&Scene);
+
+	return true;
+}
+
+static int Compare_Float(const void *pA, const void *pB)
+{
+	float a = *(const float *)pA;
+	float b = *(const float *)pB;
+
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
+//percent of the sorted values, 50 is the median
+static float Percentile(const float *pSorted, DWORD dwCount, DWORD dwPercent)
+{
+	if(!dwCount)
+		return 0.0f;
+
+	DWORD dwIndex = (dwCount - 1) * dwPercent / 100;
+	return pSorted[dwIndex];
+}
+
+static double Average(const float *pValues, DWORD dwCount)
+{
+	if(!dwCount)
+		return 0.0;
+
+	double Sum = 0.0;
+	for(DWORD i = 0; i < dwCount; i++)
+		Sum += pValues[i];
+
+	return Sum / dwCount;
+}
+
+static void Print_Table(runner_config *pConfigs, int ConfigCount)
+{
+	printf("%-28s %9s %9s %9s %9s %9s %8s %8s\n",
+		"config", "load ms", "frame ms", "median", "p95", "max", "fps", "vs 1st");
+
+	double FirstMs = 0.0;
+
+	for(int c = 0; c < ConfigCount; c++)
+	{
+		runner_config *pConfig = &pConfigs[c];
+		if(pConfig->bFailed)
+		{
+			printf("%-28s FAILED\n", pConfig->szLabel);
+			continue;
+		}
+
+		//the median load, the first one may wait for the disk
+		qsort(pConfig->pLoadMs, pConfig->dwLoadCount, sizeof(float), Compare_Float);
+		float LoadMs = Percentile(pConfig->pLoadMs, pConfig->dwLoadCount, 50);
+
+		double FrameMs = Average(pConfig->pFrameMs, pConfig->dwFrameCount);
+		qsort(pConfig->pFrameMs, pConfig->dwFrameCount, sizeof(float), Compare_Float);
+
+		char szChange[32] = "-";
+		if(FirstMs > 0.0)
+			sprintf(szChange, "%+.1f%%", (FrameMs / FirstMs - 1.0) * 100.0);
+		else
+			FirstMs = FrameMs;
+
+		printf("%-28s %9.3f %9.3f %9.3f %9.3f %9.3f %8.1f %8s\n",
+			pConfig->szLabel, LoadMs, FrameMs,
+			Percentile(pConfig->pFrameMs, pConfig->dwFrameCount, 50),
+			Percentile(pConfig->pFrameMs, pConfig->dwFrameCount, 95),
+			pConfig->dwFrameCount ? pConfig->pFrameMs[pConfig->dwFrameCount - 1] : 0.0f,
+			FrameMs > 0.0 ? 1000.0 / FrameMs : 0.0, szChange);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	runner_options Opt;
+	Opt.szRoot = ".";
+	Opt.dwFrames = 200;
+	Opt.dwWarmup = 4;
+	Opt.dwRounds = 3;
+	Opt.dwLoads = 3;
+	Opt.dwWidth = 640;
+	Opt.dwHeight = 480;
+	Opt.dwObjects = 0;
+	Opt.szMesh = NULL;
+
+	const char *szSpecs[RUNNER_MAX_CONFIGS];
+	int ConfigCount = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool bValue = i + 1 < argc;
+
+		if(!strcmp(argv[i], "-run") && bValue)
+		{
+			if(ConfigCount == RUNNER_MAX_CONFIGS)
+			{
+				printf("at most %d configurations\n", RUNNER_MAX_CONFIGS);
+				return 1;
+			}
+			szSpecs[ConfigCount++] = argv[++i];
+		}
+		else if(!strcmp(argv[i], "-root") && bValue)
+			Opt.szRoot = argv[++i];
+		else if(!strcmp(argv[i], "-frames") && bValue)
+			Opt.dwFrames = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-warmup") && bValue)
+			Opt.dwWarmup = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-rounds") && bValue)
+			Opt.dwRounds = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-loads") && bValue)
+			Opt.dwLoads = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-width") && bValue)
+			Opt.dwWidth = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-height") && bValue)
+			Opt.dwHeight = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-objects") && bValue)
+			Opt.dwObjects = (DWORD)atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-mesh") && bValue)
+			Opt.szMesh = argv[++i];
+		else
+		{
+			Print_Usage();
+			return 1;
+		}
+	}
+
+	if(!Opt.dwWidth || !Opt.dwHeight || !Opt.dwRounds || !Opt.dwLoads)
+	{
+		Print_Usage();
+		return 1;
+	}
+
+	//without -run the samples as they are
+	char szSamples[RUNNER_MAX_CONFIGS][4];
+	if(!ConfigCount)
+	{
+		for(int s = 0; s < Scene_Count() && s < RUNNER_MAX_CONFIGS; s++)
+		{
+			sprintf(szSamples[s], "%.3s", Scene_Get(s)->szName);
+			szSpecs[ConfigCount++] = szSamples[s];
+		}
+	}
+
+	runner_config Configs[RUNNER_MAX_CONFIGS];
+	for(int c = 0; c < ConfigCount; c++)
+	{
+		if(!Parse_Config(szSpecs[c], &Configs[c]))
+			return 1;
+
+		Configs[c].Options.dwObjects = Opt.dwObjects;
+		Configs[c].Options.szMesh = Opt.szMesh;
+		Configs[c].pFrameMs = new(std::nothrow) float[Opt.dwFrames * Opt.dwRounds + 1];
+		Configs[c].pLoadMs = new(std::nothrow) float[Opt.dwLoads * Opt.dwRounds];
+		if(!Configs[c].pFrameMs || !Configs[c].pLoadMs)
+		{
+			printf("out of memory\n");
+			return 1;
+		}
+	}
+
+	printf("%d configurations, %u rounds of %u frames at %ux%u\n", ConfigCount,
+		(unsigned)Opt.dwRounds, (unsigned)Opt.dwFrames, (unsigned)Opt.dwWidth, (unsigned)Opt.dwHeight);
+
+	for(DWORD r = 0; r < Opt.dwRounds; r++)
+	{
+		for(int c = 0; c < ConfigCount; c++)
+		{
+			if(!Configs[c].bFailed && !Run_Config(&Configs[c], &Opt))
+				Configs[c].bFailed = true;
+		}
+	}
+
+	Print_Table(Configs, ConfigCount);
+
+	int Failed = 0;
+	for(int c = 0; c < ConfigCount; c++)
+	{
+		if(Configs[c].bFailed)
+			Failed++;
+
+		delete [] Configs[c].pFrameMs;
+		delete [] Configs[c].pLoadMs;
+	}
+
+	return Failed ? 1 : 0;
+}